@@ -240,6 +240,9 @@ extern int devel_walkio_out(const QwalkArea_t *, const int *);
 /** Modify a #QwalkArea_t according to a #DevelWalkCmd_t.            */
 extern int devel_walkl_tick(/*@null@*/QwalkArea_t *, /*@null@*/int *, DevelWalkCmd_t);
 
+/** Populate the chunk of a #QwalkArea_t under the cursor.          */
+extern int devel_walkl_cursor_chunk_populate(/*@null@*/QwalkArea_t *, /*@null@*/const int *);
+
 /** Get a #QattrList_t from a #QwalkArea_t according to coordinates. */
 /*@observer@*//*@null@*/
 extern QattrList_t *devel_walkl_loc_attr_list_get(const QwalkArea_t *, const int *)/*@*/;
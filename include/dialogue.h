@@ -147,6 +147,16 @@ typedef enum DialogueCommand_t {
 /** For conversion to and from #DIALOGUE_COMMAND_EXIT. */
 #define DIALOGUE_STRING_COMMAND_EXIT "exit"
 
+/**
+ * X-macro table of every #DialogueCommand_t used in QDL files and its string;
+ * see qreflect.h. #DIALOGUE_COMMAND_EMPTY has no string.
+ * @param[in] X: macro taking a #DialogueCommand_t and its string.
+ */
+#define DIALOGUE_COMMAND_TABLE(X) \
+	X(DIALOGUE_COMMAND_GOTO,   DIALOGUE_STRING_COMMAND_GOTO) \
+	X(DIALOGUE_COMMAND_BECOME, DIALOGUE_STRING_COMMAND_BECOME) \
+	X(DIALOGUE_COMMAND_EXIT,   DIALOGUE_STRING_COMMAND_EXIT)
+
 
 /**
  * A specific line of dialogue the player can choose to say to an NPC.
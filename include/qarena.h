@@ -0,0 +1,63 @@
+/**
+ * @file qarena.h
+ * Header file for the arena module.
+ * An arena hands out memory for many small objects sharing a single lifetime
+ * (e.g. every #QattrList_t of a #QwalkLayer_t) from a few large chunks, and
+ * frees all of it at once. Depends on stddef.h and stdbool.h.
+ */
+
+
+
+/**
+ * Number of bytes in a chunk of a #Qarena_t.
+ * Allocations larger than this get a chunk of their own.
+ */
+#define QARENA_CHUNK_SIZE 65536
+
+
+/** Chunk of memory in a #Qarena_t. */
+typedef struct QarenaChunk_t {
+	/** Chunk allocated before this one, or @c NULL. */
+	/*@null@*//*@only@*/struct QarenaChunk_t *next;
+
+	size_t size; /**< Number of bytes in @ref QarenaChunk_t.bytes.       */
+	size_t used; /**< Number of bytes handed out of the chunk so far. */
+
+	/** The memory itself, zeroed upon allocation. */
+	unsigned char bytes[];
+} QarenaChunk_t;
+
+
+/**
+ * Bump allocator whose memory is only ever freed as a whole, via
+ * qarena_destroy().
+ */
+typedef struct Qarena_t {
+	/** Chunk currently allocated from, followed by every earlier one. */
+	/*@null@*//*@only@*/QarenaChunk_t *chunks;
+
+	/**
+	 * Number of times heap memory was attached to memory of the arena (e.g.
+	 * a heap #Qdatameta_t set in an arena #QattrList_t); see
+	 * qarena_heap_note(). As long as it is 0, nothing in the arena needs to
+	 * be visited before the arena is destroyed.
+	 */
+	size_t heapc;
+} Qarena_t;
+
+
+
+/** Create an empty #Qarena_t.                           */
+extern /*@null@*//*@only@*/Qarena_t *qarena_create(void);
+
+/** Allocate zeroed memory from a #Qarena_t.             */
+extern /*@null@*//*@dependent@*/void *qarena_alloc(Qarena_t *, size_t);
+
+/** Note that heap memory hangs off a #Qarena_t.         */
+extern void qarena_heap_note(Qarena_t *);
+
+/** Tell whether no heap memory hangs off a #Qarena_t.   */
+extern bool qarena_isclean(const Qarena_t *)/*@*/;
+
+/** Free a #Qarena_t along with everything allocated from it. */
+extern void qarena_destroy(/*@only@*/Qarena_t *);
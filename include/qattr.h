@@ -2,7 +2,7 @@
  * @file qattr.h
  * Header file for the attribute module. Attributes can be used to store 
  * arbitrary data tied to a key. These keys must be defined in the enum 
- * declaration. Depends on qdefs.h.
+ * declaration. Depends on qdefs.h and stdbool.h.
  */
 
 
@@ -169,6 +169,21 @@ typedef enum QattrKey_t {
  */
 #define QATTR_STRING_KEY_UNRECOGNIZED      "KEY NOT RECOGNIZED!"
 
+/**
+ * @ingroup AttrKeyStrings
+ * X-macro table of every #QattrKey_t and its string; see qreflect.h.
+ * @param[in] X: macro taking a #QattrKey_t and its string.
+ */
+#define QATTR_KEY_TABLE(X) \
+	X(QATTR_KEY_QOBJECT_TYPE,      QATTR_STRING_KEY_QOBJECT_TYPE) \
+	X(QATTR_KEY_NAME,              QATTR_STRING_KEY_NAME) \
+	X(QATTR_KEY_DESCRIPTION_BRIEF, QATTR_STRING_KEY_DESCRIPTION_BRIEF) \
+	X(QATTR_KEY_DESCRIPTION_LONG,  QATTR_STRING_KEY_DESCRIPTION_LONG) \
+	X(QATTR_KEY_CANMOVE,           QATTR_STRING_KEY_CANMOVE) \
+	X(QATTR_KEY_QDL_FILE,          QATTR_STRING_KEY_QDL_FILE) \
+	X(QATTR_KEY_EMPTY,             QATTR_STRING_KEY_EMPTY) \
+	X(QATTR_KEY_DEBUG,             QATTR_STRING_KEY_DEBUG)
+
 
 /**
  * Type for holding attribute pairs.
@@ -181,21 +196,136 @@ typedef struct Qattr_t {
 /**
  * Type for holding a collection of attributes.
  * (e.g. for tying to an object).
+ * A list may inherit the attributes of a shared prototype, in which case it
+ * only holds those it overrides; see qattr_list_prototype_create(). Every
+ * accessor but qattr_list_key_to_index() sees the inherited attributes as
+ * following those of the list itself.
  */
 typedef struct QattrList_t {
 	size_t   count; /**< The number of #Qattr_t in the list. */
 	/*@only@*/Qattr_t *attrp; /**< The actual collection of #Qattr_t structs. */
 	size_t   index_ok; /**< The earliest index of attrp that isn't yet in use. */
+
+	/**
+	 * Number of #Qattr_t allocated to @ref QattrList_t.attrp; at least @ref
+	 * QattrList_t.count. Grows geometrically, and never shrinks, such that
+	 * adding or removing attributes seldom reallocates.
+	 */
+	size_t   capacity;
+
+	/**
+	 * Index in @ref QattrList_t.attrp of every #QattrKey_t, plus one; 0 if the
+	 * key isn't in the list. Kept alongside the order of @ref
+	 * QattrList_t.attrp, which is still the one attributes are written in.
+	 */
+	unsigned char slots[QATTR_KEY_COUNT + 1];
+
+	/**
+	 * #Qarena_t the list and its @ref QattrList_t.attrp were allocated from,
+	 * or @c NULL if they are on the heap; see qattr_list_arena_create().
+	 */
+	/*@null@*//*@dependent@*/struct Qarena_t *arena;
+
+	/**
+	 * Immutable #QattrList_t whose attributes are inherited, or @c NULL.
+	 * It must outlive the list, and never has a prototype itself.
+	 */
+	/*@null@*//*@observer@*/const struct QattrList_t *prototype;
+
+	/**
+	 * Number of attributes of @ref QattrList_t.prototype whose key isn't
+	 * overridden by the list.
+	 */
+	size_t   inheritc;
+
+	/**
+	 * #QattrStore_t mirroring the hot attributes of the list, or @c NULL;
+	 * see qattr_store_bind(). Every setter of this module keeps it in sync.
+	 */
+	/*@null@*//*@dependent@*/struct QattrStore_t *store;
+
+	/** Index of the list in @ref QattrList_t.store.                      */
+	size_t   store_index;
+
+	/**
+	 * #QATTR_KEY_BIT() of every key in the list or its prototype, such that
+	 * presence is known without a lookup; see qattr_list_key_has().
+	 */
+	unsigned long keymask;
 } QattrList_t;
 
+/** Bit of a #QattrKey_t in @ref QattrList_t.keymask and query masks.     */
+#define QATTR_KEY_BIT(key) (1ul << (unsigned) (key))
+
+/**
+ * Greatest number of #Qattr_t a #QattrList_t may hold, such that every index
+ * plus one fits in @ref QattrList_t.slots.
+ */
+#define QATTR_LIST_COUNT_MAX 254
+
+/**
+ * Dense copies of the attributes most often asked of many #QattrList_t (e.g.
+ * those of every object in a #QwalkLayer_t), one entry per list.
+ * Passes over all of the lists thus scan a few small arrays rather than
+ * chasing a pointer into each list; the lists themselves still hold every
+ * attribute, and are what the store is rebuilt from upon each change.
+ * Bitsets hold one bit per entry, #QATTR_STORE_WORD_BITS to a word.
+ */
+typedef struct QattrStore_t {
+	size_t count; /**< Number of entries in the store. */
+	size_t wordc; /**< Number of words in each bitset of the store. */
+
+	/** #QATTR_KEY_QOBJECT_TYPE of each entry, or #Q_ERRORCODE_ENUM.      */
+	/*@only@*/QobjType_t *types;
+
+	/** Bitset of the entries whose #QATTR_KEY_CANMOVE is @c true.       */
+	/*@only@*/unsigned long *canmove;
+
+	/**
+	 * Bitset of the entries having each #QattrKey_t, one after the other;
+	 * that of @c key starts at word `key * wordc`.
+	 */
+	/*@only@*/unsigned long *keybits;
+
+	/**
+	 * Bitset of the entries of each #QobjType_t, laid out like @ref
+	 * QattrStore_t.keybits.
+	 */
+	/*@only@*/unsigned long *typebits;
+
+	/** #QATTR_KEY_NAME of each entry, or @c NULL.                        */
+	/*@only@*/const char **names;
+
+	/** #QATTR_KEY_DESCRIPTION_BRIEF of each entry, or @c NULL.           */
+	/*@only@*/const char **briefs;
+} QattrStore_t;
+
+/** Number of bits in each word of the bitsets of a #QattrStore_t.       */
+#define QATTR_STORE_WORD_BITS (sizeof(unsigned long) * 8)
+
 /** Splint type for a #QattrList_t with the `/\*@only*\/` annotation. */
 typedef /*@only@*/QattrList_t *OnlyQattrListp_t;
 
+/** Declared in @ref qfile.h, which itself depends on this header. */
+struct QfileHandle_t;
+
 
 
 /** Return a newly-created attr list of a given size.                    */
 extern /*@null@*//*@partial@*/QattrList_t *qattr_list_create(size_t);
 
+/** Return a newly-created attr list of a given size in a #Qarena_t.     */
+extern /*@null@*//*@partial@*/QattrList_t *qattr_list_arena_create(
+		struct Qarena_t *, size_t);
+
+/** Return a new attr list inheriting the attributes of a prototype.   */
+extern /*@null@*//*@only@*/QattrList_t *qattr_list_prototype_create(
+		/*@observer@*/const QattrList_t *);
+
+/** Make a #QattrList_t inherit from another prototype, dropping its own. */
+extern int qattr_list_prototype_set(QattrList_t *attr_list,
+		/*@observer@*/const QattrList_t *prototype)/*@modifies attr_list@*/;
+
 /** Clone a #QattrList_t.                                                */
 /*@unused@*//*@null@*/
 extern QattrList_t *qattr_list_clone(const QattrList_t *);
@@ -216,9 +346,16 @@ extern int qattr_list_write(const QattrList_t *);
 /** Read a #QattrList_t from storage.                                    */
 extern /*@null@*//*@only@*/QattrList_t *qattr_list_read(void);
 
+/** Write a #QattrList_t to a #QfileHandle_t.                            */
+extern int qattr_list_handle_write(struct QfileHandle_t *, const QattrList_t *);
+
+/** Read a #QattrList_t from a #QfileHandle_t.                           */
+extern /*@null@*//*@only@*/QattrList_t *qattr_list_handle_read(
+		struct QfileHandle_t *);
+
 /** Return the value associated with a key in a #QattrList_t.             */
 extern /*@null@*//*@observer@*/Qdatameta_t *qattr_list_value_get(
-		/*@returned@*/const QattrList_t *, QattrKey_t)/*@*/;
+		/*@returned@*/const QattrList_t *, QattrKey_t);
 
 /** Convert a #QattrKey_t to an index in a #QattrList_t.                  */
 extern int qattr_list_key_to_index(
@@ -244,6 +381,15 @@ extern int qattr_list_attr_set(QattrList_t *, QattrKey_t, /*@only@*/Qdatameta_t
 extern int qattr_list_attr_delete(OnlyQattrListp_t *attr_listp,
 		QattrKey_t key)/*@modifies attr_listp@*/;
 
+/** Set many #QattrKey_t/#Qdatameta_t pairs in a #QattrList_t at once.     */
+extern int qattr_list_attrs_set(QattrList_t *attr_list, const QattrKey_t *keys,
+		/*@only@*/Qdatameta_t **datametas, size_t pairc)
+	/*@modifies attr_list, datametas@*/;
+
+/** Delete many #Qattr_t in a #QattrList_t at once.                        */
+extern int qattr_list_attrs_delete(QattrList_t *attr_list,
+		const QattrKey_t *keys, size_t keyc)/*@modifies attr_list@*/;
+
 /** Modify the value of an existing #QattrKey_t.                          */
 /*@unused@*/extern int qattr_list_attr_modify(QattrList_t *attr_list,
 		QattrKey_t attr_key, /*@only@*/Qdatameta_t *datameta)
@@ -256,4 +402,207 @@ extern int qattr_list_attr_delete(OnlyQattrListp_t *attr_listp,
 /*@observer@*//*@unused@*/extern char *qattr_key_to_string(QattrKey_t)/*@*/;
 
 /** Convert a `char *` to a #QattrKey_t.                                  */
-/*@unused@*/extern QattrKey_t qattr_string_to_key(const char *)/*@*/;
+/*@unused@*/extern QattrKey_t qattr_string_to_key(const char *);
+
+/** Tell whether the values of a #QattrKey_t are loaded upon first access. */
+extern bool qattr_key_iscold(QattrKey_t)/*@*/;
+
+/** Report why a typed getter such as qattr_list_bool_get() failed.        */
+extern void qattr_list_typed_get_fail(const QattrList_t *, QattrKey_t,
+		QdataType_t)/*@*/;
+
+/** Create a #QattrStore_t of a given size.                                */
+extern /*@null@*//*@only@*/QattrStore_t *qattr_store_create(size_t);
+
+/** Free a #QattrStore_t from memory.                                      */
+extern void qattr_store_destroy(/*@only@*/QattrStore_t *);
+
+/** Mirror a #QattrList_t in an entry of a #QattrStore_t.                  */
+extern int qattr_store_bind(QattrStore_t *store, size_t index,
+		QattrList_t *attr_list)/*@modifies store, attr_list@*/;
+
+/** Find every entry of a #QattrStore_t with some keys and types.          */
+extern size_t qattr_store_query(const QattrStore_t *store,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		/*@out@*/size_t *indices)/*@modifies indices@*/;
+
+/** Find the next entry of a #QattrStore_t with some keys and types.       */
+extern size_t qattr_store_query_next(const QattrStore_t *store,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		size_t start, size_t end)/*@*/;
+
+
+
+/**
+ * Get the #QdataType_t the values of a #QattrKey_t are stored as.
+ * Folds to a constant for a constant @p key.
+ * @param[in] key: relevant #QattrKey_t.
+ * @return #QdataType_t of @p key or #Q_ERRORCODE_ENUM.
+ */
+static inline QdataType_t
+qattr_key_type_get(QattrKey_t key) {
+	switch (key) {
+	case QATTR_KEY_QOBJECT_TYPE:
+		return QDATA_TYPE_QOBJECT_TYPE;
+	case QATTR_KEY_NAME:
+	case QATTR_KEY_DESCRIPTION_BRIEF:
+	case QATTR_KEY_DESCRIPTION_LONG:
+	case QATTR_KEY_QDL_FILE:
+		return QDATA_TYPE_CHAR_STRING;
+	case QATTR_KEY_CANMOVE:
+		return QDATA_TYPE_BOOL;
+	default:
+		return (QdataType_t) Q_ERRORCODE_ENUM;
+	}
+}
+
+
+/**
+ * Tell whether a #QattrList_t or its prototype has a key.
+ * Reads @ref QattrList_t.keymask only.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] key: #QattrKey_t to look up; must be a valid key.
+ * @return whether @p key is present.
+ */
+static inline bool
+qattr_list_key_has(const QattrList_t *attr_list, QattrKey_t key) {
+	return (attr_list->keymask & QATTR_KEY_BIT(key)) != 0;
+}
+
+
+/**
+ * Find the #Qdatameta_t of a key in a #QattrList_t or in its prototype.
+ * Unlike qattr_list_value_get(), a deferred #Qdatameta_t is returned as is.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] key: #QattrKey_t to look up; must be a valid key.
+ * @return #Qdatameta_t of @p key or @c NULL if it is absent.
+ */
+/*@null@*//*@observer@*/static inline const Qdatameta_t *
+qattr_list_value_peek(const QattrList_t *attr_list, QattrKey_t key) {
+	unsigned char slot;
+
+	do {
+		if ((slot = attr_list->slots[key]) != 0) {
+			return attr_list->attrp[slot - 1].valuep;
+		}
+	} while ((attr_list = attr_list->prototype) != NULL);
+
+	return NULL;
+}
+
+
+/**
+ * Get the value of a #QDATA_TYPE_BOOL key in a #QattrList_t.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] key: #QattrKey_t whose value to get, e.g. #QATTR_KEY_CANMOVE.
+ * @return value of @p key or @c false upon failure.
+ */
+static inline bool
+qattr_list_bool_get(const QattrList_t *attr_list, QattrKey_t key) {
+	const Qdatameta_t *datameta;
+
+	if ((qattr_key_type_get(key) != QDATA_TYPE_BOOL)
+			|| ((datameta = qattr_list_value_peek(attr_list, key)) == NULL)
+			|| (datameta->type != QDATA_TYPE_BOOL) || (datameta->count != 1)) {
+		qattr_list_typed_get_fail(attr_list, key, QDATA_TYPE_BOOL);
+		return false;
+	}
+	return *(const bool *) datameta->datap;
+}
+
+
+/**
+ * Get the value of a #QDATA_TYPE_QOBJECT_TYPE key in a #QattrList_t.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] key: #QattrKey_t whose value to get, e.g.
+ * #QATTR_KEY_QOBJECT_TYPE.
+ * @return value of @p key or #Q_ERRORCODE_ENUM upon failure.
+ */
+static inline QobjType_t
+qattr_list_objtype_get(const QattrList_t *attr_list, QattrKey_t key) {
+	const Qdatameta_t *datameta;
+
+	if ((qattr_key_type_get(key) != QDATA_TYPE_QOBJECT_TYPE)
+			|| ((datameta = qattr_list_value_peek(attr_list, key)) == NULL)
+			|| (datameta->type != QDATA_TYPE_QOBJECT_TYPE)
+			|| (datameta->count != 1)) {
+		qattr_list_typed_get_fail(attr_list, key, QDATA_TYPE_QOBJECT_TYPE);
+		return (QobjType_t) Q_ERRORCODE_ENUM;
+	}
+	return *(const QobjType_t *) datameta->datap;
+}
+
+
+/**
+ * Get the value of a #QDATA_TYPE_CHAR_STRING key in a #QattrList_t.
+ * A deferred value is loaded first, via qattr_list_value_get().
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] key: #QattrKey_t whose value to get, e.g. #QATTR_KEY_NAME.
+ * @return value of @p key or @c NULL upon failure.
+ */
+/*@null@*//*@observer@*/static inline const char *
+qattr_list_cstr_get(const QattrList_t *attr_list, QattrKey_t key) {
+	const Qdatameta_t *datameta;
+
+	if ((qattr_key_type_get(key) != QDATA_TYPE_CHAR_STRING)
+			|| ((datameta = qattr_list_value_peek(attr_list, key)) == NULL)
+			|| (datameta->type != QDATA_TYPE_CHAR_STRING)) {
+		qattr_list_typed_get_fail(attr_list, key, QDATA_TYPE_CHAR_STRING);
+		return NULL;
+	}
+	if ((datameta->source != NULL)
+			&& ((datameta = qattr_list_value_get(attr_list, key)) == NULL)) {
+		qattr_list_typed_get_fail(attr_list, key, QDATA_TYPE_CHAR_STRING);
+		return NULL;
+	}
+	return (const char *) datameta->datap;
+}
+
+
+/**
+ * Get the #QATTR_KEY_QOBJECT_TYPE of an entry in a #QattrStore_t.
+ * @param[in] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry; must be in range.
+ * @return #QobjType_t of the entry or #Q_ERRORCODE_ENUM if it has none.
+ */
+static inline QobjType_t
+qattr_store_type_get(const QattrStore_t *store, size_t index) {
+	return store->types[index];
+}
+
+
+/**
+ * Get the #QATTR_KEY_CANMOVE of an entry in a #QattrStore_t.
+ * @param[in] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry; must be in range.
+ * @return value of the entry, or @c false if it has none.
+ */
+static inline bool
+qattr_store_canmove_get(const QattrStore_t *store, size_t index) {
+	return ((store->canmove[index / QATTR_STORE_WORD_BITS]
+				>> (index % QATTR_STORE_WORD_BITS)) & 1ul) != 0;
+}
+
+
+/**
+ * Get the #QATTR_KEY_NAME of an entry in a #QattrStore_t.
+ * @param[in] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry; must be in range.
+ * @return name of the entry or @c NULL if it has none.
+ */
+/*@null@*//*@observer@*/static inline const char *
+qattr_store_name_get(const QattrStore_t *store, size_t index) {
+	return store->names[index];
+}
+
+
+/**
+ * Get the #QATTR_KEY_DESCRIPTION_BRIEF of an entry in a #QattrStore_t.
+ * @param[in] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry; must be in range.
+ * @return brief description of the entry or @c NULL if it has none.
+ */
+/*@null@*//*@observer@*/static inline const char *
+qattr_store_brief_get(const QattrStore_t *store, size_t index) {
+	return store->briefs[index];
+}
@@ -36,6 +36,9 @@ extern int qdefault_qwalk_layer_object_incomplete(
 		/*@reldef@*/QwalkLayer_t *layer, int index, QobjType_t
 		default_type)/*@modifies layer@*/;
 
+extern int qdefault_qwalk_layer_chunk_fill(QwalkLayer_t *layer, int y, int x,
+		QobjType_t default_type)/*@modifies layer@*/;
+
 extern int qdefault_qwalk_attr_list_attr_default(QwalkLayer_t *layer, int index,
 		QobjType_t default_type, QattrKey_t key)
 	/*@modifies layer@*//*@globals internalState@*/;
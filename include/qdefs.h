@@ -125,6 +125,19 @@ typedef enum QdataType_t {
 	QDATA_TYPE_COUNT = QDATA_TYPE_QOBJECT_TYPE
 } QdataType_t;
 
+/**
+ * X-macro table of every #QdataType_t and its string; see qreflect.h.
+ * @param[in] X: macro taking a #QdataType_t and its string.
+ */
+#define QDATA_TYPE_TABLE(X) \
+	X(QDATA_TYPE_INT,          "int") \
+	X(QDATA_TYPE_FLOAT,        "float") \
+	X(QDATA_TYPE_BOOL,         "bool") \
+	X(QDATA_TYPE_INT_STRING,   "int string") \
+	X(QDATA_TYPE_CHAR_STRING,  "char string") \
+	X(QDATA_TYPE_QWALK_AREA,   "walk area") \
+	X(QDATA_TYPE_QOBJECT_TYPE, "object type")
+
 
 /**
  * Type ID for an object belonging to any Q module.
@@ -166,6 +179,17 @@ typedef enum QobjType_t {
 /** String version of #QOBJ_TYPE_NPC_FRIENDLY. */
 #define QOBJ_STRING_TYPE_NPC_FRIENDLY "person"
 
+/**
+ * X-macro table of every #QobjType_t and its string; see qreflect.h.
+ * @param[in] X: macro taking a #QobjType_t and its string.
+ */
+#define QOBJ_TYPE_TABLE(X) \
+	X(QOBJ_TYPE_PLAYER,       QOBJ_STRING_TYPE_PLAYER) \
+	X(QOBJ_TYPE_GRASS,        QOBJ_STRING_TYPE_GRASS) \
+	X(QOBJ_TYPE_TREE,         QOBJ_STRING_TYPE_TREE) \
+	X(QOBJ_TYPE_NPC_FRIENDLY, QOBJ_STRING_TYPE_NPC_FRIENDLY) \
+	X(QOBJ_TYPE_VOID,         QOBJ_STRING_TYPE_VOID)
+
 /** @} */
 
 
@@ -178,6 +202,26 @@ typedef enum QobjType_t {
 typedef void Qdata_t;
 
 
+/**
+ * Greatest number of bytes of data a #Qdatameta_t holds inline.
+ * Covers every scalar #QdataType_t and short strings.
+ */
+#define QDATAMETA_INLINE_SIZE 16
+
+/** Storage for the inline data of a #Qdatameta_t. */
+typedef union QdatametaInline_t {
+	unsigned char bytes[QDATAMETA_INLINE_SIZE]; /**< The data itself.  */
+	long long alignment_ll; /**< Aligns @ref QdatametaInline_t.bytes.  */
+	double    alignment_d;  /**< Aligns @ref QdatametaInline_t.bytes.  */
+	void     *alignment_p;  /**< Aligns @ref QdatametaInline_t.bytes.  */
+
+	/**
+	 * Of a deferred #Qdatameta_t, which has no data to hold: string store to
+	 * resolve it into, or @c NULL for the shared one; see
+	 * qfile_qdatameta_resolve().
+	 */
+	/*@null@*//*@dependent@*/void *store;
+} QdatametaInline_t;
 
 
 /** Type for holding #Qdata_t and its size */
@@ -193,6 +237,44 @@ typedef struct Qdatameta_t {
 	size_t      count; 
 	
 	QdataType_t type;    /**< Type of the data. */
+
+	/**
+	 * Whether @c datap is a read-only view into memory owned elsewhere (e.g.
+	 * a mapped area file). Views are never freed along with the #Qdatameta_t.
+	 */
+	bool isview;
+
+	/**
+	 * Where the data of a deferred #Qdatameta_t still lies in a mapped file,
+	 * or @c NULL. A deferred #Qdatameta_t has no @c datap until
+	 * qattr_list_value_get() materializes it; see qattr_key_iscold().
+	 */
+	/*@null@*//*@observer@*/const void *source;
+
+	/**
+	 * Whether @c datap points to @ref Qdatameta_t.inline_data rather than to
+	 * memory of its own; see qdatameta_alloc(). Such a #Qdatameta_t must never
+	 * be copied by value.
+	 */
+	bool isinline;
+
+	/**
+	 * Whether the #Qdatameta_t, and any data it holds, was allocated from a
+	 * #Qarena_t; see qdatameta_arena_alloc(). Such a #Qdatameta_t is freed
+	 * along with its arena rather than by qdatameta_destroy().
+	 */
+	bool isarena;
+
+	/**
+	 * Number of owners of the #Qdatameta_t; see qdatameta_share(). It is
+	 * freed once the last of them calls qdatameta_destroy(). Data is never
+	 * written to in place, shared or not: a #QattrList_t changes a value by
+	 * replacing its #Qdatameta_t. Unused for a #Qdatameta_t in a #Qarena_t.
+	 */
+	size_t refc;
+
+	/** Storage for data of up to #QDATAMETA_INLINE_SIZE bytes. */
+	QdatametaInline_t inline_data;
 } Qdatameta_t;
 
 
@@ -201,9 +283,36 @@ typedef struct Qdatameta_t {
 /** Create a #Qdatameta_t.                    */
 extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_create(/*@keep@*//*@returned@*/Qdata_t *, QdataType_t, size_t);
 
+/** Create a #Qdatameta_t viewing other data. */
+extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_view_create(/*@observer@*/const Qdata_t *, QdataType_t, size_t);
+
+/** Create a #Qdatameta_t with room for data. */
+extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_alloc(QdataType_t, size_t);
+
+/** Create a #Qdatameta_t copying data.       */
+extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_copy_create(const Qdata_t *, QdataType_t, size_t);
+
+/** Create a deferred #Qdatameta_t.         */
+extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_deferred_create(/*@observer@*/const void *, QdataType_t, size_t);
+
+/** Declared in @ref qarena.h.               */
+struct Qarena_t;
+
+/** Create a #Qdatameta_t viewing other data in a #Qarena_t. */
+extern /*@null@*//*@dependent@*/Qdatameta_t *qdatameta_arena_view_create(struct Qarena_t *, /*@observer@*/const Qdata_t *, QdataType_t, size_t);
+
+/** Create a #Qdatameta_t with room for data in a #Qarena_t. */
+extern /*@null@*//*@dependent@*/Qdatameta_t *qdatameta_arena_alloc(struct Qarena_t *, QdataType_t, size_t);
+
+/** Create a deferred #Qdatameta_t in a #Qarena_t.           */
+extern /*@null@*//*@dependent@*/Qdatameta_t *qdatameta_arena_deferred_create(struct Qarena_t *, /*@observer@*/const void *, QdataType_t, size_t);
+
 /** Clone a #Qdatameta_t.                     */
 extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_clone(const Qdatameta_t *);
 
+/** Share a #Qdatameta_t with another owner.  */
+extern /*@null@*//*@only@*/Qdatameta_t *qdatameta_share(Qdatameta_t *);
+
 /** Destroy a #Qdatameta_t.                   */
 extern void qdatameta_destroy(/*@only@*/Qdatameta_t *);
 
@@ -223,7 +332,13 @@ extern size_t qdata_type_size_get(QdataType_t)/*@*/;
 /*@unused@*/extern /*@observer@*/char *qobj_type_to_string(QobjType_t)/*@*/;
 
 /** Convert a string to a #QobjType_t.        */
-/*@unused@*/extern QobjType_t qobj_string_to_type(const char *)/*@*/;
+/*@unused@*/extern QobjType_t qobj_string_to_type(const char *);
+
+/** Convert a #QdataType_t to a string.       */
+/*@unused@*/extern /*@observer@*/const char *qdata_type_to_string(QdataType_t)/*@*/;
+
+/** Convert a string to a #QdataType_t.       */
+/*@unused@*/extern QdataType_t qdata_string_to_type(const char *);
 
 /** Convert a @c bool to a string.            */
 /*@unused@*/extern /*@observer@*/char *bool_to_string(bool)/*@*/;
@@ -89,6 +89,9 @@ typedef enum Qerror_t {
 	/** Error for violating internal file read/write permissions.             */
 	QERROR_FILE_MODE,
 
+	/** Error for a file whose contents don't follow its expected format.    */
+	QERROR_FILE_FORMAT,
+
 	/** Error for a #Qdatameta_t whose usage is incompatible with its type.   */
 	QERROR_QDATAMETA_TYPE_INCOMPATIBLE,
 
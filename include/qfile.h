@@ -1,6 +1,7 @@
 /**
  * @file qfile.h
  * Header file for the file module of Q.
+ * Depends on stdio.h, stdbool.h, stdint.h, @ref qdefs.h and @ref qattr.h.
  */
 
 
@@ -11,6 +12,74 @@
 /** Default filename for walk_area development projects. */
 #define QFILE_DEVEL_WALK_DEFAULT "walk_area.dat"
 
+/**
+ * Suffix of the temporary file written in #QFILE_MODE_WRITE_ATOMIC.
+ * The temporary file is renamed over the target once it is complete.
+ */
+#define QFILE_ATOMIC_TMP_SUFFIX ".tmp"
+
+/** Starting capacity in bytes of the #QFILE_MODE_WRITE_ATOMIC buffer. */
+#define QFILE_ATOMIC_BUFFER_CAPACITY_INIT 4096
+
+/**
+ * Magic number opening a block file.
+ * A block file wraps the bytes of any other file in a series of blocks, which
+ * are decoded transparently upon reading.
+ */
+#define QFILE_BLOCK_MAGIC "QFILEBLK"
+
+/**
+ * Magic number opening a file written in #QFILE_MODE_WRITE_APPEND.
+ * It is followed by a series of frames, one per time the file was appended to.
+ */
+#define QFILE_APPEND_MAGIC "QFILEAPP"
+
+/** Number of bytes in #QFILE_APPEND_MAGIC, without its terminating NUL. */
+#define QFILE_APPEND_MAGIC_SIZE 8
+
+/**
+ * Size in bytes of the header of each frame of an append file: a @c uint32
+ * size, then a @c uint32 FNV-1a checksum of the bytes of the frame.
+ */
+#define QFILE_APPEND_FRAME_HEADER_SIZE 8
+
+/**
+ * #QdataType_t written in place of #QDATA_TYPE_CHAR_STRING for strings kept in
+ * the string table of a file. The type is followed by the @c size_t index of
+ * the string in the table; if the index is that of the next free entry, the
+ * string itself follows and fills it. Each distinct string is thus written
+ * once per file, the first time it is referenced. Never found outside of files,
+ * and must stay clear of every proper #QdataType_t.
+ */
+#define QFILE_QDATA_TYPE_STRING_REF ((QdataType_t) 256)
+
+/** Number of bytes in #QFILE_BLOCK_MAGIC, without its terminating NUL. */
+#define QFILE_BLOCK_MAGIC_SIZE 8
+
+/** Version of the block file format written by qfile. */
+#define QFILE_BLOCK_VERSION 1
+
+/**
+ * Size in bytes of the header of a block file: #QFILE_BLOCK_MAGIC, then a
+ * @c uint16 version, @c uint16 flags and @c uint32 block size.
+ */
+#define QFILE_BLOCK_HEADER_SIZE 16
+
+/**
+ * Size in bytes of the header of each block: a @c uint32 decoded size, then a
+ * @c uint32 stored size. A block whose sizes are equal is stored as-is.
+ */
+#define QFILE_BLOCK_SECTION_HEADER_SIZE 8
+
+/** Block file flag; blocks are compressed via qfile_block_compress(). */
+#define QFILE_BLOCK_FLAG_COMPRESSED 0x0001
+
+/**
+ * Number of decoded bytes per block in the block files qfile writes.
+ * Also the greatest block size accepted upon reading.
+ */
+#define QFILE_BLOCK_SIZE 65536
+
 
 
 /**
@@ -37,21 +106,210 @@ typedef enum QfileMode_t {
 	/** Read mode  */
 	QFILE_MODE_READ = Q_ENUM_VALUE_START, 
 	QFILE_MODE_WRITE,    /**< Write mode */
+
+	/**
+	 * Memory-mapped read mode.
+	 * The whole file is mapped upon opening and subsequent reads are decoded
+	 * from a cursor over the mapped bytes rather than through stdio.
+	 */
+	QFILE_MODE_READ_MAPPED,
+
+	/**
+	 * Buffered, atomic write mode.
+	 * Every write is serialized into memory; upon closing, the buffer is
+	 * written to a temporary file in one burst, synced, and renamed over the
+	 * target. The target thus holds either its old or its new contents, but
+	 * never a half-written mix of the two.
+	 */
+	QFILE_MODE_WRITE_ATOMIC,
+
+	/**
+	 * Buffered append mode.
+	 * Every write is serialized into memory; upon closing, the buffer is
+	 * appended to the file as one checksummed frame and synced. Readers detect
+	 * append files by themselves and see the frames back to back; a frame cut
+	 * short by a crash is taken to be the end of the file.
+	 */
+	QFILE_MODE_WRITE_APPEND,
+
 	QFILE_MODE_INACTIVE, /**< File isn't open */
 
 	/**
 	 * Number of modes.
 	 * Must be defined by final enum constant.
 	 */
-	QFILE_MODE_COUNT = QFILE_MODE_WRITE
+	QFILE_MODE_COUNT = QFILE_MODE_WRITE_APPEND
 } QfileMode_t;
 
+
+/**
+ * Whole contents of a file, detached from qfile.
+ * Lets a reader keep using the bytes of a file in place after qfile_close();
+ * namely, the mapping of a #QFILE_MODE_READ_MAPPED file is handed over as-is.
+ */
+typedef struct QfileBuffer_t {
+	/** Contents of the file. */
+	/*@observer@*/const unsigned char *data;
+	size_t size;   /**< Number of bytes in @ref QfileBuffer_t.data.        */
+	bool ismapped; /**< Whether @ref QfileBuffer_t.data must be unmapped. */
+} QfileBuffer_t;
+
+/** Slot of a #QfileStringIndex_t. */
+typedef struct QfileStringIndexSlot_t {
+	/** String owned by the caller, or @c NULL if the slot is empty. */
+	/*@null@*//*@observer@*/const char *key;
+	size_t   size;  /**< Number of bytes in @ref QfileStringIndexSlot_t.key. */
+	uint32_t hash;  /**< qfile_hash() of @ref QfileStringIndexSlot_t.key.    */
+	size_t   value; /**< Value mapped to @ref QfileStringIndexSlot_t.key.    */
+} QfileStringIndexSlot_t;
+
+/**
+ * Map from string contents to @c size_t values.
+ * Zero-initialized, it is an empty map; its memory is freed via
+ * qfile_string_index_clear().
+ */
+typedef struct QfileStringIndex_t {
+	/** Open-addressed slots. */
+	/*@null@*//*@only@*/QfileStringIndexSlot_t *slots;
+	size_t slotc; /**< Number of slots; 0 or a power of 2. */
+	size_t count; /**< Number of slots in use.              */
+} QfileStringIndex_t;
+
+/** Entry of the string table of a file being read. */
+typedef struct QfileString_t {
+	/**
+	 * String from qfile_string_intern(), or @c NULL if the entry was first
+	 * met as a deferred value and has yet to be interned.
+	 */
+	/*@null@*//*@observer@*/const char *data;
+
+	/** Where the string lies in the mapped file; used while it isn't interned. */
+	/*@null@*//*@observer@*/const char *source;
+	size_t size; /**< Number of bytes in the string. */
+} QfileString_t;
+
+/**
+ * An open file and all of its state.
+ * Handles are independent of each other; each one may be used by one thread at
+ * a time.
+ */
+typedef struct QfileHandle_t {
+	/** Underlying stream in #QFILE_MODE_READ and #QFILE_MODE_WRITE. */
+	/*@null@*/FILE *ptr;
+
+	QfileMode_t mode; /**< #QfileMode_t the file was opened in. */
+
+	/**
+	 * Bytes of the file in #QFILE_MODE_READ_MAPPED.
+	 * @c NULL in every other mode, or if the mapped file is empty.
+	 */
+	/*@null@*/unsigned char *map;
+	size_t map_size;   /**< Size in bytes of @ref QfileHandle_t.map.        */
+	size_t map_cursor; /**< Offset of the next byte to be read in the map. */
+
+	/**
+	 * Whether cold values may be left in the map, to be read upon first
+	 * access; set via qfile_handle_defer_begin().
+	 */
+	bool isdeferring;
+
+	/**
+	 * #Qarena_t that lists and values read via qattr_list_handle_read() are
+	 * allocated from, or @c NULL for the heap; set via
+	 * qfile_handle_arena_set().
+	 */
+	/*@null@*//*@dependent@*/struct Qarena_t *arena;
+
+	/**
+	 * String store that strings read are interned into, or @c NULL for the
+	 * shared one; set via qfile_handle_store_set().
+	 */
+	/*@null@*//*@dependent@*/struct QfileStringStore_t *store;
+
+	/**
+	 * Serialized contents of the file in #QFILE_MODE_WRITE_ATOMIC and
+	 * #QFILE_MODE_WRITE_APPEND. @c NULL in every other mode.
+	 */
+	/*@null@*//*@only@*/unsigned char *buf;
+	size_t buf_size;     /**< Number of bytes in use in @ref QfileHandle_t.buf. */
+	size_t buf_capacity; /**< Number of bytes allocated to @ref QfileHandle_t.buf. */
+
+	/** Target filename in #QFILE_MODE_WRITE_ATOMIC and #QFILE_MODE_WRITE_APPEND. */
+	char atomic_filename[QFILE_MAX_PATH_SIZE + 1];
+
+	/**
+	 * Whether the file is a block file.
+	 * Detected upon opening in the read modes; set via
+	 * qfile_handle_compression_set() in the write modes.
+	 */
+	bool isblock;
+
+	/**
+	 * Whether the file is an append file, read one frame at a time.
+	 * Its frames are decoded as blocks; @ref QfileHandle_t.isblock is thus
+	 * also set.
+	 */
+	bool isappend;
+
+	/**
+	 * Offset of the frame of an append file found to be torn, i.e. the size
+	 * of its intact part; 0 if no such frame has been found.
+	 */
+	size_t append_torn_offset;
+
+	/**
+	 * Decoded bytes of the current block of a block file.
+	 * Upon reading, the block last decoded; upon writing, the block being
+	 * filled. @c NULL unless @ref QfileHandle_t.isblock.
+	 */
+	/*@null@*//*@only@*/unsigned char *block;
+	size_t block_size;     /**< Number of bytes in use in @ref QfileHandle_t.block.    */
+	size_t block_cursor;   /**< Offset of the next byte to be read in the block.      */
+	size_t block_capacity; /**< Number of bytes allocated to @ref QfileHandle_t.block. */
+
+	/** Stored bytes of the current block; sized via qfile_block_bound(). */
+	/*@null@*//*@only@*/unsigned char *zblock;
+
+	/**
+	 * String table of the file being read, in order of appearance.
+	 * @c NULL until the first #QFILE_QDATA_TYPE_STRING_REF is read. Every frame
+	 * of an append file starts with an empty table, as it was written through
+	 * a handle of its own.
+	 */
+	/*@null@*//*@only@*/QfileString_t *strings;
+	size_t stringc;           /**< Number of strings in the string table.            */
+	size_t strings_capacity;  /**< Number of entries allocated to @ref QfileHandle_t.strings. */
+
+	/** Index of every string in the string table of the file being written. */
+	QfileStringIndex_t string_index;
+} QfileHandle_t;
+
+
+
+/** Open a file as a #QfileHandle_t.  */
+extern /*@null@*//*@only@*/QfileHandle_t *qfile_handle_open(const char *, QfileMode_t);
+
+/** Close a #QfileHandle_t.           */
+extern           int          qfile_handle_close(/*@only@*/QfileHandle_t *);
+
+/** Close a #QfileHandle_t, dropping what was written. */
+extern           int          qfile_handle_discard(/*@only@*/QfileHandle_t *);
+
+/** Compress what is written to a handle. */
+extern           int          qfile_handle_compression_set(QfileHandle_t *);
+
+/** Get the handle of qfile_open().   */
+extern /*@null@*//*@observer@*/QfileHandle_t *qfile_handle_default_get(void)/*@*/;
+
 /** Open a file for qfile.            */
 extern           int          qfile_open(const char *, QfileMode_t);
 
 /** Close a file for qfile.           */
 extern           int          qfile_close(void);
 
+/** Compress what is written to qfile. */
+extern           int          qfile_compression_set(void);
+
 /** Write a #Qdatameta_t to a file.   */
 extern           int          qfile_qdatameta_write(const Qdatameta_t *);
 
@@ -85,3 +343,139 @@ extern           QattrKey_t  qfile_qattr_key_read(void);
 
 /** Read a #Qdata_t from a file.      */
 extern /*@null@*/Qdata_t    *qfile_qdata_read(QdataType_t, size_t);
+
+
+/** Write raw bytes to storage.       */
+extern           int          qfile_bytes_write(const void *, size_t);
+
+/** Read raw bytes from storage.      */
+/*@unused@*/extern int        qfile_bytes_read(/*@out@*/void *, size_t);
+
+/** Peek at upcoming bytes in a file. */
+extern           size_t       qfile_bytes_peek(/*@out@*/void *, size_t);
+
+/** Detach the contents of a file.    */
+extern /*@null@*//*@only@*/QfileBuffer_t *qfile_buffer_detach(void);
+
+/** Release a #QfileBuffer_t.         */
+extern           void         qfile_buffer_release(/*@only@*/QfileBuffer_t *);
+
+
+
+/** Write a #Qdatameta_t to a handle. */
+extern           int          qfile_handle_qdatameta_write(QfileHandle_t *, const Qdatameta_t *);
+
+/** Write an @c int to a handle.      */
+/*@unused@*/extern int        qfile_handle_int_write(QfileHandle_t *, int);
+
+/** Write a @c size_t to a handle.    */
+extern           int          qfile_handle_size_write(QfileHandle_t *, size_t);
+
+/** Write a #QdataType_t to a handle. */
+extern           int          qfile_handle_qdata_type_write(QfileHandle_t *, QdataType_t);
+
+/** Write a #QattrKey_t to a handle.  */
+extern           int          qfile_handle_qattr_key_write(QfileHandle_t *, QattrKey_t);
+
+/** Read a #Qdatameta_t from a handle.*/
+extern /*@null@*/Qdatameta_t *qfile_handle_qdatameta_read(QfileHandle_t *);
+
+/** Read a possibly deferred #Qdatameta_t from a handle. */
+extern /*@null@*/Qdatameta_t *qfile_handle_qdatameta_defer_read(QfileHandle_t *);
+
+/** Let a handle leave cold values in its map. */
+extern           bool         qfile_handle_defer_begin(QfileHandle_t *);
+
+/** Have a handle read lists into a #Qarena_t. */
+extern           void         qfile_handle_arena_set(QfileHandle_t *,
+		/*@null@*//*@dependent@*/struct Qarena_t *);
+
+/** Have a handle intern strings into a store. */
+extern           void         qfile_handle_store_set(QfileHandle_t *,
+		/*@null@*//*@dependent@*/struct QfileStringStore_t *);
+
+/** Read an @c int from a handle.     */
+/*@unused@*/extern int        qfile_handle_int_read(QfileHandle_t *);
+
+/** Read a @c size_t from a handle.   */
+extern           size_t       qfile_handle_size_read(QfileHandle_t *);
+
+/** Read a #QdataType_t from a handle.*/
+extern           QdataType_t  qfile_handle_qdata_type_read(QfileHandle_t *);
+
+/** Read a #QattrKey_t from a handle. */
+extern           QattrKey_t   qfile_handle_qattr_key_read(QfileHandle_t *);
+
+/** Read a #Qdata_t from a handle.    */
+extern /*@null@*/Qdata_t     *qfile_handle_qdata_read(QfileHandle_t *, QdataType_t, size_t);
+
+/** Write raw bytes to a handle.      */
+extern           int          qfile_handle_bytes_write(QfileHandle_t *, const void *, size_t);
+
+/** Read raw bytes from a handle.     */
+extern           int          qfile_handle_bytes_read(QfileHandle_t *, /*@out@*/void *, size_t);
+
+/** Peek at upcoming bytes in a handle. */
+extern           size_t       qfile_handle_bytes_peek(QfileHandle_t *, /*@out@*/void *, size_t);
+
+/** Detach the contents of a handle.  */
+extern /*@null@*//*@only@*/QfileBuffer_t *qfile_handle_buffer_detach(QfileHandle_t *);
+
+/** Materialize a deferred #Qdatameta_t. */
+extern           int          qfile_qdatameta_resolve(Qdatameta_t *);
+
+
+
+/** Get the compressed size bound of a block. */
+extern           size_t       qfile_block_bound(size_t)/*@*/;
+
+/** Compress a block.                 */
+extern           size_t       qfile_block_compress(const unsigned char *, size_t,
+		/*@out@*/unsigned char *, size_t);
+
+/** Decompress a block.               */
+extern           int          qfile_block_decompress(const unsigned char *, size_t,
+		/*@out@*/unsigned char *, size_t);
+
+
+
+/** Create a string store.           */
+extern /*@null@*//*@only@*/struct QfileStringStore_t *qfile_string_store_create(void);
+
+/** Destroy a string store.           */
+extern           void         qfile_string_store_destroy(/*@only@*/struct QfileStringStore_t *);
+
+/** Intern a string.                  */
+extern /*@null@*//*@observer@*/const char *qfile_string_intern(
+		/*@null@*/struct QfileStringStore_t *, const char *, size_t);
+
+/** Count the strings interned.       */
+/*@unused@*/extern size_t     qfile_string_count_get(/*@null@*/struct QfileStringStore_t *);
+
+/** Look up a #QfileStringIndex_t.    */
+extern           int          qfile_string_index_get(const QfileStringIndex_t *, const char *,
+		size_t, /*@out@*/size_t *);
+
+/** Add to a #QfileStringIndex_t.     */
+extern           int          qfile_string_index_put(QfileStringIndex_t *, /*@observer@*/const char *,
+		size_t, size_t);
+
+/** Empty a #QfileStringIndex_t.      */
+extern           void         qfile_string_index_clear(QfileStringIndex_t *);
+
+
+
+/** Hash bytes via FNV-1a.            */
+extern           uint32_t     qfile_hash(const void *, size_t, uint32_t)/*@*/;
+
+/** Decode a little-endian @c uint16. */
+extern           uint16_t     qfile_u16_get(const unsigned char *)/*@*/;
+
+/** Decode a little-endian @c uint32. */
+extern           uint32_t     qfile_u32_get(const unsigned char *)/*@*/;
+
+/** Encode a little-endian @c uint16. */
+extern           void         qfile_u16_put(/*@out@*/unsigned char *, uint16_t);
+
+/** Encode a little-endian @c uint32. */
+extern           void         qfile_u32_put(/*@out@*/unsigned char *, uint32_t);
@@ -0,0 +1,80 @@
+/**
+ * @file qreflect.h
+ * Header file for the reflection module.
+ * Converts the constants of an enum to and from their string versions, given
+ * a table of those strings indexed by constant. Such tables are generated
+ * from an X-macro listing every constant with its string (e.g.
+ * #QATTR_KEY_TABLE), so that the strings can't fall out of step with the
+ * enum. Depends on stddef.h, stdint.h and stdbool.h.
+ */
+
+
+
+/**
+ * Number of slots in the perfect hash of a #Qreflect_t; a power of 2, and
+ * enough for a table of up to a quarter as many strings.
+ */
+#define QREFLECT_SLOTC_MAX 128
+
+/**
+ * Entry of an X-macro table, as a designated initializer of the string array
+ * of a #Qreflect_t.
+ * @param[in] constant: enum constant.
+ * @param[in] string: string version of @p constant.
+ */
+#define QREFLECT_STRING(constant, string) [(constant)] = (string),
+
+/**
+ * Entry of an X-macro table, as a count; `(0 TABLE(QREFLECT_ONE))` is the
+ * number of entries in TABLE.
+ * @param[in] constant: enum constant.
+ * @param[in] string: string version of @p constant.
+ */
+#define QREFLECT_ONE(constant, string) + 1
+
+/**
+ * Initializer of a #Qreflect_t.
+ * @param[in] strings: see @ref Qreflect_t.strings.
+ * @param[in] first: see @ref Qreflect_t.first.
+ * @param[in] last: see @ref Qreflect_t.last.
+ */
+#define QREFLECT_INITIALIZER(strings, first, last) \
+	{(strings), (first), (last), false, 0, 0, {0}}
+
+
+/**
+ * Reflection table of an enum.
+ * String to enum lookups go through a perfect hash of the strings, built upon
+ * the first lookup; every string then has a slot of its own, and a lookup
+ * costs a single hash and a single comparison.
+ */
+typedef struct Qreflect_t {
+	/**
+	 * String version of each enum constant, indexed by constant; @c NULL for
+	 * a constant without one.
+	 */
+	/*@observer@*/const char *const *strings;
+
+	int first; /**< Smallest enum constant in the table. */
+	int last;  /**< Greatest enum constant in the table. */
+
+	/**
+	 * Whether the perfect hash has been built; once set, lookups read it
+	 * without a lock, see qreflect_constant_get().
+	 */
+	bool     built;
+	uint32_t seed;  /**< Seed making the hash of the strings perfect. */
+	size_t   slotc; /**< Number of slots in use; a power of 2.       */
+
+	/** Perfect hash slots; each is 1 + an index of @ref Qreflect_t.strings, or 0. */
+	unsigned char slots[QREFLECT_SLOTC_MAX];
+} Qreflect_t;
+
+
+
+/** Get the string version of an enum constant.              */
+extern /*@null@*//*@observer@*/const char *qreflect_string_get(
+		const Qreflect_t *, int)/*@*/;
+
+/** Get the enum constant of a string.                       */
+extern int qreflect_constant_get(Qreflect_t *, const char *);
@@ -1,28 +1,109 @@
 /**
  * @file qwalk.h
  * qwalk module header file.
- * Depends on ncurses.h, @ref qdefs.h, @ref stdint.h, and @ref dialogue.h.
+ * Depends on ncurses.h, @ref qdefs.h, @ref stdint.h, @ref qattr.h, and @ref
+ * dialogue.h.
  */
 
 
-#define QWALK_LAYER_SIZE_Y 25  /**< Y dimension for a #QwalkLayer_t */
-#define QWALK_LAYER_SIZE_X 50  /**< X dimension for a #QwalkLayer_t */
+/**
+ * Y dimension of a raw (v1) or #QWALK_FILE_VERSION_UNCHUNKED #QwalkArea_t,
+ * which don't record their dimensions, and of a new one by default.
+ */
+#define QWALK_LAYER_SIZE_Y 25
+#define QWALK_LAYER_SIZE_X 50  /**< X counterpart of #QWALK_LAYER_SIZE_Y. */
 
-/** Area of the qwalk field */
+/** Area of a #QWALK_LAYER_SIZE_Y by #QWALK_LAYER_SIZE_X #QwalkLayer_t. */
 #define QWALK_LAYER_SIZE (QWALK_LAYER_SIZE_Y * QWALK_LAYER_SIZE_X)
 
+/**
+ * Greatest y or x dimension of a #QwalkLayer_t, as recorded in a columnar
+ * file. The area of a layer must moreover fit in an @c int.
+ */
+#define QWALK_LAYER_DIMENSION_MAX 65535
+
 /** Minimum x/y coordinate value on a #QwalkLayer_t */
 #define QWALK_LAYER_COORD_MINIMUM 0
 
+#define QWALK_CHUNK_SIZE_Y 32  /**< Y dimension of a #QwalkChunk_t. */
+#define QWALK_CHUNK_SIZE_X 32  /**< X dimension of a #QwalkChunk_t. */
+
+/** Number of tiles in a #QwalkChunk_t. */
+#define QWALK_CHUNK_SIZE (QWALK_CHUNK_SIZE_Y * QWALK_CHUNK_SIZE_X)
+
 /** Total amount of #QwalkLayer_t per #QwalkArea_t. */
 #define QWALK_AREA_TOTAL_LAYER_COUNT 2
 
+/**
+ * Magic number at the start of a columnar (v2) #QwalkArea_t file.
+ * Files without it are taken to be in the raw (v1) format written by
+ * qwalk_area_write().
+ */
+#define QWALK_FILE_MAGIC "QWLKAREA"
+
+/** Length of #QWALK_FILE_MAGIC in bytes. */
+#define QWALK_FILE_MAGIC_SIZE 8
+
+/** Version of the columnar #QwalkArea_t file format. */
+#define QWALK_FILE_VERSION 3
+
+/**
+ * Former version of the columnar format, holding every object of a
+ * #QWALK_LAYER_SIZE layer rather than its chunks; still read.
+ */
+#define QWALK_FILE_VERSION_UNCHUNKED 2
+
+/** Directory the journal files of areas are kept in. */
+#define QWALK_JOURNAL_DIR "saves/"
+
+/** Suffix of journal files; see qwalk_journal_filename_get(). */
+#define QWALK_JOURNAL_SUFFIX ".jnl"
+
+/** Magic number at the start of every save in a journal file. */
+#define QWALK_JOURNAL_MAGIC "QWLKJRNL"
+
+/** Length of #QWALK_JOURNAL_MAGIC in bytes. */
+#define QWALK_JOURNAL_MAGIC_SIZE 8
+
+/**
+ * Suffix appended to a journal file found to belong to another version of its
+ * area file, which is moved aside rather than replayed.
+ */
+#define QWALK_JOURNAL_STALE_SUFFIX ".stale"
+
+/** Number of ticks between two saves of the journal of the current area. */
+#define QWALK_JOURNAL_AUTOSAVE_TICKS 64
+
 /** Filename for the starting area in qwalk. */
 #define QWALK_AREA_FILENAME_DEFAULT "data/walk-world/test2.dat"
 
+/**
+ * Format of the basename of the file of the area at a pair of
+ * meta-coordinates, y first, in a world; see qwalk_world_create().
+ */
+#define QWALK_WORLD_AREA_FILENAME_FORMAT "area_%d_%d.dat"
+
+/** Most areas a #QwalkWorld_t holds in memory, the current one included. */
+#define QWALK_WORLD_CACHE_SIZE 6
+
+/**
+ * Distance from an edge of the current area within which the area across it
+ * is read in the background.
+ */
+#define QWALK_WORLD_PREFETCH_DISTANCE 8
+
+/**
+ * Environment variable which, if set, has qwalk report to @c stderr how long
+ * loading the area and setting up the windows took upon startup.
+ */
+#define QWALK_TIMING_ENV "Q_WALK_TIMING"
+
 /** Maximum distance for the player to be able to execute dialogue from. */
 #define QWALK_DIALOGUE_DISTANCE_MAX 3
 
+/** Greatest number of #QOBJ_TYPE_PLAYER objects a #QwalkArea_t may hold. */
+#define QWALK_AREA_PLAYERC_MAX 8
+
 #define QWALK_EXCESSIVE_DISTANCE_LOG_MESSAGE \
 	"Object is too far away to interact with!"
 
@@ -132,13 +213,66 @@ typedef struct QwalkObj_t {
 } QwalkObj_t;
 
 
+/**
+ * A #QWALK_CHUNK_SIZE_Y by #QWALK_CHUNK_SIZE_X block of a #QwalkLayer_t.
+ * Objects are numbered within a chunk row by row; this local index is also
+ * that of their entry in @ref QwalkChunk_t.store.
+ */
+typedef struct QwalkChunk_t {
+	/** Objects of the chunk; those past the edge of the layer stay unset. */
+	QwalkObj_t objects[QWALK_CHUNK_SIZE];
+
+	/**
+	 * Type, mobility, name and brief description of every object, side by
+	 * side and in the order of @ref QwalkChunk_t.objects. Every
+	 * @ref QwalkObj_t.attr_list is bound to its entry, and kept in sync by the
+	 * setters of this module and of the attribute module alike; passes over a
+	 * whole chunk read this rather than each list.
+	 */
+	/*@only@*/QattrStore_t *store;
+
+	int objc;  /**< Number of objects set in @ref QwalkChunk_t.objects. */
+} QwalkChunk_t;
+
+
 /**
  * A lone z-level of a playable area in the qwalk module.
+ * Objects are known by their index, @c y * @ref QwalkLayer_t.size_x + @c x,
+ * but kept in chunks, which are only allocated once an object is set in
+ * them. Tiles of a chunk never populated are void, and cost nothing beyond a
+ * @c NULL in @ref QwalkLayer_t.chunks; memory and loading thus scale with the
+ * populated chunks rather than with the dimensions.
  */
 typedef struct QwalkLayer_t {
-	/** Pointer to the collection of #QwalkObj_t present on the field. */
-	/*@only@*/QwalkObj_t *objects;
-	int index_ok; /**< next available index. */
+	int size_y; /**< Y dimension. */
+	int size_x; /**< X dimension. */
+
+	int chunkc_y; /**< Number of rows of chunks.    */
+	int chunkc_x; /**< Number of columns of chunks. */
+
+	/**
+	 * Every chunk, row by row, @c NULL until populated; see
+	 * qwalk_layer_chunk_get().
+	 */
+	/*@only@*/QwalkChunk_t **chunks;
+	int chunkc; /**< Number of populated chunks. */
+
+	int objc;  /**< Number of objects set, over every chunk. */
+
+	/**
+	 * Number of tiles of the populated chunks within the layer; once it
+	 * equals @ref QwalkLayer_t.objc, the layer is complete.
+	 */
+	int tilec;
+
+	/**
+	 * #Qarena_t the objects were read into, or @c NULL.
+	 * Set by qwalk_layer_handle_read() and the reader of #QWALK_FILE_VERSION
+	 * files, such that the lists of a layer lie side by side and are freed all
+	 * at once. Lists replaced afterwards (e.g. by devel_walk or @c become) are
+	 * on the heap; see qwalk_layer_object_attr_list_replace().
+	 */
+	/*@null@*//*@only@*/struct Qarena_t *arena;
 } QwalkLayer_t;
 
 
@@ -164,13 +298,38 @@ typedef enum QwalkLayerType_t {
 typedef struct QwalkArea_t {
 	QwalkLayer_t *layer_earth;   /**< layer that's embedded in the earth.  */
 	QwalkLayer_t *layer_floater; /**< layer that sits on top of the earth. */
-	
-	/*
-	 * For future implementations when there will be more than one field vvv
-	   		QwalkMetaCoord_t meta_coord_x;
-	   		QwalkMetaCoord_t meta_coord_y;
-	 *
-	*/
+
+	/**
+	 * Contents of the file the area was loaded from, if its attributes are
+	 * views into them (see qwalk_area_v2_read()) or were deferred (see
+	 * qwalk_area_handle_read()); @c NULL otherwise.
+	 */
+	/*@null@*//*@only@*/struct QfileBuffer_t *storage;
+
+	/**
+	 * String store that the strings of the area were interned into upon
+	 * reading it or replaying its journal, freed along with it; @c NULL if
+	 * none were read.
+	 */
+	/*@null@*//*@only@*/struct QfileStringStore_t *strings;
+
+	/**
+	 * Index in @ref QwalkArea_t.layer_floater of each #QOBJ_TYPE_PLAYER
+	 * object, such that finding one needn't scan the layer. Filled in by
+	 * qwalk_area_players_track(), and kept current by movement afterwards.
+	 */
+	int player_indices[QWALK_AREA_PLAYERC_MAX];
+	int playerc; /**< Number of players in @ref QwalkArea_t.player_indices. */
+
+	/** Member of @ref QwalkArea_t.player_indices which commands move.    */
+	int player_active;
+
+	/**
+	 * Position of the area in its world, in areas; see #QwalkWorld_t. The
+	 * area across its northern edge lies at one less meta_coord_y.
+	 */
+	int meta_coord_y;
+	int meta_coord_x; /**< X counterpart of @ref QwalkArea_t.meta_coord_y. */
 } QwalkArea_t;
 
 
@@ -197,6 +356,11 @@ extern int qwalk_dialogue_command_handler(QwalkLayer_t *layer, int index,
 /** Execute the subtick step of executing the game logic. */
 extern int qwalk_logic_subtick(QwalkArea_t *, QwalkCommand_t);
 
+/** Move the active player across an edge into the next area. */
+extern int qwalk_logic_area_cross(QwalkArea_t *walk_area,
+		QwalkArea_t *walk_area_next, QwalkCommand_t walk_command)
+	/*@modifies walk_area, walk_area_next@*/;
+
 /** Initialize the I/O module.                            */
 extern int qwalk_io_init(WINDOW *argwin, WINDOW *log_argwin)
 	/*@modifies internalState@*/;
@@ -205,7 +369,8 @@ extern           void              qwalk_io_end(void)
 	/*@modifies internalState@*/;
 
 /** Execute the subtick step of taking an input.          */
-extern           QwalkCommand_t    qwalk_input_subtick(int index);
+extern           QwalkCommand_t    qwalk_input_subtick(const QwalkLayer_t *layer,
+		int index, int target_index);
 
 /** Execute the subtick step of updating the screen.      */
 extern           int               qwalk_output_subtick(const QwalkArea_t *);
@@ -213,7 +378,7 @@ extern           int               qwalk_output_subtick(const QwalkArea_t *);
 extern int qwalk_log_print(const char *s)/*@modifies internalState@*/;
 
 extern int qwalk_input_player_object_select(WINDOW *select_win,
-		int start_index);
+		const QwalkLayer_t *layer, int start_index);
 
 
 /*@observer@*//*@null@*/
@@ -227,12 +392,109 @@ extern /*@null@*//*@only@*/QwalkArea_t *qwalk_area_create(/*@returned@*//*@keep@
 /** Destroy a #QwalkArea_t.                               */
 extern void qwalk_area_destroy(/*@only@*/QwalkArea_t *);
 
+/** Check the invariants the logic of a #QwalkArea_t relies on.     */
+extern int qwalk_area_validate(const QwalkArea_t *)/*@*/;
+
+/** Find every player of a #QwalkArea_t anew.                        */
+extern int qwalk_area_players_track(QwalkArea_t *walk_area)
+	/*@modifies walk_area@*/;
+
+/** Get the index of the active player of a #QwalkArea_t.            */
+extern int qwalk_area_player_index_get(const QwalkArea_t *)/*@*/;
+
 /** Write a #QwalkArea_t to storage.                      */
 extern int qwalk_area_write(const QwalkArea_t *)/*@*/;
 
 /** Read a #QwalkArea_t from storage.                     */
 extern /*@null@*//*@only@*/QwalkArea_t *qwalk_area_read(void);
 
+/** Write a #QwalkArea_t to storage in the columnar format.*/
+extern int qwalk_area_v2_write(const QwalkArea_t *)/*@*/;
+
+/** Read a columnar #QwalkArea_t from storage.            */
+extern /*@null@*//*@only@*/QwalkArea_t *qwalk_area_v2_read(void);
+
+/** Tell whether the open file is a columnar #QwalkArea_t. */
+extern bool qwalk_area_file_isv2(void)/*@*/;
+
+/** Write a #QwalkArea_t to a #QfileHandle_t.             */
+extern int qwalk_area_handle_write(struct QfileHandle_t *, const QwalkArea_t *);
+
+/** Read a #QwalkArea_t from a #QfileHandle_t.            */
+extern /*@null@*//*@only@*/QwalkArea_t *qwalk_area_handle_read(
+		struct QfileHandle_t *);
+
+/** Write a columnar #QwalkArea_t to a #QfileHandle_t.    */
+extern int qwalk_area_v2_handle_write(struct QfileHandle_t *,
+		const QwalkArea_t *);
+
+/** Read a columnar #QwalkArea_t from a #QfileHandle_t.   */
+extern /*@null@*//*@only@*/QwalkArea_t *qwalk_area_v2_handle_read(
+		struct QfileHandle_t *);
+
+/** Tell whether a #QfileHandle_t is a columnar #QwalkArea_t. */
+extern bool qwalk_area_file_handle_isv2(struct QfileHandle_t *);
+
+/** Convert a #QwalkArea_t file to the columnar format.   */
+extern int qwalk_area_file_convert(const char *src_filename,
+		const char *dest_filename, bool compress);
+
+/** Create a journal for the area stored in a file.       */
+extern /*@null@*//*@only@*/struct QwalkJournal_t *qwalk_journal_create(
+		const char *area_filename);
+
+/** Destroy a journal.                                    */
+extern void qwalk_journal_destroy(/*@only@*/struct QwalkJournal_t *);
+
+/** Mark an object of a #QwalkArea_t as edited.           */
+extern int qwalk_journal_mark(struct QwalkJournal_t *, QwalkLayerType_t, int);
+
+/** Append the marked objects to the journal file.        */
+extern int qwalk_journal_save(struct QwalkJournal_t *, const QwalkArea_t *);
+
+/** Serialize the marked objects into a save to append later. */
+extern int qwalk_journal_frame_get(struct QwalkJournal_t *, const QwalkArea_t *,
+		/*@out@*//*@null@*//*@only@*/struct QfileHandle_t **);
+
+/** Replay the journal file over a #QwalkArea_t.          */
+extern int qwalk_journal_replay(const struct QwalkJournal_t *, QwalkArea_t *);
+
+/** Tell whether an area file has a journal file.         */
+extern bool qwalk_journal_exists(const char *area_filename);
+
+/** Fold the journal file of an area file into it.        */
+extern int qwalk_journal_compact(const char *area_filename);
+
+/** Create a world around the area stored in a file.      */
+extern /*@null@*//*@only@*/struct QwalkWorld_t *qwalk_world_create(
+		const char *area_filename);
+
+/** Destroy a world and every area it holds.              */
+extern void qwalk_world_destroy(/*@only@*/struct QwalkWorld_t *);
+
+/** Get the area of a world the player is in.             */
+extern /*@null@*//*@observer@*/QwalkArea_t *qwalk_world_area_curr_get(
+		struct QwalkWorld_t *);
+
+/** Get the journal of the area of a world the player is in. */
+extern /*@null@*//*@observer@*/struct QwalkJournal_t *qwalk_world_journal_curr_get(
+		const struct QwalkWorld_t *)/*@*/;
+
+/** Get how long the current area of a world took to read. */
+extern double qwalk_world_load_ms_get(const struct QwalkWorld_t *)/*@*/;
+
+/** Read the areas the player nears in the background.    */
+extern int qwalk_world_prefetch(struct QwalkWorld_t *);
+
+/** Move the player across an edge of the current area.   */
+extern int qwalk_world_cross(struct QwalkWorld_t *, QwalkCommand_t);
+
+/** Save the journal of every area a world holds.         */
+extern int qwalk_world_save(struct QwalkWorld_t *);
+
+/** Save the journal of the current area in the background. */
+extern int qwalk_world_curr_save(struct QwalkWorld_t *);
+
 /** Get the layer_earth member from a #QwalkArea_t.       */
 extern /*@null@*//*@observer@*/QwalkLayer_t *qwalk_area_layer_earth_get(const /*@null@*//*@returned@*/QwalkArea_t *)/*@*/;
 
@@ -242,7 +504,8 @@ extern /*@null@*//*@observer@*/QwalkLayer_t *qwalk_area_layer_floater_get(const/
 
 
 /** Create a #QwalkLayer_t.                               */
-extern /*@null@*//*@partial@*/QwalkLayer_t *qwalk_layer_create(void);
+extern /*@null@*//*@partial@*/QwalkLayer_t *qwalk_layer_create(int size_y,
+		int size_x);
  
 /** Destory a #QwalkLayer_t.                              */
 extern                        void          qwalk_layer_destroy(/*@only@*/QwalkLayer_t *);
@@ -253,9 +516,30 @@ extern                        int           qwalk_layer_write(const QwalkLayer_t
 /** Read a #QwalkLayer_t from storage.                    */
 extern    /*@null@*//*@only@*/QwalkLayer_t *qwalk_layer_read(void);
 
+/** Write a #QwalkLayer_t to a #QfileHandle_t.            */
+extern                        int           qwalk_layer_handle_write(struct QfileHandle_t *, const QwalkLayer_t *);
+
+/** Read a #QwalkLayer_t from a #QfileHandle_t.           */
+extern    /*@null@*//*@only@*/QwalkLayer_t *qwalk_layer_handle_read(struct QfileHandle_t *);
+
 /** Add a #QwalkObj_t * to a #QwalkLayer_t *.             */
 extern                        int          qwalk_layer_object_set(/*@null@*/QwalkLayer_t *, int, int, /*@null@*//*@only@*/QattrList_t *);
 
+/** Replace the #QattrList_t of a #QwalkObj_t.            */
+extern                        void         qwalk_layer_object_attr_list_replace(QwalkLayer_t *, int, /*@only@*/QattrList_t *);
+
+/** Tell whether every tile of the populated chunks is set. */
+extern bool qwalk_layer_iscomplete(const QwalkLayer_t *)/*@*/;
+
+/** Get the #QwalkChunk_t holding an index of a #QwalkLayer_t. */
+/*@null@*//*@observer@*/
+extern QwalkChunk_t *qwalk_layer_chunk_get(const QwalkLayer_t *layer,
+		int index, /*@out@*/int *localp)/*@modifies localp@*/;
+
+/** Get the index of an object of a #QwalkChunk_t in its layer. */
+extern int qwalk_layer_chunk_index_get(const QwalkLayer_t *layer, int chunk,
+		int local)/*@*/;
+
 
 
 /*@observer@*//*@null@*/
@@ -268,6 +552,30 @@ extern QobjType_t qwalk_layer_object_type_get(
 extern int qwalk_layer_obj_index_get(
 		const QwalkLayer_t *parse_layer, const QobjType_t type_search)/*@*/;
 
+/** Find every object of a #QwalkLayer_t with some keys and types.   */
+extern int qwalk_layer_objects_query(const QwalkLayer_t *layer,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		/*@out@*/int *indices)/*@modifies indices@*/;
+
+/** Find every object of a #QwalkLayer_t within a rectangle.        */
+extern int qwalk_layer_rect_query(const QwalkLayer_t *layer,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		int y0, int x0, int y1, int x1, /*@out@*/int *indices)
+	/*@modifies indices@*/;
+
+/** Find every object of a #QwalkLayer_t within a distance of a point. */
+extern int qwalk_layer_radius_query(const QwalkLayer_t *layer,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		int y, int x, int radius, /*@out@*/int *indices)/*@modifies indices@*/;
+
+/** Find the object of a #QobjType_t nearest to a point.             */
+extern int qwalk_layer_nearest_get(const QwalkLayer_t *layer, QobjType_t type,
+		int y, int x, int radius_max)/*@*/;
+
+/** Find the distance between two indices of a #QwalkLayer_t.        */
+extern int qwalk_index_distance_get(const QwalkLayer_t *layer, int index_a,
+		int index_b)/*@*/;
+
 /** Get the y coordinate of a #QwalkObj_t.                */
 extern int               qwalk_layer_object_coord_y_get(/*@null@*/const QwalkLayer_t *, int)/*@*/;
 
@@ -279,11 +587,11 @@ extern /*@null@*//*@observer@*/QattrList_t *qwalk_layer_object_attr_list_get(/*@
 
 
 
-extern int    qwalk_coords_to_index(int, int)/*@*/;
+extern int    qwalk_coords_to_index(const QwalkLayer_t *, int, int)/*@*/;
 
-extern int   *qwalk_index_to_coords(int)/*@*/;
+extern int   *qwalk_index_to_coords(const QwalkLayer_t *, int)/*@*/;
 
-extern bool   qwalk_logic_coords_arevalid(int, int)/*@*/;
+extern bool   qwalk_logic_coords_arevalid(const QwalkLayer_t *, int, int)/*@*/;
 
 extern chtype qwalk_obj_type_to_chtype(QobjType_t)/*@*/;
 
@@ -0,0 +1,838 @@
+/**
+ * @file bench.c
+ * Microbenchmarks for the hot paths of qfile, qattr and qwalk.
+ * Built via `make bench`. Every benchmark runs against a synthetic
+ * #QwalkArea_t whose size, attribute density and string sizes are set on the
+ * command line; after some warmup runs, each one is repeated and reported as JSON, in
+ * nanoseconds, bytes allocated and allocations per operation.
+ *
+ * Allocations are counted by wrapping malloc(), calloc() and realloc() at link
+ * time (see @c BENCH_LDFLAGS in the Makefile); those made by the C library on
+ * its own (e.g. within fopen()) thus go uncounted.
+ */
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ncurses.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "splint_types.h"
+#include "dialogue.h"
+#include "qattr.h"
+#include "qfile.h"
+#include "qwalk.h"
+
+
+
+/** Number of #QattrKey_t an object may be given; see @ref bench_keys. */
+#define BENCH_KEYC 6
+
+/** Number of distinct values of every string attribute. */
+#define BENCH_VARIETY 16
+
+/** Greatest number of repetitions of a benchmark. */
+#define BENCH_REPETITIONS_MAX 1000
+
+/** Default scratch file for the area I/O benchmarks. */
+#define BENCH_FILENAME_DEFAULT "bench_area.dat"
+
+
+
+/** Shape of the synthetic area and the way benchmarks are run. */
+typedef struct BenchConfig_t {
+	int size_y;       /**< Rows of both layers of the area.                   */
+	int size_x;       /**< Columns of both layers of the area.                */
+	int attrc;        /**< Attributes per object; 1 to #BENCH_KEYC.           */
+	int density;      /**< Percentage of floater tiles holding an object.     */
+	size_t text_size; /**< Bytes in every long description.                   */
+	int warmup;       /**< Runs of each benchmark before measuring.           */
+	int repetitions;  /**< Measured runs of each benchmark.                   */
+
+	/** Scratch file for the area I/O benchmarks. */
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+} BenchConfig_t;
+
+/** Measurements of one run of a benchmark. */
+typedef struct BenchSample_t {
+	size_t ops;        /**< Operations performed.                             */
+	uint64_t ns;       /**< Nanoseconds spent in them.                        */
+	size_t allocs;     /**< Allocations made by them.                         */
+	size_t bytes;      /**< Bytes allocated by them.                          */
+	size_t file_bytes; /**< Size of the file read or written, if any.         */
+
+	/* state of the clock and counters while measuring */
+	uint64_t ns_start;
+	size_t allocs_start;
+	size_t bytes_start;
+} BenchSample_t;
+
+/** A benchmark; performs one run against an area. */
+typedef int (*BenchFunc_t)(const BenchConfig_t *, QwalkArea_t *,
+		BenchSample_t *);
+
+
+
+/** #QattrKey_t given to objects, in order, up to @ref BenchConfig_t.attrc. */
+static const QattrKey_t bench_keys[BENCH_KEYC] = {
+	QATTR_KEY_QOBJECT_TYPE,
+	QATTR_KEY_CANMOVE,
+	QATTR_KEY_NAME,
+	QATTR_KEY_DESCRIPTION_BRIEF,
+	QATTR_KEY_DESCRIPTION_LONG,
+	QATTR_KEY_QDL_FILE
+};
+
+/** Allocations made so far. */
+static size_t bench_allocs = 0;
+
+/** Bytes allocated so far. */
+static size_t bench_alloc_bytes = 0;
+
+
+
+/*@external@*/extern void *__real_malloc(size_t);
+/*@external@*/extern void *__real_calloc(size_t, size_t);
+/*@external@*/extern void *__real_realloc(void *, size_t);
+void *__wrap_malloc(size_t);
+void *__wrap_calloc(size_t, size_t);
+void *__wrap_realloc(void *, size_t);
+
+/*@null@*//*@only@*/
+static QwalkArea_t *bench_area_create(const BenchConfig_t *config);
+/*@null@*//*@only@*/
+static QattrList_t *bench_attr_list_create(const BenchConfig_t *config,
+		QobjType_t type, int attrc, int index);
+/*@null@*//*@only@*/
+static Qdatameta_t *bench_value_create(const BenchConfig_t *config,
+		QattrKey_t key, QobjType_t type, int index);
+static QattrList_t *bench_attr_list_get(QwalkArea_t *walk_area, int index)/*@*/;
+static int      bench_area_objc_get(const QwalkArea_t *walk_area)/*@*/;
+static int      bench_area_write(const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample);
+static int      bench_area_read(const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample);
+static int      bench_attr_list_clone(const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample);
+static int      bench_attr_list_value_get(const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample);
+static int      bench_attr_list_attr_delete(const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample);
+static int      bench_run(const BenchConfig_t *config, QwalkArea_t *walk_area,
+		const char *name, BenchFunc_t func, bool isfirst);
+static void     bench_sample_start(BenchSample_t *sample)/*@modifies sample@*/;
+static void     bench_sample_stop(BenchSample_t *sample)/*@modifies sample@*/;
+static uint64_t bench_now(void)/*@*/;
+static int      bench_ns_compare(const void *a, const void *b)/*@*/;
+static void     bench_print_help(void);
+
+
+
+/**
+ * Main function for the bench program.
+ * @param[in] argc: argument count.
+ * @param[in] argv: argument vector.
+ * @return 0 on success or 1 otherwise.
+ */
+int main(int argc, char **argv) {
+	BenchConfig_t config;
+	QwalkArea_t *walk_area;
+	int opt;
+	int returnval = EXIT_SUCCESS;
+
+	config.size_y = QWALK_LAYER_SIZE_Y;
+	config.size_x = QWALK_LAYER_SIZE_X;
+	config.attrc = 5;
+	config.density = 50;
+	config.text_size = (size_t) 256;
+	config.warmup = 2;
+	config.repetitions = 10;
+	strcpy(config.filename, BENCH_FILENAME_DEFAULT);
+
+	/* parse command line args */
+	while ((opt = getopt(argc, argv, "hs:a:d:l:w:r:f:")) != -1) {
+		switch (opt) {
+		case 'h':
+			bench_print_help();
+			exit(EXIT_SUCCESS);
+		case 's':
+			if (sscanf(optarg, "%dx%d", &config.size_y, &config.size_x) != 2) {
+				bench_print_help();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'a':
+			config.attrc = atoi(optarg);
+			break;
+		case 'd':
+			config.density = atoi(optarg);
+			break;
+		case 'l':
+			config.text_size = (size_t) strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			config.warmup = atoi(optarg);
+			break;
+		case 'r':
+			config.repetitions = atoi(optarg);
+			break;
+		case 'f':
+			if (strlen(optarg) > (size_t) QFILE_MAX_PATH_SIZE) {
+				Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+				exit(EXIT_FAILURE);
+			}
+			strcpy(config.filename, optarg);
+			break;
+		default:
+			bench_print_help();
+			exit(EXIT_FAILURE);
+		}
+	}
+	/* both layers together are indexed by int; see bench_attr_list_get() */
+	if ((config.size_y <= 0) || (config.size_y > QWALK_LAYER_DIMENSION_MAX)
+			|| (config.size_x <= 0) || (config.size_x > QWALK_LAYER_DIMENSION_MAX)
+			|| (config.size_y > INT_MAX / 2 / config.size_x)
+			|| (config.attrc < 1) || (config.attrc > BENCH_KEYC)
+			|| (config.density < 0) || (config.density > 100)
+			|| (config.text_size < (size_t) 1) || (config.warmup < 0)
+			|| (config.repetitions < 1)
+			|| (config.repetitions > BENCH_REPETITIONS_MAX)) {
+		bench_print_help();
+		exit(EXIT_FAILURE);
+	}
+
+	if ((walk_area = bench_area_create(&config)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		exit(EXIT_FAILURE);
+	}
+
+	printf("{\n");
+	printf("\t\"config\": {\"attrc\": %d, \"density\": %d, \"text_size\": %zu, "
+			"\"warmup\": %d, \"repetitions\": %d, \"layer_size_y\": %d, "
+			"\"layer_size_x\": %d, \"layer_size\": %d},\n",
+			config.attrc, config.density, config.text_size, config.warmup,
+			config.repetitions, walk_area->layer_earth->size_y,
+			walk_area->layer_earth->size_x, bench_area_objc_get(walk_area) / 2);
+	printf("\t\"benchmarks\": [\n");
+
+	/* qwalk_area_write() comes first, as qwalk_area_read() reads its file */
+	if ((bench_run(&config, walk_area, "qwalk_area_write", bench_area_write,
+					true) == Q_ERROR)
+			|| (bench_run(&config, walk_area, "qwalk_area_read",
+					bench_area_read, false) == Q_ERROR)
+			|| (bench_run(&config, walk_area, "qattr_list_clone",
+					bench_attr_list_clone, false) == Q_ERROR)
+			|| (bench_run(&config, walk_area, "qattr_list_value_get",
+					bench_attr_list_value_get, false) == Q_ERROR)
+			|| (bench_run(&config, walk_area, "qattr_list_attr_delete",
+					bench_attr_list_attr_delete, false) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = EXIT_FAILURE;
+	}
+
+	printf("\n\t]\n}\n");
+
+	(void) unlink(config.filename);
+	qwalk_area_destroy(walk_area);
+	return returnval;
+}
+
+
+/**
+ * Count an allocation via malloc().
+ * @param[in] size: number of bytes to allocate.
+ * @return allocated memory or @c NULL.
+ */
+void *
+__wrap_malloc(size_t size) {
+	bench_allocs++;
+	bench_alloc_bytes += size;
+	return __real_malloc(size);
+}
+
+
+/**
+ * Count an allocation via calloc().
+ * @param[in] nmemb: number of elements to allocate.
+ * @param[in] size: size of every element.
+ * @return allocated memory or @c NULL.
+ */
+void *
+__wrap_calloc(size_t nmemb, size_t size) {
+	bench_allocs++;
+	bench_alloc_bytes += nmemb * size;
+	return __real_calloc(nmemb, size);
+}
+
+
+/**
+ * Count an allocation via realloc().
+ * @param[in] ptr: memory to reallocate, or @c NULL.
+ * @param[in] size: new number of bytes.
+ * @return reallocated memory or @c NULL.
+ */
+void *
+__wrap_realloc(void *ptr, size_t size) {
+	bench_allocs++;
+	bench_alloc_bytes += size;
+	return __real_realloc(ptr, size);
+}
+
+
+/**
+ * Create the synthetic #QwalkArea_t described by a #BenchConfig_t.
+ * Both layers are @ref BenchConfig_t.size_y by @ref BenchConfig_t.size_x
+ * tiles. Every earth tile holds an object of @ref BenchConfig_t.attrc attributes,
+ * and so do @ref BenchConfig_t.density percent of the floater tiles, spread
+ * evenly; the rest are void objects with just a #QATTR_KEY_QOBJECT_TYPE.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @return new #QwalkArea_t or @c NULL.
+ */
+QwalkArea_t *
+bench_area_create(const BenchConfig_t *config) {
+	QwalkLayer_t *layer_earth;
+	QwalkLayer_t *layer_floater;
+	QattrList_t *attr_list;
+	QobjType_t type;
+	int *coords;
+	bool isfull;
+
+	if ((layer_earth = qwalk_layer_create(config->size_y, config->size_x))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	if ((layer_floater = qwalk_layer_create(config->size_y, config->size_x))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_layer_destroy(layer_earth);
+		return NULL;
+	}
+
+	for (int i = 0; i < config->size_y * config->size_x; i++) {
+		if ((coords = qwalk_index_to_coords(layer_earth, i)) == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			abort();
+		}
+
+		type = (i % 7 == 0) ? QOBJ_TYPE_TREE : QOBJ_TYPE_GRASS;
+		if (((attr_list = bench_attr_list_create(config, type, config->attrc, i))
+					== NULL)
+				|| (qwalk_layer_object_set(layer_earth, coords[0], coords[1],
+						attr_list) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			abort();
+		}
+
+		/* (i * 37) % 100 visits every percentage once per 100 tiles */
+		isfull = ((i * 37) % 100) < config->density;
+		attr_list = isfull
+			? bench_attr_list_create(config, QOBJ_TYPE_NPC_FRIENDLY,
+					config->attrc, i)
+			: bench_attr_list_create(config, QOBJ_TYPE_VOID, 1, i);
+		if ((attr_list == NULL)
+				|| (qwalk_layer_object_set(layer_floater, coords[0], coords[1],
+						attr_list) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			abort();
+		}
+
+		free(coords);
+	}
+
+	return qwalk_area_create(layer_earth, layer_floater);
+}
+
+
+/**
+ * Create the #QattrList_t of a synthetic object.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @param[in] type: #QobjType_t of the object.
+ * @param[in] attrc: number of attributes, taken in order from @ref bench_keys.
+ * @param[in] index: index of the object in its layer.
+ * @return new #QattrList_t or @c NULL.
+ */
+QattrList_t *
+bench_attr_list_create(const BenchConfig_t *config, QobjType_t type, int attrc,
+		int index) {
+	QattrList_t *attr_list;
+	Qdatameta_t *datameta;
+
+	if ((attr_list = qattr_list_create((size_t) attrc)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	for (int i = 0; i < attrc; i++) {
+		if (((datameta = bench_value_create(config, bench_keys[i], type, index))
+					== NULL)
+				|| (qattr_list_attr_set(attr_list, bench_keys[i], datameta)
+					== Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qattr_list_destroy(attr_list);
+			return NULL;
+		}
+	}
+
+	return attr_list;
+}
+
+
+/**
+ * Create the value of one attribute of a synthetic object.
+ * String values come in #BENCH_VARIETY variants, chosen by @p index.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @param[in] key: #QattrKey_t of the value.
+ * @param[in] type: #QobjType_t of the object.
+ * @param[in] index: index of the object in its layer.
+ * @return new #Qdatameta_t or @c NULL.
+ */
+Qdatameta_t *
+bench_value_create(const BenchConfig_t *config, QattrKey_t key, QobjType_t type,
+		int index) {
+	bool canmove;
+	char *s;
+	char buf[32];
+	size_t count;
+	int variant = index % BENCH_VARIETY;
+
+	switch (key) {
+	case QATTR_KEY_QOBJECT_TYPE:
+		return qdatameta_copy_create(&type, QDATA_TYPE_QOBJECT_TYPE, (size_t) 1);
+
+	case QATTR_KEY_CANMOVE:
+		canmove = (type != QOBJ_TYPE_TREE);
+		return qdatameta_copy_create(&canmove, QDATA_TYPE_BOOL, (size_t) 1);
+
+	case QATTR_KEY_DESCRIPTION_LONG:
+		count = config->text_size + 1;
+		if ((s = calloc(count, sizeof(*s))) == NULL) {
+			Q_ERROR_SYSTEM("calloc()");
+			return NULL;
+		}
+		for (size_t i = 0; i < config->text_size; i++) {
+			s[i] = (char) ('a' + (int) ((i + (size_t) variant) % 26));
+		}
+		return qdatameta_create(s, QDATA_TYPE_CHAR_STRING, count);
+
+	case QATTR_KEY_NAME:
+	case QATTR_KEY_DESCRIPTION_BRIEF:
+	case QATTR_KEY_QDL_FILE:
+		if (key == QATTR_KEY_NAME) {
+			(void) snprintf(buf, sizeof(buf), "object %d", variant);
+		} else if (key == QATTR_KEY_DESCRIPTION_BRIEF) {
+			(void) snprintf(buf, sizeof(buf), "a brief description, #%d", variant);
+		} else {
+			(void) snprintf(buf, sizeof(buf), "dialogue%d.qdl", variant);
+		}
+		return qdatameta_copy_create(buf, QDATA_TYPE_CHAR_STRING,
+				strlen(buf) + 1);
+
+	default:
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return NULL;
+	}
+}
+
+
+/**
+ * Get the #QattrList_t of an object of a #QwalkArea_t, by area-wide index.
+ * Indexes below the number of tiles of a layer are in the earth layer, the
+ * rest in the floater layer.
+ * @param[in] walk_area: relevant #QwalkArea_t.
+ * @param[in] index: area-wide index of the object.
+ * @return requested #QattrList_t.
+ */
+QattrList_t *
+bench_attr_list_get(QwalkArea_t *walk_area, int index) {
+	int size = bench_area_objc_get(walk_area) / 2;
+
+	return (index < size)
+		? qwalk_layer_object_attr_list_get(walk_area->layer_earth, index)
+		: qwalk_layer_object_attr_list_get(walk_area->layer_floater,
+				index - size);
+}
+
+
+/**
+ * Get the number of objects of a synthetic #QwalkArea_t.
+ * Every tile of both of its layers holds one; see bench_area_create().
+ * @param[in] walk_area: relevant #QwalkArea_t.
+ * @return number of objects, i.e. of area-wide indexes.
+ */
+int
+bench_area_objc_get(const QwalkArea_t *walk_area) {
+	return walk_area->layer_earth->size_y * walk_area->layer_earth->size_x * 2;
+}
+
+
+/**
+ * Benchmark qwalk_area_write(); one operation writes a whole area file.
+ * Areas not of the default size are written by qwalk_area_v2_write() instead,
+ * as the raw format records no dimensions.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @param[in] walk_area: #QwalkArea_t to write.
+ * @param[out] sample: #BenchSample_t to fill out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_area_write(const BenchConfig_t *config, QwalkArea_t *walk_area,
+		BenchSample_t *sample) {
+	struct stat st;
+	int returnval = Q_OK;
+
+	bench_sample_start(sample);
+	if (qfile_open(config->filename, QFILE_MODE_WRITE) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	/* the raw format only holds default-sized layers; see -s */
+	if (((config->size_y == QWALK_LAYER_SIZE_Y)
+					&& (config->size_x == QWALK_LAYER_SIZE_X)
+				? qwalk_area_write(walk_area)
+				: qwalk_area_v2_write(walk_area)) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	if (qfile_close() == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	bench_sample_stop(sample);
+	sample->ops = (size_t) 1;
+
+	if (stat(config->filename, &st) == -1) {
+		Q_ERROR_SYSTEM("stat()");
+		return Q_ERROR;
+	}
+	sample->file_bytes = (size_t) st.st_size;
+
+	return returnval;
+}
+
+
+/**
+ * Benchmark qwalk_area_read(); one operation reads a whole area file.
+ * The file is the one written by bench_area_write(); destroying the area read
+ * isn't measured.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @param[in] walk_area: unused.
+ * @param[out] sample: #BenchSample_t to fill out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_area_read(const BenchConfig_t *config,
+		/*@unused@*/QwalkArea_t *walk_area, BenchSample_t *sample) {
+	QwalkArea_t *walk_area_read;
+	struct stat st;
+	int returnval = Q_OK;
+
+	(void) walk_area;
+
+	bench_sample_start(sample);
+	if (qfile_open(config->filename, QFILE_MODE_READ_MAPPED) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if ((walk_area_read = qwalk_area_read()) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	if (qfile_close() == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	bench_sample_stop(sample);
+	sample->ops = (size_t) 1;
+
+	if (walk_area_read != NULL) {
+		qwalk_area_destroy(walk_area_read);
+	}
+
+	if (stat(config->filename, &st) == -1) {
+		Q_ERROR_SYSTEM("stat()");
+		return Q_ERROR;
+	}
+	sample->file_bytes = (size_t) st.st_size;
+
+	return returnval;
+}
+
+
+/**
+ * Benchmark qattr_list_clone(); one operation clones one object's list.
+ * Every object of the area is cloned; destroying the clones isn't measured.
+ * @param[in] config: unused.
+ * @param[in] walk_area: #QwalkArea_t whose objects to clone.
+ * @param[out] sample: #BenchSample_t to fill out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_attr_list_clone(/*@unused@*/const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample) {
+	QattrList_t **clones;
+	int objc = bench_area_objc_get(walk_area);
+
+	(void) config;
+
+	if ((clones = calloc((size_t) objc, sizeof(*clones))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return Q_ERROR;
+	}
+
+	bench_sample_start(sample);
+	for (int i = 0; i < objc; i++) {
+		clones[i] = qattr_list_clone(bench_attr_list_get(walk_area, i));
+	}
+	bench_sample_stop(sample);
+	sample->ops = (size_t) objc;
+
+	for (int i = 0; i < objc; i++) {
+		qattr_list_destroy(clones[i]);
+	}
+	free(clones);
+
+	return Q_OK;
+}
+
+
+/**
+ * Benchmark qattr_list_value_get(); one operation looks up one attribute.
+ * Every attribute of every object of the area is looked up.
+ * @param[in] config: unused.
+ * @param[in] walk_area: #QwalkArea_t whose attributes to look up.
+ * @param[out] sample: #BenchSample_t to fill out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_attr_list_value_get(/*@unused@*/const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample) {
+	QattrList_t *attr_list;
+	size_t ops = 0;
+	size_t found = 0;
+	int objc = bench_area_objc_get(walk_area);
+
+	(void) config;
+
+	bench_sample_start(sample);
+	for (int i = 0; i < objc; i++) {
+		attr_list = bench_attr_list_get(walk_area, i);
+		for (int j = 0; j < (int) qattr_list_index_ok_get(attr_list); j++) {
+			if (qattr_list_value_get(attr_list,
+						qattr_list_attr_key_get(attr_list, j)) != NULL) {
+				found++;
+			}
+			ops++;
+		}
+	}
+	bench_sample_stop(sample);
+	sample->ops = ops;
+
+	if (found != ops) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Benchmark qattr_list_attr_delete(); one operation deletes one attribute.
+ * The first attribute of a clone of every object is deleted, such that the
+ * last one takes its place; objects of a single attribute, which may not be
+ * emptied, are skipped. Cloning and destroying the clones isn't measured.
+ * @param[in] config: unused.
+ * @param[in] walk_area: #QwalkArea_t whose objects to clone.
+ * @param[out] sample: #BenchSample_t to fill out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_attr_list_attr_delete(/*@unused@*/const BenchConfig_t *config,
+		QwalkArea_t *walk_area, BenchSample_t *sample) {
+	QattrList_t **clones;
+	size_t ops = 0;
+	int objc = bench_area_objc_get(walk_area);
+	int returnval = Q_OK;
+
+	(void) config;
+
+	if ((clones = calloc((size_t) objc, sizeof(*clones))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return Q_ERROR;
+	}
+	for (int i = 0; i < objc; i++) {
+		clones[i] = qattr_list_clone(bench_attr_list_get(walk_area, i));
+	}
+
+	bench_sample_start(sample);
+	for (int i = 0; i < objc; i++) {
+		if (qattr_list_index_ok_get(clones[i]) < (size_t) 2) {
+			continue;
+		}
+		if (qattr_list_attr_delete(&clones[i],
+					qattr_list_attr_key_get(clones[i], 0)) == Q_ERROR) {
+			returnval = Q_ERROR;
+		}
+		ops++;
+	}
+	bench_sample_stop(sample);
+	sample->ops = ops;
+
+	for (int i = 0; i < objc; i++) {
+		qattr_list_destroy(clones[i]);
+	}
+	free(clones);
+
+	if (returnval == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+	return returnval;
+}
+
+
+/**
+ * Run a benchmark and print its results as a JSON object.
+ * @c ns_per_op is the median over the repetitions, with the fastest and the
+ * mean given alongside; allocations are averaged over every repetition.
+ * @param[in] config: relevant #BenchConfig_t.
+ * @param[in] walk_area: #QwalkArea_t to run against.
+ * @param[in] name: name of the benchmark.
+ * @param[in] func: #BenchFunc_t performing one run.
+ * @param[in] isfirst: whether this is the first benchmark printed.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+bench_run(const BenchConfig_t *config, QwalkArea_t *walk_area,
+		const char *name, BenchFunc_t func, bool isfirst) {
+	BenchSample_t sample;
+	double ns_per_op[BENCH_REPETITIONS_MAX];
+	double ns_sum = 0;
+	size_t ops = 0;
+	size_t allocs = 0;
+	size_t bytes = 0;
+	size_t file_bytes = 0;
+
+	for (int i = 0; i < config->warmup + config->repetitions; i++) {
+		memset(&sample, 0, sizeof(sample));
+		if (func(config, walk_area, &sample) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if (i < config->warmup) {
+			continue;
+		}
+		/* a run may have nothing to do, e.g. deleting from single attributes */
+		ns_per_op[i - config->warmup] = (sample.ops == 0) ? 0
+			: (double) sample.ns / (double) sample.ops;
+		ns_sum += ns_per_op[i - config->warmup];
+		ops += sample.ops;
+		allocs += sample.allocs;
+		bytes += sample.bytes;
+		file_bytes = sample.file_bytes;
+	}
+	qsort(ns_per_op, (size_t) config->repetitions, sizeof(*ns_per_op),
+			bench_ns_compare);
+
+	printf("%s\t\t{\"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.1f, "
+			"\"ns_per_op_min\": %.1f, \"ns_per_op_mean\": %.1f, "
+			"\"bytes_per_op\": %.1f, \"allocs_per_op\": %.2f, "
+			"\"file_bytes\": %zu}",
+			isfirst ? "" : ",\n", name, ops / (size_t) config->repetitions,
+			ns_per_op[config->repetitions / 2], ns_per_op[0],
+			ns_sum / config->repetitions,
+			(ops == 0) ? 0 : (double) bytes / (double) ops,
+			(ops == 0) ? 0 : (double) allocs / (double) ops, file_bytes);
+	(void) fflush(stdout);
+
+	return Q_OK;
+}
+
+
+/**
+ * Start measuring a #BenchSample_t.
+ * @param[in,out] sample: relevant #BenchSample_t.
+ */
+void
+bench_sample_start(BenchSample_t *sample) {
+	sample->allocs_start = bench_allocs;
+	sample->bytes_start = bench_alloc_bytes;
+	sample->ns_start = bench_now();
+	return;
+}
+
+
+/**
+ * Stop measuring a #BenchSample_t, and add what was measured to it.
+ * @param[in,out] sample: relevant #BenchSample_t.
+ */
+void
+bench_sample_stop(BenchSample_t *sample) {
+	sample->ns += bench_now() - sample->ns_start;
+	sample->allocs += bench_allocs - sample->allocs_start;
+	sample->bytes += bench_alloc_bytes - sample->bytes_start;
+	return;
+}
+
+
+/**
+ * Read the monotonic clock.
+ * @return nanoseconds since an arbitrary point in time.
+ */
+uint64_t
+bench_now() {
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+		Q_ERROR_SYSTEM("clock_gettime()");
+		return 0;
+	}
+	return (uint64_t) ts.tv_sec * 1000000000U + (uint64_t) ts.tv_nsec;
+}
+
+
+/**
+ * Compare two @c double for qsort().
+ * @param[in] a: first @c double.
+ * @param[in] b: second @c double.
+ * @return negative, zero or positive as @p a is less than, equal to or
+ * greater than @p b.
+ */
+int
+bench_ns_compare(const void *a, const void *b) {
+	double x = *((const double *) a);
+	double y = *((const double *) b);
+
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * Print the help message for the bench program.
+ */
+void
+bench_print_help() {
+	printf("usage: bench [-h] [-s YxX] [-a ATTRC] [-d DENSITY] [-l SIZE] [-w WARMUP] [-r REPS] [-f FILE]\n");
+	printf("\t-h: print this help message.\n");
+	printf("\t-s: rows and columns of the area, up to %d each (default %dx%d).\n",
+			QWALK_LAYER_DIMENSION_MAX, QWALK_LAYER_SIZE_Y, QWALK_LAYER_SIZE_X);
+	printf("\t-a: attributes per object, 1 to %d (default 5).\n", BENCH_KEYC);
+	printf("\t-d: percentage of floater tiles holding an object (default 50).\n");
+	printf("\t-l: bytes in every long description (default 256).\n");
+	printf("\t-w: runs of each benchmark before measuring (default 2).\n");
+	printf("\t-r: measured runs of each benchmark, up to %d (default 10).\n",
+			BENCH_REPETITIONS_MAX);
+	printf("\t-f: scratch file for the area I/O benchmarks (default %s).\n",
+			BENCH_FILENAME_DEFAULT);
+	printf("Results are printed to stdout as JSON.\n");
+	return;
+}
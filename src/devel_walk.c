@@ -7,6 +7,9 @@
 
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 #include <string.h>
 #include <errno.h>
@@ -28,10 +31,10 @@
 
 
 /*@null@*//*@only@*/
-static QwalkArea_t *devel_walk_area_default_create(void);
+static QwalkArea_t *devel_walk_area_default_create(int, int);
 /*@null@*//*@only@*/
 static QwalkArea_t *devel_walk_area_load(const char *);
-static int          devel_walk_area_write(const QwalkArea_t *, const char *);
+static int          devel_walk_area_write(const QwalkArea_t *, const char *, bool);
 static void         devel_walk_print_help(void);
 
 
@@ -48,32 +51,91 @@ int main(int argc, char **argv) {
 	DevelWalkCmd_t cmd = DEVEL_WALK_CMD_INIT;
 	int r;
 	char file_path[QFILE_MAX_PATH_SIZE];
+	char convert_path[QFILE_MAX_PATH_SIZE];
+	bool isconvert = false;
+	bool iscompress = false;
+	bool iscompact = false;
 	WINDOW *area_win, *area_border_win, *info_win, *info_border_win;
 	int curs_loc[] = {0, 0, 0};
+	int size_y = QWALK_LAYER_SIZE_Y;
+	int size_x = QWALK_LAYER_SIZE_X;
 
 	strcpy(file_path, QFILE_DEVEL_WALK_DEFAULT);
 
 	/* parse command line args */
-	while ((opt = getopt(argc, argv, "hf:")) != -1) {
+	while ((opt = getopt(argc, argv, "hf:c:zjs:")) != -1) {
 		switch (opt) {
 		case 'h':
 			devel_walk_print_help();
 			exit(EXIT_SUCCESS);
 		case 'f':
-			strcpy(file_path, optarg); 
+			if (strlen(optarg) >= sizeof(file_path)) {
+				devel_walk_print_help();
+				exit(EXIT_FAILURE);
+			}
+			strcpy(file_path, optarg);
+			break;
+		case 'c':
+			if (strlen(optarg) >= sizeof(convert_path)) {
+				devel_walk_print_help();
+				exit(EXIT_FAILURE);
+			}
+			strcpy(convert_path, optarg);
+			isconvert = true;
+			break;
+		case 'z':
+			iscompress = true;
+			break;
+		case 'j':
+			iscompact = true;
+			break;
+		case 's':
+			/* tiles are indexed by int, so their number must fit one */
+			if ((sscanf(optarg, "%dx%d", &size_y, &size_x) != 2)
+					|| (size_y <= 0) || (size_y > QWALK_LAYER_DIMENSION_MAX)
+					|| (size_x <= 0) || (size_x > QWALK_LAYER_DIMENSION_MAX)
+					|| (size_y > INT_MAX / size_x)) {
+				devel_walk_print_help();
+				exit(EXIT_FAILURE);
+			}
 			break;
 		default:
 			devel_walk_print_help();
 			exit(EXIT_FAILURE);
 		}
 	}
+	if (iscompact) {
+		if (qwalk_journal_compact(file_path) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			exit(EXIT_FAILURE);
+		}
+		exit(EXIT_SUCCESS);
+	}
+	if (isconvert) {
+		if (qwalk_area_file_convert(file_path, convert_path, iscompress) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			exit(EXIT_FAILURE);
+		}
+		exit(EXIT_SUCCESS);
+	}
+	/* saving would leave the journal behind, stale; fold it in first */
+	if (qwalk_journal_exists(file_path)) {
+		if (fprintf(stderr, "%s has a journal under %s; fold it in via -j or "
+					"remove it first\n", file_path, QWALK_JOURNAL_DIR) < 0) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+		exit(EXIT_FAILURE);
+	}
 	if (access(file_path, F_OK) != 0) {
-		walk_area = devel_walk_area_default_create();
+		walk_area = devel_walk_area_default_create(size_y, size_x);
 	}	else {
 		walk_area = devel_walk_area_load(file_path);
 	}
 	assert(walk_area != NULL);
 
+	r = devel_walkl_cursor_chunk_populate(walk_area, curs_loc);
+	assert(r != Q_ERROR);
+
 	r = devel_walkio_init();
 	assert(r != Q_ERROR);
 
@@ -93,7 +155,7 @@ int main(int argc, char **argv) {
 		assert((cmd >= (DevelWalkCmd_t) Q_ENUM_VALUE_START) && (cmd <= DEVEL_WALK_CMD_COUNT));
 
 		if (cmd == DEVEL_WALK_CMD_SAVE) {
-			r = devel_walk_area_write(walk_area, file_path);
+			r = devel_walk_area_write(walk_area, file_path, iscompress);
 			if (r == Q_ERROR) {
 				if (devel_walkio_message_print(DEVEL_WALKIO_MESSAGE_SAVE_ERROR) == Q_ERROR) {
 					Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -129,7 +191,7 @@ QwalkArea_t *
 devel_walk_area_load(const char *filepath) {
 	
 	QwalkArea_t *walk_area;
-	if (qfile_open(filepath, QFILE_MODE_READ) == Q_ERROR) {
+	if (qfile_open(filepath, QFILE_MODE_READ_MAPPED) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
@@ -148,21 +210,27 @@ devel_walk_area_load(const char *filepath) {
 
 /**
  * Write a #QwalkArea_t to storage.
+ * Projects are always saved in the columnar format.
  * @param[in] walk_area: #QwalkArea_t to write.
  * @param[in] filepath:  filepath to write to.
+ * @param[in] compress:  whether to save a compressed block file.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-devel_walk_area_write(const QwalkArea_t *walk_area, const char *filepath) {
+devel_walk_area_write(const QwalkArea_t *walk_area, const char *filepath,
+		bool compress) {
 
 	int returnval = Q_OK;
 
-	if (qfile_open(filepath, QFILE_MODE_WRITE) == Q_ERROR) {
+	if (qfile_open(filepath, QFILE_MODE_WRITE_ATOMIC) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
-	if (qwalk_area_write(walk_area) == Q_ERROR) {
+	if (compress && (qfile_compression_set() == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	} else if (qwalk_area_v2_write(walk_area) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returnval = Q_ERROR;
 	}
@@ -179,17 +247,21 @@ devel_walk_area_write(const QwalkArea_t *walk_area, const char *filepath) {
 /**
  * Generate a default #QwalkArea_t.
  * Used for initializing a default #QwalkArea_t; the specific values depend on
- * the QATTR_KEY_*_DEFAULT_* class of defines from @ref qfile.h.
+ * the QATTR_KEY_*_DEFAULT_* class of defines from @ref qfile.h. Only the
+ * chunks covering the default-sized region in the corner are populated; the
+ * rest are populated as the cursor enters them.
+ * @param[in] size_y: number of rows of the area.
+ * @param[in] size_x: number of columns of the area.
  * @return newly-generated #QwalkArea_t.
  */
 QwalkArea_t *
-devel_walk_area_default_create() {
+devel_walk_area_default_create(int size_y, int size_x) {
 	QwalkLayer_t *walk_layer_earth;
 	QwalkLayer_t *walk_layer_floater;
 	QwalkArea_t  *walk_area;
 
-	walk_layer_earth = qwalk_layer_create();
-	walk_layer_floater = qwalk_layer_create();
+	walk_layer_earth = qwalk_layer_create(size_y, size_x);
+	walk_layer_floater = qwalk_layer_create(size_y, size_x);
 
 	if ((walk_layer_earth == NULL) || (walk_layer_floater == NULL)) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
@@ -197,20 +269,22 @@ devel_walk_area_default_create() {
 	}
 
 
-	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
+	for (int y = 0; (y < size_y) && (y < QWALK_LAYER_SIZE_Y); y += QWALK_CHUNK_SIZE_Y) {
+		for (int x = 0; (x < size_x) && (x < QWALK_LAYER_SIZE_X); x += QWALK_CHUNK_SIZE_X) {
 
-		if ((qdefault_qwalk_layer_object_incomplete(walk_layer_earth, i,
-						DEVEL_WALK_LAYER_EARTH_OBJ_TYPE_DEFAULT)) == Q_ERROR) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
-		}
+			if ((qdefault_qwalk_layer_chunk_fill(walk_layer_earth, y, x,
+							DEVEL_WALK_LAYER_EARTH_OBJ_TYPE_DEFAULT)) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				abort();
+			}
 
-		if ((qdefault_qwalk_layer_object_incomplete(walk_layer_floater, i,
-						DEVEL_WALK_LAYER_FLOATER_OBJ_TYPE_DEFAULT)) == Q_ERROR) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
-		}
+			if ((qdefault_qwalk_layer_chunk_fill(walk_layer_floater, y, x,
+							DEVEL_WALK_LAYER_FLOATER_OBJ_TYPE_DEFAULT)) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				abort();
+			}
 
+		}
 	}
 
 	walk_area = qwalk_area_create(walk_layer_earth, walk_layer_floater);
@@ -233,10 +307,21 @@ devel_walk_print_help() {
 				"\n"
 				"Without a specified filename, projects are saved in walk_area.dat\n"
 				"\n"
-				"Usage: devel_walk [-f filename] [-h]\n"
+				"Usage: devel_walk [-f filename] [-c filename] [-s YxX] [-z] [-j] [-h]\n"
 				"\n"
 				"-f <filename> Load from and use as save file\n"
+				"-c <filename> Convert the save file to the columnar format, write it\n"
+				"              to filename, and exit\n"
+				"-s <Y>x<X>    Size of a new area (25x50 by default); its chunks\n"
+				"              are populated as the cursor enters them; at most\n"
+				"              65535 a side, and 2147483647 tiles in all\n"
+				"-z            Compress the save file (and the -c file)\n"
+				"-j            Fold the journal of the save file (kept under saves/),\n"
+				"              i.e. the saves of play sessions, into it and exit;\n"
+				"              required before editing a file which has one\n"
 				"-h            Print help (this message) and exit\n"
+				"\n"
+				"Filenames may be up to 254 characters long.\n"
 				) < 0) {
 		Q_ERRORFOUND (QERROR_ERRORVAL);
 	}
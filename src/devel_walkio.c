@@ -140,6 +140,11 @@
 /** The window to draw the border for #info_win.       */
 /*@null@*/static WINDOW *info_border_win = NULL;
 
+/** Row of the #QwalkArea_t shown on the first line of #area_win.      */
+static int devel_walkio_view_y = 0;
+/** Column of the #QwalkArea_t shown on the first column of #area_win. */
+static int devel_walkio_view_x = 0;
+
 /** 
  * Stores string from user. 
  */
@@ -235,6 +240,7 @@ static int devel_walkio_info_out(const QwalkArea_t *, const int *, DevelWalkIOIn
 static int devel_walkio_string_input_raw(const char *);
 static int devel_walkio_string_input_choice(QattrKey_t);
 static DevelWalkCmd_t devel_walkio_input_to_command(int);
+static int devel_walkio_view_origin_get(int, int, int)/*@*/;
 
 
 
@@ -522,7 +528,8 @@ devel_walkio_out(const QwalkArea_t *walk_area, const int *curs_loc) {
 	
 	box(info_border_win, 0, 0);
 	
-	if (wmove(area_win, curs_loc[0], curs_loc[1]) == ERR) {
+	if (wmove(area_win, curs_loc[0] - devel_walkio_view_y,
+				curs_loc[1] - devel_walkio_view_x) == ERR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returnval = Q_ERROR;
 	}
@@ -552,6 +559,8 @@ devel_walkio_out(const QwalkArea_t *walk_area, const int *curs_loc) {
 
 /**
  * Output the state to the screen.
+ * Only the part of @p walk_area in view is drawn; the view scrolls to keep the
+ * cursor within it, and unpopulated chunks are left blank.
  * @param[in] walk_area: #QwalkArea_t to output to the screen.
  * @param[in] curs_loc: y, x, z coords of the cursor.
  * @return #Q_OK or #Q_ERROR.
@@ -560,10 +569,12 @@ int
 devel_walkio_area_out(const QwalkArea_t *walk_area, const int *curs_loc) {
 	/*@observer@*/QattrList_t *layer_object_attr_list;
 	/*@observer@*/Qdatameta_t *datameta_value;
+	const QwalkChunk_t *chunk;
 	QobjType_t *obj_typep;
 	chtype outch;
-	int *coords;
-	int r;
+	int height, width;
+	int y_end, x_end;
+	int local;
 	int returnval = Q_OK;
 
 	/* routine error-checking */
@@ -575,11 +586,6 @@ devel_walkio_area_out(const QwalkArea_t *walk_area, const int *curs_loc) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
-	if ((!(qwalk_logic_coords_arevalid(curs_loc[0], curs_loc[1])))
-			|| ((curs_loc[2] != 0) && (curs_loc[2] != 1))) {
-		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
-		return Q_ERROR;
-	}
 
 	/*@observer@*/QwalkLayer_t *layer_earth; 
 	layer_earth = qwalk_area_layer_earth_get(walk_area);
@@ -595,57 +601,85 @@ devel_walkio_area_out(const QwalkArea_t *walk_area, const int *curs_loc) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
+
+	if ((!(qwalk_logic_coords_arevalid(layer_earth, curs_loc[0], curs_loc[1])))
+			|| ((curs_loc[2] != 0) && (curs_loc[2] != 1))) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	getmaxyx(area_win, height, width);
+	devel_walkio_view_y = devel_walkio_view_origin_get(curs_loc[0],
+			devel_walkio_view_y, height);
+	devel_walkio_view_x = devel_walkio_view_origin_get(curs_loc[1],
+			devel_walkio_view_x, width);
+	y_end = devel_walkio_view_y + height < layer_earth->size_y
+		? devel_walkio_view_y + height : layer_earth->size_y;
+	x_end = devel_walkio_view_x + width < layer_earth->size_x
+		? devel_walkio_view_x + width : layer_earth->size_x;
+
+	if (werase(area_win) == ERR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
 	
 	/*
-	 * iterate through both layers and print their contents to the screen;
-	 * print everything on layer_earth and then print layer_floater non-void
-	 * objects
+	 * iterate through both layers and print their contents in view to the
+	 * screen; print everything on layer_earth and then print layer_floater
+	 * non-void objects
 	 */
 	for (int i = 0; i < 2; i++) {
-		for (int j = 0; j < QWALK_LAYER_SIZE; j++) {
-			if (i == 0) {
-				layer_object_attr_list = qwalk_layer_object_attr_list_get(layer_earth, j);
-			} else {
-				layer_object_attr_list = qwalk_layer_object_attr_list_get(layer_floater, j);
-			}
-			if (layer_object_attr_list == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-	
-			datameta_value = qattr_list_value_get(layer_object_attr_list, QATTR_KEY_QOBJECT_TYPE);
-			if (datameta_value == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-	
-			if (qdatameta_type_get(datameta_value) != QDATA_TYPE_QOBJECT_TYPE) {
-				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
-				abort();
-			}
-	
-			obj_typep = ((QobjType_t *) (qdatameta_datap_get(datameta_value)));
-			if (obj_typep == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-			
-			/* if *obj_typep isn't a layer_floater void, print it to the screen */
-			if ((*obj_typep != QOBJ_TYPE_VOID) || (i != 1)) {
-				
-				outch = qwalk_obj_type_to_chtype(*obj_typep);
-				if (outch == (chtype) ERR) {
-					Q_ERRORFOUND(QERROR_ERRORVAL);
+		for (int y = devel_walkio_view_y; y < y_end; y++) {
+			for (int x = devel_walkio_view_x; x < x_end; x++) {
+				if (i == 0) {
+					chunk = qwalk_layer_chunk_get(layer_earth,
+							(y * layer_earth->size_x) + x, &local);
+				} else {
+					chunk = qwalk_layer_chunk_get(layer_floater,
+							(y * layer_floater->size_x) + x, &local);
+				}
+				/* unpopulated chunks are void */
+				if (chunk == NULL) {
+					continue;
+				}
+				layer_object_attr_list = chunk->objects[local].attr_list;
+				if (layer_object_attr_list == NULL) {
+					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+					return Q_ERROR;
+				}
+		
+				datameta_value = qattr_list_value_get(layer_object_attr_list, QATTR_KEY_QOBJECT_TYPE);
+				if (datameta_value == NULL) {
+					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+					return Q_ERROR;
+				}
+		
+				if (qdatameta_type_get(datameta_value) != QDATA_TYPE_QOBJECT_TYPE) {
+					Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
 					abort();
 				}
-	
-				coords = qwalk_index_to_coords(j);
-				r = mvwaddch(area_win, coords[0], coords[1], outch);
-				free(coords);
-				if (r != OK) {
-					Q_ERRORFOUND(QERROR_ERRORVAL);
+		
+				obj_typep = ((QobjType_t *) (qdatameta_datap_get(datameta_value)));
+				if (obj_typep == NULL) {
+					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 					return Q_ERROR;
 				}
+				
+				/* if *obj_typep isn't a layer_floater void, print it to the screen */
+				if ((*obj_typep != QOBJ_TYPE_VOID) || (i != 1)) {
+					
+					outch = qwalk_obj_type_to_chtype(*obj_typep);
+					if (outch == (chtype) ERR) {
+						Q_ERRORFOUND(QERROR_ERRORVAL);
+						abort();
+					}
+		
+					if (mvwaddch(area_win, y - devel_walkio_view_y,
+								x - devel_walkio_view_x, outch) != OK) {
+						Q_ERRORFOUND(QERROR_ERRORVAL);
+						return Q_ERROR;
+					}
+				}
 			}
 		}
 	}
@@ -1281,3 +1315,22 @@ devel_walkio_input_to_command(int ch) {
 		return DEVEL_WALK_CMD_WAIT;
 	}
 }
+
+
+/**
+ * Scroll the view along one dimension just enough to keep the cursor in it.
+ * @param[in] curs: coordinate of the cursor.
+ * @param[in] origin: current first coordinate in view.
+ * @param[in] span: length of the view.
+ * @return new first coordinate in view.
+ */
+int
+devel_walkio_view_origin_get(int curs, int origin, int span) {
+	if (curs < origin) {
+		return curs;
+	}
+	if (curs >= origin + span) {
+		return curs - span + 1;
+	}
+	return origin;
+}
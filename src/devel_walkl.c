@@ -22,8 +22,8 @@
 
 
 
-static int  devel_walkl_cursor_move(int *, DevelWalkCmd_t);
-static bool devel_walkl_coords_arevalid(int, int, int)/*@*/;
+static int  devel_walkl_cursor_move(const QwalkArea_t *, int *, DevelWalkCmd_t);
+static bool devel_walkl_coords_arevalid(const QwalkArea_t *, int, int, int)/*@*/;
 
 
 
@@ -56,9 +56,13 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 
 	/* check if cmd is a cursor movement command */
 	if ((cmd >= DEVEL_WALK_CMD_MOVE_MIN) && (cmd <= DEVEL_WALK_CMD_MOVE_MAX)) {
-		if (devel_walkl_cursor_move(curs_loc, cmd) == Q_ERROR) {
+		if (devel_walkl_cursor_move(walk_area, curs_loc, cmd) == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 		}
+		if (devel_walkl_cursor_chunk_populate(walk_area, curs_loc) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
 	}
 
 	/* check if cmd is a modify command */
@@ -184,7 +188,7 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 				}
 			}
 
-			if ((index = qwalk_coords_to_index(curs_loc[0], curs_loc[1])) 
+			if ((index = qwalk_coords_to_index(layer, curs_loc[0], curs_loc[1]))
 					== Q_ERRORCODE_INT) {
 				Q_ERRORFOUND(QERROR_ERRORVAL);
 				return Q_ERROR;
@@ -241,10 +245,8 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 			QattrKey_t key;
 			Qdatameta_t *datameta;
 			QobjType_t obj_type;
-			QobjType_t *obj_typep;
-			char  *char_data; 
 			size_t userstring_len;
-			bool *boolptr;
+			bool canmove;
 
 			if ((attr_list = devel_walkl_loc_attr_list_get(walk_area, curs_loc)) == NULL) {
 				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
@@ -263,13 +265,7 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 			case QATTR_KEY_QOBJECT_TYPE:
 				/* devel_walkio sets userint to the int version of the new value */
 				obj_type = (QobjType_t) devel_walkio_userint_get();
-				if ((obj_typep = calloc((size_t) 1, sizeof(QobjType_t))) == NULL) {
-					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-					return Q_ERROR;
-				}
-
-				*obj_typep = obj_type;
-				if ((datameta = qdatameta_create((Qdata_t *) obj_typep, 
+				if ((datameta = qdatameta_copy_create(&obj_type,
 								QDATA_TYPE_QOBJECT_TYPE, (size_t) 1)) == NULL) {
 					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 					abort();
@@ -280,14 +276,9 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 
 			case QATTR_KEY_CANMOVE:
 				
-				if ((boolptr = calloc((size_t) 1, sizeof(*boolptr))) == NULL) {
-					Q_ERRORFOUND(QERROR_SYSTEM_MEMORY);
-					return Q_ERROR;
-				}
+				canmove = (bool) devel_walkio_userint_get();
 
-				*boolptr = (bool) devel_walkio_userint_get();
-
-				if ((datameta = qdatameta_create((Qdata_t *) boolptr, 
+				if ((datameta = qdatameta_copy_create(&canmove,
 							QDATA_TYPE_BOOL, (size_t) 1)) == NULL) {
 					Q_ERRORFOUND(QERROR_ERRORVAL);
 					abort();
@@ -303,13 +294,8 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 			/*@fallthrough@*/
 			case QATTR_KEY_QDL_FILE:
 				/*@i1@*/userstring_len = strlen(devel_walkio_userstring_get()) + (size_t) 1;
-				if ((char_data = calloc(userstring_len, sizeof(*char_data))) == NULL) {
-					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-					return Q_ERROR;
-				}
-				/*@i2@*/strcpy(char_data, devel_walkio_userstring_get());
 
-				if ((datameta = qdatameta_create((Qdata_t *) char_data,
+				/*@i1@*/if ((datameta = qdatameta_copy_create(devel_walkio_userstring_get(),
 								QDATA_TYPE_CHAR_STRING, userstring_len)) == NULL) {
 					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 					return Q_ERROR;
@@ -330,19 +316,60 @@ devel_walkl_tick(QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 }
 
 
+/**
+ * Populate the chunk under the cursor if it isn't already.
+ * Both layers get default objects for every unset tile of the chunk, so that
+ * the cursor always rests on tiles that can be edited.
+ * @param[out] walk_area: #QwalkArea_t to operate on.
+ * @param[in]  curs_loc:  y, x, z coords of cursor.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+devel_walkl_cursor_chunk_populate(QwalkArea_t *walk_area, const int *curs_loc) {
+	QwalkLayer_t *layer_earth;
+	QwalkLayer_t *layer_floater;
+
+	if ((walk_area == NULL) || (curs_loc == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (!devel_walkl_coords_arevalid(walk_area, curs_loc[0], curs_loc[1], curs_loc[2])) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	if (((layer_earth = qwalk_area_layer_earth_get(walk_area)) == NULL)
+			|| ((layer_floater = qwalk_area_layer_floater_get(walk_area)) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if ((qdefault_qwalk_layer_chunk_fill(layer_earth, curs_loc[0], curs_loc[1],
+					DEVEL_WALK_LAYER_EARTH_OBJ_TYPE_DEFAULT) == Q_ERROR)
+			|| (qdefault_qwalk_layer_chunk_fill(layer_floater, curs_loc[0], curs_loc[1],
+					DEVEL_WALK_LAYER_FLOATER_OBJ_TYPE_DEFAULT) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	return Q_OK;
+}
+
+
 /**
  * Move the cursor according to a command.
+ * @param[in]  walk_area: #QwalkArea_t bounding the cursor.
  * @param[out] curs_loc: y, x, z coords.
  * @param[in]  cmd:      relevant #DevelWalkCmd_t.
  * @return #Q_OK, #Q_ERROR, or #Q_ERROR_NOCHANGE if the move wasn't allowed.
  */
 int
-devel_walkl_cursor_move(int *curs_loc, DevelWalkCmd_t cmd) {
+devel_walkl_cursor_move(const QwalkArea_t *walk_area, int *curs_loc, DevelWalkCmd_t cmd) {
 	int y_new = curs_loc[0];
 	int x_new = curs_loc[1];
 	int z_new = curs_loc[2];
 
-	if (!devel_walkl_coords_arevalid(y_new, x_new, z_new))	{
+	if (!devel_walkl_coords_arevalid(walk_area, y_new, x_new, z_new))	{
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return Q_ERROR;
 	}
@@ -375,7 +402,7 @@ devel_walkl_cursor_move(int *curs_loc, DevelWalkCmd_t cmd) {
 		return Q_ERROR;
 	}
 
-	if (devel_walkl_coords_arevalid(y_new, x_new, z_new)) {
+	if (devel_walkl_coords_arevalid(walk_area, y_new, x_new, z_new)) {
 		curs_loc[0] = y_new;
 		curs_loc[1] = x_new;
 		curs_loc[2] = z_new;
@@ -402,7 +429,7 @@ devel_walkl_loc_attr_list_get(const QwalkArea_t *walk_area, const int *curs_loc)
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return NULL;
 	}
-	if (!devel_walkl_coords_arevalid(curs_loc[0], curs_loc[1], curs_loc[2])) {
+	if (!devel_walkl_coords_arevalid(walk_area, curs_loc[0], curs_loc[1], curs_loc[2])) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		return NULL;
 	}
@@ -416,7 +443,7 @@ devel_walkl_loc_attr_list_get(const QwalkArea_t *walk_area, const int *curs_loc)
 		return NULL;
 	}
 
-	if ((index = qwalk_coords_to_index(curs_loc[0], curs_loc[1])) == Q_ERRORCODE_INT) {
+	if ((index = qwalk_coords_to_index(layer, curs_loc[0], curs_loc[1])) == Q_ERRORCODE_INT) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
@@ -448,7 +475,7 @@ devel_walkl_loc_attr_list_set(QwalkArea_t *walk_area, const int *curs_loc, Qattr
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
 	}
-	if (!devel_walkl_coords_arevalid(curs_loc[0], curs_loc[1], curs_loc[2])) {
+	if (!devel_walkl_coords_arevalid(walk_area, curs_loc[0], curs_loc[1], curs_loc[2])) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
@@ -464,15 +491,13 @@ devel_walkl_loc_attr_list_set(QwalkArea_t *walk_area, const int *curs_loc, Qattr
 		return Q_ERROR;
 	}
 
-	if ((index = qwalk_coords_to_index(curs_loc[0], curs_loc[1])) == Q_ERRORCODE_INT) {
+	if ((index = qwalk_coords_to_index(layer, curs_loc[0], curs_loc[1])) == Q_ERRORCODE_INT) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
 	}
 	
-	qattr_list_destroy(layer->objects[index].attr_list);
-
-	layer->objects[index].attr_list = attr_list;
+	qwalk_layer_object_attr_list_replace(layer, index, attr_list);
 
 	return Q_OK;
 }
@@ -480,26 +505,29 @@ devel_walkl_loc_attr_list_set(QwalkArea_t *walk_area, const int *curs_loc, Qattr
 
 /**
  * Check the validity of a set of coordinates.
+ * @param[in] walk_area: #QwalkArea_t bounding the coordinates.
  * @param[in] y: y coord.
  * @param[in] x: x coord.
  * @param[in] z: z coord.
  * @return @c true or @c false.
  */
 bool
-devel_walkl_coords_arevalid(int y, int x, int z) {
+devel_walkl_coords_arevalid(const QwalkArea_t *walk_area, int y, int x, int z) {
+	const QwalkLayer_t *layer;
+
 	/* check against minimum values */
 	if ((y < QWALK_LAYER_COORD_MINIMUM)
 			|| (x < QWALK_LAYER_COORD_MINIMUM)
 			|| (z < QWALK_LAYER_COORD_MINIMUM)) {
 		return false;
-	/* check y and x maximum values */
-	} else if ((y >= QWALK_LAYER_SIZE_Y) || (x >= QWALK_LAYER_SIZE_X)) {
-		return false;
 	/* check z maximum value */
 	} else if (z > (QWALK_AREA_TOTAL_LAYER_COUNT - 1)) {
 		return false;
+	/* check y and x maximum values */
+	} else if ((layer = qwalk_area_layer_earth_get(walk_area)) == NULL) {
+		return false;
 	} else {
-		return true;
+		return qwalk_logic_coords_arevalid(layer, y, x);
 	}
 
 }
@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <string.h>
 #include <stdbool.h>
@@ -20,9 +22,24 @@
 #include "splint_types.h"
 
 #include "dialogue.h"
+#include "qreflect.h"
 
 
 
+/* every #DialogueCommand_t but #DIALOGUE_COMMAND_EMPTY must have a string */
+_Static_assert((0 DIALOGUE_COMMAND_TABLE(QREFLECT_ONE))
+		== DIALOGUE_COMMAND_EMPTY - Q_ENUM_VALUE_START,
+		"DIALOGUE_COMMAND_TABLE disagrees with DialogueCommand_t");
+
+/** String version of each #DialogueCommand_t. */
+static const char *const dialogue_command_strings[DIALOGUE_COMMAND_COUNT + 1] = {
+	DIALOGUE_COMMAND_TABLE(QREFLECT_STRING)
+};
+
+/** Reflection table of #DialogueCommand_t. */
+static Qreflect_t dialogue_command_reflect = QREFLECT_INITIALIZER(
+		dialogue_command_strings, Q_ENUM_VALUE_START, DIALOGUE_COMMAND_COUNT);
+
 /** Argument to be accessed by other modules. */
 /*@i1@*/static char arg_external[DIALOGUE_SECTION_SIZE_MAX] = "";
 
@@ -59,7 +76,8 @@ static void dialogue_sections_counter_destroy(int branchesc, /*@only@*/int *obje
 
 static long file_size_get(FILE *fp)/*@modifies fileSystem, fp@*/;
 
-static DialogueCommand_t string_to_dialogue_command(const char *s)/*@*/;
+static DialogueCommand_t string_to_dialogue_command(const char *s)
+	/*@modifies dialogue_command_reflect@*/;
 
 
 
@@ -958,15 +976,12 @@ file_size_get(FILE *fp) {
  */
 DialogueCommand_t
 string_to_dialogue_command(const char *s) {
+	int command;
 
-	if (strcmp(s, DIALOGUE_STRING_COMMAND_GOTO) == 0) {
-		return DIALOGUE_COMMAND_GOTO;
-	} else if (strcmp(s, DIALOGUE_STRING_COMMAND_BECOME) == 0) {
-		return DIALOGUE_COMMAND_BECOME;
-	} else if (strcmp(s, DIALOGUE_STRING_COMMAND_EXIT) == 0) {
-		return DIALOGUE_COMMAND_EXIT;
-	} else {
+	if ((command = qreflect_constant_get(&dialogue_command_reflect, s))
+			== Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		return (DialogueCommand_t) Q_ERRORCODE_ENUM;
 	}
+	return (DialogueCommand_t) command;
 }
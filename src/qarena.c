@@ -0,0 +1,160 @@
+/**
+ * @file qarena.c
+ * Program file for the arena module.
+ * Memory is bumped out of the latest chunk, aligned for any type; once a
+ * chunk is full, another is allocated in front of it. Nothing is freed until
+ * the whole arena is, so that a #QwalkLayer_t read from a file is torn down
+ * with a handful of calls to free() rather than several per object.
+ */
+
+
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "qarena.h"
+
+
+
+/** Alignment of every allocation from a #Qarena_t. */
+#define QARENA_ALIGNMENT _Alignof(max_align_t)
+
+
+
+static /*@null@*//*@only@*/QarenaChunk_t *qarena_chunk_create(size_t size);
+
+
+
+/**
+ * Create an empty #Qarena_t.
+ * Its first chunk is only allocated upon its first allocation.
+ * @return new #Qarena_t or @c NULL upon failure.
+ * @allocs{1} for returned pointer.
+ */
+Qarena_t *
+qarena_create() {
+	Qarena_t *arena;
+
+	if ((arena = calloc((size_t) 1, sizeof(*arena))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	arena->chunks = NULL;
+	arena->heapc = 0;
+	return arena;
+}
+
+
+/**
+ * Allocate zeroed memory from a #Qarena_t.
+ * The memory is aligned for any type, and lives until qarena_destroy().
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] size: number of bytes to allocate.
+ * @return pointer to the memory or @c NULL upon failure.
+ */
+void *
+qarena_alloc(Qarena_t *arena, size_t size) {
+	QarenaChunk_t *chunk;
+	size_t padding = 0;
+
+	if (size == 0) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+	if (size > SIZE_MAX - QARENA_ALIGNMENT) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+
+	chunk = arena->chunks;
+	if (chunk != NULL) {
+		padding = (QARENA_ALIGNMENT
+				- ((uintptr_t) (chunk->bytes + chunk->used) % QARENA_ALIGNMENT))
+			% QARENA_ALIGNMENT;
+	}
+
+	if ((chunk == NULL) || (padding + size > chunk->size - chunk->used)) {
+		if ((chunk = qarena_chunk_create(size + QARENA_ALIGNMENT
+						> (size_t) QARENA_CHUNK_SIZE
+						? size + QARENA_ALIGNMENT
+						: (size_t) QARENA_CHUNK_SIZE)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return NULL;
+		}
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		padding = (QARENA_ALIGNMENT
+				- ((uintptr_t) chunk->bytes % QARENA_ALIGNMENT))
+			% QARENA_ALIGNMENT;
+	}
+
+	chunk->used += padding + size;
+	return chunk->bytes + chunk->used - size;
+}
+
+
+/**
+ * Note that heap memory hangs off memory of a #Qarena_t.
+ * Whoever owns the arena must then free such memory before destroying it.
+ * @param[in,out] arena: relevant #Qarena_t.
+ */
+void
+qarena_heap_note(Qarena_t *arena) {
+	arena->heapc++;
+	return;
+}
+
+
+/**
+ * Tell whether no heap memory hangs off memory of a #Qarena_t.
+ * @see qarena_heap_note().
+ * @param[in] arena: relevant #Qarena_t.
+ * @return whether @p arena may be destroyed without visiting its contents.
+ */
+bool
+qarena_isclean(const Qarena_t *arena) {
+	return arena->heapc == 0;
+}
+
+
+/**
+ * Free a #Qarena_t along with everything allocated from it.
+ * @param[out] arena: #Qarena_t to free from memory.
+ */
+void
+qarena_destroy(Qarena_t *arena) {
+	QarenaChunk_t *chunk;
+
+	while ((chunk = arena->chunks) != NULL) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+	return;
+}
+
+
+/**
+ * Allocate a zeroed chunk for a #Qarena_t.
+ * @param[in] size: number of bytes in the chunk.
+ * @return new #QarenaChunk_t or @c NULL upon failure.
+ */
+QarenaChunk_t *
+qarena_chunk_create(size_t size) {
+	QarenaChunk_t *chunk;
+
+	if ((chunk = calloc((size_t) 1, sizeof(*chunk) + size)) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
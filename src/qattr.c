@@ -4,6 +4,7 @@
  */
 
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
@@ -14,7 +15,51 @@
 #include "qerror.h"
 
 #include "qattr.h"
+#include "qarena.h"
 #include "qfile.h"
+#include "qreflect.h"
+
+
+
+/* every #QattrKey_t must have a string */
+_Static_assert((0 QATTR_KEY_TABLE(QREFLECT_ONE))
+		== QATTR_KEY_COUNT - Q_ENUM_VALUE_START + 1,
+		"QATTR_KEY_TABLE disagrees with QattrKey_t");
+
+/* every #QattrKey_t must have a bit in QattrList_t.keymask */
+_Static_assert(QATTR_KEY_COUNT < 32, "QattrKey_t outgrew QattrList_t.keymask");
+
+/** String version of each #QattrKey_t. */
+static const char *const qattr_key_strings[QATTR_KEY_COUNT + 1] = {
+	QATTR_KEY_TABLE(QREFLECT_STRING)
+};
+
+/** Reflection table of #QattrKey_t. */
+static Qreflect_t qattr_key_reflect = QREFLECT_INITIALIZER(qattr_key_strings,
+		Q_ENUM_VALUE_START, QATTR_KEY_COUNT);
+
+
+
+/*@null@*//*@observer@*/
+static const Qattr_t *qattr_list_attr_get(const QattrList_t *attr_list,
+		size_t index)/*@*/;
+static int    qattr_list_reserve(QattrList_t *attr_list, size_t capacity_min)
+	/*@modifies attr_list@*/;
+static int    qattr_list_attr_remove(QattrList_t *attr_list, QattrKey_t key)
+	/*@modifies attr_list@*/;
+static int    qattr_list_materialize(QattrList_t *attr_list)
+	/*@modifies attr_list@*/;
+static size_t qattr_list_inheritc_count(const QattrList_t *attr_list)/*@*/;
+static unsigned long qattr_list_keymask_build(const QattrList_t *attr_list)
+	/*@*/;
+static void   qattr_list_slot_rebuild(QattrList_t *attr_list, QattrKey_t key)
+	/*@modifies attr_list@*/;
+static void   qattr_list_store_sync(const QattrList_t *attr_list);
+static void   qattr_store_entry_set(QattrStore_t *store, size_t index,
+		/*@null@*/const QattrList_t *attr_list)/*@modifies store@*/;
+static unsigned long qattr_store_query_word(const QattrStore_t *store,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		size_t word)/*@*/;
 
 
 
@@ -28,6 +73,11 @@
 QattrList_t*
 qattr_list_create(size_t count){
 	QattrList_t *qattr_listp;
+	if (count > (size_t) QATTR_LIST_COUNT_MAX) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+	/* calloc() also leaves every key of the slot table out of the list */
 	qattr_listp        = calloc((size_t) 1, sizeof(*qattr_listp));
 	if (qattr_listp == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
@@ -41,14 +91,141 @@ qattr_list_create(size_t count){
 	}
 
 	qattr_listp->count = count;
+	qattr_listp->capacity = count;
 	/* Initialize index_ok to zero because it is the first available index */
 	qattr_listp->index_ok = (size_t) 0;
+	qattr_listp->arena = NULL;
+	qattr_listp->prototype = NULL;
+	qattr_listp->inheritc = 0;
+	qattr_listp->store = NULL;
+	qattr_listp->store_index = 0;
+	qattr_listp->keymask = 0;
+	return qattr_listp;
+}
+
+
+/**
+ * Create a #QattrList_t in a #Qarena_t.
+ * The list and its attrp member are allocated from @p arena, next to those of
+ * the lists created before it. qattr_list_destroy() then only destroys the
+ * values of the list which aren't in @p arena themselves; the rest is freed
+ * along with @p arena.
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] count: the number of #Qattr_t to allocate memory for
+ * @return pointer to a newly allocated #QattrList_t or @c NULL upon failure
+ */
+QattrList_t *
+qattr_list_arena_create(Qarena_t *arena, size_t count) {
+	QattrList_t *qattr_listp;
+	if (count > (size_t) QATTR_LIST_COUNT_MAX) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+	/* arena memory is zeroed, like that of calloc() */
+	if ((qattr_listp = qarena_alloc(arena, sizeof(*qattr_listp))) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	/* an empty list still gets an attrp of its own, as from calloc() */
+	if ((qattr_listp->attrp = qarena_alloc(arena, (count > 0 ? count : 1)
+					* sizeof(*(qattr_listp->attrp)))) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	qattr_listp->count = count;
+	qattr_listp->capacity = count > 0 ? count : 1;
+	qattr_listp->index_ok = (size_t) 0;
+	qattr_listp->arena = arena;
+	qattr_listp->prototype = NULL;
+	qattr_listp->inheritc = 0;
+	qattr_listp->store = NULL;
+	qattr_listp->store_index = 0;
+	qattr_listp->keymask = 0;
 	return qattr_listp;
 }
 
 
+/**
+ * Create a #QattrList_t inheriting every attribute of a prototype.
+ * The new list holds no attribute of its own; those set or modified later on
+ * override the inherited ones, and the prototype itself is never written to.
+ * Many lists may thus share a single prototype at the cost of one allocation
+ * each.
+ * @param[in] prototype: #QattrList_t to inherit from; must outlive the new
+ * list, and must not have a prototype of its own.
+ * @return pointer to a newly allocated #QattrList_t or @c NULL upon failure
+ * @allocs{1} for returned pointer.
+ */
+QattrList_t *
+qattr_list_prototype_create(const QattrList_t *prototype) {
+	QattrList_t *qattr_listp;
+
+	if (prototype->prototype != NULL) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+	if ((qattr_listp = calloc((size_t) 1, sizeof(*qattr_listp))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+
+	qattr_listp->count = 0;
+	qattr_listp->capacity = 0;
+	qattr_listp->attrp = NULL;
+	qattr_listp->index_ok = (size_t) 0;
+	qattr_listp->arena = NULL;
+	qattr_listp->prototype = prototype;
+	qattr_listp->inheritc = qattr_list_inheritc_count(qattr_listp);
+	qattr_listp->store = NULL;
+	qattr_listp->store_index = 0;
+	qattr_listp->keymask = prototype->keymask;
+	return qattr_listp;
+}
+
+
+/**
+ * Make a #QattrList_t inherit every attribute of another prototype.
+ * Attributes of the list's own are destroyed, such that it ends up just as if
+ * created by qattr_list_prototype_create().
+ * @param[out] attr_list: #QattrList_t to alter; must be on the heap.
+ * @param[in] prototype: #QattrList_t to inherit from; see
+ * qattr_list_prototype_create().
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_prototype_set(QattrList_t *attr_list, const QattrList_t *prototype) {
+
+	if ((attr_list->arena != NULL) || (prototype->prototype != NULL)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	for (size_t i = 0; i < attr_list->index_ok; i++) {
+		if (attr_list->attrp[i].key != QATTR_KEY_EMPTY) {
+			qdatameta_destroy(attr_list->attrp[i].valuep);
+		}
+	}
+	/*@i1@*/free(attr_list->attrp);
+
+	attr_list->attrp = NULL;
+	attr_list->count = 0;
+	attr_list->capacity = 0;
+	attr_list->index_ok = (size_t) 0;
+	memset(attr_list->slots, 0, sizeof(attr_list->slots));
+	attr_list->prototype = prototype;
+	attr_list->inheritc = qattr_list_inheritc_count(attr_list);
+	attr_list->keymask = prototype->keymask;
+	qattr_list_store_sync(attr_list);
+	return Q_OK;
+}
+
+
 /**
  * Clone a #QattrList_t.
+ * A clone shares the prototype of @p attr_listr, if any, and only copies the
+ * attributes overriding it. Their values are shared as well, via
+ * qdatameta_share(), rather than copied.
  * @param[in] attr_listr: pointer to #QattrList_t to clone.
  * @return clone of @p attr_list.
  */
@@ -71,7 +248,13 @@ qattr_list_clone(const QattrList_t *attr_listr) {
 		return NULL;
 	}
 
-	attr_list = qattr_list_create(count);
+	if (attr_listr->prototype != NULL) {
+		/* the attributes of the list's own come first */
+		attr_list = qattr_list_prototype_create(attr_listr->prototype);
+		count = attr_listr->index_ok;
+	} else {
+		attr_list = qattr_list_create(count);
+	}
 	if (attr_list == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		abort();
@@ -84,7 +267,7 @@ qattr_list_clone(const QattrList_t *attr_listr) {
 			abort();
 		}
 		
-		datameta = qdatameta_clone(qattr_list_value_get(attr_listr, attr_key));
+		datameta = qdatameta_share(qattr_list_value_get(attr_listr, attr_key));
 		if (datameta == NULL) {
 			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);;
 			abort();
@@ -103,10 +286,16 @@ qattr_list_clone(const QattrList_t *attr_listr) {
 
 /**
  * Destroy a #QattrList_t
+ * Its prototype, if any, is left alone, and its entry in @ref
+ * QattrList_t.store, if any, is emptied.
  * @param[in] qattr_list: #QattrList_t to free from memory
  */
 void
 qattr_list_destroy(QattrList_t *qattr_list) {
+	if (qattr_list->store != NULL) {
+		qattr_store_entry_set(qattr_list->store, qattr_list->store_index, NULL);
+	}
+
 	for (int i = 0; i < (int) qattr_list->index_ok; i++) {
 		if (qattr_list->attrp[i].key != QATTR_KEY_EMPTY) {
 			qdatameta_destroy(qattr_list->attrp[i].valuep);
@@ -114,6 +303,11 @@ qattr_list_destroy(QattrList_t *qattr_list) {
 		}
 	}
 
+	/* the rest is freed along with the arena */
+	if (qattr_list->arena != NULL) {
+		return;
+	}
+
 	/*@i1@*/free(qattr_list->attrp);
 	free(qattr_list);
 	return;
@@ -121,7 +315,10 @@ qattr_list_destroy(QattrList_t *qattr_list) {
 
 
 /**
- * Resize a #QattrList_t.
+ * Resize a #QattrList_t in place.
+ * Attributes past the new size are destroyed; growing only reallocates once
+ * @ref QattrList_t.capacity runs out. Anything inherited from a prototype is
+ * copied into the list first.
  * @param[out] qattr_list: #QattrList_t to resize.
  * @param[in] dilation_addend: amount to add to the original size (can be
  * negative).
@@ -131,9 +328,13 @@ QattrList_t *
 qattr_list_resize(QattrList_t *qattr_list, int dilation_addend) {
 	size_t count_orig;
 	size_t count_new;
+	Qattr_t *attr;
 
-	QattrKey_t key_old;
-	Qdatameta_t *datameta_old;
+	if (qattr_list_materialize(qattr_list) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qattr_list_destroy(qattr_list);
+		return NULL;
+	}
 
 	if ((count_orig = qattr_list_count_get(qattr_list))
 			== (size_t) Q_ERRORCODE_SIZE) {
@@ -148,61 +349,57 @@ qattr_list_resize(QattrList_t *qattr_list, int dilation_addend) {
 		qattr_list_destroy(qattr_list);
 		return NULL;
 	}
-
 	count_new = (size_t) ((int) count_orig + dilation_addend);
 
-	/*@only@*/
-	QattrList_t *list_new;
-
-	if ((list_new = qattr_list_create(count_new)) == NULL) {
+	if (qattr_list_reserve(qattr_list, count_new) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		qattr_list_destroy(qattr_list);
 		return NULL;
 	}
 
-	size_t sz;
-
-	/* copy over all that we're allowed to given the new size */
-	for (sz = 0; (sz < count_orig) && (sz < count_new); sz++) {
-		if ((key_old = qattr_list_attr_key_get(qattr_list, (int) sz)) ==
-				(QattrKey_t) Q_ERRORCODE_ENUM) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
+	/* clean up leftover attributes past the new size */
+	while (qattr_list->index_ok > count_new) {
+		attr = &qattr_list->attrp[--qattr_list->index_ok];
+		if (attr->key == QATTR_KEY_EMPTY) {
+			continue;
 		}
-		
-		if ((datameta_old = qattr_list_value_get(qattr_list, key_old)) == NULL) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
+		if (qattr_list->slots[attr->key]
+				== (unsigned char) (qattr_list->index_ok + 1)) {
+			qattr_list_slot_rebuild(qattr_list, attr->key);
 		}
-
-		if (qattr_list_attr_set(list_new, key_old, datameta_old) == Q_ERROR) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
-		}
-	/*@i1@*/}
-
-	size_t index_ok_old;
-	/*@i1@*/index_ok_old = qattr_list_index_ok_get(qattr_list);
-
-	/* clean up leftover attributes in the original */
-	while (sz < index_ok_old) {
-		/*@i1@*/qdatameta_destroy(qattr_list->attrp[sz].valuep);
-		sz++;
+		qdatameta_destroy(attr->valuep);
+		attr->key = QATTR_KEY_EMPTY;
+		attr->valuep = NULL;
 	}
-	/*@i1@*/free(qattr_list->attrp);
-	/*@i1@*/free(qattr_list);
+	qattr_list->count = count_new;
+	qattr_list->keymask = qattr_list_keymask_build(qattr_list);
+	qattr_list_store_sync(qattr_list);
 
-	return list_new;
+	return qattr_list;
 }
 
 
 /**
- * Write a #QattrList_t to storage.
+ * Write a #QattrList_t to the file opened via qfile_open().
+ * @see qattr_list_handle_write().
  * @param[in] attr_list: #QattrList_t to write; must be completely filled out.
  * @return #Q_OK or #Q_ERROR.
  */
 int
 qattr_list_write(const QattrList_t *attr_list) {
+	return qattr_list_handle_write(qfile_handle_default_get(), attr_list);
+}
+
+
+/**
+ * Write a #QattrList_t to a #QfileHandle_t.
+ * @param[out] handle: #QfileHandle_t to write to.
+ * @param[in] attr_list: #QattrList_t to write; must be completely filled out.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_handle_write(QfileHandle_t *handle, const QattrList_t *attr_list) {
+	const Qattr_t *attr;
 	int r;
 	int returnval = Q_OK;
 
@@ -211,20 +408,26 @@ qattr_list_write(const QattrList_t *attr_list) {
 		return Q_ERROR;
 	}
 
-	r = qfile_size_write(attr_list->count);
+	r = qfile_handle_size_write(handle, qattr_list_count_get(attr_list));
 	if (r == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returnval = Q_ERROR;
 	}
 
-	for (int i = 0; i < (int) attr_list->count; i++) {
-		r = qfile_qattr_key_write(attr_list->attrp[i].key);
+	/* inherited attributes are written out like any other */
+	for (size_t i = 0; i < qattr_list_count_get(attr_list); i++) {
+		if ((attr = qattr_list_attr_get(attr_list, i)) == NULL) {
+			Q_ERRORFOUND(QERROR_STRUCT_INCOMPLETE);
+			return Q_ERROR;
+		}
+
+		r = qfile_handle_qattr_key_write(handle, attr->key);
 		if (r == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			returnval = Q_ERROR;
 		}
 		
-		r = qfile_qdatameta_write(attr_list->attrp[i].valuep);
+		r = qfile_handle_qdatameta_write(handle, attr->valuep);
 		if (r == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			returnval = Q_ERROR;
@@ -236,46 +439,70 @@ qattr_list_write(const QattrList_t *attr_list) {
 
 
 /**
- * Read a #QattrList_t from storage.
+ * Read a #QattrList_t from the file opened via qfile_open().
+ * @see qattr_list_handle_read().
  * @return new #QattrList_t.
  */
 QattrList_t *
 qattr_list_read() {
+	return qattr_list_handle_read(qfile_handle_default_get());
+}
+
+
+/**
+ * Read a #QattrList_t from a #QfileHandle_t.
+ * Values of cold keys (see qattr_key_iscold()) are deferred if the handle
+ * allows it. The list and its values are allocated from @ref
+ * QfileHandle_t.arena, if set. A list cut short or otherwise malformed is
+ * dropped, such that e.g. a journal file can be checked before it is trusted.
+ * @param[in,out] handle: #QfileHandle_t to read from.
+ * @return new #QattrList_t or @c NULL.
+ */
+QattrList_t *
+qattr_list_handle_read(QfileHandle_t *handle) {
 	QattrList_t *attr_list;
 	size_t count;
 	QattrKey_t attr_key;
 	Qdatameta_t *datameta;
 	int r;
 
-	count = qfile_size_read();
+	count = qfile_handle_size_read(handle);
 	if (count == (size_t) Q_ERRORCODE_SIZE) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
 
-	attr_list = qattr_list_create(count);
+	attr_list = (handle->arena != NULL)
+		? qattr_list_arena_create(handle->arena, count)
+		: qattr_list_create(count);
 	if (attr_list == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		abort();
 	}
 
 	for (int i = 0; i < (int) count; i++) {
-		attr_key = qfile_qattr_key_read();
+		attr_key = qfile_handle_qattr_key_read(handle);
 		if (attr_key == (QattrKey_t) Q_ERRORCODE_ENUM) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
+			qattr_list_destroy(attr_list);
+			return NULL;
 		}
 		
-		datameta = qfile_qdatameta_read();
+		datameta = qattr_key_iscold(attr_key)
+			? qfile_handle_qdatameta_defer_read(handle)
+			: qfile_handle_qdatameta_read(handle);
 		if (datameta == NULL) {
-			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);;
-			abort();
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			qattr_list_destroy(attr_list);
+			return NULL;
 		}
 
 		r = qattr_list_attr_set(attr_list, attr_key, datameta);
 		if (r == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			abort();
+			qdatameta_destroy(datameta);
+			qattr_list_destroy(attr_list);
+			return NULL;
 		}
 	}
 
@@ -285,7 +512,9 @@ qattr_list_read() {
 
 /**
  * Fetch an attribute value
- * Fetches the value associated with a #QattrKey_t in a #QattrList_t.
+ * Fetches the value associated with a #QattrKey_t in a #QattrList_t, or else
+ * in its prototype. A deferred value is materialized first, and stays so from
+ * then on.
  * @param[in] attr_key: key whose value is to be found
  * @param[in] attr_list: list whose keys are to be parsed
  * @return #Qdatameta_t containing the value or @c NULL if the key doesn't exist.
@@ -301,6 +530,14 @@ qattr_list_value_get(const QattrList_t *attr_list, QattrKey_t attr_key) {
 	int index;
 	
 	if ((index = qattr_list_key_to_index(attr_list, attr_key)) == Q_ERRORCODE_INT) {
+		if (attr_list->prototype != NULL) {
+			return qattr_list_value_get(attr_list->prototype, attr_key);
+		}
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	if (qfile_qdatameta_resolve(attr_list->attrp[index].valuep) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
@@ -311,6 +548,8 @@ qattr_list_value_get(const QattrList_t *attr_list, QattrKey_t attr_key) {
 
 /**
  * Convert a #QattrKey_t to an index in a #QattrList_t.
+ * Looks @p attr_key up in @ref QattrList_t.slots, in constant time. Inherited
+ * attributes have no index in @ref QattrList_t.attrp, and aren't found.
  * @param[in] attr_list: relevant #QattrList_t.
  * @param[in] attr_key: #QattrKey_t to search for.
  * @return desired index or #Q_ERRORCODE_INT on error.
@@ -323,18 +562,18 @@ qattr_list_key_to_index(const QattrList_t *attr_list, QattrKey_t attr_key) {
 		return Q_ERRORCODE_INT;
 	}
 
-	for (int i = 0; i < (int) (attr_list->index_ok); i++) {
-		if (attr_list->attrp[i].key == attr_key) {
-			return i;
-		}
+	if (((unsigned int) attr_key > (unsigned int) QATTR_KEY_COUNT)
+			|| (attr_list->slots[attr_key] == 0)) {
+		return Q_ERRORCODE_INT;
 	}
 
-	return Q_ERRORCODE_INT;
+	return (int) attr_list->slots[attr_key] - 1;
 }
 
 
 /**
  * Get @ref QattrList_t.count.
+ * Inherited attributes count as well.
  * @param[in] attr_list: relevant attr_list.
  * @return @ref QattrList_t.count or #Q_ERRORCODE_SIZE.
  */ 
@@ -344,12 +583,13 @@ qattr_list_count_get(const QattrList_t *attr_list) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return (size_t) Q_ERRORCODE_SIZE;
 	}
-	return attr_list->count;
+	return attr_list->count + attr_list->inheritc;
 }
 
 
 /**
  * Get @ref QattrList_t.index_ok.
+ * Inherited attributes count as well.
  * @param[in] attr_list: relevant attr_list.
  * @return @ref QattrList_t.index_ok or #Q_ERRORCODE_SIZE.
  */ 
@@ -359,7 +599,7 @@ qattr_list_index_ok_get(const QattrList_t *attr_list) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return (size_t) Q_ERRORCODE_SIZE;
 	}
-	return attr_list->index_ok;
+	return attr_list->index_ok + attr_list->inheritc;
 }
 
 
@@ -371,23 +611,32 @@ qattr_list_index_ok_get(const QattrList_t *attr_list) {
  */ 
 QattrKey_t
 qattr_list_attr_key_get(const QattrList_t *attr_list, int index) {
+	const Qattr_t *attr;
 
 	if (attr_list == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return (QattrKey_t) Q_ERRORCODE_ENUM;
 	}
 
-	if (index >= (int) qattr_list_index_ok_get(attr_list)) {
+	if ((index < 0) || (index >= (int) qattr_list_index_ok_get(attr_list))) {
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return (QattrKey_t) Q_ERRORCODE_ENUM;
 	}
 
-	return attr_list->attrp[index].key;
+	if ((attr = qattr_list_attr_get(attr_list, (size_t) index)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return (QattrKey_t) Q_ERRORCODE_ENUM;
+	}
+
+	return attr->key;
 }
 
 
 /**
  * Add key/value pair to a #QattrList_t.
+ * Should @p attr_key already be in @p attr_list, lookups keep finding the
+ * earlier value; should it be inherited, the new value overrides it. A full
+ * list grows by one, reallocating only once its capacity runs out.
  * @param[out] attr_list: list to gain a key/value pair. Its @ref
  * #QattrList_t.index_ok is incremented with a successful addition.
  * @param[in]  attr_key: key to add to the #QattrList_t
@@ -399,11 +648,31 @@ qattr_list_attr_set(QattrList_t *attr_list, QattrKey_t attr_key, Qdatameta_t *da
 	size_t index_free = attr_list->index_ok; /* To ease readability */
 	
 	/* Validate attr_key */
-	assert((attr_key > (QattrKey_t) Q_ENUM_VALUE_START) || (attr_key < QATTR_KEY_COUNT));
+	assert((attr_key >= (QattrKey_t) Q_ENUM_VALUE_START) && (attr_key <= QATTR_KEY_COUNT));
+
+	if (index_free >= attr_list->count) {
+		if (qattr_list_reserve(attr_list, attr_list->count + 1) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		attr_list->count++;
+	}
+
+	if ((attr_list->arena != NULL) && !datameta->isarena) {
+		qarena_heap_note(attr_list->arena);
+	}
 
 	attr_list->attrp[index_free].key = attr_key;
 	attr_list->attrp[index_free].valuep = datameta;
+	if (attr_list->slots[attr_key] == 0) {
+		attr_list->slots[attr_key] = (unsigned char) (index_free + 1);
+	}
+	attr_list->keymask |= QATTR_KEY_BIT(attr_key);
 	(attr_list->index_ok)++; /* Index is no longer available; move to the next */
+	if (attr_list->prototype != NULL) {
+		attr_list->inheritc = qattr_list_inheritc_count(attr_list);
+	}
+	qattr_list_store_sync(attr_list);
 	return Q_OK;
 }
 
@@ -425,14 +694,23 @@ qattr_list_attrs_swap(QattrList_t *attr_list,
 	attr_list->attrp[movend_index] = mover_buffer;
 	attr_list->attrp[mover_index] = movend_buffer;
 
+	/* follow both keys in the slot table */
+	if (attr_list->slots[mover_buffer.key] == (unsigned char) (mover_index + 1)) {
+		attr_list->slots[mover_buffer.key] = (unsigned char) (movend_index + 1);
+	}
+	if (attr_list->slots[movend_buffer.key] == (unsigned char) (movend_index + 1)) {
+		attr_list->slots[movend_buffer.key] = (unsigned char) (mover_index + 1);
+	}
+
 	return;
 }
 
 /** 
  * Delete a #QattrKey_t/#Qdatameta_t pair in the given #QattrList_t.
  * If the selected #Qattr_t is not the final one in @p attr_list, replace the
- * deleted element's spot with the final element. Also, reallocate the memory to
- * fit the new size.
+ * deleted element's spot with the final element. The memory of the list is
+ * kept for later additions. Any inherited attribute is copied into the list
+ * first.
  * @param[out] attr_listp: pointer to the #QattrList_t to remove a #Qattr_t from.
  * @param[in] key: key in @p attr_list whose parent #Qattr_t should be removed.
  * @return #Q_OK or #Q_ERROR.
@@ -440,39 +718,97 @@ qattr_list_attrs_swap(QattrList_t *attr_list,
 int
 qattr_list_attr_delete(OnlyQattrListp_t *attr_listp, QattrKey_t key) {
 
-	int index;
-
-	if ((index = qattr_list_key_to_index(*attr_listp, key)) == Q_ERRORCODE_INT) {
+	if (qattr_list_attr_remove(*attr_listp, key) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
-	if ((*attr_listp)->attrp[index].key != QATTR_KEY_EMPTY) {
-		qdatameta_destroy((*attr_listp)->attrp[index].valuep);
+	return Q_OK;
+}
+
+
+/**
+ * Set many #QattrKey_t/#Qdatameta_t pairs in a #QattrList_t at once.
+ * Room for every pair is made up front. A key the list already has of its own
+ * gets its value replaced; any other key is added as by qattr_list_attr_set().
+ * @param[out] attr_list: #QattrList_t to alter.
+ * @param[in] keys: keys to set.
+ * @param[in] datametas: values of @p keys, in the same order. Every one of
+ * them is owned by @p attr_list or destroyed afterwards, even upon failure.
+ * @param[in] pairc: number of members of @p keys and @p datametas.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_attrs_set(QattrList_t *attr_list, const QattrKey_t *keys,
+		Qdatameta_t **datametas, size_t pairc) {
+	int index;
+	int r = Q_OK;
+
+	if (qattr_list_reserve(attr_list, attr_list->index_ok + pairc) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		r = Q_ERROR;
 	}
 
-	(*attr_listp)->attrp[index].key = QATTR_KEY_EMPTY;
+	for (size_t i = 0; i < pairc; i++) {
+		if (r == Q_ERROR) {
+			qdatameta_destroy(datametas[i]);
+			continue;
+		}
+		if ((keys[i] < (QattrKey_t) Q_ENUM_VALUE_START)
+				|| (keys[i] > QATTR_KEY_COUNT)) {
+			Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+			qdatameta_destroy(datametas[i]);
+			r = Q_ERROR;
+			continue;
+		}
 
-	/* 
-	 * if it's not the final attribute index-wise, trade its place with the final
-	 * attribute.
-	 */
-	(*attr_listp)->index_ok--;
-	if ((size_t) index != (*attr_listp)->index_ok) {
-		qattr_list_attrs_swap(*attr_listp, (size_t) index, (*attr_listp)->index_ok);
+		if ((index = qattr_list_key_to_index(attr_list, keys[i]))
+				!= Q_ERRORCODE_INT) {
+			qdatameta_destroy(attr_list->attrp[index].valuep);
+			attr_list->attrp[index].valuep = datametas[i];
+			if ((attr_list->arena != NULL) && !datametas[i]->isarena) {
+				qarena_heap_note(attr_list->arena);
+			}
+		} else if (qattr_list_attr_set(attr_list, keys[i], datametas[i])
+				== Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qdatameta_destroy(datametas[i]);
+			r = Q_ERROR;
+		}
 	}
+	qattr_list_store_sync(attr_list);
 
-	if (((*attr_listp) = qattr_list_resize((*attr_listp), -1)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		abort();
+	return r;
+}
+
+
+/**
+ * Delete many #Qattr_t in a #QattrList_t at once.
+ * Keys absent from @p attr_list are skipped, but still make for an error.
+ * @param[out] attr_list: #QattrList_t to remove members of.
+ * @param[in] keys: keys whose #Qattr_t should be removed.
+ * @param[in] keyc: number of members of @p keys.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_attrs_delete(QattrList_t *attr_list, const QattrKey_t *keys,
+		size_t keyc) {
+	int r = Q_OK;
+
+	for (size_t i = 0; i < keyc; i++) {
+		if (qattr_list_attr_remove(attr_list, keys[i]) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			r = Q_ERROR;
+		}
 	}
 
-	return Q_OK;
+	return r;
 }
 
 
 /**
  * Alter the value of an already-existing key in a #QattrList_t.
+ * An inherited key is overridden, leaving the prototype as it is.
  * @param[out] attr_list: #QattrList_t whose key is to be altered.
  * @param[in] attr_key: #QattrKey_t whose value will be set to @p datameta.
  * @param[in] datameta: #Qdatameta_t to add to @p attr_list.
@@ -490,12 +826,26 @@ qattr_list_attr_modify(QattrList_t *attr_list, QattrKey_t attr_key, Qdatameta_t
 	 * when the matching key is found, destroy its value and replace it with the
 	 * new one.
 	 */
-	for (int i = 0; i < (int) qattr_list_count_get(attr_list); i++) {
-		if (qattr_list_attr_key_get(attr_list, i) == attr_key) {
-			qdatameta_destroy(attr_list->attrp[i].valuep);
-			attr_list->attrp[i].valuep = datameta;
-			return Q_OK;
+	int index;
+	if ((index = qattr_list_key_to_index(attr_list, attr_key)) != Q_ERRORCODE_INT) {
+		qdatameta_destroy(attr_list->attrp[index].valuep);
+		attr_list->attrp[index].valuep = datameta;
+		if ((attr_list->arena != NULL) && !datameta->isarena) {
+			qarena_heap_note(attr_list->arena);
 		}
+		qattr_list_store_sync(attr_list);
+		return Q_OK;
+	}
+
+	if ((attr_list->prototype != NULL)
+			&& (qattr_list_key_to_index(attr_list->prototype, attr_key)
+				!= Q_ERRORCODE_INT)) {
+		if (qattr_list_attr_set(attr_list, attr_key, datameta) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qdatameta_destroy(datameta);
+			return Q_ERROR;
+		}
+		return Q_OK;
 	}
 
 	/* 
@@ -568,27 +918,13 @@ qattr_value_to_string(const QattrList_t *attr_list, QattrKey_t key) {
  */
 char *
 qattr_key_to_string(QattrKey_t key) {
-	switch (key) {
-		case QATTR_KEY_QOBJECT_TYPE:
-			return QATTR_STRING_KEY_QOBJECT_TYPE;
-		case QATTR_KEY_NAME:
-			return QATTR_STRING_KEY_NAME;
-		case QATTR_KEY_DESCRIPTION_BRIEF:
-			return QATTR_STRING_KEY_DESCRIPTION_BRIEF;
-		case QATTR_KEY_DESCRIPTION_LONG:
-			return QATTR_STRING_KEY_DESCRIPTION_LONG;
-		case QATTR_KEY_CANMOVE:
-			return QATTR_STRING_KEY_CANMOVE;
-		case QATTR_KEY_QDL_FILE:
-			return QATTR_STRING_KEY_QDL_FILE;
-		case QATTR_KEY_EMPTY:
-			return QATTR_STRING_KEY_EMPTY;
-		case QATTR_KEY_DEBUG:
-			return QATTR_STRING_KEY_DEBUG;
-		default:
-			Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
-			return QATTR_STRING_KEY_UNRECOGNIZED;
+	const char *s;
+
+	if ((s = qreflect_string_get(&qattr_key_reflect, (int) key)) == NULL) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return QATTR_STRING_KEY_UNRECOGNIZED;
 	}
+	/*@i1@*/return (char *) s;
 }
 
 
@@ -599,24 +935,593 @@ qattr_key_to_string(QattrKey_t key) {
  */
 QattrKey_t
 qattr_string_to_key(const char *s) {
-	if (strcmp(s, QATTR_STRING_KEY_QOBJECT_TYPE) == 0) {
-		return QATTR_KEY_QOBJECT_TYPE;
-	} else if (strcmp(s, QATTR_STRING_KEY_NAME) == 0) {
-		return QATTR_KEY_NAME;
-	} else if (strcmp(s, QATTR_STRING_KEY_DESCRIPTION_BRIEF) == 0) {
-		return QATTR_KEY_DESCRIPTION_BRIEF;
-	} else if (strcmp(s, QATTR_STRING_KEY_DESCRIPTION_LONG) == 0) {
-		return QATTR_KEY_DESCRIPTION_LONG;
-	} else if (strcmp(s, QATTR_STRING_KEY_CANMOVE) == 0) {
-		return QATTR_KEY_CANMOVE;
-	} else if (strcmp(s, QATTR_STRING_KEY_QDL_FILE) == 0) {
-		return QATTR_KEY_QDL_FILE;
-	} else if (strcmp(s, QATTR_STRING_KEY_EMPTY) == 0) {
-		return QATTR_KEY_EMPTY;
-	} else if (strcmp(s, QATTR_STRING_KEY_DEBUG) == 0) {
-		return QATTR_KEY_DEBUG;
-	} else {
+	int key;
+
+	if ((key = qreflect_constant_get(&qattr_key_reflect, s)) == Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 		return (QattrKey_t) Q_ERRORCODE_ENUM;
 	}
+	return (QattrKey_t) key;
+}
+
+
+/**
+ * Tell whether the values of a #QattrKey_t are cold.
+ * Cold values are long and seldom read (e.g. only upon inspecting or talking
+ * to an object), so they are left in the file upon loading an area and only
+ * read upon first access; see qfile_handle_qdatameta_defer_read().
+ * @param[in] key: relevant #QattrKey_t.
+ * @return whether @p key is cold.
+ */
+bool
+qattr_key_iscold(QattrKey_t key) {
+	return (key == QATTR_KEY_DESCRIPTION_LONG) || (key == QATTR_KEY_QDL_FILE);
+}
+
+
+/**
+ * Report why a typed getter such as qattr_list_bool_get() failed.
+ * Kept out of line, so that the getters themselves stay small.
+ * @param[in] attr_list: #QattrList_t the getter was called on.
+ * @param[in] key: #QattrKey_t the getter was called with.
+ * @param[in] type: #QdataType_t the getter returns.
+ */
+void
+qattr_list_typed_get_fail(const QattrList_t *attr_list, QattrKey_t key,
+		QdataType_t type) {
+	const Qdatameta_t *datameta;
+
+	if (qattr_key_type_get(key) != type) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+	} else if ((datameta = qattr_list_value_peek(attr_list, key)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	} else if (datameta->type != type) {
+		Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
+	} else {
+		Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
+	}
+	return;
+}
+
+
+/**
+ * Create a #QattrStore_t whose every entry is empty.
+ * @param[in] count: number of entries in the store.
+ * @return new #QattrStore_t or @c NULL upon failure.
+ * @allocs{6} for returned pointer and each of its arrays.
+ */
+QattrStore_t *
+qattr_store_create(size_t count) {
+	QattrStore_t *store;
+	size_t wordc = (count + QATTR_STORE_WORD_BITS - 1) / QATTR_STORE_WORD_BITS;
+
+	if ((store = calloc((size_t) 1, sizeof(*store))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	/* calloc() leaves every name, brief description and bit clear */
+	store->types = calloc(count, sizeof(*store->types));
+	store->canmove = calloc(wordc, sizeof(*store->canmove));
+	store->keybits = calloc((size_t) (QATTR_KEY_COUNT + 1) * wordc,
+			sizeof(*store->keybits));
+	store->typebits = calloc((size_t) (QOBJ_TYPE_COUNT + 1) * wordc,
+			sizeof(*store->typebits));
+	store->names = calloc(count, sizeof(*store->names));
+	store->briefs = calloc(count, sizeof(*store->briefs));
+	if ((store->types == NULL) || (store->canmove == NULL)
+			|| (store->keybits == NULL) || (store->typebits == NULL)
+			|| (store->names == NULL) || (store->briefs == NULL)) {
+		Q_ERROR_SYSTEM("calloc()");
+		qattr_store_destroy(store);
+		return NULL;
+	}
+
+	store->count = count;
+	store->wordc = wordc;
+	for (size_t i = 0; i < count; i++) {
+		store->types[i] = (QobjType_t) Q_ERRORCODE_ENUM;
+	}
+	return store;
+}
+
+
+/**
+ * Free a #QattrStore_t from memory.
+ * Lists still bound to it must be destroyed first, or not be altered again.
+ * @param[out] store: #QattrStore_t to free.
+ */
+void
+qattr_store_destroy(QattrStore_t *store) {
+	free(store->types);
+	free(store->canmove);
+	free(store->keybits);
+	free(store->typebits);
+	/*@i2@*/free(store->names);
+	free(store->briefs);
+	free(store);
+	return;
+}
+
+
+/**
+ * Mirror a #QattrList_t in an entry of a #QattrStore_t.
+ * The entry is filled in from @p attr_list, and kept in sync by every setter
+ * of this module until the list is bound elsewhere or destroyed. A list bound
+ * to the entry before is left alone, and must be bound elsewhere as well.
+ * @param[out] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry in @p store.
+ * @param[out] attr_list: #QattrList_t to mirror.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_store_bind(QattrStore_t *store, size_t index, QattrList_t *attr_list) {
+
+	if (index >= store->count) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		return Q_ERROR;
+	}
+
+	attr_list->store = store;
+	attr_list->store_index = index;
+	qattr_store_entry_set(store, index, attr_list);
+	return Q_OK;
+}
+
+
+/**
+ * Find every entry of a #QattrStore_t having some keys and being of some
+ * types, e.g. each NPC with a #QATTR_KEY_QDL_FILE.
+ * The bitsets of the store are intersected a word at a time, such that the
+ * entries themselves are never visited.
+ * @param[in] store: #QattrStore_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the entries must have;
+ * 0 for any.
+ * @param[in] types: #QobjType_t the entries may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[out] indices: ascending index of each matching entry; room for
+ * @ref QattrStore_t.count of them is needed.
+ * @return number of matching entries or #Q_ERRORCODE_SIZE.
+ */
+size_t
+qattr_store_query(const QattrStore_t *store, unsigned long keymask,
+		const QobjType_t *types, size_t typec, size_t *indices) {
+	unsigned long word;
+	size_t indexc = 0;
+
+	for (size_t i = 0; i < typec; i++) {
+		if ((types[i] < (QobjType_t) Q_ENUM_VALUE_START)
+				|| (types[i] > QOBJ_TYPE_COUNT)) {
+			Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+			return (size_t) Q_ERRORCODE_SIZE;
+		}
+	}
+
+	for (size_t w = 0; w < store->wordc; w++) {
+		word = qattr_store_query_word(store, keymask, types, typec, w);
+		while (word != 0) {
+			indices[indexc++] = (w * QATTR_STORE_WORD_BITS)
+				+ (size_t) __builtin_ctzl(word);
+			word &= word - 1;
+		}
+	}
+
+	return indexc;
+}
+
+
+/**
+ * Find the first entry of a #QattrStore_t within a range of indices having
+ * some keys and being of some types.
+ * Only the words of the bitsets overlapping the range are read, such that a
+ * short range (e.g. a row of a rectangle) is cheap however large the store.
+ * @see qattr_store_query().
+ * @param[in] store: #QattrStore_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the entry must have.
+ * @param[in] types: #QobjType_t the entry may be of, or @c NULL for any; each
+ * must be valid.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] start: index to search from.
+ * @param[in] end: index to search up to, excluded; at most @ref
+ * QattrStore_t.count.
+ * @return index of the entry, or @p end if there is none.
+ */
+size_t
+qattr_store_query_next(const QattrStore_t *store, unsigned long keymask,
+		const QobjType_t *types, size_t typec, size_t start, size_t end) {
+	unsigned long word;
+	size_t index;
+
+	if (start >= end) {
+		return end;
+	}
+
+	for (size_t w = start / QATTR_STORE_WORD_BITS;
+			w <= (end - 1) / QATTR_STORE_WORD_BITS; w++) {
+		word = qattr_store_query_word(store, keymask, types, typec, w);
+		if (w == start / QATTR_STORE_WORD_BITS) {
+			word &= ~0ul << (start % QATTR_STORE_WORD_BITS);
+		}
+		if (word != 0) {
+			index = (w * QATTR_STORE_WORD_BITS) + (size_t) __builtin_ctzl(word);
+			return index < end ? index : end;
+		}
+	}
+
+	return end;
+}
+
+
+/**
+ * Get a #Qattr_t of a #QattrList_t, inherited ones included.
+ * Indices past those of @ref QattrList_t.attrp address the inherited
+ * attributes, in the order of the prototype.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @param[in] index: index of the #Qattr_t.
+ * @return #Qattr_t or @c NULL if @p index is out of range.
+ */
+const Qattr_t *
+qattr_list_attr_get(const QattrList_t *attr_list, size_t index) {
+	const QattrList_t *prototype;
+
+	if (index < attr_list->index_ok) {
+		return &attr_list->attrp[index];
+	}
+	if ((prototype = attr_list->prototype) == NULL) {
+		return NULL;
+	}
+
+	index -= attr_list->index_ok;
+	for (size_t i = 0; i < prototype->index_ok; i++) {
+		/* overridden attributes are skipped */
+		if (attr_list->slots[prototype->attrp[i].key] != 0) {
+			continue;
+		}
+		if (index == 0) {
+			return &prototype->attrp[i];
+		}
+		index--;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * Make sure a #QattrList_t has room for a number of #Qattr_t.
+ * The capacity at least doubles, so that adding attributes one at a time costs
+ * amortized constant time. A list in a #Qarena_t gets its new room from the
+ * arena, leaving the old one to be freed along with it.
+ * @param[out] attr_list: relevant #QattrList_t.
+ * @param[in] capacity_min: number of #Qattr_t to make room for.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_reserve(QattrList_t *attr_list, size_t capacity_min) {
+	Qattr_t *attrp_new;
+	size_t capacity_new;
+
+	if (capacity_min <= attr_list->capacity) {
+		return Q_OK;
+	}
+	if (capacity_min > (size_t) QATTR_LIST_COUNT_MAX) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		return Q_ERROR;
+	}
+
+	capacity_new = attr_list->capacity * 2;
+	if (capacity_new < capacity_min) {
+		capacity_new = capacity_min;
+	}
+	if (capacity_new > (size_t) QATTR_LIST_COUNT_MAX) {
+		capacity_new = (size_t) QATTR_LIST_COUNT_MAX;
+	}
+
+	if (attr_list->arena != NULL) {
+		/* arena memory is zeroed already */
+		if ((attrp_new = qarena_alloc(attr_list->arena,
+						capacity_new * sizeof(*attrp_new))) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if (attr_list->capacity > 0) {
+			memcpy(attrp_new, attr_list->attrp,
+					attr_list->capacity * sizeof(*attrp_new));
+		}
+	} else {
+		/*@i1@*/if ((attrp_new = realloc(attr_list->attrp,
+						capacity_new * sizeof(*attrp_new))) == NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return Q_ERROR;
+		}
+		memset(attrp_new + attr_list->capacity, 0,
+				(capacity_new - attr_list->capacity) * sizeof(*attrp_new));
+	}
+
+	attr_list->attrp = attrp_new;
+	attr_list->capacity = capacity_new;
+	return Q_OK;
+}
+
+
+/**
+ * Remove a #Qattr_t from a #QattrList_t without reallocating it.
+ * The final #Qattr_t takes the place of the removed one. Any inherited
+ * attribute is copied into the list first. Should the list hold another
+ * #Qattr_t of @p key (see qattr_list_attr_set()), it is found from then on.
+ * @param[out] attr_list: relevant #QattrList_t.
+ * @param[in] key: key whose #Qattr_t should be removed.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_attr_remove(QattrList_t *attr_list, QattrKey_t key) {
+	int index;
+
+	if (qattr_list_materialize(attr_list) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if ((index = qattr_list_key_to_index(attr_list, key)) == Q_ERRORCODE_INT) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if (attr_list->attrp[index].key != QATTR_KEY_EMPTY) {
+		qdatameta_destroy(attr_list->attrp[index].valuep);
+	}
+
+	attr_list->slots[key] = 0;
+	attr_list->attrp[index].key = QATTR_KEY_EMPTY;
+	attr_list->attrp[index].valuep = NULL;
+
+	/* 
+	 * if it's not the final attribute index-wise, trade its place with the final
+	 * attribute.
+	 */
+	attr_list->index_ok--;
+	if ((size_t) index != attr_list->index_ok) {
+		qattr_list_attrs_swap(attr_list, (size_t) index, attr_list->index_ok);
+	}
+	qattr_list_slot_rebuild(attr_list, key);
+	attr_list->count--;
+	attr_list->keymask = qattr_list_keymask_build(attr_list);
+	qattr_list_store_sync(attr_list);
+
+	return Q_OK;
+}
+
+
+/**
+ * Copy every inherited attribute of a #QattrList_t into the list itself.
+ * This is the copy in copy-on-write, for changes that overrides can't express
+ * (e.g. deleting an inherited attribute). The list no longer has a prototype
+ * afterwards.
+ * @param[out] attr_list: relevant #QattrList_t; left alone if it has no
+ * prototype.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qattr_list_materialize(QattrList_t *attr_list) {
+	const QattrList_t *prototype;
+	unsigned char slots_own[QATTR_KEY_COUNT + 1];
+	Qdatameta_t *datameta;
+	QattrKey_t key;
+
+	if ((prototype = attr_list->prototype) == NULL) {
+		return Q_OK;
+	}
+
+	if (qattr_list_reserve(attr_list, attr_list->count + attr_list->inheritc)
+			== Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	memcpy(slots_own, attr_list->slots, sizeof(slots_own));
+	for (size_t i = 0; i < prototype->index_ok; i++) {
+		key = prototype->attrp[i].key;
+		if (slots_own[key] != 0) {
+			continue;
+		}
+		if ((datameta = qdatameta_share(prototype->attrp[i].valuep)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			attr_list->inheritc = qattr_list_inheritc_count(attr_list);
+			return Q_ERROR;
+		}
+		attr_list->attrp[attr_list->index_ok].key = key;
+		attr_list->attrp[attr_list->index_ok].valuep = datameta;
+		if (attr_list->slots[key] == 0) {
+			attr_list->slots[key] = (unsigned char) (attr_list->index_ok + 1);
+		}
+		attr_list->index_ok++;
+		attr_list->count++;
+	}
+
+	attr_list->prototype = NULL;
+	attr_list->inheritc = 0;
+	return Q_OK;
+}
+
+
+/**
+ * Count the attributes a #QattrList_t inherits from its prototype.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @return number of attributes of the prototype whose key isn't overridden.
+ */
+size_t
+qattr_list_inheritc_count(const QattrList_t *attr_list) {
+	size_t inheritc = 0;
+
+	if (attr_list->prototype == NULL) {
+		return 0;
+	}
+	for (size_t i = 0; i < attr_list->prototype->index_ok; i++) {
+		if (attr_list->slots[attr_list->prototype->attrp[i].key] == 0) {
+			inheritc++;
+		}
+	}
+	return inheritc;
+}
+
+
+/**
+ * Bring the entry of a #QattrList_t in its #QattrStore_t up to date.
+ * @param[in] attr_list: relevant #QattrList_t; left alone if it isn't bound
+ * to a store.
+ */
+void
+qattr_list_store_sync(const QattrList_t *attr_list) {
+	if (attr_list->store != NULL) {
+		qattr_store_entry_set(attr_list->store, attr_list->store_index,
+				attr_list);
+	}
+	return;
+}
+
+
+/**
+ * Fill in an entry of a #QattrStore_t from a #QattrList_t.
+ * Values that are absent, ill-typed or still deferred leave their part of the
+ * entry empty, without error; those asking the store report it instead.
+ * @param[out] store: relevant #QattrStore_t.
+ * @param[in] index: index of the entry in @p store.
+ * @param[in] attr_list: #QattrList_t to copy from, or @c NULL to empty the
+ * entry.
+ */
+void
+qattr_store_entry_set(QattrStore_t *store, size_t index,
+		const QattrList_t *attr_list) {
+	const Qdatameta_t *datameta;
+	size_t word = index / QATTR_STORE_WORD_BITS;
+	unsigned long bit = 1ul << (index % QATTR_STORE_WORD_BITS);
+	QobjType_t type;
+
+	if ((type = store->types[index]) != (QobjType_t) Q_ERRORCODE_ENUM) {
+		store->typebits[((size_t) type * store->wordc) + word] &= ~bit;
+	}
+	store->types[index] = (QobjType_t) Q_ERRORCODE_ENUM;
+	store->canmove[word] &= ~bit;
+	store->names[index] = NULL;
+	store->briefs[index] = NULL;
+	for (size_t key = 0; key <= (size_t) QATTR_KEY_COUNT; key++) {
+		if ((attr_list != NULL)
+				&& ((attr_list->keymask & QATTR_KEY_BIT(key)) != 0)) {
+			store->keybits[(key * store->wordc) + word] |= bit;
+		} else {
+			store->keybits[(key * store->wordc) + word] &= ~bit;
+		}
+	}
+	if (attr_list == NULL) {
+		return;
+	}
+
+	if (((datameta = qattr_list_value_peek(attr_list, QATTR_KEY_QOBJECT_TYPE))
+				!= NULL) && (datameta->type == QDATA_TYPE_QOBJECT_TYPE)
+			&& (datameta->count == 1)
+			&& ((type = *(const QobjType_t *) datameta->datap)
+				>= (QobjType_t) Q_ENUM_VALUE_START)
+			&& (type <= QOBJ_TYPE_COUNT)) {
+		store->types[index] = type;
+		store->typebits[((size_t) type * store->wordc) + word] |= bit;
+	}
+	if (((datameta = qattr_list_value_peek(attr_list, QATTR_KEY_CANMOVE))
+				!= NULL) && (datameta->type == QDATA_TYPE_BOOL)
+			&& (datameta->count == 1) && *(const bool *) datameta->datap) {
+		store->canmove[word] |= bit;
+	}
+	if (((datameta = qattr_list_value_peek(attr_list, QATTR_KEY_NAME)) != NULL)
+			&& (datameta->type == QDATA_TYPE_CHAR_STRING)
+			&& (datameta->source == NULL)) {
+		store->names[index] = (const char *) datameta->datap;
+	}
+	if (((datameta = qattr_list_value_peek(attr_list,
+						QATTR_KEY_DESCRIPTION_BRIEF)) != NULL)
+			&& (datameta->type == QDATA_TYPE_CHAR_STRING)
+			&& (datameta->source == NULL)) {
+		store->briefs[index] = (const char *) datameta->datap;
+	}
+	return;
+}
+
+
+/**
+ * Intersect the bitsets of a #QattrStore_t over a single word.
+ * @see qattr_store_query().
+ * @param[in] store: relevant #QattrStore_t.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key to require.
+ * @param[in] types: #QobjType_t to allow, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] word: index of the word in each bitset.
+ * @return bits of the matching entries within the word.
+ */
+unsigned long
+qattr_store_query_word(const QattrStore_t *store, unsigned long keymask,
+		const QobjType_t *types, size_t typec, size_t word) {
+	unsigned long bits = ~0ul;
+	unsigned long typebits;
+
+	/* entries past the end of the store never match */
+	if ((word == store->wordc - 1) && (store->count % QATTR_STORE_WORD_BITS != 0)) {
+		bits = (1ul << (store->count % QATTR_STORE_WORD_BITS)) - 1;
+	}
+
+	for (size_t key = 0; keymask != 0; key++, keymask >>= 1) {
+		if ((keymask & 1ul) != 0) {
+			bits &= store->keybits[(key * store->wordc) + word];
+		}
+	}
+
+	if (types != NULL) {
+		typebits = 0;
+		for (size_t i = 0; i < typec; i++) {
+			typebits |= store->typebits[((size_t) types[i] * store->wordc) + word];
+		}
+		bits &= typebits;
+	}
+
+	return bits;
+}
+
+
+/**
+ * Compute @ref QattrList_t.keymask from the slot table and prototype of a
+ * #QattrList_t.
+ * @param[in] attr_list: relevant #QattrList_t.
+ * @return the mask.
+ */
+unsigned long
+qattr_list_keymask_build(const QattrList_t *attr_list) {
+	unsigned long keymask = 0;
+
+	if (attr_list->prototype != NULL) {
+		keymask = attr_list->prototype->keymask;
+	}
+	for (size_t key = 0; key <= (size_t) QATTR_KEY_COUNT; key++) {
+		if (attr_list->slots[key] != 0) {
+			keymask |= QATTR_KEY_BIT(key);
+		}
+	}
+	return keymask;
+}
+
+
+/**
+ * Point the slot of a key of a #QattrList_t at its first #Qattr_t, if any.
+ * qattr_list_attr_set() appends rather than replaces, so a list may hold a
+ * key twice; once the #Qattr_t a slot points at is gone, the other one takes
+ * its place.
+ * @param[out] attr_list: relevant #QattrList_t.
+ * @param[in] key: key whose slot to rebuild.
+ */
+void
+qattr_list_slot_rebuild(QattrList_t *attr_list, QattrKey_t key) {
+	attr_list->slots[key] = 0;
+	for (size_t i = 0; i < attr_list->index_ok; i++) {
+		if (attr_list->attrp[i].key == key) {
+			attr_list->slots[key] = (unsigned char) (i + 1);
+			break;
+		}
+	}
+
+	return;
 }
@@ -83,12 +83,25 @@ static const QdefaultQwalkObject_t *default_qwalk_objects[] = {
 /** Number of elements in #default_qwalk_objects. */
 #define QDEFAULT_QWALK_OBJECTSC 3
 
+/**
+ * Shared prototype #QattrList_t of every #QobjType_t, indexed by type.
+ * Built upon first use by qdefault_qwalk_prototype_get(), and kept for the
+ * rest of the program, since every default object inherits from one.
+ */
+/*@null@*//*@only@*/static QattrList_t
+*default_qwalk_prototypes[QOBJ_TYPE_COUNT + 1] = { NULL };
+
 
 
 /*@null@*//*@only@*/
 static QattrList_t *qdefault_qwalk_default_attr_list_create(
 		QobjType_t type_search);
 
+/*@null@*//*@observer@*/
+static const QattrList_t *qdefault_qwalk_prototype_get(QobjType_t type)
+	/*@globals default_qwalk_objects, default_qwalk_prototypes@*/
+	/*@modifies default_qwalk_prototypes@*/;
+
 /*@null@*//*@only@*/
 static Qdatameta_t *qdefault_qwalk_default_datameta_create(
 		QobjType_t type_search, QattrKey_t key)
@@ -104,8 +117,9 @@ static int qdefault_qwalk_overrides_index_search(QattrKey_t key)
 
 /**
  * Update an object in a #QwalkLayer_t to a default.
- * Assumes that the object was previously defined. Wrapper function with regards
- * to @ref qdefault_qwalk_layer_object().
+ * Assumes that the object was previously defined. A list on the heap merely
+ * swaps its prototype (see qattr_list_prototype_set()); one in the arena of
+ * @p layer is replaced by a new one.
  * @param[in] layer: #QwalkLayer_t to operate on.
  * @param[in] index: index in @p layer of object to update.
  * @param[in] default_type: the #QobjType_t to initialize to.
@@ -115,13 +129,32 @@ int
 qdefault_qwalk_layer_object_replace(QwalkLayer_t *layer, int index,
 		QobjType_t default_type) {
 
-	qattr_list_destroy(layer->objects[index].attr_list);
+	const QattrList_t *prototype;
+	QattrList_t *attr_list;
 
-	if (qdefault_qwalk_layer_object(layer, index, default_type) == Q_ERROR) {
+	if ((prototype = qdefault_qwalk_prototype_get(default_type)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
-		abort();
+		return Q_ERROR;
 	}
 
+	if ((attr_list = qwalk_layer_object_attr_list_get(layer, index)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (attr_list->arena == NULL) {
+		if (qattr_list_prototype_set(attr_list, prototype) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		return Q_OK;
+	}
+
+	if ((attr_list = qattr_list_prototype_create(prototype)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	qwalk_layer_object_attr_list_replace(layer, index, attr_list);
+
 	return Q_OK;
 }
 
@@ -129,7 +162,8 @@ qdefault_qwalk_layer_object_replace(QwalkLayer_t *layer, int index,
 /**
  * Create an object in a #QwalkLayer_t as a default.
  * Assumes that @p layer isn't fully defined and is in the process of being
- * defined.
+ * defined. The object inherits its attributes from the prototype of @p
+ * default_type, and populates its chunk if need be.
  * @param[in] layer: #QwalkLayer_t to operate on.
  * @param[in] index: index in @p layer of object to update.
  * @param[in] default_type: the #QobjType_t to initialize to.
@@ -139,26 +173,29 @@ int
 qdefault_qwalk_layer_object_incomplete(QwalkLayer_t *layer, int index,
 		QobjType_t default_type) {
 
+	const QattrList_t *prototype;
 	QattrList_t *attr_list;
 
-	if ((attr_list = qdefault_qwalk_default_attr_list_create(default_type))
-			== NULL) {
+	if (((prototype = qdefault_qwalk_prototype_get(default_type)) == NULL)
+			|| ((attr_list = qattr_list_prototype_create(prototype)) == NULL)) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
 	int *coords;
 
-	if ((coords = qwalk_index_to_coords(index)) == NULL) {
+	if ((coords = qwalk_index_to_coords(layer, index)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
 	}
 
-	layer->objects[layer->index_ok].coord_y = coords[0];
-	layer->objects[layer->index_ok].coord_x = coords[1];
-	/*@i2@*/layer->objects[layer->index_ok].attr_list = attr_list;
-	layer->index_ok++;
+	/*@i2@*/if (qwalk_layer_object_set(layer, coords[0], coords[1], attr_list)
+			== Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(coords);
+		return Q_ERROR;
+	}
 
 	free(coords);
 	
@@ -166,9 +203,56 @@ qdefault_qwalk_layer_object_incomplete(QwalkLayer_t *layer, int index,
 }
 
 
+/**
+ * Fill the chunk of a #QwalkLayer_t holding some coordinates with defaults.
+ * Every tile of the chunk not yet set becomes a new object inheriting from the
+ * prototype of @p default_type; the chunk is populated if need be.
+ * @param[in] layer: #QwalkLayer_t to operate on.
+ * @param[in] y: y coordinate within the chunk.
+ * @param[in] x: x coordinate within the chunk.
+ * @param[in] default_type: the #QobjType_t to initialize to.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qdefault_qwalk_layer_chunk_fill(QwalkLayer_t *layer, int y, int x,
+		QobjType_t default_type) {
+
+	const QwalkChunk_t *chunk;
+	int chunk_index;
+	int index;
+	int local;
+
+	if (!qwalk_logic_coords_arevalid(layer, y, x)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+	chunk_index = ((y / QWALK_CHUNK_SIZE_Y) * layer->chunkc_x)
+		+ (x / QWALK_CHUNK_SIZE_X);
+
+	for (int i = 0; i < QWALK_CHUNK_SIZE; i++) {
+		if ((index = qwalk_layer_chunk_index_get(layer, chunk_index, i))
+				== Q_ERRORCODE_INT_NOTFOUND) {
+			continue;
+		}
+		if (((chunk = qwalk_layer_chunk_get(layer, index, &local)) != NULL)
+				&& (chunk->objects[local].attr_list != NULL)) {
+			continue;
+		}
+		if (qdefault_qwalk_layer_object_incomplete(layer, index, default_type)
+				== Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+	}
+
+	return Q_OK;
+}
+
+
 /**
  * Update an object in a #QwalkLayer_t to a default.
- * Assumes that the object was not previously defined.
+ * Assumes that the object was not previously defined. The object inherits its
+ * attributes from the prototype of @p default_type.
  * @param[in] layer: #QwalkLayer_t to operate on.
  * @param[in] index: index in @p layer of object to update.
  * @param[in] default_type: the #QobjType_t to initialize to.
@@ -179,15 +263,27 @@ qdefault_qwalk_layer_object(QwalkLayer_t *layer, int index,
 		QobjType_t default_type)
 {
 
+	const QattrList_t *prototype;
 	QattrList_t *attr_list;
+	QwalkChunk_t *chunk;
+	int local;
 
-	if ((attr_list = qdefault_qwalk_default_attr_list_create(default_type))
-			== NULL) {
+	if (((prototype = qdefault_qwalk_prototype_get(default_type)) == NULL)
+			|| ((attr_list = qattr_list_prototype_create(prototype)) == NULL)) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
-	layer->objects[index].attr_list = attr_list;
+	if ((chunk = qwalk_layer_chunk_get(layer, index, &local)) == NULL) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		qattr_list_destroy(attr_list);
+		return Q_ERROR;
+	}
+	chunk->objects[local].attr_list = attr_list;
+	if (qattr_store_bind(chunk->store, (size_t) local, attr_list) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
 
 	return Q_OK;
 }
@@ -229,6 +325,36 @@ qdefault_qwalk_default_attr_list_create(QobjType_t type_search) {
 }
 
 
+/**
+ * Get the shared prototype #QattrList_t of a default qwalk #QobjType_t.
+ * The prototype is built upon the first call for @p type; it must never be
+ * written to, nor destroyed.
+ * @param[in] type: #QobjType_t to get the prototype of.
+ * @return prototype or @c NULL if @p type has no default.
+ */
+const QattrList_t *
+qdefault_qwalk_prototype_get(QobjType_t type) {
+
+	if ((type < (QobjType_t) Q_ENUM_VALUE_START) || (type > QOBJ_TYPE_COUNT)) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return NULL;
+	}
+	if (qdefault_qwalk_objects_index_search(type) == Q_ERRORCODE_INT_NOTFOUND) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+
+	if ((default_qwalk_prototypes[type] == NULL)
+			&& ((default_qwalk_prototypes[type]
+					= qdefault_qwalk_default_attr_list_create(type)) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	return default_qwalk_prototypes[type];
+}
+
+
 /**
  * Add a default attribute to a #QwalkLayer_t object.
  * @param[in] layer: relevant #QwalkLayer_t.
@@ -278,17 +404,14 @@ Qdatameta_t *
 qdefault_qwalk_default_datameta_create(QobjType_t type_search, QattrKey_t key) {
 
 	QobjType_t typealias = (QobjType_t) Q_ERRORCODE_ENUM;
-	QobjType_t *type;
 	const char *salias = NULL;
-	char *s;
 	bool balias = false;
-	bool *b;
 
 	int index;
 
 	QdataType_t data_type;
 	size_t count;
-	Qdata_t *data;
+	const Qdata_t *data;
 	Qdatameta_t *datameta;
 
 	salias = NULL;
@@ -330,6 +453,7 @@ qdefault_qwalk_default_datameta_create(QobjType_t type_search, QattrKey_t key) {
 		}
 	}
 
+	/* every default value is copied into its #Qdatameta_t; small ones inline */
 	if (isoverride) {
 		if (salias == NULL) {
 			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
@@ -337,23 +461,13 @@ qdefault_qwalk_default_datameta_create(QobjType_t type_search, QattrKey_t key) {
 		}
 		data_type = QDATA_TYPE_CHAR_STRING;
 		count = strlen(salias) + (size_t) 1;
-		if ((s = calloc(count, sizeof(*s))) == NULL) {
-			Q_ERROR_SYSTEM("calloc()");
-			return NULL;
-		}
-		strcpy(s, salias);
-		data = (Qdata_t *) s;
+		data = salias;
 	} else {
 		switch (key) {
 		case QATTR_KEY_QOBJECT_TYPE:
 			data_type = QDATA_TYPE_QOBJECT_TYPE;
 			count = (size_t) 1;
-			if ((type = calloc(count, sizeof(*type))) == NULL) {
-				Q_ERROR_SYSTEM("calloc()");
-				return NULL;
-			}
-			*type = typealias;
-			data = (Qdata_t *) type;
+			data = &typealias;
 			break;
 		
 		case QATTR_KEY_NAME:
@@ -365,23 +479,13 @@ qdefault_qwalk_default_datameta_create(QobjType_t type_search, QattrKey_t key) {
 			}
 			data_type = QDATA_TYPE_CHAR_STRING;
 			count = strlen(salias) + (size_t) 1;
-			if ((s = calloc(count, sizeof(*s))) == NULL) {
-				Q_ERROR_SYSTEM("calloc()");
-				return NULL;
-			}
-			strcpy(s, salias);
-			data = (Qdata_t *) s;
+			data = salias;
 			break;
 		
 		case QATTR_KEY_CANMOVE:
 			data_type = QDATA_TYPE_BOOL;
 			count = (size_t) 1;
-			if ((b = calloc(count, sizeof(*b))) == NULL) {
-				Q_ERROR_SYSTEM("calloc()");
-				return NULL;
-			}
-			*b = balias;
-			data = (Qdata_t *) b;
+			data = &balias;
 			break;
 
 		default:
@@ -390,7 +494,7 @@ qdefault_qwalk_default_datameta_create(QobjType_t type_search, QattrKey_t key) {
 		}
 	}
 
-	if ((datameta = qdatameta_create(data, data_type, count)) == NULL) {
+	if ((datameta = qdatameta_copy_create(data, data_type, count)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
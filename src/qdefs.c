@@ -7,6 +7,8 @@
 
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
@@ -20,7 +22,42 @@
 #include "dialogue.h"
 #include "mode.h"
 #include "qattr.h"
+#include "qarena.h"
 #include "qwalk.h"
+#include "qreflect.h"
+
+
+
+/* every #QobjType_t and #QdataType_t must have a string */
+_Static_assert((0 QOBJ_TYPE_TABLE(QREFLECT_ONE))
+		== QOBJ_TYPE_COUNT - Q_ENUM_VALUE_START + 1,
+		"QOBJ_TYPE_TABLE disagrees with QobjType_t");
+_Static_assert((0 QDATA_TYPE_TABLE(QREFLECT_ONE))
+		== QDATA_TYPE_COUNT - Q_ENUM_VALUE_START + 1,
+		"QDATA_TYPE_TABLE disagrees with QdataType_t");
+
+/** String version of each #QobjType_t. */
+static const char *const qobj_type_strings[QOBJ_TYPE_COUNT + 1] = {
+	QOBJ_TYPE_TABLE(QREFLECT_STRING)
+};
+
+/** Reflection table of #QobjType_t. */
+static Qreflect_t qobj_type_reflect = QREFLECT_INITIALIZER(qobj_type_strings,
+		Q_ENUM_VALUE_START, QOBJ_TYPE_COUNT);
+
+/** String version of each #QdataType_t. */
+static const char *const qdata_type_strings[QDATA_TYPE_COUNT + 1] = {
+	QDATA_TYPE_TABLE(QREFLECT_STRING)
+};
+
+/** Reflection table of #QdataType_t. */
+static Qreflect_t qdata_type_reflect = QREFLECT_INITIALIZER(qdata_type_strings,
+		Q_ENUM_VALUE_START, QDATA_TYPE_COUNT);
+
+
+
+static /*@null@*//*@dependent@*/Qdatameta_t *qdatameta_arena_shell_create(
+		Qarena_t *arena, QdataType_t type, size_t count)/*@modifies arena@*/;
 
 
 
@@ -43,22 +80,252 @@ qdatameta_create(Qdata_t *datap, QdataType_t type, size_t count) {
 	datameta->datap = datap;
 	datameta->count = count;
 	datameta->type = type;
+	datameta->isview = false;
+	datameta->isinline = false;
+	datameta->isarena = false;
+	datameta->refc = 1;
+	return datameta;
+}
+
+
+/**
+ * Create a #Qdatameta_t whose data is a view into memory owned elsewhere.
+ * The viewed data must outlive the #Qdatameta_t and is never written through
+ * it; qdatameta_clone() on a view yields an ordinary, owning #Qdatameta_t.
+ * @param[in] datap: pointer to raw data to view.
+ * @param[in] type:  type of @c data
+ * @param[in] count: number of elements at the given pointer
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ * @allocs{1} for returned pointer.
+ */ 
+Qdatameta_t *
+qdatameta_view_create(const Qdata_t *datap, QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	/*@i1@*/if ((datameta = qdatameta_create((Qdata_t *) datap, type, count))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	datameta->isview = true;
+	return datameta;
+}
+
+
+/**
+ * Create a #Qdatameta_t with zeroed room for its data.
+ * Data of up to #QDATAMETA_INLINE_SIZE bytes is kept inside the #Qdatameta_t
+ * itself, which then costs a single allocation; larger data is allocated
+ * separately, as for qdatameta_create().
+ * @param[in] type:  type of the data.
+ * @param[in] count: number of elements to make room for.
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ * @allocs{1} for returned pointer, or @allocs{2} if the data isn't inline.
+ */ 
+Qdatameta_t *
+qdatameta_alloc(QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	Qdata_t *datap;
+	size_t size;
+
+	if ((size = qdata_type_size_get(type)) == Q_ERRORCODE_SIZE) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	if ((count <= (size_t) QDATAMETA_INLINE_SIZE / size)
+			/* the QwalkArea_t destructor takes ownership of its own pointer */
+			&& (type != QDATA_TYPE_QWALK_AREA)) {
+		if ((datameta = qdatameta_create(NULL, type, count)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return NULL;
+		}
+		datameta->datap = datameta->inline_data.bytes;
+		datameta->isinline = true;
+		return datameta;
+	}
+
+	if ((datap = calloc(count, size)) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	if ((datameta = qdatameta_create(datap, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(datap);
+		return NULL;
+	}
+	return datameta;
+}
+
+
+/**
+ * Create a #Qdatameta_t holding a copy of some data.
+ * @see qdatameta_alloc().
+ * @param[in] datap: pointer to the data to copy.
+ * @param[in] type:  type of the data.
+ * @param[in] count: number of elements at @p datap.
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ */ 
+Qdatameta_t *
+qdatameta_copy_create(const Qdata_t *datap, QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+
+	if ((datameta = qdatameta_alloc(type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	/*@i1@*/memcpy(datameta->datap, datap, count * qdata_type_size_get(type));
+	return datameta;
+}
+
+
+/**
+ * Create a deferred #Qdatameta_t, whose data has yet to be read.
+ * @p source must outlive the #Qdatameta_t, just like the data of a view; the
+ * data is materialized on first access via qattr_list_value_get().
+ * @param[in] source: where the data lies in a mapped file.
+ * @param[in] type:   type of the data.
+ * @param[in] count:  number of elements at @p source.
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ * @allocs{1} for returned pointer.
+ */ 
+Qdatameta_t *
+qdatameta_deferred_create(const void *source, QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	if ((datameta = qdatameta_create(NULL, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	datameta->source = source;
+	return datameta;
+}
+
+
+/**
+ * Create a #Qdatameta_t in a #Qarena_t, viewing other data.
+ * @see qdatameta_view_create().
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] datap: pointer to raw data to view.
+ * @param[in] type:  type of @c data
+ * @param[in] count: number of elements at the given pointer
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ */ 
+Qdatameta_t *
+qdatameta_arena_view_create(Qarena_t *arena, const Qdata_t *datap,
+		QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	if ((datameta = qdatameta_arena_shell_create(arena, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	/*@i1@*/datameta->datap = (Qdata_t *) datap;
+	datameta->isview = true;
+	return datameta;
+}
+
+
+/**
+ * Create a #Qdatameta_t in a #Qarena_t, with zeroed room for its data.
+ * Data too large to be inline is allocated from @p arena as well. A
+ * #QDATA_TYPE_QWALK_AREA, whose destructor takes ownership of its own
+ * pointer, is the exception, and is allocated from the heap as by
+ * qdatameta_alloc().
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] type:  type of the data.
+ * @param[in] count: number of elements to make room for.
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ */ 
+Qdatameta_t *
+qdatameta_arena_alloc(Qarena_t *arena, QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	size_t size;
+
+	if (type == QDATA_TYPE_QWALK_AREA) {
+		/*@i1@*/return qdatameta_alloc(type, count);
+	}
+
+	if ((size = qdata_type_size_get(type)) == Q_ERRORCODE_SIZE) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	if (count > SIZE_MAX / size) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+
+	if ((datameta = qdatameta_arena_shell_create(arena, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	if (count <= (size_t) QDATAMETA_INLINE_SIZE / size) {
+		datameta->datap = datameta->inline_data.bytes;
+		datameta->isinline = true;
+		return datameta;
+	}
+
+	if ((datameta->datap = qarena_alloc(arena, count * size)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	return datameta;
+}
+
+
+/**
+ * Create a deferred #Qdatameta_t in a #Qarena_t.
+ * @see qdatameta_deferred_create().
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] source: where the data lies in a mapped file.
+ * @param[in] type:   type of the data.
+ * @param[in] count:  number of elements at @p source.
+ * @return newly created #Qdatameta_t or @c NULL pointer 
+ */ 
+Qdatameta_t *
+qdatameta_arena_deferred_create(Qarena_t *arena, const void *source,
+		QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	if ((datameta = qdatameta_arena_shell_create(arena, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	datameta->source = source;
+	return datameta;
+}
+
+
+/**
+ * Allocate a #Qdatameta_t without data from a #Qarena_t.
+ * @param[in,out] arena: #Qarena_t to allocate from.
+ * @param[in] type:  type of the data.
+ * @param[in] count: number of elements of data.
+ * @return zeroed #Qdatameta_t but for @p type and @p count, or @c NULL.
+ */
+Qdatameta_t *
+qdatameta_arena_shell_create(Qarena_t *arena, QdataType_t type, size_t count) {
+	Qdatameta_t *datameta;
+	if ((datameta = qarena_alloc(arena, sizeof(*datameta))) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	datameta->count = count;
+	datameta->type = type;
+	datameta->isarena = true;
 	return datameta;
 }
 
 
 /**
  * Clone a #Qdatameta_t.
+ * The clone holds a copy of the data of its own; see qdatameta_share() for a
+ * cheaper alternative.
  * @param[in] datametar: #Qdatameta_t to clone.
  * @return clone of @p datameta.
  */
 Qdatameta_t *
 qdatameta_clone(const Qdatameta_t *datametar) {
-	Qdata_t *data;
 	Qdata_t *datar;
 	QdataType_t type;
 	size_t count;
-	size_t size;
 	Qdatameta_t *datameta;
 
 	if ((count = qdatameta_count_get(datametar)) == Q_ERRORCODE_SIZE) {
@@ -71,46 +338,96 @@ qdatameta_clone(const Qdatameta_t *datametar) {
 		return NULL;
 	}
 
- 	if ((size = qdata_type_size_get(type)) == Q_ERRORCODE_SIZE) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return NULL;
+	/* a deferred clone lies in the same mapped file, bound to the same store */
+	if (datametar->source != NULL) {
+		if ((datameta = qdatameta_deferred_create(datametar->source, type,
+						count)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return NULL;
+		}
+		datameta->inline_data.store = datametar->inline_data.store;
+		return datameta;
 	}
-	
+
 	if ((datar = qdatameta_datap_get(datametar)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
 
-	if ((data = calloc(count, size)) == NULL) {
-		Q_ERRORFOUND(QERROR_SYSTEM_MEMORY);
+	/* small data is copied inline */
+	if ((datameta = qdatameta_copy_create(datar, type, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
 
-	memcpy(data, datar, count * size);
+	return datameta;
+}
+
 
-	if ((datameta = qdatameta_create(data, type, count)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
+/**
+ * Share a #Qdatameta_t with another owner.
+ * Rather than copying the data, the #Qdatameta_t itself is handed out again,
+ * and is only freed once every owner destroyed it. This is safe because a
+ * value is never written to in place; changing one replaces its #Qdatameta_t.
+ * Views and #Qdatameta_t in a #Qarena_t, which may not outlive the memory
+ * behind them, are cloned instead, as by qdatameta_clone(). Every value of an
+ * area read from a v2 file is one of those, so only values built on the heap
+ * (e.g. those of the devel_walk clipboard) are actually shared.
+ * @param[in,out] datameta: #Qdatameta_t to share.
+ * @return @p datameta, a clone of it, or @c NULL upon failure.
+ */
+Qdatameta_t *
+qdatameta_share(Qdatameta_t *datameta) {
+
+	if (datameta == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return NULL;
 	}
 
-	return datameta;
-}
+	if (datameta->isview || datameta->isarena) {
+		return qdatameta_clone(datameta);
+	}
 
+	datameta->refc++;
+	/*@i1@*/return datameta;
+}
 
 
 /**
  * Recursively destroy a #Qdatameta_t.
+ * A shared #Qdatameta_t merely loses an owner, until the last of them.
  * @param[out] datameta: #Qdatameta_t to free from memory.
  */
 void
 qdatameta_destroy(Qdatameta_t *datameta) {
 
+	/* arena memory is freed along with its arena */
+	if (datameta->isarena) {
+		return;
+	}
+
+	if (datameta->refc > 1) {
+		datameta->refc--;
+		return;
+	}
+
+	/* deferred data belongs to the mapped file it lies in */
+	if (datameta->source != NULL) {
+		free(datameta);
+		return;
+	}
+
 	if (datameta->datap == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		free(datameta);
 		return;
 	}
 
+	if (datameta->isview || datameta->isinline) {
+		free(datameta);
+		return;
+	}
+
 	if ((datameta->type < (QdataType_t) Q_ENUM_VALUE_START) || (datameta->type > QDATA_TYPE_COUNT)) {
 		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 		free(datameta->datap);
@@ -223,25 +540,13 @@ qdatameta_type_get(const Qdatameta_t *datameta) {
  */
 char *
 qobj_type_to_string(QobjType_t type) {
-	if ((type < (QobjType_t) Q_ENUM_VALUE_START) || (type > QOBJ_TYPE_COUNT)) {
-		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
-		return Q_ERRORCODE_CHARSTRING;
-	}
-	switch (type) {
-	case QOBJ_TYPE_PLAYER:
-		return QOBJ_STRING_TYPE_PLAYER;
-	case QOBJ_TYPE_GRASS:
-		return QOBJ_STRING_TYPE_GRASS;
-	case QOBJ_TYPE_TREE:
-		return QOBJ_STRING_TYPE_TREE;
-	case QOBJ_TYPE_VOID:
-		return QOBJ_STRING_TYPE_VOID;
-	case QOBJ_TYPE_NPC_FRIENDLY:
-		return QOBJ_STRING_TYPE_NPC_FRIENDLY; 
-	default:
+	const char *s;
+
+	if ((s = qreflect_string_get(&qobj_type_reflect, (int) type)) == NULL) {
 		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 		return Q_ERRORCODE_CHARSTRING;
 	}
+	/*@i1@*/return (char *) s;
 }
 
 
@@ -252,22 +557,47 @@ qobj_type_to_string(QobjType_t type) {
  */
 QobjType_t
 qobj_string_to_type(const char *s) {
-	
-	if (strcmp(s, QOBJ_STRING_TYPE_PLAYER) == 0) {
-		return QOBJ_TYPE_PLAYER;
-	} else if (strcmp(s, QOBJ_STRING_TYPE_GRASS) == 0) {
-		return QOBJ_TYPE_GRASS;
-	} else if (strcmp(s, QOBJ_STRING_TYPE_TREE) == 0) {
-		return QOBJ_TYPE_TREE;
-	} else if (strcmp(s, QOBJ_STRING_TYPE_VOID) == 0) {
-		return QOBJ_TYPE_VOID;
-	} else if (strcmp(s, QOBJ_STRING_TYPE_NPC_FRIENDLY) == 0) {
-		return QOBJ_TYPE_NPC_FRIENDLY;
-	} else {
+	int type;
+
+	if ((type = qreflect_constant_get(&qobj_type_reflect, s)) == Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		return (QobjType_t) Q_ERRORCODE_ENUM;
 	}
+	return (QobjType_t) type;
+}
+
+
+/**
+ * Convert a #QdataType_t to a string.
+ * @param[in] type: relevant #QdataType_t.
+ * @return string version of @p type or #Q_ERRORCODE_CHARSTRING.
+ */
+const char *
+qdata_type_to_string(QdataType_t type) {
+	const char *s;
+
+	if ((s = qreflect_string_get(&qdata_type_reflect, (int) type)) == NULL) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return Q_ERRORCODE_CHARSTRING;
+	}
+	return s;
+}
+
+
+/**
+ * Convert a string to a #QdataType_t.
+ * @param[in] s: relevant string.
+ * @return #QdataType_t version of @p s or #Q_ERRORCODE_ENUM.
+ */
+QdataType_t
+qdata_string_to_type(const char *s) {
+	int type;
 
+	if ((type = qreflect_constant_get(&qdata_type_reflect, s)) == Q_ERRORCODE_ENUM) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return (QdataType_t) Q_ERRORCODE_ENUM;
+	}
+	return (QdataType_t) type;
 }
 
 
@@ -7,20 +7,18 @@
 
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 
 #include "qdefs.h"
 
 #include "qerror.h"
+#include "qreflect.h"
 
  
 
-/** Maximum number of characters in a qerror string.      */
-#define QERROR_ERROR_LENGTH_MAX 100
-
-
-
 /** String for #QERROR_NULL_POINTER_UNEXPECTED.           */
 #define QERROR_STRING_NULL_POINTER_UNEXPECTED \
 	"Encountered unexpected NULL pointer"
@@ -81,6 +79,10 @@
 #define QERROR_STRING_FILE_MODE \
 	"Tried to operate on a file that was opened in an incompatible mode"
 
+/** String for #QERROR_FILE_FORMAT.                       */
+#define QERROR_STRING_FILE_FORMAT \
+	"File contents do not follow the expected format"
+
 /** String for #QERROR_QDATAMETA_TYPE_INCOMPATIBLE.       */
 #define QERROR_STRING_QDATAMETA_TYPE_INCOMPATIBLE \
 	"Qdatameta usage is incompatible with its type"
@@ -103,6 +105,52 @@
 #define QERROR_STRING_QERROR_USAGE \
 	"Error in invocation of QERROR; error does not exist"
 
+/**
+ * X-macro table of every #Qerror_t and its string; see qreflect.h.
+ * @param[in] X: macro taking a #Qerror_t and its string.
+ */
+#define QERROR_TABLE(X) \
+	X(QERROR_NULL_POINTER_UNEXPECTED, QERROR_STRING_NULL_POINTER_UNEXPECTED) \
+	X(QERROR_NONNULL_POINTER_UNEXPECTED, \
+			QERROR_STRING_NONNULL_POINTER_UNEXPECTED) \
+	X(QERROR_NULL_VALUE_UNEXPECTED, QERROR_STRING_NULL_VALUE_UNEXPECTED) \
+	X(QERROR_SYSTEM_MEMORY, QERROR_STRING_SYSTEM_MEMORY) \
+	X(QERROR_ZERO_VALUE_UNEXPECTED, QERROR_STRING_ZERO_VALUE_UNEXPECTED) \
+	X(QERROR_NEGATIVE_VALUE_UNEXPECTED, QERROR_STRING_NEGATIVE_VALUE_UNEXPECTED) \
+	X(QERROR_BADDEFINE, QERROR_STRING_BADDEFINE) \
+	X(QERROR_ENUM_CONSTANT_INVALID, QERROR_STRING_ENUM_CONSTANT_INVALID) \
+	X(QERROR_ENUM_CONSTANT_INVALID_ZERO, \
+			QERROR_STRING_ENUM_CONSTANT_INVALID_ZERO) \
+	X(QERROR_STRUCT_INCOMPLETE, QERROR_STRING_STRUCT_INCOMPLETE) \
+	X(QERROR_INDEX_OUTOFRANGE, QERROR_STRING_INDEX_OUTOFRANGE) \
+	X(QERROR_PARAMETER_INVALID, QERROR_STRING_PARAMETER_INVALID) \
+	X(QERROR_MODULE_INITIALIZED, QERROR_STRING_MODULE_INITIALIZED) \
+	X(QERROR_MODULE_UNINITIALIZED, QERROR_STRING_MODULE_UNINITIALIZED) \
+	X(QERROR_FILE_MODE, QERROR_STRING_FILE_MODE) \
+	X(QERROR_FILE_FORMAT, QERROR_STRING_FILE_FORMAT) \
+	X(QERROR_QDATAMETA_TYPE_INCOMPATIBLE, \
+			QERROR_STRING_QDATAMETA_TYPE_INCOMPATIBLE) \
+	X(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE, \
+			QERROR_STRING_QDATAMETA_TYPE_COUNT_INCOMPATIBLE) \
+	X(QERROR_SYSTEM, QERROR_STRING_SYSTEM) \
+	X(QERROR_ERRORVAL, QERROR_STRING_ERRORVAL)
+
+
+
+/* every #Qerror_t must have a string */
+_Static_assert((0 QERROR_TABLE(QREFLECT_ONE))
+		== QERROR_COUNT - Q_ENUM_VALUE_START + 1,
+		"QERROR_TABLE disagrees with Qerror_t");
+
+/** String version of each #Qerror_t. */
+static const char *const qerror_strings[QERROR_COUNT + 1] = {
+	QERROR_TABLE(QREFLECT_STRING)
+};
+
+/** Reflection table of #Qerror_t. */
+static const Qreflect_t qerror_reflect = QREFLECT_INITIALIZER(qerror_strings,
+		Q_ENUM_VALUE_START, QERROR_COUNT);
+
 
 
 /**
@@ -117,69 +165,11 @@
 void
 qerror_internal(Qerror_t error, const char *file, const char *func, int line) {
 	
-	char error_string[QERROR_ERROR_LENGTH_MAX];
-
-	switch (error) {
-	case QERROR_NULL_POINTER_UNEXPECTED:
-		strcpy(error_string, QERROR_STRING_NULL_POINTER_UNEXPECTED);
-		break;
-	case QERROR_NONNULL_POINTER_UNEXPECTED:
-		strcpy(error_string, QERROR_STRING_NONNULL_POINTER_UNEXPECTED);
-		break;
-	case QERROR_NULL_VALUE_UNEXPECTED:
-		strcpy(error_string, QERROR_STRING_NULL_VALUE_UNEXPECTED);
-		break;
-	case QERROR_SYSTEM_MEMORY:
-		strcpy(error_string, QERROR_STRING_SYSTEM_MEMORY);
-		break;
-	case QERROR_NEGATIVE_VALUE_UNEXPECTED:
-		strcpy(error_string, QERROR_STRING_NEGATIVE_VALUE_UNEXPECTED);
-		break;
-	case QERROR_BADDEFINE:
-		strcpy(error_string, QERROR_STRING_BADDEFINE);
-		break;
-	case QERROR_ZERO_VALUE_UNEXPECTED:
-		strcpy(error_string, QERROR_STRING_ZERO_VALUE_UNEXPECTED);
-		break;
-	case QERROR_ENUM_CONSTANT_INVALID:
-		strcpy(error_string, QERROR_STRING_ENUM_CONSTANT_INVALID);
-		break;
-	case QERROR_ENUM_CONSTANT_INVALID_ZERO:
-		strcpy(error_string, QERROR_STRING_ENUM_CONSTANT_INVALID_ZERO);
-		break;
-	case QERROR_STRUCT_INCOMPLETE:
-		strcpy(error_string, QERROR_STRING_STRUCT_INCOMPLETE);
-		break;
-	case QERROR_INDEX_OUTOFRANGE:
-		strcpy(error_string, QERROR_STRING_INDEX_OUTOFRANGE);
-		break;
-	case QERROR_PARAMETER_INVALID:
-		strcpy(error_string, QERROR_STRING_PARAMETER_INVALID);
-		break;
-	case QERROR_MODULE_INITIALIZED:
-		strcpy(error_string, QERROR_STRING_MODULE_INITIALIZED);
-		break;
-	case QERROR_MODULE_UNINITIALIZED:
-		strcpy(error_string, QERROR_STRING_MODULE_UNINITIALIZED);
-		break;
-	case QERROR_FILE_MODE:
-		strcpy(error_string, QERROR_STRING_FILE_MODE);
-		break;
-	case QERROR_QDATAMETA_TYPE_INCOMPATIBLE:
-		strcpy(error_string, QERROR_STRING_QDATAMETA_TYPE_INCOMPATIBLE);
-		break;
-	case QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE:
-		strcpy(error_string, QERROR_STRING_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
-		break;
-	case QERROR_SYSTEM:
-		strcpy(error_string, QERROR_STRING_SYSTEM);
-		break;
-	case QERROR_ERRORVAL:
-		strcpy(error_string, QERROR_STRING_ERRORVAL);
-		break;
-	default:
-		strcpy(error_string, QERROR_STRING_QERROR_USAGE);
-		break;
+	const char *error_string;
+
+	if ((error_string = qreflect_string_get(&qerror_reflect, (int) error))
+			== NULL) {
+		error_string = QERROR_STRING_QERROR_USAGE;
 	}
 
 	fprintf(stderr, "Internal error: %s in file %s, in function %s, on line %i\n",
@@ -1,106 +1,383 @@
 /**
  * @file qfile.c
  * Program file for the file module of Q.
- * Responsible for reading and writing binary information to files. This module
- * keeps the current file for I/O operations at a global scope; this avoids the
- * need to open & close a file every time a lone datam needs to be written.
+ * Responsible for reading and writing binary information to files. Every file
+ * is kept open in a #QfileHandle_t, which holds all of its state; this avoids
+ * the need to open & close a file every time a lone datam needs to be written,
+ * and lets several files be open at once. For convenience, the handle-less
+ * functions (e.g. qfile_size_read()) operate on the one file opened via
+ * qfile_open().
+ * Files opened in #QFILE_MODE_READ_MAPPED are mapped into memory whole, such
+ * that reading a datam costs a copy from the mapping rather than a stdio call.
+ * Likewise, files opened in #QFILE_MODE_WRITE_ATOMIC are serialized into memory
+ * and only hit the disk, in one burst, upon closing.
+ * Strings are written through a per-file string table, such that each distinct
+ * string is stored once per file (see #QFILE_QDATA_TYPE_STRING_REF); upon
+ * reading, they are interned via qfile_string_intern() rather than allocated,
+ * into the string store set via qfile_handle_store_set().
+ * Any file may also be a block file (see #QFILE_BLOCK_MAGIC), whose blocks are
+ * compressed upon writing and decompressed one at a time upon reading; the
+ * readers and writers above it never see the difference.
+ * Files opened in #QFILE_MODE_WRITE_APPEND grow by one checksummed frame per
+ * handle (see #QFILE_APPEND_MAGIC); upon reading, the frames are decoded like
+ * blocks, and a torn final frame is dropped rather than reported.
  */
 
 
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <libgen.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "qdefs.h"
 #include "qerror.h"
 
 #include "qattr.h"
+#include "qarena.h"
 #include "qfile.h"
 
 
 
 /**
- * Pointer to the current active file.
+ * #QfileHandle_t behind the handle-less functions (e.g. qfile_size_read()).
  * Modify via qfile_open() and qfile_close().
  */
-/*@null@*/static FILE *qfile_ptr;
-
-/** Current #QfileMode_t */
-static QfileMode_t qfile_mode = QFILE_MODE_INACTIVE;
+/*@null@*//*@only@*/static QfileHandle_t *qfile_handle_default = NULL;
+
+
+
+static int  qfile_map_open(QfileHandle_t *handle, const char *filename)
+	/*@modifies handle@*/;
+static size_t qfile_raw_read(QfileHandle_t *handle,
+		/*@out@*/void *dest, size_t size, size_t count)
+	/*@modifies handle, dest@*/;
+static size_t qfile_stored_read(QfileHandle_t *handle,
+		/*@out@*/void *dest, size_t size, size_t count)
+	/*@modifies handle, dest@*/;
+static int  qfile_atomic_commit(const QfileHandle_t *handle)
+	/*@modifies fileSystem, errno@*/;
+static int  qfile_append_commit(const QfileHandle_t *handle)
+	/*@modifies fileSystem, errno@*/;
+static int  qfile_append_next(QfileHandle_t *handle)/*@modifies handle@*/;
+static void qfile_append_end(QfileHandle_t *handle, size_t frame_offset)
+	/*@modifies handle@*/;
+static size_t qfile_append_remaining_get(QfileHandle_t *handle)/*@*/;
+static int  qfile_fd_write_all(int fd, const unsigned char *buf, size_t size)
+	/*@modifies fileSystem, errno@*/;
+static size_t qfile_raw_write(QfileHandle_t *handle,
+		const void *src, size_t size, size_t count)
+	/*@modifies handle@*/;
+static size_t qfile_stored_write(QfileHandle_t *handle,
+		const void *src, size_t size, size_t count)
+	/*@modifies handle@*/;
+static int  qfile_string_write(QfileHandle_t *handle, const Qdatameta_t *datameta)
+	/*@modifies handle@*/;
+/*@null@*//*@only@*/
+static Qdatameta_t *qfile_qdatameta_load(QfileHandle_t *handle, bool defer)
+	/*@modifies handle@*/;
+/*@null@*//*@only@*/
+static Qdatameta_t *qfile_string_read(QfileHandle_t *handle, QdataType_t type,
+		size_t count, bool defer)/*@modifies handle@*/;
+/*@null@*//*@only@*/
+static Qdatameta_t *qfile_string_view_create(QfileHandle_t *handle,
+		/*@observer@*/const char *data, size_t count)/*@modifies handle@*/;
+/*@null@*//*@only@*/
+static Qdatameta_t *qfile_string_deferred_create(QfileHandle_t *handle,
+		/*@observer@*/const char *source, size_t count)/*@modifies handle@*/;
+static int  qfile_string_table_push(QfileHandle_t *handle,
+		/*@null@*//*@observer@*/const char *data,
+		/*@null@*//*@observer@*/const char *source, size_t size)
+	/*@modifies handle@*/;
+static int  qfile_block_open(QfileHandle_t *handle)/*@modifies handle@*/;
+static int  qfile_block_alloc(QfileHandle_t *handle, size_t capacity)
+	/*@modifies handle@*/;
+static int  qfile_block_next(QfileHandle_t *handle)/*@modifies handle@*/;
+static int  qfile_block_flush(QfileHandle_t *handle)/*@modifies handle@*/;
+static bool qfile_handle_isread(/*@null@*/const QfileHandle_t *handle)/*@*/;
+static bool qfile_handle_iswrite(/*@null@*/const QfileHandle_t *handle)/*@*/;
 
 
 
 /**
- * Opens a file for future access by the qfile module.
+ * Open a file as a new #QfileHandle_t.
+ * Every handle is independent of the others, so several files may be open at
+ * once (e.g. on different threads), so long as each handle is only used by
+ * one thread at a time.
  * @param[in] filename: name of the file to be kept open.
  * @param[in] mode: #QfileMode_t to open @p filename in.
- * @return #Q_OK or #Q_ERROR.
+ * @return new #QfileHandle_t or @c NULL.
  */
-int
-qfile_open(const char *filename, QfileMode_t mode) {
-	if (qfile_mode != QFILE_MODE_INACTIVE) {
-		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
-		return Q_ERROR;
+QfileHandle_t *
+qfile_handle_open(const char *filename, QfileMode_t mode) {
+	QfileHandle_t *handle;
+
+	if ((handle = calloc((size_t) 1, sizeof(*handle))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
 	}
+	handle->mode = QFILE_MODE_INACTIVE;
+
 	if (mode == QFILE_MODE_WRITE) {
-		qfile_ptr  = fopen(filename, "w");
-		qfile_mode = QFILE_MODE_WRITE;
+		handle->ptr  = fopen(filename, "w");
+		handle->mode = QFILE_MODE_WRITE;
 	} else if (mode == QFILE_MODE_READ) {
-		qfile_ptr = fopen(filename, "r");
-		qfile_mode = QFILE_MODE_READ;
+		handle->ptr = fopen(filename, "r");
+		handle->mode = QFILE_MODE_READ;
+	} else if (mode == QFILE_MODE_READ_MAPPED) {
+		if (qfile_map_open(handle, filename) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			free(handle);
+			return NULL;
+		}
+		handle->mode = QFILE_MODE_READ_MAPPED;
+	} else if (mode == QFILE_MODE_WRITE_ATOMIC) {
+		if (strlen(filename) + strlen(QFILE_ATOMIC_TMP_SUFFIX)
+				> (size_t) QFILE_MAX_PATH_SIZE) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			free(handle);
+			return NULL;
+		}
+		if ((handle->buf = malloc((size_t) QFILE_ATOMIC_BUFFER_CAPACITY_INIT))
+				== NULL) {
+			Q_ERROR_SYSTEM("malloc()");
+			free(handle);
+			return NULL;
+		}
+		handle->buf_size = 0;
+		handle->buf_capacity = (size_t) QFILE_ATOMIC_BUFFER_CAPACITY_INIT;
+		strcpy(handle->atomic_filename, filename);
+		handle->mode = QFILE_MODE_WRITE_ATOMIC;
+		return handle;
+	} else if (mode == QFILE_MODE_WRITE_APPEND) {
+		if (strlen(filename) > (size_t) QFILE_MAX_PATH_SIZE) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			free(handle);
+			return NULL;
+		}
+		if ((handle->buf = malloc((size_t) QFILE_ATOMIC_BUFFER_CAPACITY_INIT))
+				== NULL) {
+			Q_ERROR_SYSTEM("malloc()");
+			free(handle);
+			return NULL;
+		}
+		handle->buf_size = 0;
+		handle->buf_capacity = (size_t) QFILE_ATOMIC_BUFFER_CAPACITY_INIT;
+		strcpy(handle->atomic_filename, filename);
+		handle->mode = QFILE_MODE_WRITE_APPEND;
+		return handle;
 	} else{
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
-		return Q_ERROR;
+		free(handle);
+		return NULL;
 	}
-	if (qfile_ptr == NULL){
+	if ((handle->mode != QFILE_MODE_READ_MAPPED) && (handle->ptr == NULL)) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		qfile_mode = QFILE_MODE_INACTIVE;
-		return Q_ERROR;
+		free(handle);
+		return NULL;
 	}
-	return Q_OK;
+	if (qfile_handle_isread(handle) && (qfile_block_open(handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		(void) qfile_handle_close(handle);
+		return NULL;
+	}
+	return handle;
 }
 
 
 /**
- * Closes the file opened in the qfile module.
+ * Close the file of a #QfileHandle_t and destroy the handle.
+ * The handle is destroyed even if closing the file fails.
+ * @param[out] handle: #QfileHandle_t to close.
  * @return #Q_OK or #Q_ERROR
  */
 int
-qfile_close() {
-	if (qfile_ptr == NULL) {
+qfile_handle_close(QfileHandle_t *handle) {
+	int returnval = Q_OK;
+
+	if (handle->isblock && qfile_handle_iswrite(handle)
+			&& (qfile_block_flush(handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	if (handle->mode == QFILE_MODE_WRITE_ATOMIC) {
+		if ((returnval == Q_ERROR) || (qfile_atomic_commit(handle) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+		free(handle->buf);
+	} else if (handle->mode == QFILE_MODE_WRITE_APPEND) {
+		if (qfile_append_commit(handle) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+		free(handle->buf);
+	} else if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		if ((handle->map != NULL) && (munmap(handle->map, handle->map_size) == -1)) {
+			Q_ERROR_SYSTEM("munmap()");
+			returnval = Q_ERROR;
+		}
+	} else if (handle->ptr == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		returnval = Q_ERROR;
+	} else if (fclose(handle->ptr) == EOF) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	free(handle->block);
+	free(handle->zblock);
+	free(handle->strings);
+	qfile_string_index_clear(&handle->string_index);
+	free(handle);
+	return returnval;
+}
+
+
+/**
+ * Close a #QfileHandle_t without committing what was written to it.
+ * In #QFILE_MODE_WRITE_ATOMIC and #QFILE_MODE_WRITE_APPEND, the file is left
+ * as it was before the handle was opened, e.g. after a write fails midway. In
+ * every other mode, this is the same as qfile_handle_close().
+ * @param[out] handle: #QfileHandle_t to close.
+ * @return #Q_OK or #Q_ERROR
+ */
+int
+qfile_handle_discard(QfileHandle_t *handle) {
+	if ((handle->mode != QFILE_MODE_WRITE_ATOMIC)
+			&& (handle->mode != QFILE_MODE_WRITE_APPEND)) {
+		return qfile_handle_close(handle);
+	}
+
+	free(handle->buf);
+	free(handle->block);
+	free(handle->zblock);
+	free(handle->strings);
+	qfile_string_index_clear(&handle->string_index);
+	free(handle);
+	return Q_OK;
+}
+
+
+/**
+ * Make a #QfileHandle_t write a compressed block file.
+ * Must be called before anything is written; from then on, every write is
+ * gathered into blocks of #QFILE_BLOCK_SIZE bytes, each compressed via
+ * qfile_block_compress() as it fills up. Readers detect block files by
+ * themselves, so nothing else changes for them. Not available in
+ * #QFILE_MODE_WRITE_APPEND, whose frames are already a container of their own.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_handle_compression_set(QfileHandle_t *handle) {
+	unsigned char header[QFILE_BLOCK_HEADER_SIZE];
+
+	if (!qfile_handle_iswrite(handle) || handle->isblock
+			|| (handle->mode == QFILE_MODE_WRITE_APPEND)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
-	if (qfile_mode == QFILE_MODE_INACTIVE) {
+	if (((handle->mode == QFILE_MODE_WRITE_ATOMIC) && (handle->buf_size != 0))
+			|| ((handle->ptr != NULL) && (ftell(handle->ptr) != 0L))) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
-	if (fclose(qfile_ptr) == EOF) {
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, QFILE_BLOCK_MAGIC, (size_t) QFILE_BLOCK_MAGIC_SIZE);
+	qfile_u16_put(header + QFILE_BLOCK_MAGIC_SIZE, (uint16_t) QFILE_BLOCK_VERSION);
+	qfile_u16_put(header + QFILE_BLOCK_MAGIC_SIZE + 2,
+			(uint16_t) QFILE_BLOCK_FLAG_COMPRESSED);
+	qfile_u32_put(header + QFILE_BLOCK_MAGIC_SIZE + 4, (uint32_t) QFILE_BLOCK_SIZE);
+
+	if (qfile_stored_write(handle, header, sizeof(header), (size_t) 1)
+			!= (size_t) 1) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (qfile_block_alloc(handle, (size_t) QFILE_BLOCK_SIZE) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	handle->isblock = true;
+	return Q_OK;
+}
+
+
+/**
+ * Opens a file for future access by the qfile module.
+ * The file becomes the one behind every handle-less qfile function.
+ * @param[in] filename: name of the file to be kept open.
+ * @param[in] mode: #QfileMode_t to open @p filename in.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_open(const char *filename, QfileMode_t mode) {
+	if (qfile_handle_default != NULL) {
+		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
+		return Q_ERROR;
+	}
+	if ((qfile_handle_default = qfile_handle_open(filename, mode)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
-	qfile_mode = QFILE_MODE_INACTIVE;
 	return Q_OK;
 }
 
 
 /**
- * Write a #Qdatameta_t to the file open in qfile.
- * #Qdatameta_t.count is also written.
+ * Closes the file opened in the qfile module.
+ * @return #Q_OK or #Q_ERROR
+ */
+int
+qfile_close() {
+	int returnval;
+
+	if (qfile_handle_default == NULL) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return Q_ERROR;
+	}
+	returnval = qfile_handle_close(qfile_handle_default);
+	qfile_handle_default = NULL;
+	return returnval;
+}
+
+
+/**
+ * Get the #QfileHandle_t of the file opened via qfile_open().
+ * Lets handle-based readers and writers serve the handle-less wrappers.
+ * @return the #QfileHandle_t or @c NULL if no such file is open.
+ */
+QfileHandle_t *
+qfile_handle_default_get() {
+	return qfile_handle_default;
+}
+
+
+/**
+ * Write a #Qdatameta_t to the file open in a #QfileHandle_t.
+ * #Qdatameta_t.count is also written. #QDATA_TYPE_CHAR_STRING data goes
+ * through the string table of the file via qfile_string_write().
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @param[in] datameta: pointer to the #Qdatameta_t to be written.
  * @return #Q_OK or #Q_ERROR
  */
 int
-qfile_qdatameta_write(const Qdatameta_t *datameta) {
+qfile_handle_qdatameta_write(QfileHandle_t *handle, const Qdatameta_t *datameta) {
 	size_t datameta_data_type_size;
 	size_t data_written_count;
 	
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	if (qfile_mode != QFILE_MODE_WRITE) {
+	if (!qfile_handle_iswrite(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
@@ -111,20 +388,23 @@ qfile_qdatameta_write(const Qdatameta_t *datameta) {
 		return Q_ERROR;
 	}
 	
-	if (qfile_size_write(datameta->count) == Q_ERROR) {
+	if (qfile_handle_size_write(handle, datameta->count) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
-	if (qfile_qdata_type_write(datameta->type) == Q_ERROR) {
+	if (datameta->type == QDATA_TYPE_CHAR_STRING) {
+		return qfile_string_write(handle, datameta);
+	}
+
+	if (qfile_handle_qdata_type_write(handle, datameta->type) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
 
-	data_written_count = fwrite((void *) (datameta->datap),
+	data_written_count = qfile_raw_write(handle, (void *) (datameta->datap),
 			datameta_data_type_size,
-			datameta->count,
-			qfile_ptr);
+			datameta->count);
 
 	if (data_written_count != datameta->count) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -136,24 +416,21 @@ qfile_qdatameta_write(const Qdatameta_t *datameta) {
 
 
 /**
- * Write an @c int to the file open in qfile.
+ * Write an @c int to the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @param[in] i: @c int to write.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-qfile_int_write(int i) {
+qfile_handle_int_write(QfileHandle_t *handle, int i) {
 	size_t data_written_count;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	if (qfile_mode != QFILE_MODE_WRITE) {
+	if (!qfile_handle_iswrite(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
 
-	data_written_count = fwrite((void *) &i, sizeof(i), (size_t) 1, qfile_ptr);
+	data_written_count = qfile_raw_write(handle, (void *) &i, sizeof(i), (size_t) 1);
 	if (data_written_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
@@ -164,23 +441,20 @@ qfile_int_write(int i) {
 
 
 /**
- * Write a @c size_t to the file open in qfile.
+ * Write a @c size_t to the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-qfile_size_write(size_t size) {
+qfile_handle_size_write(QfileHandle_t *handle, size_t size) {
 	size_t data_written_count;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	if (qfile_mode != QFILE_MODE_WRITE) {
+	if (!qfile_handle_iswrite(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
 
-	data_written_count = fwrite((void *) &size, sizeof(size), (size_t) 1, qfile_ptr);
+	data_written_count = qfile_raw_write(handle, (void *) &size, sizeof(size), (size_t) 1);
 	if (data_written_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
@@ -191,23 +465,20 @@ qfile_size_write(size_t size) {
 
 
 /**
- * Write a #QdataType_t to the file open in qfile.
+ * Write a #QdataType_t to the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-qfile_qdata_type_write(QdataType_t type) {
+qfile_handle_qdata_type_write(QfileHandle_t *handle, QdataType_t type) {
 	size_t data_written_count;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	if (qfile_mode != QFILE_MODE_WRITE) {
+	if (!qfile_handle_iswrite(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
 
-	data_written_count = fwrite((void *) &type, sizeof(type), (size_t) 1, qfile_ptr);
+	data_written_count = qfile_raw_write(handle, (void *) &type, sizeof(type), (size_t) 1);
 	if (data_written_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
@@ -218,23 +489,20 @@ qfile_qdata_type_write(QdataType_t type) {
 
 
 /**
- * Write a #QattrKey_t to the file open in qfile.
+ * Write a #QattrKey_t to the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-qfile_qattr_key_write(QattrKey_t attr_key) {
+qfile_handle_qattr_key_write(QfileHandle_t *handle, QattrKey_t attr_key) {
 	size_t data_written_count;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	if (qfile_mode != QFILE_MODE_WRITE) {
+	if (!qfile_handle_iswrite(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return Q_ERROR;
 	}
 
-	data_written_count = fwrite((void *) &attr_key, sizeof(attr_key), (size_t) 1, qfile_ptr);
+	data_written_count = qfile_raw_write(handle, (void *) &attr_key, sizeof(attr_key), (size_t) 1);
 	if (data_written_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
@@ -245,71 +513,159 @@ qfile_qattr_key_write(QattrKey_t attr_key) {
 
 
 /**
- * Read a #Qdatameta_t from the file open in qfile.
+ * Read a #Qdatameta_t from the file open in a #QfileHandle_t.
+ * #QDATA_TYPE_CHAR_STRING data, whether inline or from the string table of the
+ * file, is handed to qfile_string_read(); the #Qdatameta_t is then a view into
+ * the string store.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return new #Qdatameta_t.
  */
 Qdatameta_t *
-qfile_qdatameta_read() {
+qfile_handle_qdatameta_read(QfileHandle_t *handle) {
+	return qfile_qdatameta_load(handle, false);
+}
+
+
+/**
+ * Read a #Qdatameta_t of a cold key from the file open in a #QfileHandle_t.
+ * If the handle was set to defer via qfile_handle_defer_begin(), a
+ * #QDATA_TYPE_CHAR_STRING is skipped over rather than read, and the
+ * #Qdatameta_t is deferred until qfile_qdatameta_resolve(); otherwise, this
+ * is qfile_handle_qdatameta_read().
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return new #Qdatameta_t.
+ */
+Qdatameta_t *
+qfile_handle_qdatameta_defer_read(QfileHandle_t *handle) {
+	return qfile_qdatameta_load(handle, handle->isdeferring);
+}
+
+
+/**
+ * Let a #QfileHandle_t leave cold values in its map.
+ * Only possible for a #QFILE_MODE_READ_MAPPED file which isn't a block file,
+ * as deferred values point straight into the map; the map must thus outlive
+ * them, which is best done by detaching it via qfile_handle_buffer_detach()
+ * once everything has been read.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return whether values read via qfile_handle_qdatameta_defer_read() may be
+ * deferred.
+ */
+bool
+qfile_handle_defer_begin(QfileHandle_t *handle) {
+	handle->isdeferring = (handle->mode == QFILE_MODE_READ_MAPPED)
+		&& !handle->isblock && (handle->map != NULL);
+	return handle->isdeferring;
+}
+
+
+/**
+ * Have a #QfileHandle_t read lists and values into a #Qarena_t.
+ * Applies to qattr_list_handle_read() and what it reads, e.g. for the
+ * objects of a #QwalkLayer_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] arena: #Qarena_t to allocate from, or @c NULL for the heap.
+ */
+void
+qfile_handle_arena_set(QfileHandle_t *handle, Qarena_t *arena) {
+	handle->arena = arena;
+	return;
+}
+
+
+/**
+ * Have a #QfileHandle_t intern the strings it reads into a string store.
+ * Applies to deferred strings too, once resolved, so the store must outlive
+ * whatever is read; e.g. the store of a #QwalkArea_t is destroyed along with
+ * it.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] store: string store from qfile_string_store_create(), or
+ * @c NULL for the shared one.
+ */
+void
+qfile_handle_store_set(QfileHandle_t *handle, struct QfileStringStore_t *store) {
+	handle->store = store;
+	return;
+}
+
+
+/**
+ * Read a #Qdatameta_t from the file open in a #QfileHandle_t.
+ * @see qfile_handle_qdatameta_read().
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] defer: whether to defer a #QDATA_TYPE_CHAR_STRING.
+ * @return new #Qdatameta_t.
+ */
+Qdatameta_t *
+qfile_qdatameta_load(QfileHandle_t *handle, bool defer) {
 	Qdatameta_t *datameta;
 	size_t count;
 	QdataType_t type;
-	Qdata_t *datap;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return NULL;
-	}
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return NULL;
 	}
 
-	count = qfile_size_read();
+	count = qfile_handle_size_read(handle);
 	if (count == (size_t) Q_ERRORCODE_SIZE) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
 
-	type = qfile_qdata_type_read();
+	type = qfile_handle_qdata_type_read(handle);
 	if (type == (QdataType_t) Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
+	if ((type == QDATA_TYPE_CHAR_STRING) || (type == QFILE_QDATA_TYPE_STRING_REF)) {
+		return qfile_string_read(handle, type, count, defer);
+	}
 	if ((type < (QdataType_t) Q_ENUM_VALUE_START) || (type > QDATA_TYPE_COUNT)) {
 		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 		return NULL;
 	}
+	/* a #QwalkArea_t is made of pointers, which mean nothing once read back */
+	if (type == QDATA_TYPE_QWALK_AREA) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return NULL;
+	}
 
-	datap = qfile_qdata_read(type, count);
-	if (datap == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+	/* read straight into the #Qdatameta_t, which holds small data inline */
+	datameta = (handle->arena != NULL)
+		? qdatameta_arena_alloc(handle->arena, type, count)
+		: qdatameta_alloc(type, count);
+	if (datameta == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	if (qfile_raw_read(handle, datameta->datap, qdata_type_size_get(type), count)
+			< count) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qdatameta_destroy(datameta);
 		return NULL;
 	}
 
-	datameta = qdatameta_create(datap, type, count);
 	return datameta;
 }
 
 
 /**
- * Read an @c int from the file open in qfile.
+ * Read an @c int from the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return newly-read @c int.
  */
 int
-qfile_int_read() {
+qfile_handle_int_read(QfileHandle_t *handle) {
 	size_t data_read_count;
 	int i;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		abort();
-	}
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		abort();
 	}
 
-	data_read_count = fread((void *) &i, sizeof(i), (size_t) 1, qfile_ptr);
+	data_read_count = qfile_raw_read(handle, (void *) &i, sizeof(i), (size_t) 1);
 	if (data_read_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		abort();
@@ -320,24 +676,21 @@ qfile_int_read() {
 
 
 /**
- * Read a @c size_t from the file open in qfile.
+ * Read a @c size_t from the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return newly-read @c size_t.
  */
 size_t
-qfile_size_read() {
+qfile_handle_size_read(QfileHandle_t *handle) {
 	size_t data_read_count;
 	size_t size;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return (size_t) Q_ERRORCODE_SIZE;
-	}
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return (size_t) Q_ERRORCODE_SIZE;
 	}
 
-	data_read_count = fread((void *) &size, sizeof(size), (size_t) 1, qfile_ptr);
+	data_read_count = qfile_raw_read(handle, (void *) &size, sizeof(size), (size_t) 1);
 	if (data_read_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return (size_t) Q_ERRORCODE_SIZE;
@@ -348,24 +701,21 @@ qfile_size_read() {
 
 
 /**
- * Read a #QdataType_t from the file open in qfile.
+ * Read a #QdataType_t from the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return newly-read #QdataType_t or #Q_ERRORCODE_ENUM.
  */
 QdataType_t
-qfile_qdata_type_read() {
+qfile_handle_qdata_type_read(QfileHandle_t *handle) {
 	size_t data_read_count;
 	QdataType_t type;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return (QdataType_t) Q_ERRORCODE_ENUM;
-	}
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return (QdataType_t) Q_ERRORCODE_ENUM;
 	}
 
-	data_read_count = fread((void *) &type, sizeof(type), (size_t) 1, qfile_ptr);
+	data_read_count = qfile_raw_read(handle, (void *) &type, sizeof(type), (size_t) 1);
 	if (data_read_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return (QdataType_t) Q_ERRORCODE_ENUM;
@@ -376,24 +726,21 @@ qfile_qdata_type_read() {
 
 
 /**
- * Read a #QattrKey_t from the file open in qfile.
+ * Read a #QattrKey_t from the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @return newly-read #QattrKey_t or #Q_ERRORCODE_ENUM.
  */
 QattrKey_t
-qfile_qattr_key_read() {
+qfile_handle_qattr_key_read(QfileHandle_t *handle) {
 	size_t data_read_count;
 	QattrKey_t attr_key;
 
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return (QattrKey_t) Q_ERRORCODE_ENUM;
-	}
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return (QattrKey_t) Q_ERRORCODE_ENUM;
 	}
 
-	data_read_count = fread((void *) &attr_key, sizeof(attr_key), (size_t) 1, qfile_ptr);
+	data_read_count = qfile_raw_read(handle, (void *) &attr_key, sizeof(attr_key), (size_t) 1);
 	if (data_read_count < (size_t) 1) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return (QattrKey_t) Q_ERRORCODE_ENUM;
@@ -404,23 +751,19 @@ qfile_qattr_key_read() {
 
 
 /**
- * Read to a #Qdata_t * from the file open in qfile.
+ * Read to a #Qdata_t * from the file open in a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
  * @param[in] type: type of #Qdata_t.
  * @param[in] count: amount of elements.
  * @return #Q_OK or #Q_ERROR.
  */
 Qdata_t *
-qfile_qdata_read(QdataType_t type, size_t count) {
+qfile_handle_qdata_read(QfileHandle_t *handle, QdataType_t type, size_t count) {
 	size_t data_read_count;
 	size_t data_type_size;
 	
 	Qdata_t *data;
-	if (qfile_ptr == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return NULL;
-	}
-	
-	if (qfile_mode != QFILE_MODE_READ) {
+	if (!qfile_handle_isread(handle)) {
 		Q_ERRORFOUND(QERROR_FILE_MODE);
 		return NULL;
 	}
@@ -437,7 +780,7 @@ qfile_qdata_read(QdataType_t type, size_t count) {
 		return NULL;
 	}
 
-	data_read_count = fread((void *) (data), data_type_size, count, qfile_ptr);
+	data_read_count = qfile_raw_read(handle, (void *) (data), data_type_size, count);
 	
 	if (data_read_count < count) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -447,3 +790,1574 @@ qfile_qdata_read(QdataType_t type, size_t count) {
 
 	/*@i1@*/return data;
 }
+
+
+/**
+ * Write raw bytes to the file open in a #QfileHandle_t.
+ * Meant for formats that lay out their own bytes (e.g. columnar area files);
+ * no count or type is written alongside @p src.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] src: bytes to write.
+ * @param[in] size: number of bytes in @p src.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_handle_bytes_write(QfileHandle_t *handle, const void *src, size_t size) {
+	if (!qfile_handle_iswrite(handle)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return Q_ERROR;
+	}
+	if (size == 0) {
+		return Q_OK;
+	}
+	if (qfile_raw_write(handle, src, size, (size_t) 1) != (size_t) 1) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Read raw bytes from the file open in a #QfileHandle_t.
+ * The counterpart of qfile_handle_bytes_write(); nothing but the bytes is
+ * expected in the file.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[out] dest: buffer of at least @p size bytes.
+ * @param[in] size: number of bytes to read.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_handle_bytes_read(QfileHandle_t *handle, void *dest, size_t size) {
+	if (!qfile_handle_isread(handle)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return Q_ERROR;
+	}
+	if (size == 0) {
+		return Q_OK;
+	}
+	if (qfile_raw_read(handle, dest, size, (size_t) 1) != (size_t) 1) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Peek at the upcoming bytes of the file open in a #QfileHandle_t.
+ * The read position is left untouched, such that e.g. a format's magic number
+ * can be checked before deciding how to decode the rest of the file. In a
+ * block file, peeking never reaches past the current block.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[out] dest: buffer of at least @p size bytes.
+ * @param[in] size: number of bytes to peek at.
+ * @return number of bytes copied to @p dest.
+ */
+size_t
+qfile_handle_bytes_peek(QfileHandle_t *handle, void *dest, size_t size) {
+	size_t peeked;
+
+	if (!qfile_handle_isread(handle)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return 0;
+	}
+
+	if (handle->isblock) {
+		if ((handle->block_cursor == handle->block_size)
+				&& (qfile_block_next(handle) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return 0;
+		}
+		peeked = handle->block_size - handle->block_cursor;
+		if (peeked > size) {
+			peeked = size;
+		}
+		/*@i1@*/memcpy(dest, handle->block + handle->block_cursor, peeked);
+		return peeked;
+	}
+
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		if (handle->map == NULL) {
+			return 0;
+		}
+		peeked = handle->map_size - handle->map_cursor;
+		if (peeked > size) {
+			peeked = size;
+		}
+		memcpy(dest, handle->map + handle->map_cursor, peeked);
+		return peeked;
+	}
+
+	if (handle->ptr == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return 0;
+	}
+	peeked = fread(dest, (size_t) 1, size, handle->ptr);
+	if (fseek(handle->ptr, -((long) peeked), SEEK_CUR) == -1) {
+		Q_ERROR_SYSTEM("fseek()");
+		return 0;
+	}
+	return peeked;
+}
+
+
+/**
+ * Detach the whole contents of the file open in a #QfileHandle_t.
+ * In #QFILE_MODE_READ_MAPPED, the mapping itself is handed over and outlives
+ * the handle; in #QFILE_MODE_READ, the file is read into the heap. A block
+ * file is decoded into the heap from its first block onwards, whatever the
+ * mode. Either way, the file should be closed afterwards as usual.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return new #QfileBuffer_t or @c NULL.
+ */
+QfileBuffer_t *
+qfile_handle_buffer_detach(QfileHandle_t *handle) {
+	QfileBuffer_t *buffer;
+	unsigned char *data;
+	unsigned char *data_new;
+	size_t data_size = 0;
+	size_t data_capacity;
+	size_t header_size;
+	struct stat st;
+
+	if (!qfile_handle_isread(handle)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return NULL;
+	}
+
+	if ((buffer = calloc((size_t) 1, sizeof(*buffer))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+
+	if (handle->isblock) {
+		/* rewind to the first block */
+		header_size = handle->isappend ? (size_t) QFILE_APPEND_MAGIC_SIZE
+			: (size_t) QFILE_BLOCK_HEADER_SIZE;
+		if (handle->mode == QFILE_MODE_READ_MAPPED) {
+			handle->map_cursor = header_size;
+		} else if ((handle->ptr == NULL)
+				|| (fseek(handle->ptr, (long) header_size, SEEK_SET) == -1)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			free(buffer);
+			return NULL;
+		}
+		handle->block_size = 0;
+		handle->block_cursor = 0;
+
+		data_capacity = handle->block_capacity;
+		if ((data = malloc(data_capacity)) == NULL) {
+			Q_ERROR_SYSTEM("malloc()");
+			free(buffer);
+			return NULL;
+		}
+		while (true) {
+			if (qfile_block_next(handle) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				free(data);
+				free(buffer);
+				return NULL;
+			}
+			if (handle->block_size == 0) {
+				break;
+			}
+			if (handle->block_size > data_capacity - data_size) {
+				while (handle->block_size > data_capacity - data_size) {
+					data_capacity *= 2;
+				}
+				if ((data_new = realloc(data, data_capacity)) == NULL) {
+					Q_ERROR_SYSTEM("realloc()");
+					free(data);
+					free(buffer);
+					return NULL;
+				}
+				data = data_new;
+			}
+			/*@i1@*/memcpy(data + data_size, handle->block, handle->block_size);
+			data_size += handle->block_size;
+			handle->block_cursor = handle->block_size;
+		}
+		if (data_size == 0) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			free(data);
+			free(buffer);
+			return NULL;
+		}
+
+		buffer->data = data;
+		buffer->size = data_size;
+		buffer->ismapped = false;
+		return buffer;
+	}
+
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		if (handle->map == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			free(buffer);
+			return NULL;
+		}
+		/* whoever keeps the mapping will access it at random from now on */
+		(void) madvise(handle->map, handle->map_size, MADV_NORMAL);
+		buffer->data = handle->map;
+		buffer->size = handle->map_size;
+		buffer->ismapped = true;
+		handle->isdeferring = false;
+		handle->map = NULL;
+		handle->map_size = 0;
+		handle->map_cursor = 0;
+		return buffer;
+	}
+
+	if (handle->ptr == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		free(buffer);
+		return NULL;
+	}
+	if (fstat(fileno(handle->ptr), &st) == -1) {
+		Q_ERROR_SYSTEM("fstat()");
+		free(buffer);
+		return NULL;
+	}
+	if ((st.st_size <= 0) || (fseek(handle->ptr, 0L, SEEK_SET) == -1)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(buffer);
+		return NULL;
+	}
+	if ((data = malloc((size_t) st.st_size)) == NULL) {
+		Q_ERROR_SYSTEM("malloc()");
+		free(buffer);
+		return NULL;
+	}
+	if (fread(data, (size_t) 1, (size_t) st.st_size, handle->ptr)
+			!= (size_t) st.st_size) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(data);
+		free(buffer);
+		return NULL;
+	}
+
+	buffer->data = data;
+	buffer->size = (size_t) st.st_size;
+	buffer->ismapped = false;
+	return buffer;
+}
+
+
+/**
+ * Make the file opened via qfile_open() a compressed block file.
+ * @see qfile_handle_compression_set().
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_compression_set() {
+	return qfile_handle_compression_set(qfile_handle_default);
+}
+
+
+/**
+ * Write a #Qdatameta_t to the file opened via qfile_open().
+ * @see qfile_handle_qdatameta_write().
+ * @param[in] datameta: pointer to the #Qdatameta_t to be written.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_qdatameta_write(const Qdatameta_t *datameta) {
+	return qfile_handle_qdatameta_write(qfile_handle_default, datameta);
+}
+
+
+/**
+ * Write an @c int to the file opened via qfile_open().
+ * @see qfile_handle_int_write().
+ * @param[in] i: @c int to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_int_write(int i) {
+	return qfile_handle_int_write(qfile_handle_default, i);
+}
+
+
+/**
+ * Write a @c size_t to the file opened via qfile_open().
+ * @see qfile_handle_size_write().
+ * @param[in] size: @c size_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_size_write(size_t size) {
+	return qfile_handle_size_write(qfile_handle_default, size);
+}
+
+
+/**
+ * Write a #QdataType_t to the file opened via qfile_open().
+ * @see qfile_handle_qdata_type_write().
+ * @param[in] type: #QdataType_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_qdata_type_write(QdataType_t type) {
+	return qfile_handle_qdata_type_write(qfile_handle_default, type);
+}
+
+
+/**
+ * Write a #QattrKey_t to the file opened via qfile_open().
+ * @see qfile_handle_qattr_key_write().
+ * @param[in] attr_key: #QattrKey_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_qattr_key_write(QattrKey_t attr_key) {
+	return qfile_handle_qattr_key_write(qfile_handle_default, attr_key);
+}
+
+
+/**
+ * Read a #Qdatameta_t from the file opened via qfile_open().
+ * @see qfile_handle_qdatameta_read().
+ * @return new #Qdatameta_t.
+ */
+Qdatameta_t *
+qfile_qdatameta_read() {
+	return qfile_handle_qdatameta_read(qfile_handle_default);
+}
+
+
+/**
+ * Read an @c int from the file opened via qfile_open().
+ * @see qfile_handle_int_read().
+ * @return newly-read @c int.
+ */
+int
+qfile_int_read() {
+	return qfile_handle_int_read(qfile_handle_default);
+}
+
+
+/**
+ * Read a @c size_t from the file opened via qfile_open().
+ * @see qfile_handle_size_read().
+ * @return newly-read @c size_t.
+ */
+size_t
+qfile_size_read() {
+	return qfile_handle_size_read(qfile_handle_default);
+}
+
+
+/**
+ * Read a #QdataType_t from the file opened via qfile_open().
+ * @see qfile_handle_qdata_type_read().
+ * @return newly-read #QdataType_t or #Q_ERRORCODE_ENUM.
+ */
+QdataType_t
+qfile_qdata_type_read() {
+	return qfile_handle_qdata_type_read(qfile_handle_default);
+}
+
+
+/**
+ * Read a #QattrKey_t from the file opened via qfile_open().
+ * @see qfile_handle_qattr_key_read().
+ * @return newly-read #QattrKey_t or #Q_ERRORCODE_ENUM.
+ */
+QattrKey_t
+qfile_qattr_key_read() {
+	return qfile_handle_qattr_key_read(qfile_handle_default);
+}
+
+
+/**
+ * Read to a #Qdata_t * from the file opened via qfile_open().
+ * @see qfile_handle_qdata_read().
+ * @param[in] type: type of #Qdata_t.
+ * @param[in] count: amount of elements.
+ * @return new #Qdata_t or @c NULL.
+ */
+Qdata_t *
+qfile_qdata_read(QdataType_t type, size_t count) {
+	return qfile_handle_qdata_read(qfile_handle_default, type, count);
+}
+
+
+/**
+ * Write raw bytes to the file opened via qfile_open().
+ * @see qfile_handle_bytes_write().
+ * @param[in] src: bytes to write.
+ * @param[in] size: number of bytes in @p src.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_bytes_write(const void *src, size_t size) {
+	return qfile_handle_bytes_write(qfile_handle_default, src, size);
+}
+
+
+/**
+ * Read raw bytes from the file opened via qfile_open().
+ * @see qfile_handle_bytes_read().
+ * @param[out] dest: buffer of at least @p size bytes.
+ * @param[in] size: number of bytes to read.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_bytes_read(void *dest, size_t size) {
+	return qfile_handle_bytes_read(qfile_handle_default, dest, size);
+}
+
+
+/**
+ * Peek at the upcoming bytes of the file opened via qfile_open().
+ * @see qfile_handle_bytes_peek().
+ * @param[out] dest: buffer of at least @p size bytes.
+ * @param[in] size: number of bytes to peek at.
+ * @return number of bytes copied to @p dest.
+ */
+size_t
+qfile_bytes_peek(void *dest, size_t size) {
+	return qfile_handle_bytes_peek(qfile_handle_default, dest, size);
+}
+
+
+/**
+ * Detach the whole contents of the file opened via qfile_open().
+ * @see qfile_handle_buffer_detach().
+ * @return new #QfileBuffer_t or @c NULL.
+ */
+QfileBuffer_t *
+qfile_buffer_detach() {
+	return qfile_handle_buffer_detach(qfile_handle_default);
+}
+
+
+/**
+ * Release a #QfileBuffer_t from qfile_handle_buffer_detach().
+ * @param[out] buffer: #QfileBuffer_t to release.
+ */
+void
+qfile_buffer_release(QfileBuffer_t *buffer) {
+	if (buffer->ismapped) {
+		/*@i1@*/if (munmap((void *) buffer->data, buffer->size) == -1) {
+			Q_ERROR_SYSTEM("munmap()");
+		}
+	} else {
+		/*@i1@*/free((void *) buffer->data);
+	}
+	free(buffer);
+	return;
+}
+
+
+/**
+ * Hash a series of bytes via FNV-1a.
+ * Used for the checksums of append frames, the string store and reflection
+ * tables alike.
+ * @param[in] src: bytes to hash.
+ * @param[in] size: number of bytes in @p src.
+ * @param[in] seed: mixed into the offset basis; 0 for plain FNV-1a.
+ * @return hash of @p src.
+ */
+uint32_t
+qfile_hash(const void *src, size_t size, uint32_t seed) {
+	const unsigned char *bytes = src;
+	uint32_t hash = 2166136261U ^ seed;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (uint32_t) bytes[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+
+/**
+ * Decode a little-endian @c uint16.
+ * @param[in] src: 2 bytes to decode.
+ * @return decoded value.
+ */
+uint16_t
+qfile_u16_get(const unsigned char *src) {
+	return (uint16_t) ((unsigned) src[0] | ((unsigned) src[1] << 8));
+}
+
+
+/**
+ * Decode a little-endian @c uint32.
+ * @param[in] src: 4 bytes to decode.
+ * @return decoded value.
+ */
+uint32_t
+qfile_u32_get(const unsigned char *src) {
+	return (uint32_t) src[0] | ((uint32_t) src[1] << 8)
+		| ((uint32_t) src[2] << 16) | ((uint32_t) src[3] << 24);
+}
+
+
+/**
+ * Encode a little-endian @c uint16.
+ * @param[out] dest: 2 bytes to encode to.
+ * @param[in] val: value to encode.
+ */
+void
+qfile_u16_put(unsigned char *dest, uint16_t val) {
+	dest[0] = (unsigned char) (val & 0xff);
+	dest[1] = (unsigned char) (val >> 8);
+	return;
+}
+
+
+/**
+ * Encode a little-endian @c uint32.
+ * @param[out] dest: 4 bytes to encode to.
+ * @param[in] val: value to encode.
+ */
+void
+qfile_u32_put(unsigned char *dest, uint32_t val) {
+	dest[0] = (unsigned char) (val & 0xff);
+	dest[1] = (unsigned char) ((val >> 8) & 0xff);
+	dest[2] = (unsigned char) ((val >> 16) & 0xff);
+	dest[3] = (unsigned char) (val >> 24);
+	return;
+}
+
+
+/**
+ * Map a file into memory for #QFILE_MODE_READ_MAPPED.
+ * Sets @ref QfileHandle_t.map, @ref QfileHandle_t.map_size and @ref
+ * QfileHandle_t.map_cursor. An empty file is left unmapped; every subsequent
+ * read on it simply fails.
+ * @param[out] handle: #QfileHandle_t to map the file for.
+ * @param[in] filename: name of the file to map.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_map_open(QfileHandle_t *handle, const char *filename) {
+	int fd;
+	struct stat st;
+	void *map;
+
+	if ((fd = open(filename, O_RDONLY)) == -1) {
+		Q_ERROR_SYSTEM("open()");
+		return Q_ERROR;
+	}
+	if (fstat(fd, &st) == -1) {
+		Q_ERROR_SYSTEM("fstat()");
+		(void) close(fd);
+		return Q_ERROR;
+	}
+
+	handle->map = NULL;
+	handle->map_size = (size_t) st.st_size;
+	handle->map_cursor = 0;
+
+	if (handle->map_size > 0) {
+		map = mmap(NULL, handle->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED) {
+			Q_ERROR_SYSTEM("mmap()");
+			(void) close(fd);
+			handle->map_size = 0;
+			return Q_ERROR;
+		}
+		/* area files are always decoded front to back */
+		(void) madvise(map, handle->map_size, MADV_SEQUENTIAL);
+		handle->map = (unsigned char *) map;
+	}
+
+	if (close(fd) == -1) {
+		Q_ERROR_SYSTEM("close()");
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Read raw elements from the file open in a #QfileHandle_t.
+ * In a block file, elements are copied out of the decoded blocks, which are
+ * refilled via qfile_block_next() as they run out; decoding thus streams
+ * alongside reading instead of preceding it. Otherwise, the file is read
+ * as-is via qfile_stored_read().
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[out] dest: buffer of at least @p size * @p count bytes.
+ * @param[in] size: size of each element.
+ * @param[in] count: number of elements to read.
+ * @return number of elements read.
+ */
+size_t
+qfile_raw_read(QfileHandle_t *handle, void *dest, size_t size, size_t count) {
+	size_t bytes;
+	size_t bytes_read = 0;
+	size_t chunk;
+
+	if (!handle->isblock) {
+		return qfile_stored_read(handle, dest, size, count);
+	}
+	if ((size == 0) || (handle->block == NULL)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return 0;
+	}
+
+	bytes = size * count;
+	while (bytes_read < bytes) {
+		if (handle->block_cursor == handle->block_size) {
+			if (qfile_block_next(handle) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				break;
+			}
+			if (handle->block_size == 0) {
+				break;
+			}
+		}
+		chunk = handle->block_size - handle->block_cursor;
+		if (chunk > bytes - bytes_read) {
+			chunk = bytes - bytes_read;
+		}
+		memcpy((unsigned char *) dest + bytes_read,
+				handle->block + handle->block_cursor, chunk);
+		handle->block_cursor += chunk;
+		bytes_read += chunk;
+	}
+
+	return bytes_read / size;
+}
+
+
+/**
+ * Read raw elements from the file open in a #QfileHandle_t as they are stored.
+ * Dispatches on @ref QfileHandle_t.mode; namely, @c fread() in
+ * #QFILE_MODE_READ and a copy from the cursor in #QFILE_MODE_READ_MAPPED. As
+ * with @c fread(), a short read only happens at the end of the file and never
+ * splits an element.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[out] dest: buffer of at least @p size * @p count bytes.
+ * @param[in] size: size of each element.
+ * @param[in] count: number of elements to read.
+ * @return number of elements read.
+ */
+size_t
+qfile_stored_read(QfileHandle_t *handle, void *dest, size_t size, size_t count) {
+	size_t count_avail;
+
+	if (handle->mode == QFILE_MODE_READ) {
+		if (handle->ptr == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			return 0;
+		}
+		return fread(dest, size, count, handle->ptr);
+	}
+
+	if ((handle->mode != QFILE_MODE_READ_MAPPED) || (size == 0)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return 0;
+	}
+	if (handle->map == NULL) {
+		return 0;
+	}
+
+	count_avail = (handle->map_size - handle->map_cursor) / size;
+	if (count > count_avail) {
+		count = count_avail;
+	}
+	memcpy(dest, handle->map + handle->map_cursor, size * count);
+	handle->map_cursor += size * count;
+	return count;
+}
+
+
+/**
+ * Write raw elements to the file open in a #QfileHandle_t.
+ * In a block file, elements are gathered into @ref QfileHandle_t.block, which
+ * is handed to qfile_block_flush() whenever it fills up. Otherwise, the file is
+ * written as-is via qfile_stored_write().
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] src: buffer of at least @p size * @p count bytes.
+ * @param[in] size: size of each element.
+ * @param[in] count: number of elements to write.
+ * @return number of elements written.
+ */
+size_t
+qfile_raw_write(QfileHandle_t *handle, const void *src, size_t size, size_t count) {
+	size_t bytes;
+	size_t bytes_written = 0;
+	size_t chunk;
+
+	if (!handle->isblock) {
+		return qfile_stored_write(handle, src, size, count);
+	}
+	if ((size == 0) || (handle->block == NULL)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return 0;
+	}
+
+	bytes = size * count;
+	while (bytes_written < bytes) {
+		if ((handle->block_size == handle->block_capacity)
+				&& (qfile_block_flush(handle) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			break;
+		}
+		chunk = handle->block_capacity - handle->block_size;
+		if (chunk > bytes - bytes_written) {
+			chunk = bytes - bytes_written;
+		}
+		memcpy(handle->block + handle->block_size,
+				(const unsigned char *) src + bytes_written, chunk);
+		handle->block_size += chunk;
+		bytes_written += chunk;
+	}
+
+	return bytes_written / size;
+}
+
+
+/**
+ * Write raw elements to the file open in a #QfileHandle_t as they are stored.
+ * Dispatches on @ref QfileHandle_t.mode; namely, @c fwrite() in
+ * #QFILE_MODE_WRITE and an append to @ref QfileHandle_t.buf in
+ * #QFILE_MODE_WRITE_ATOMIC and #QFILE_MODE_WRITE_APPEND. The buffer grows geometrically, so a whole area
+ * costs a handful of reallocations.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] src: buffer of at least @p size * @p count bytes.
+ * @param[in] size: size of each element.
+ * @param[in] count: number of elements to write.
+ * @return number of elements written.
+ */
+size_t
+qfile_stored_write(QfileHandle_t *handle, const void *src, size_t size, size_t count) {
+	size_t bytes;
+	size_t capacity_new;
+	unsigned char *buf_new;
+
+	if (handle->mode == QFILE_MODE_WRITE) {
+		if (handle->ptr == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			return 0;
+		}
+		return fwrite(src, size, count, handle->ptr);
+	}
+
+	if (((handle->mode != QFILE_MODE_WRITE_ATOMIC)
+				&& (handle->mode != QFILE_MODE_WRITE_APPEND))
+			|| (handle->buf == NULL)) {
+		Q_ERRORFOUND(QERROR_FILE_MODE);
+		return 0;
+	}
+
+	bytes = size * count;
+	if (bytes > handle->buf_capacity - handle->buf_size) {
+		capacity_new = handle->buf_capacity;
+		while (bytes > capacity_new - handle->buf_size) {
+			capacity_new *= 2;
+		}
+		if ((buf_new = realloc(handle->buf, capacity_new)) == NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return 0;
+		}
+		handle->buf = buf_new;
+		handle->buf_capacity = capacity_new;
+	}
+
+	memcpy(handle->buf + handle->buf_size, src, bytes);
+	handle->buf_size += bytes;
+	return count;
+}
+
+
+/**
+ * Write a #QDATA_TYPE_CHAR_STRING #Qdatameta_t through the string table.
+ * Its count is expected to have been written already. Strings are looked up
+ * by their contents in @ref QfileHandle_t.string_index; a string seen for
+ * the first time is given the next index and written in full. Nothing is
+ * interned: the index refers to the string as it is, which thus must not
+ * change until the handle is closed.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] datameta: #Qdatameta_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_string_write(QfileHandle_t *handle, const Qdatameta_t *datameta) {
+	const char *s;
+	size_t index;
+	bool isnew = false;
+
+	/* a deferred string is written straight from its file */
+	if ((s = (datameta->source != NULL) ? (const char *) datameta->source
+				: (const char *) datameta->datap) == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (qfile_string_index_get(&handle->string_index, s, datameta->count,
+				&index) == Q_ERRORCODE_INT_NOTFOUND) {
+		index = handle->string_index.count;
+		if (qfile_string_index_put(&handle->string_index, s, datameta->count,
+					index) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		isnew = true;
+	}
+
+	if ((qfile_handle_qdata_type_write(handle, QFILE_QDATA_TYPE_STRING_REF)
+				== Q_ERROR)
+			|| (qfile_handle_size_write(handle, index) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (isnew && (qfile_raw_write(handle, s, (size_t) 1, datameta->count)
+				!= datameta->count)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Read a #QDATA_TYPE_CHAR_STRING #Qdatameta_t into the string store.
+ * Its count and type are expected to have been read already. Inline strings
+ * (#QDATA_TYPE_CHAR_STRING) are interned as they are read; table references
+ * (#QFILE_QDATA_TYPE_STRING_REF) either resolve to an earlier entry of @ref
+ * QfileHandle_t.strings or, if they define the next one, are read in full.
+ * If @p defer is set, the string is instead left where it lies in the map, and
+ * the #Qdatameta_t deferred; so are table entries defined this way, until a
+ * string that isn't deferred refers to them.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] type: #QdataType_t read from the file.
+ * @param[in] count: number of bytes in the string.
+ * @param[in] defer: whether to defer the string; requires @ref
+ * QfileHandle_t.isdeferring.
+ * @return new #Qdatameta_t viewing the string store, or @c NULL.
+ */
+Qdatameta_t *
+qfile_string_read(QfileHandle_t *handle, QdataType_t type, size_t count,
+		bool defer) {
+	QfileString_t *entry;
+	size_t index = 0;
+	char *s;
+	const char *source;
+	const char *interned;
+
+	if (type == QFILE_QDATA_TYPE_STRING_REF) {
+		if ((index = qfile_handle_size_read(handle)) > handle->stringc) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return NULL;
+		}
+		if (index < handle->stringc) {
+			/*@-nullderef@*/
+			entry = &handle->strings[index];
+			/*@=nullderef@*/
+			if (entry->size != count) {
+				Q_ERRORFOUND(QERROR_FILE_FORMAT);
+				return NULL;
+			}
+			if ((entry->data == NULL) && (entry->source != NULL)) {
+				if (defer) {
+					return qfile_string_deferred_create(handle,
+							entry->source, count);
+				}
+				if ((entry->data = qfile_string_intern(handle->store,
+								entry->source, count)) == NULL) {
+					Q_ERRORFOUND(QERROR_ERRORVAL);
+					return NULL;
+				}
+			}
+			/*@i1@*/return qfile_string_view_create(handle, entry->data, count);
+		}
+	}
+
+	if (defer) {
+		if ((handle->map == NULL)
+				|| (count > handle->map_size - handle->map_cursor)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return NULL;
+		}
+		source = (const char *) (handle->map + handle->map_cursor);
+		handle->map_cursor += count;
+		if ((type == QFILE_QDATA_TYPE_STRING_REF)
+				&& (qfile_string_table_push(handle, NULL, source, count)
+					== Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return NULL;
+		}
+		return qfile_string_deferred_create(handle, source, count);
+	}
+
+	if ((s = qfile_handle_qdata_read(handle, QDATA_TYPE_CHAR_STRING, count))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	interned = qfile_string_intern(handle->store, s, count);
+	free(s);
+	if (interned == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	if ((type == QFILE_QDATA_TYPE_STRING_REF)
+			&& (qfile_string_table_push(handle, interned, NULL, count)
+				== Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	return qfile_string_view_create(handle, interned, count);
+}
+
+
+/**
+ * Create a #Qdatameta_t viewing a string in the string store.
+ * It is allocated from @ref QfileHandle_t.arena, if set.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] data: interned string.
+ * @param[in] count: number of bytes in @p data.
+ * @return new #Qdatameta_t or @c NULL.
+ */
+Qdatameta_t *
+qfile_string_view_create(QfileHandle_t *handle, const char *data, size_t count) {
+	if (handle->arena != NULL) {
+		/*@i1@*/return qdatameta_arena_view_create(handle->arena, data,
+				QDATA_TYPE_CHAR_STRING, count);
+	}
+	return qdatameta_view_create(data, QDATA_TYPE_CHAR_STRING, count);
+}
+
+
+/**
+ * Create a deferred #QDATA_TYPE_CHAR_STRING #Qdatameta_t.
+ * It is allocated from @ref QfileHandle_t.arena, if set, and is to be
+ * resolved into @ref QfileHandle_t.store.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] source: where the string lies in the map.
+ * @param[in] count: number of bytes at @p source.
+ * @return new #Qdatameta_t or @c NULL.
+ */
+Qdatameta_t *
+qfile_string_deferred_create(QfileHandle_t *handle, const char *source,
+		size_t count) {
+	Qdatameta_t *datameta;
+
+	if (handle->arena != NULL) {
+		datameta = qdatameta_arena_deferred_create(handle->arena, source,
+				QDATA_TYPE_CHAR_STRING, count);
+	} else {
+		datameta = qdatameta_deferred_create(source, QDATA_TYPE_CHAR_STRING,
+				count);
+	}
+	if (datameta == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	datameta->inline_data.store = handle->store;
+	/*@i1@*/return datameta;
+}
+
+
+/**
+ * Add the next entry to the string table of a #QfileHandle_t.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] data: @ref QfileString_t.data.
+ * @param[in] source: @ref QfileString_t.source.
+ * @param[in] size: @ref QfileString_t.size.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_string_table_push(QfileHandle_t *handle, const char *data,
+		const char *source, size_t size) {
+	QfileString_t *strings_new;
+	size_t capacity_new;
+
+	if (handle->stringc == handle->strings_capacity) {
+		capacity_new = (handle->strings_capacity == 0)
+			? (size_t) 64 : handle->strings_capacity * 2;
+		if ((strings_new = realloc(handle->strings,
+						capacity_new * sizeof(*strings_new))) == NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return Q_ERROR;
+		}
+		handle->strings = strings_new;
+		handle->strings_capacity = capacity_new;
+	}
+	/*@-nullderef@*/
+	handle->strings[handle->stringc].data = data;
+	handle->strings[handle->stringc].source = source;
+	handle->strings[handle->stringc].size = size;
+	/*@=nullderef@*/
+	handle->stringc++;
+
+	return Q_OK;
+}
+
+
+/**
+ * Materialize a deferred #Qdatameta_t.
+ * Its string is interned straight from the map it was left in, into the
+ * string store of the handle it was read through, which then caches it: the
+ * #Qdatameta_t becomes a view into the store, shared by every other copy of
+ * the same bytes. Does nothing to a
+ * #Qdatameta_t which isn't deferred.
+ * @param[in,out] datameta: relevant #Qdatameta_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_qdatameta_resolve(Qdatameta_t *datameta) {
+	const char *interned;
+
+	if (datameta == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (datameta->source == NULL) {
+		return Q_OK;
+	}
+
+	if ((interned = qfile_string_intern(datameta->inline_data.store,
+					(const char *) datameta->source, datameta->count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	/*@i1@*/datameta->datap = (Qdata_t *) interned;
+	datameta->isview = true;
+	datameta->source = NULL;
+	datameta->inline_data.store = NULL;
+
+	return Q_OK;
+}
+
+
+/**
+ * Detect whether the file open in a #QfileHandle_t is a block file.
+ * If it is, its header is consumed and checked, and the block buffers are
+ * allocated; otherwise, the read position is left untouched. Append files are
+ * detected here too, and set up to be read as block files whose blocks are
+ * their frames.
+ * @param[in,out] handle: relevant #QfileHandle_t, open in a read mode.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_block_open(QfileHandle_t *handle) {
+	unsigned char header[QFILE_BLOCK_HEADER_SIZE];
+	uint16_t flags;
+	uint32_t block_capacity;
+
+	if (qfile_handle_bytes_peek(handle, header, (size_t) QFILE_BLOCK_MAGIC_SIZE)
+			!= (size_t) QFILE_BLOCK_MAGIC_SIZE) {
+		return Q_OK;
+	}
+
+	if (memcmp(header, QFILE_APPEND_MAGIC, (size_t) QFILE_APPEND_MAGIC_SIZE)
+			== 0) {
+		if (qfile_stored_read(handle, header, (size_t) QFILE_APPEND_MAGIC_SIZE,
+					(size_t) 1) != (size_t) 1) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		if (qfile_block_alloc(handle, (size_t) QFILE_BLOCK_SIZE) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		handle->isblock = true;
+		handle->isappend = true;
+		return Q_OK;
+	}
+
+	if (memcmp(header, QFILE_BLOCK_MAGIC, (size_t) QFILE_BLOCK_MAGIC_SIZE) != 0) {
+		return Q_OK;
+	}
+
+	if (qfile_stored_read(handle, header, sizeof(header), (size_t) 1)
+			!= (size_t) 1) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	flags = qfile_u16_get(header + QFILE_BLOCK_MAGIC_SIZE + 2);
+	block_capacity = qfile_u32_get(header + QFILE_BLOCK_MAGIC_SIZE + 4);
+	if ((qfile_u16_get(header + QFILE_BLOCK_MAGIC_SIZE) != QFILE_BLOCK_VERSION)
+			|| ((flags & ~QFILE_BLOCK_FLAG_COMPRESSED) != 0)
+			|| (block_capacity == 0)
+			|| (block_capacity > (uint32_t) QFILE_BLOCK_SIZE)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+
+	if (qfile_block_alloc(handle, (size_t) block_capacity) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	handle->isblock = true;
+	return Q_OK;
+}
+
+
+/**
+ * Allocate the block buffers of a #QfileHandle_t.
+ * @param[out] handle: relevant #QfileHandle_t.
+ * @param[in] capacity: number of decoded bytes per block.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_block_alloc(QfileHandle_t *handle, size_t capacity) {
+	if ((handle->block = malloc(capacity)) == NULL) {
+		Q_ERROR_SYSTEM("malloc()");
+		return Q_ERROR;
+	}
+	if ((handle->zblock = malloc(qfile_block_bound(capacity))) == NULL) {
+		Q_ERROR_SYSTEM("malloc()");
+		free(handle->block);
+		handle->block = NULL;
+		return Q_ERROR;
+	}
+	handle->block_size = 0;
+	handle->block_cursor = 0;
+	handle->block_capacity = capacity;
+	return Q_OK;
+}
+
+
+/**
+ * Decode the next block of a block file into @ref QfileHandle_t.block.
+ * In #QFILE_MODE_READ_MAPPED, a block is decoded straight from the mapping;
+ * otherwise, its stored bytes are first read into @ref QfileHandle_t.zblock.
+ * Once there are no blocks left, @ref QfileHandle_t.block_size is set to 0.
+ * The frames of an append file are handed to qfile_append_next() instead.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_block_next(QfileHandle_t *handle) {
+	unsigned char header[QFILE_BLOCK_SECTION_HEADER_SIZE];
+	const unsigned char *stored;
+	size_t header_read;
+	size_t raw_size;
+	size_t stored_size;
+
+	if (handle->isappend) {
+		return qfile_append_next(handle);
+	}
+
+	handle->block_size = 0;
+	handle->block_cursor = 0;
+
+	if ((handle->block == NULL) || (handle->zblock == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	header_read = qfile_stored_read(handle, header, (size_t) 1, sizeof(header));
+	if (header_read == 0) {
+		return Q_OK;
+	}
+	if (header_read != sizeof(header)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	raw_size = (size_t) qfile_u32_get(header);
+	stored_size = (size_t) qfile_u32_get(header + 4);
+	if ((raw_size == 0) || (raw_size > handle->block_capacity)
+			|| (stored_size == 0) || (stored_size > raw_size)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		if ((handle->map == NULL)
+				|| (stored_size > handle->map_size - handle->map_cursor)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		stored = handle->map + handle->map_cursor;
+		handle->map_cursor += stored_size;
+	} else {
+		if (qfile_stored_read(handle, handle->zblock, stored_size, (size_t) 1)
+				!= (size_t) 1) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		stored = handle->zblock;
+	}
+
+	if (stored_size == raw_size) {
+		memcpy(handle->block, stored, raw_size);
+	} else if (qfile_block_decompress(stored, stored_size, handle->block, raw_size)
+			== Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	handle->block_size = raw_size;
+	return Q_OK;
+}
+
+
+/**
+ * Compress and store @ref QfileHandle_t.block, then empty it.
+ * A block that doesn't shrink is stored as-is.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_block_flush(QfileHandle_t *handle) {
+	unsigned char header[QFILE_BLOCK_SECTION_HEADER_SIZE];
+	const unsigned char *stored;
+	size_t stored_size;
+
+	if (handle->block_size == 0) {
+		return Q_OK;
+	}
+	if ((handle->block == NULL) || (handle->zblock == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	stored_size = qfile_block_compress(handle->block, handle->block_size,
+			handle->zblock, handle->block_size - 1);
+	if (stored_size == 0) {
+		stored = handle->block;
+		stored_size = handle->block_size;
+	} else {
+		stored = handle->zblock;
+	}
+
+	qfile_u32_put(header, (uint32_t) handle->block_size);
+	qfile_u32_put(header + 4, (uint32_t) stored_size);
+	if ((qfile_stored_write(handle, header, sizeof(header), (size_t) 1)
+				!= (size_t) 1)
+			|| (qfile_stored_write(handle, stored, stored_size, (size_t) 1)
+				!= (size_t) 1)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	handle->block_size = 0;
+	return Q_OK;
+}
+
+
+/**
+ * Commit @ref QfileHandle_t.buf to @ref QfileHandle_t.atomic_filename.
+ * The buffer is written to a temporary file, which is synced to disk and then
+ * renamed over the target; finally, the parent directory is synced such that
+ * the rename itself survives a crash. On failure, the target is untouched.
+ * The temporary file takes the permissions of the target it replaces, or
+ * 0644 if the target is new.
+ * @param[in] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_atomic_commit(const QfileHandle_t *handle) {
+	char tmp_filename[QFILE_MAX_PATH_SIZE + 1];
+	char dir_filename[QFILE_MAX_PATH_SIZE + 1];
+	struct stat st;
+	bool isnew;
+	int fd;
+
+	if (handle->buf == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	strcpy(tmp_filename, handle->atomic_filename);
+	strcat(tmp_filename, QFILE_ATOMIC_TMP_SUFFIX);
+
+	if (stat(handle->atomic_filename, &st) == -1) {
+		if (errno != ENOENT) {
+			Q_ERROR_SYSTEM("stat()");
+			return Q_ERROR;
+		}
+		isnew = true;
+	} else {
+		isnew = false;
+	}
+
+	if ((fd = open(tmp_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		Q_ERROR_SYSTEM("open()");
+		return Q_ERROR;
+	}
+	/* fchmod() rather than the mode of open(), which the umask would mask */
+	if (!isnew && (fchmod(fd, st.st_mode & 07777) == -1)) {
+		Q_ERROR_SYSTEM("fchmod()");
+		(void) close(fd);
+		(void) unlink(tmp_filename);
+		return Q_ERROR;
+	}
+	if (qfile_fd_write_all(fd, handle->buf, handle->buf_size) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		(void) close(fd);
+		(void) unlink(tmp_filename);
+		return Q_ERROR;
+	}
+	if (fsync(fd) == -1) {
+		Q_ERROR_SYSTEM("fsync()");
+		(void) close(fd);
+		(void) unlink(tmp_filename);
+		return Q_ERROR;
+	}
+	if (close(fd) == -1) {
+		Q_ERROR_SYSTEM("close()");
+		(void) unlink(tmp_filename);
+		return Q_ERROR;
+	}
+	if (rename(tmp_filename, handle->atomic_filename) == -1) {
+		Q_ERROR_SYSTEM("rename()");
+		(void) unlink(tmp_filename);
+		return Q_ERROR;
+	}
+
+	/* dirname() may modify its argument, hence the copy */
+	strcpy(dir_filename, handle->atomic_filename);
+	if ((fd = open(dirname(dir_filename), O_RDONLY)) != -1) {
+		(void) fsync(fd);
+		(void) close(fd);
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Append @ref QfileHandle_t.buf to @ref QfileHandle_t.atomic_filename as a frame.
+ * The file is created with #QFILE_APPEND_MAGIC if it is new; a file too short
+ * to even hold the magic number is left over from a crash, and started over.
+ * The frame is synced to disk before returning. Nothing is appended if nothing
+ * was written.
+ * @param[in] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_append_commit(const QfileHandle_t *handle) {
+	unsigned char header[QFILE_APPEND_FRAME_HEADER_SIZE];
+	struct stat st;
+	int fd;
+
+	if (handle->buf == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (handle->buf_size == 0) {
+		return Q_OK;
+	}
+	if (handle->buf_size > (size_t) UINT32_MAX) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	if ((fd = open(handle->atomic_filename, O_WRONLY | O_CREAT | O_APPEND, 0644))
+			== -1) {
+		Q_ERROR_SYSTEM("open()");
+		return Q_ERROR;
+	}
+	if (fstat(fd, &st) == -1) {
+		Q_ERROR_SYSTEM("fstat()");
+		(void) close(fd);
+		return Q_ERROR;
+	}
+	if (st.st_size < (off_t) QFILE_APPEND_MAGIC_SIZE) {
+		if (ftruncate(fd, (off_t) 0) == -1) {
+			Q_ERROR_SYSTEM("ftruncate()");
+			(void) close(fd);
+			return Q_ERROR;
+		}
+		if (qfile_fd_write_all(fd, (const unsigned char *) QFILE_APPEND_MAGIC,
+					(size_t) QFILE_APPEND_MAGIC_SIZE) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			(void) close(fd);
+			return Q_ERROR;
+		}
+	}
+
+	qfile_u32_put(header, (uint32_t) handle->buf_size);
+	qfile_u32_put(header + 4, qfile_hash(handle->buf, handle->buf_size, 0U));
+	if ((qfile_fd_write_all(fd, header, sizeof(header)) == Q_ERROR)
+			|| (qfile_fd_write_all(fd, handle->buf, handle->buf_size) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		(void) close(fd);
+		return Q_ERROR;
+	}
+	if (fsync(fd) == -1) {
+		Q_ERROR_SYSTEM("fsync()");
+		(void) close(fd);
+		return Q_ERROR;
+	}
+	if (close(fd) == -1) {
+		Q_ERROR_SYSTEM("close()");
+		return Q_ERROR;
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Read the next frame of an append file into @ref QfileHandle_t.block.
+ * The block grows to fit the frame if need be. A frame that is cut short or
+ * fails its checksum can only be the remains of an append interrupted by a
+ * crash; it ends the file, along with anything after it (see
+ * @ref QfileHandle_t.append_torn_offset). Each frame restarts
+ * the string table, since it was written by a handle of its own.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_append_next(QfileHandle_t *handle) {
+	unsigned char header[QFILE_APPEND_FRAME_HEADER_SIZE];
+	unsigned char *block_new;
+	size_t header_read;
+	size_t frame_size;
+	size_t frame_offset;
+	long offset;
+
+	handle->block_size = 0;
+	handle->block_cursor = 0;
+	handle->stringc = 0;
+
+	if (handle->block == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		frame_offset = handle->map_cursor;
+	} else if ((handle->ptr != NULL) && ((offset = ftell(handle->ptr)) != -1L)) {
+		frame_offset = (size_t) offset;
+	} else {
+		Q_ERROR_SYSTEM("ftell()");
+		return Q_ERROR;
+	}
+
+	header_read = qfile_stored_read(handle, header, (size_t) 1, sizeof(header));
+	if (header_read == 0) {
+		return Q_OK;
+	}
+	frame_size = (size_t) qfile_u32_get(header);
+	if ((header_read != sizeof(header)) || (frame_size == 0)
+			|| (frame_size > qfile_append_remaining_get(handle))) {
+		qfile_append_end(handle, frame_offset);
+		return Q_OK;
+	}
+
+	if (frame_size > handle->block_capacity) {
+		if ((block_new = realloc(handle->block, frame_size)) == NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return Q_ERROR;
+		}
+		handle->block = block_new;
+		handle->block_capacity = frame_size;
+	}
+	if (qfile_stored_read(handle, handle->block, frame_size, (size_t) 1)
+			!= (size_t) 1) {
+		qfile_append_end(handle, frame_offset);
+		return Q_OK;
+	}
+	if (qfile_hash(handle->block, frame_size, 0U) != qfile_u32_get(header + 4)) {
+		qfile_append_end(handle, frame_offset);
+		return Q_OK;
+	}
+
+	handle->block_size = frame_size;
+	return Q_OK;
+}
+
+
+/**
+ * Give up on the torn frame of an append file.
+ * Its offset is kept in @ref QfileHandle_t.append_torn_offset, such that the
+ * file may be cut back to its intact frames, and the read position is moved to
+ * the end of the file.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @param[in] frame_offset: offset of the torn frame.
+ */
+void
+qfile_append_end(QfileHandle_t *handle, size_t frame_offset) {
+	handle->append_torn_offset = frame_offset;
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		handle->map_cursor = handle->map_size;
+	} else if (handle->ptr != NULL) {
+		(void) fseek(handle->ptr, 0L, SEEK_END);
+	}
+}
+
+
+/**
+ * Get the number of bytes left to read in the file of a #QfileHandle_t.
+ * Bounds the size of a frame before its block is grown to fit it.
+ * @param[in] handle: relevant #QfileHandle_t.
+ * @return number of bytes left, or 0 if it can't be told.
+ */
+size_t
+qfile_append_remaining_get(QfileHandle_t *handle) {
+	struct stat st;
+	long offset;
+
+	if (handle->mode == QFILE_MODE_READ_MAPPED) {
+		return handle->map_size - handle->map_cursor;
+	}
+	if ((handle->ptr == NULL) || (fstat(fileno(handle->ptr), &st) == -1)
+			|| ((offset = ftell(handle->ptr)) == -1L)
+			|| ((off_t) offset > st.st_size)) {
+		return 0;
+	}
+	return (size_t) (st.st_size - (off_t) offset);
+}
+
+
+/**
+ * Write a whole buffer to a file descriptor.
+ * Retries on short writes and interruptions.
+ * @param[in] fd: file descriptor to write to.
+ * @param[in] buf: bytes to write.
+ * @param[in] size: number of bytes in @p buf.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_fd_write_all(int fd, const unsigned char *buf, size_t size) {
+	ssize_t written;
+
+	while (size > 0) {
+		if ((written = write(fd, buf, size)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			Q_ERROR_SYSTEM("write()");
+			return Q_ERROR;
+		}
+		buf += written;
+		size -= (size_t) written;
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Tell whether a #QfileHandle_t is open in one of the read modes.
+ * @param[in] handle: relevant #QfileHandle_t; may be @c NULL.
+ * @return @c true or @c false.
+ */
+bool
+qfile_handle_isread(const QfileHandle_t *handle) {
+	if (handle == NULL) {
+		return false;
+	}
+	return ((handle->mode == QFILE_MODE_READ)
+			|| (handle->mode == QFILE_MODE_READ_MAPPED));
+}
+
+
+/**
+ * Tell whether a #QfileHandle_t is open in one of the write modes.
+ * @param[in] handle: relevant #QfileHandle_t; may be @c NULL.
+ * @return @c true or @c false.
+ */
+bool
+qfile_handle_iswrite(const QfileHandle_t *handle) {
+	if (handle == NULL) {
+		return false;
+	}
+	return ((handle->mode == QFILE_MODE_WRITE)
+			|| (handle->mode == QFILE_MODE_WRITE_ATOMIC)
+			|| (handle->mode == QFILE_MODE_WRITE_APPEND));
+}
@@ -0,0 +1,455 @@
+/**
+ * @file qfiles.c
+ * Program file for the string section of the qfile module.
+ * Responsible for string stores, each of which holds one immutable copy of
+ * every distinct string interned into it via qfile_string_intern(). Strings
+ * read from files are interned and handed out as views (see
+ * qdatameta_view_create()), so text repeated across tiles and layers is kept
+ * in memory only once. A store created via qfile_string_store_create() lives
+ * as long as whatever its strings were read for, e.g. a #QwalkArea_t, and is
+ * freed along with it; the shared store, used by handles which weren't given
+ * one, lives until the program exits.
+ *
+ * Also responsible for #QfileStringIndex_t, a small map from string contents
+ * to indices, with which writers assign each distinct string one slot in the
+ * string table of a file.
+ */
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "qattr.h"
+#include "qfile.h"
+
+
+
+/** Number of bytes of string data per chunk of a string store. */
+#define QFILE_STRING_CHUNK_SIZE 65536
+
+/** Number of bytes of string data in the first chunk of a string store. */
+#define QFILE_STRING_CHUNK_SIZE_MIN 4096
+
+/** Starting number of slots in a string store; must be a power of 2. */
+#define QFILE_STRING_SLOTC_INIT 64
+
+/** Starting number of slots in a #QfileStringIndex_t; must be a power of 2. */
+#define QFILE_STRING_INDEX_SLOTC_INIT 64
+
+
+
+/**
+ * Chunk of string data in a string store.
+ * Strings never move once interned; chunks are only ever added.
+ */
+typedef struct QfileStringChunk_t {
+	/** Previously filled chunk. */
+	/*@null@*//*@only@*/struct QfileStringChunk_t *next;
+	size_t size;     /**< Number of bytes in use in @ref QfileStringChunk_t.data. */
+	size_t capacity; /**< Number of bytes allocated to @ref QfileStringChunk_t.data. */
+	char data[];     /**< String data. */
+} QfileStringChunk_t;
+
+/** Slot of a string store. */
+typedef struct QfileStringSlot_t {
+	/** Interned string, or @c NULL if the slot is empty. */
+	/*@null@*//*@observer@*/const char *data;
+	size_t   size; /**< Number of bytes in @ref QfileStringSlot_t.data. */
+	uint32_t hash; /**< Hash of @ref QfileStringSlot_t.data.           */
+} QfileStringSlot_t;
+
+/** Set of interned strings, freed all at once. */
+struct QfileStringStore_t {
+	/** Guards every other member. */
+	pthread_mutex_t mutex;
+
+	/** Open-addressed slots. */
+	/*@null@*//*@only@*/QfileStringSlot_t *slots;
+	size_t slotc; /**< Number of slots; 0 or a power of 2. */
+	size_t count; /**< Number of strings in the store.     */
+
+	/** Chunk strings are currently copied into. */
+	/*@null@*//*@only@*/QfileStringChunk_t *chunk;
+};
+
+
+
+/** String store of handles which weren't given one of their own. */
+static struct QfileStringStore_t qfile_string_store_shared = {
+	PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, NULL
+};
+
+
+
+static int      qfile_string_slots_grow(struct QfileStringStore_t *store)
+	/*@modifies store@*/;
+/*@null@*//*@observer@*/
+static char    *qfile_string_copy(struct QfileStringStore_t *store,
+		const char *s, size_t size)
+	/*@modifies store@*/;
+static size_t   qfile_string_index_slot(const QfileStringIndex_t *index,
+		const char *s, size_t size, uint32_t hash)/*@*/;
+static int      qfile_string_index_grow(QfileStringIndex_t *index)
+	/*@modifies index@*/;
+
+
+
+/**
+ * Create a string store.
+ * @return new, empty string store, or @c NULL.
+ */
+struct QfileStringStore_t *
+qfile_string_store_create() {
+	struct QfileStringStore_t *store;
+
+	if ((store = calloc((size_t) 1, sizeof(*store))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	if (pthread_mutex_init(&store->mutex, NULL) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(store);
+		return NULL;
+	}
+	return store;
+}
+
+
+/**
+ * Destroy a string store and every string interned into it.
+ * Nothing may view its strings afterwards.
+ * @param[in] store: string store from qfile_string_store_create().
+ */
+void
+qfile_string_store_destroy(struct QfileStringStore_t *store) {
+	QfileStringChunk_t *chunk;
+
+	while ((chunk = store->chunk) != NULL) {
+		store->chunk = chunk->next;
+		free(chunk);
+	}
+	free(store->slots);
+	(void) pthread_mutex_destroy(&store->mutex);
+	free(store);
+	return;
+}
+
+
+/**
+ * Intern a string.
+ * The returned copy is shared by every caller interning the same bytes into
+ * the same store, and is never modified; interned strings of one store may
+ * thus be compared by address. It lives until the store is destroyed. Safe to
+ * call from several threads at once.
+ * @param[in,out] store: string store from qfile_string_store_create(), or
+ * @c NULL for the shared store, which is never freed.
+ * @param[in] s: string to intern; need not be NUL-terminated.
+ * @param[in] size: number of bytes in @p s.
+ * @return interned copy of @p s, followed by a NUL, or @c NULL.
+ */
+const char *
+qfile_string_intern(struct QfileStringStore_t *store, const char *s,
+		size_t size) {
+	uint32_t hash;
+	size_t i;
+	const char *interned = NULL;
+	char *copy;
+
+	if (store == NULL) {
+		store = &qfile_string_store_shared;
+	}
+	hash = qfile_hash(s, size, 0U);
+
+	if (pthread_mutex_lock(&store->mutex) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	/* keep at most half of the slots in use, so probe sequences stay short */
+	if (((store->count + 1) * 2 > store->slotc)
+			&& (qfile_string_slots_grow(store) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		(void) pthread_mutex_unlock(&store->mutex);
+		return NULL;
+	}
+
+	/*@-nullderef@*/
+	i = (size_t) hash & (store->slotc - 1);
+	while (store->slots[i].data != NULL) {
+		if ((store->slots[i].hash == hash)
+				&& (store->slots[i].size == size)
+				&& (memcmp(store->slots[i].data, s, size) == 0)) {
+			interned = store->slots[i].data;
+			break;
+		}
+		i = (i + 1) & (store->slotc - 1);
+	}
+
+	if (interned == NULL) {
+		if ((copy = qfile_string_copy(store, s, size)) != NULL) {
+			store->slots[i].data = copy;
+			store->slots[i].size = size;
+			store->slots[i].hash = hash;
+			store->count++;
+			interned = copy;
+		} else {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+	}
+	/*@=nullderef@*/
+
+	(void) pthread_mutex_unlock(&store->mutex);
+	return interned;
+}
+
+
+/**
+ * Get the number of strings in a string store.
+ * @param[in,out] store: string store, or @c NULL for the shared store.
+ * @return number of distinct strings interned into @p store so far.
+ */
+size_t
+qfile_string_count_get(struct QfileStringStore_t *store) {
+	size_t count;
+
+	if (store == NULL) {
+		store = &qfile_string_store_shared;
+	}
+	(void) pthread_mutex_lock(&store->mutex);
+	count = store->count;
+	(void) pthread_mutex_unlock(&store->mutex);
+	return count;
+}
+
+
+/**
+ * Look up a string in a #QfileStringIndex_t.
+ * @param[in] index: relevant #QfileStringIndex_t.
+ * @param[in] s: string to look up; need not be NUL-terminated.
+ * @param[in] size: number of bytes in @p s.
+ * @param[out] valuep: value of @p s, if found.
+ * @return #Q_OK or #Q_ERRORCODE_INT_NOTFOUND.
+ */
+int
+qfile_string_index_get(const QfileStringIndex_t *index, const char *s,
+		size_t size, size_t *valuep) {
+	size_t i;
+
+	if (index->slots == NULL) {
+		return Q_ERRORCODE_INT_NOTFOUND;
+	}
+	i = qfile_string_index_slot(index, s, size, qfile_hash(s, size, 0U));
+	if (index->slots[i].key == NULL) {
+		return Q_ERRORCODE_INT_NOTFOUND;
+	}
+	*valuep = index->slots[i].value;
+	return Q_OK;
+}
+
+
+/**
+ * Add a string to a #QfileStringIndex_t, or update its value.
+ * The index keeps @p s rather than a copy of it, so @p s must outlive the
+ * index, or at least its next qfile_string_index_clear().
+ * @param[in,out] index: relevant #QfileStringIndex_t.
+ * @param[in] s: string to add; need not be NUL-terminated.
+ * @param[in] size: number of bytes in @p s.
+ * @param[in] value: value to map @p s to.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_string_index_put(QfileStringIndex_t *index, const char *s, size_t size,
+		size_t value) {
+	uint32_t hash;
+	size_t i;
+
+	if (((index->count + 1) * 2 > index->slotc)
+			&& (qfile_string_index_grow(index) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	hash = qfile_hash(s, size, 0U);
+	/*@-nullderef@*/
+	i = qfile_string_index_slot(index, s, size, hash);
+	if (index->slots[i].key == NULL) {
+		index->slots[i].key = s;
+		index->slots[i].size = size;
+		index->slots[i].hash = hash;
+		index->count++;
+	}
+	index->slots[i].value = value;
+	/*@=nullderef@*/
+	return Q_OK;
+}
+
+
+/**
+ * Empty a #QfileStringIndex_t and free its slots.
+ * The index may be reused afterwards.
+ * @param[in,out] index: relevant #QfileStringIndex_t.
+ */
+void
+qfile_string_index_clear(QfileStringIndex_t *index) {
+	free(index->slots);
+	index->slots = NULL;
+	index->slotc = 0;
+	index->count = 0;
+	return;
+}
+
+
+/**
+ * Double the number of slots of a string store, rehashing every string.
+ * Must be called with the mutex of @p store held.
+ * @param[in,out] store: relevant string store.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_string_slots_grow(struct QfileStringStore_t *store) {
+	QfileStringSlot_t *slots;
+	size_t slotc;
+	size_t j;
+
+	slotc = (store->slotc == 0)
+		? (size_t) QFILE_STRING_SLOTC_INIT : store->slotc * 2;
+	if ((slots = calloc(slotc, sizeof(*slots))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return Q_ERROR;
+	}
+
+	for (size_t i = 0; i < store->slotc; i++) {
+		/*@-nullderef@*/
+		if (store->slots[i].data == NULL) {
+			continue;
+		}
+		j = (size_t) store->slots[i].hash & (slotc - 1);
+		while (slots[j].data != NULL) {
+			j = (j + 1) & (slotc - 1);
+		}
+		slots[j] = store->slots[i];
+		/*@=nullderef@*/
+	}
+
+	free(store->slots);
+	store->slots = slots;
+	store->slotc = slotc;
+	return Q_OK;
+}
+
+
+/**
+ * Copy a string into the chunks of a string store.
+ * Chunks double in size up to #QFILE_STRING_CHUNK_SIZE, so that the stores of
+ * small areas stay small; strings larger than that get a chunk of their own.
+ * Must be called with the mutex of @p store held.
+ * @param[in,out] store: relevant string store.
+ * @param[in] s: string to copy.
+ * @param[in] size: number of bytes in @p s.
+ * @return copy of @p s, followed by a NUL, or @c NULL.
+ */
+char *
+qfile_string_copy(struct QfileStringStore_t *store, const char *s, size_t size) {
+	QfileStringChunk_t *chunk;
+	size_t capacity;
+	char *copy;
+
+	if ((store->chunk == NULL)
+			|| (size + 1 > store->chunk->capacity - store->chunk->size)) {
+		capacity = (store->chunk == NULL)
+			? (size_t) QFILE_STRING_CHUNK_SIZE_MIN : store->chunk->capacity * 2;
+		if (capacity > (size_t) QFILE_STRING_CHUNK_SIZE) {
+			capacity = (size_t) QFILE_STRING_CHUNK_SIZE;
+		}
+		if (size + 1 > capacity) {
+			capacity = size + 1;
+		}
+		if ((chunk = malloc(sizeof(*chunk) + capacity)) == NULL) {
+			Q_ERROR_SYSTEM("malloc()");
+			return NULL;
+		}
+		chunk->next = store->chunk;
+		chunk->size = 0;
+		chunk->capacity = capacity;
+		store->chunk = chunk;
+	}
+
+	copy = store->chunk->data + store->chunk->size;
+	memcpy(copy, s, size);
+	copy[size] = '\0';
+	store->chunk->size += size + 1;
+	return copy;
+}
+
+
+/**
+ * Find the slot of a string in a #QfileStringIndex_t.
+ * @param[in] index: relevant #QfileStringIndex_t, with at least one empty slot.
+ * @param[in] s: string to find.
+ * @param[in] size: number of bytes in @p s.
+ * @param[in] hash: qfile_hash() of @p s.
+ * @return slot holding @p s, or the empty slot it would go into.
+ */
+size_t
+qfile_string_index_slot(const QfileStringIndex_t *index, const char *s,
+		size_t size, uint32_t hash) {
+	size_t i;
+
+	i = (size_t) hash & (index->slotc - 1);
+	/*@-nullderef@*/
+	while ((index->slots[i].key != NULL)
+			&& ((index->slots[i].hash != hash)
+				|| (index->slots[i].size != size)
+				|| (memcmp(index->slots[i].key, s, size) != 0))) {
+		i = (i + 1) & (index->slotc - 1);
+	}
+	/*@=nullderef@*/
+	return i;
+}
+
+
+/**
+ * Double the number of slots of a #QfileStringIndex_t.
+ * @param[in,out] index: relevant #QfileStringIndex_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_string_index_grow(QfileStringIndex_t *index) {
+	QfileStringIndex_t grown;
+	size_t j;
+
+	grown.slotc = (index->slotc == 0)
+		? (size_t) QFILE_STRING_INDEX_SLOTC_INIT : index->slotc * 2;
+	grown.count = 0;
+	if ((grown.slots = calloc(grown.slotc, sizeof(*grown.slots))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return Q_ERROR;
+	}
+
+	/* keys are unique already, so each one just takes the first empty slot */
+	for (size_t i = 0; i < index->slotc; i++) {
+		/*@-nullderef@*/
+		if (index->slots[i].key == NULL) {
+			continue;
+		}
+		j = (size_t) index->slots[i].hash & (grown.slotc - 1);
+		while (grown.slots[j].key != NULL) {
+			j = (j + 1) & (grown.slotc - 1);
+		}
+		grown.slots[j] = index->slots[i];
+		grown.count++;
+		/*@=nullderef@*/
+	}
+
+	free(index->slots);
+	*index = grown;
+	return Q_OK;
+}
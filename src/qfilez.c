@@ -0,0 +1,341 @@
+/**
+ * @file qfilez.c
+ * Program file for the compression section of the qfile module.
+ * Responsible for the codec behind the blocks of compressed files (see
+ * #QFILE_BLOCK_FLAG_COMPRESSED). It is a byte-oriented LZ77 variant with no
+ * entropy stage, such that decoding a block costs little more than copying it.
+ * A compressed block is a series of sequences, each laid out as follows:
+ * - a token byte, whose high nibble is the number of literals and whose low
+ *   nibble is the match length minus #QFILE_BLOCK_MATCH_MIN. A nibble of 15
+ *   means the value continues in extra bytes, each added to it, up to and
+ *   including the first byte that isn't 255.
+ * - the extra literal count bytes, then the literals themselves.
+ * - a @c uint16 little-endian offset, counted back from the end of the output
+ *   so far, then the extra match length bytes.
+ *
+ * The last sequence of a block stops right after its literals; the decoder
+ * knows it has reached it once the output is full. Matches may overlap their
+ * own output, which is how runs (e.g. a layer of identical tiles) shrink to a
+ * handful of bytes.
+ */
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "qattr.h"
+#include "qfile.h"
+
+
+
+/** Shortest match worth encoding, in bytes. */
+#define QFILE_BLOCK_MATCH_MIN 4
+
+/** Greatest offset a match may reach back to. */
+#define QFILE_BLOCK_OFFSET_MAX 65535
+
+/** Number of bits in the hash of a #QFILE_BLOCK_MATCH_MIN byte sequence. */
+#define QFILE_BLOCK_HASH_BITS 12
+
+/** Value of a token nibble meaning that the value continues in extra bytes. */
+#define QFILE_BLOCK_NIBBLE_MAX 15
+
+
+
+static size_t   qfile_block_length_put(unsigned char *dest, size_t dest_capacity,
+		size_t length)/*@modifies dest@*/;
+static size_t   qfile_block_sequence_put(unsigned char *dest, size_t dest_capacity,
+		const unsigned char *literals, size_t literalc, size_t offset,
+		size_t match_length)/*@modifies dest@*/;
+static uint32_t qfile_block_hash(const unsigned char *src)/*@*/;
+
+
+
+/**
+ * Get the greatest size a block of @p size bytes may compress to.
+ * Incompressible data grows by its token and length bytes.
+ * @param[in] size: number of bytes to compress.
+ * @return compressed size upper bound.
+ */
+size_t
+qfile_block_bound(size_t size) {
+	return size + (size / 255) + 16;
+}
+
+
+/**
+ * Compress a block.
+ * Back-references are found through a table of the latest position of every
+ * hashed #QFILE_BLOCK_MATCH_MIN byte sequence; the table is rebuilt for every
+ * block, so blocks are independent of each other.
+ * @param[in] src: bytes to compress.
+ * @param[in] src_size: number of bytes in @p src; at most
+ * #QFILE_BLOCK_OFFSET_MAX + 1.
+ * @param[out] dest: buffer for the compressed bytes.
+ * @param[in] dest_capacity: size of @p dest.
+ * @return size of the compressed block, or 0 if it didn't fit in @p dest.
+ */
+size_t
+qfile_block_compress(const unsigned char *src, size_t src_size,
+		unsigned char *dest, size_t dest_capacity) {
+	uint32_t table[1 << QFILE_BLOCK_HASH_BITS];
+	size_t ip = 0;
+	size_t anchor = 0;
+	size_t dest_size = 0;
+	size_t match;
+	size_t match_length;
+	size_t written;
+	uint32_t h;
+
+	if (src_size > (size_t) QFILE_BLOCK_OFFSET_MAX + 1) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return 0;
+	}
+
+	/* entries hold position + 1, so that 0 means empty */
+	memset(table, 0, sizeof(table));
+
+	while (ip + QFILE_BLOCK_MATCH_MIN <= src_size) {
+		h = qfile_block_hash(src + ip);
+		if (table[h] == 0) {
+			table[h] = (uint32_t) (ip + 1);
+			ip++;
+			continue;
+		}
+		match = (size_t) table[h] - 1;
+		table[h] = (uint32_t) (ip + 1);
+		if (memcmp(src + match, src + ip, (size_t) QFILE_BLOCK_MATCH_MIN) != 0) {
+			ip++;
+			continue;
+		}
+
+		match_length = (size_t) QFILE_BLOCK_MATCH_MIN;
+		while ((ip + match_length < src_size)
+				&& (src[match + match_length] == src[ip + match_length])) {
+			match_length++;
+		}
+
+		written = qfile_block_sequence_put(dest + dest_size,
+				dest_capacity - dest_size, src + anchor, ip - anchor,
+				ip - match, match_length);
+		if (written == 0) {
+			return 0;
+		}
+		dest_size += written;
+		ip += match_length;
+		anchor = ip;
+	}
+
+	written = qfile_block_sequence_put(dest + dest_size,
+			dest_capacity - dest_size, src + anchor, src_size - anchor,
+			0, 0);
+	if (written == 0) {
+		return 0;
+	}
+	return dest_size + written;
+}
+
+
+/**
+ * Decompress a block from qfile_block_compress().
+ * Every length and offset is checked against the bounds of @p src and @p
+ * dest, so a corrupt block is an error rather than a stray access.
+ * @param[in] src: compressed bytes.
+ * @param[in] src_size: number of bytes in @p src.
+ * @param[out] dest: buffer for the decompressed bytes.
+ * @param[in] dest_size: exact size of the decompressed block.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qfile_block_decompress(const unsigned char *src, size_t src_size,
+		unsigned char *dest, size_t dest_size) {
+	size_t ip = 0;
+	size_t op = 0;
+	size_t literalc;
+	size_t match_length;
+	size_t offset;
+	unsigned char token;
+	unsigned char extra;
+
+	while (ip < src_size) {
+		token = src[ip++];
+
+		literalc = (size_t) (token >> 4);
+		if (literalc == (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+			do {
+				if (ip >= src_size) {
+					Q_ERRORFOUND(QERROR_FILE_FORMAT);
+					return Q_ERROR;
+				}
+				extra = src[ip++];
+				literalc += (size_t) extra;
+			} while (extra == 255);
+		}
+		if ((literalc > src_size - ip) || (literalc > dest_size - op)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		memcpy(dest + op, src + ip, literalc);
+		ip += literalc;
+		op += literalc;
+
+		if (op == dest_size) {
+			break;
+		}
+
+		if (src_size - ip < 2) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		offset = (size_t) qfile_u16_get(src + ip);
+		ip += 2;
+
+		match_length = (size_t) (token & 0x0f);
+		if (match_length == (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+			do {
+				if (ip >= src_size) {
+					Q_ERRORFOUND(QERROR_FILE_FORMAT);
+					return Q_ERROR;
+				}
+				extra = src[ip++];
+				match_length += (size_t) extra;
+			} while (extra == 255);
+		}
+		match_length += (size_t) QFILE_BLOCK_MATCH_MIN;
+
+		if ((offset == 0) || (offset > op) || (match_length > dest_size - op)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			return Q_ERROR;
+		}
+		/* byte by byte, since the match may overlap its own output */
+		for (size_t i = 0; i < match_length; i++) {
+			dest[op + i] = dest[op - offset + i];
+		}
+		op += match_length;
+	}
+
+	if ((op != dest_size) || (ip != src_size)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Write the extra bytes of a length whose token nibble overflowed.
+ * @param[out] dest: buffer for the extra bytes.
+ * @param[in] dest_capacity: size of @p dest.
+ * @param[in] length: what remains of the length after the nibble.
+ * @return number of bytes written, or 0 if they didn't fit.
+ */
+size_t
+qfile_block_length_put(unsigned char *dest, size_t dest_capacity,
+		size_t length) {
+	size_t written = 0;
+
+	while (length >= 255) {
+		if (written >= dest_capacity) {
+			return 0;
+		}
+		dest[written++] = 255;
+		length -= 255;
+	}
+	if (written >= dest_capacity) {
+		return 0;
+	}
+	dest[written++] = (unsigned char) length;
+	return written;
+}
+
+
+/**
+ * Write one sequence of a compressed block.
+ * @param[out] dest: buffer for the sequence.
+ * @param[in] dest_capacity: size of @p dest.
+ * @param[in] literals: literal bytes.
+ * @param[in] literalc: number of bytes in @p literals.
+ * @param[in] offset: match offset; ignored for the last sequence.
+ * @param[in] match_length: match length, or 0 for the last sequence.
+ * @return number of bytes written, or 0 if they didn't fit.
+ */
+size_t
+qfile_block_sequence_put(unsigned char *dest, size_t dest_capacity,
+		const unsigned char *literals, size_t literalc, size_t offset,
+		size_t match_length) {
+	size_t written = 1;
+	size_t extra;
+	unsigned char token;
+	size_t match_rest = 0;
+
+	if (dest_capacity < 1) {
+		return 0;
+	}
+
+	if (literalc >= (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+		token = (unsigned char) (QFILE_BLOCK_NIBBLE_MAX << 4);
+	} else {
+		token = (unsigned char) (literalc << 4);
+	}
+	if (match_length > 0) {
+		match_rest = match_length - QFILE_BLOCK_MATCH_MIN;
+		if (match_rest >= (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+			token |= (unsigned char) QFILE_BLOCK_NIBBLE_MAX;
+		} else {
+			token |= (unsigned char) match_rest;
+		}
+	}
+	dest[0] = token;
+
+	if (literalc >= (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+		if ((extra = qfile_block_length_put(dest + written,
+						dest_capacity - written,
+						literalc - QFILE_BLOCK_NIBBLE_MAX)) == 0) {
+			return 0;
+		}
+		written += extra;
+	}
+	if (literalc > dest_capacity - written) {
+		return 0;
+	}
+	memcpy(dest + written, literals, literalc);
+	written += literalc;
+
+	if (match_length == 0) {
+		return written;
+	}
+
+	if (dest_capacity - written < 2) {
+		return 0;
+	}
+	qfile_u16_put(dest + written, (uint16_t) offset);
+	written += 2;
+
+	if (match_rest >= (size_t) QFILE_BLOCK_NIBBLE_MAX) {
+		if ((extra = qfile_block_length_put(dest + written,
+						dest_capacity - written,
+						match_rest - QFILE_BLOCK_NIBBLE_MAX)) == 0) {
+			return 0;
+		}
+		written += extra;
+	}
+
+	return written;
+}
+
+
+/**
+ * Hash the #QFILE_BLOCK_MATCH_MIN bytes at @p src.
+ * @param[in] src: bytes to hash.
+ * @return hash of #QFILE_BLOCK_HASH_BITS bits.
+ */
+uint32_t
+qfile_block_hash(const unsigned char *src) {
+	return (qfile_u32_get(src) * 2654435761U) >> (32 - QFILE_BLOCK_HASH_BITS);
+}
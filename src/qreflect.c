@@ -0,0 +1,151 @@
+/**
+ * @file qreflect.c
+ * Program file for the reflection module.
+ * The perfect hash of a #Qreflect_t is found by trial: seeds are tried in
+ * turn until one hashes every string to a slot of its own. Tables are small
+ * and built once, so this costs next to nothing.
+ */
+
+
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "qattr.h"
+#include "qfile.h"
+#include "qreflect.h"
+
+
+
+/** Number of seeds tried for each slot count before using more slots. */
+#define QREFLECT_SEED_TRIES 65536
+
+
+
+/** Guards the building of every #Qreflect_t. */
+static pthread_mutex_t qreflect_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+static int      qreflect_build(Qreflect_t *reflect)/*@modifies reflect@*/;
+
+
+
+/**
+ * Get the string version of an enum constant.
+ * Reports no error, so that qerror_internal() may use it.
+ * @param[in] reflect: #Qreflect_t of the enum.
+ * @param[in] constant: enum constant.
+ * @return string version of @p constant, or @c NULL if it has none.
+ */
+const char *
+qreflect_string_get(const Qreflect_t *reflect, int constant) {
+	if ((constant < reflect->first) || (constant > reflect->last)) {
+		return NULL;
+	}
+	return reflect->strings[constant];
+}
+
+
+/**
+ * Get the enum constant of a string.
+ * Builds the perfect hash of @p reflect upon first use, under
+ * #qreflect_mutex; once it is built, lookups take no lock. Reports no error
+ * for an unknown string, leaving that to the caller.
+ * @param[in,out] reflect: #Qreflect_t of the enum.
+ * @param[in] s: string to look up.
+ * @return enum constant of @p s, or #Q_ERRORCODE_ENUM.
+ */
+int
+qreflect_constant_get(Qreflect_t *reflect, const char *s) {
+	unsigned char slot;
+	int constant;
+
+	/* pairs with the release in qreflect_build(), so the slots are complete */
+	if (!__atomic_load_n(&reflect->built, __ATOMIC_ACQUIRE)) {
+		if (pthread_mutex_lock(&qreflect_mutex) != 0) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERRORCODE_ENUM;
+		}
+		if (!reflect->built && (qreflect_build(reflect) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			(void) pthread_mutex_unlock(&qreflect_mutex);
+			return Q_ERRORCODE_ENUM;
+		}
+		(void) pthread_mutex_unlock(&qreflect_mutex);
+	}
+
+	slot = reflect->slots[qfile_hash(s, strlen(s), reflect->seed)
+		& (reflect->slotc - 1)];
+	if (slot == 0) {
+		return Q_ERRORCODE_ENUM;
+	}
+	constant = reflect->first + (int) slot - 1;
+	if (strcmp(reflect->strings[constant], s) != 0) {
+		return Q_ERRORCODE_ENUM;
+	}
+	return constant;
+}
+
+
+/**
+ * Build the perfect hash of a #Qreflect_t.
+ * Must be called with #qreflect_mutex held. @ref Qreflect_t.built is set
+ * last, such that a lookup seeing it set sees every slot as well.
+ * @param[out] reflect: relevant #Qreflect_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qreflect_build(Qreflect_t *reflect) {
+	size_t stringc = 0;
+	size_t slot;
+	uint32_t seed;
+	bool collided;
+
+	for (int c = reflect->first; c <= reflect->last; c++) {
+		if (reflect->strings[c] != NULL) {
+			stringc++;
+		}
+	}
+
+	/* start at twice as many slots as strings, so that seeds are easy to find */
+	reflect->slotc = 8;
+	while (reflect->slotc < stringc * 2) {
+		reflect->slotc *= 2;
+	}
+
+	for (; reflect->slotc <= (size_t) QREFLECT_SLOTC_MAX; reflect->slotc *= 2) {
+		for (seed = 0; seed < (uint32_t) QREFLECT_SEED_TRIES; seed++) {
+			memset(reflect->slots, 0, sizeof(reflect->slots));
+			collided = false;
+			for (int c = reflect->first; (c <= reflect->last) && !collided; c++) {
+				if (reflect->strings[c] == NULL) {
+					continue;
+				}
+				slot = qfile_hash(reflect->strings[c],
+						strlen(reflect->strings[c]), seed)
+					& (reflect->slotc - 1);
+				if (reflect->slots[slot] != 0) {
+					collided = true;
+				}
+				reflect->slots[slot] = (unsigned char) (c - reflect->first + 1);
+			}
+			if (!collided) {
+				reflect->seed = seed;
+				__atomic_store_n(&reflect->built, true, __ATOMIC_RELEASE);
+				return Q_OK;
+			}
+		}
+	}
+
+	Q_ERRORFOUND(QERROR_BADDEFINE);
+	return Q_ERROR;
+}
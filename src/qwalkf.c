@@ -0,0 +1,989 @@
+/**
+ * @file qwalkf.c
+ * Program file for the file section of the qwalk module.
+ * Responsible for the columnar #QwalkArea_t file format. Every value in it is
+ * fixed-width and little-endian. A file is laid out as follows:
+ * - a header of #QWALK_FILE_HEADER_SIZE bytes: #QWALK_FILE_MAGIC; then, as
+ *   @c uint16, the version, flags, y dimension, x dimension, layer count and a
+ *   reserved field; then, as @c uint32, the size of a chunk section, the
+ *   offset of the blob and the size of the blob.
+ * - per layer, in the order #QwalkArea_t.layer_earth,
+ *   #QwalkArea_t.layer_floater: the @c uint32 number of populated chunks; the
+ *   @c uint32 index of each in @ref QwalkLayer_t.chunks, ascending; then a
+ *   section per chunk, in the same order. A section is a series of 4-byte
+ *   aligned columns with one entry per object: a @c uint8 #QobjType_t column,
+ *   a packed #QATTR_KEY_CANMOVE bit column, a @c uint16 column of masks of the
+ *   #QattrKey_t present, and a @c uint32 offset column and @c uint32 length
+ *   column for each key in #qwalk_file_string_keys. Entries past the edge of
+ *   the layer are zero and ignored.
+ * - the blob, holding every distinct string payload, once, with its terminating
+ *   NUL. Objects with the same string share its offset.
+ *
+ * Files of #QWALK_FILE_VERSION_UNCHUNKED are still read; they hold a single
+ * section of #QWALK_LAYER_SIZE objects per layer instead of the chunks, and
+ * their size field is that of such a section.
+ *
+ * Nothing is decoded field by field upon reading; every attribute value is a
+ * view (see qdatameta_view_create()) into either the file contents, which the
+ * #QwalkArea_t keeps in @ref QwalkArea_t.storage, or the constant tables
+ * below.
+ */
+
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ncurses.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "splint_types.h"
+#include "qattr.h"
+#include "qarena.h"
+#include "qfile.h"
+#include "dialogue.h"
+#include "qwalk.h"
+
+
+
+/** Size in bytes of the header of a columnar #QwalkArea_t file. */
+#define QWALK_FILE_HEADER_SIZE 32
+
+/**
+ * @defgroup FileHeaderOffsets File header offsets
+ * Offsets in bytes of the fields in the header of a columnar file.
+ * @{
+ */
+
+/** Offset of the @c uint16 format version.          */
+#define QWALK_FILE_HEADER_VERSION     8
+/** Offset of the @c uint16 flags (currently unused). */
+#define QWALK_FILE_HEADER_FLAGS      10
+/** Offset of the @c uint16 y dimension.             */
+#define QWALK_FILE_HEADER_SIZE_Y     12
+/** Offset of the @c uint16 x dimension.             */
+#define QWALK_FILE_HEADER_SIZE_X     14
+/** Offset of the @c uint16 layer count.             */
+#define QWALK_FILE_HEADER_LAYERC     16
+/** Offset of the @c uint32 size of a section.       */
+#define QWALK_FILE_HEADER_LAYER_SIZE 20
+/** Offset of the @c uint32 offset of the blob.      */
+#define QWALK_FILE_HEADER_BLOB       24
+/** Offset of the @c uint32 size of the blob.        */
+#define QWALK_FILE_HEADER_BLOB_SIZE  28
+
+/** @} */
+
+/** Alignment in bytes of every column in a layer section. */
+#define QWALK_FILE_COLUMN_ALIGNMENT 4
+
+/** Number of elements in #qwalk_file_string_keys. */
+#define QWALK_FILE_STRING_KEYC 4
+
+/** Starting capacity in bytes of the blob being written. */
+#define QWALK_FILE_BLOB_CAPACITY_INIT 4096
+
+
+
+/**
+ * Offsets of the columns in a chunk section, relative to the section start.
+ */
+typedef struct QwalkFileLayout_t {
+	size_t type_column;    /**< @c uint8 #QobjType_t column.          */
+	size_t canmove_column; /**< packed #QATTR_KEY_CANMOVE bit column. */
+	size_t keymask_column; /**< @c uint16 key mask column.             */
+
+	/** @c uint32 blob offset column of each #qwalk_file_string_keys. */
+	size_t string_offset_columns[QWALK_FILE_STRING_KEYC];
+
+	/** @c uint32 length column of each #qwalk_file_string_keys.      */
+	size_t string_length_columns[QWALK_FILE_STRING_KEYC];
+
+	size_t size; /**< total size of a section. */
+} QwalkFileLayout_t;
+
+
+/** Blob of a columnar file being written. */
+typedef struct QwalkFileBlob_t {
+	/*@only@*/unsigned char *data; /**< String payloads.              */
+	size_t size;     /**< Number of bytes in use in @ref QwalkFileBlob_t.data.    */
+	size_t capacity; /**< Number of bytes allocated to @ref QwalkFileBlob_t.data. */
+
+	/** Offset of every payload in the blob, by contents. */
+	QfileStringIndex_t offsets;
+} QwalkFileBlob_t;
+
+
+/** #QattrKey_t whose values are #QDATA_TYPE_CHAR_STRING kept in the blob. */
+static const QattrKey_t qwalk_file_string_keys[QWALK_FILE_STRING_KEYC] = {
+	QATTR_KEY_NAME,
+	QATTR_KEY_DESCRIPTION_BRIEF,
+	QATTR_KEY_DESCRIPTION_LONG,
+	QATTR_KEY_QDL_FILE
+};
+
+/** Every #QobjType_t, indexed by itself; viewed by #QATTR_KEY_QOBJECT_TYPE. */
+static const QobjType_t qwalk_file_obj_types[QOBJ_TYPE_COUNT + 1] = {
+	[QOBJ_TYPE_PLAYER]       = QOBJ_TYPE_PLAYER,
+	[QOBJ_TYPE_GRASS]        = QOBJ_TYPE_GRASS,
+	[QOBJ_TYPE_TREE]         = QOBJ_TYPE_TREE,
+	[QOBJ_TYPE_NPC_FRIENDLY] = QOBJ_TYPE_NPC_FRIENDLY,
+	[QOBJ_TYPE_VOID]         = QOBJ_TYPE_VOID
+};
+
+/** Both @c bool values, indexed by themselves; viewed by #QATTR_KEY_CANMOVE. */
+static const bool qwalk_file_bools[2] = {false, true};
+
+
+
+static void     qwalk_file_layout_get(/*@out@*/QwalkFileLayout_t *layout,
+		size_t objc)/*@modifies layout@*/;
+static size_t   qwalk_file_layer_size_get(const QwalkLayer_t *layer,
+		const QwalkFileLayout_t *layout)/*@*/;
+static int      qwalk_file_layer_encode(const QwalkLayer_t *layer,
+		unsigned char *dest, const QwalkFileLayout_t *layout,
+		QwalkFileBlob_t *blob)/*@modifies dest, blob@*/;
+static int      qwalk_file_object_encode(const QattrList_t *attr_list, int index,
+		unsigned char *section, const QwalkFileLayout_t *layout,
+		QwalkFileBlob_t *blob)/*@modifies section, blob@*/;
+static int      qwalk_file_blob_append(QwalkFileBlob_t *blob, const char *s,
+		size_t size, /*@out@*/size_t *offsetp)/*@modifies blob, offsetp@*/;
+/*@null@*//*@only@*/
+static QwalkLayer_t *qwalk_file_layer_decode(const unsigned char *data,
+		size_t size, size_t *offsetp, int size_y, int size_x,
+		const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size)/*@modifies offsetp@*/;
+static int      qwalk_file_section_decode(QwalkLayer_t *layer,
+		const unsigned char *section, int chunk,
+		const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size)/*@modifies layer@*/;
+/*@null@*//*@only@*/
+static QattrList_t  *qwalk_file_object_decode(const unsigned char *section,
+		int index, const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size, Qarena_t *arena)/*@modifies arena@*/;
+static int      qwalk_file_string_key_index(QattrKey_t key)/*@*/;
+
+
+
+/**
+ * Write a #QwalkArea_t to the file opened via qfile_open() in the columnar
+ * format.
+ * @see qwalk_area_v2_handle_write().
+ * @param[in] walk_area: #QwalkArea_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_v2_write(const QwalkArea_t *walk_area) {
+	return qwalk_area_v2_handle_write(qfile_handle_default_get(), walk_area);
+}
+
+
+/**
+ * Write a #QwalkArea_t to a #QfileHandle_t in the columnar format.
+ * The whole file is laid out in memory and handed to qfile in two writes.
+ * Only populated chunks are written, such that the size of the file follows
+ * them rather than the dimensions of the area.
+ * @param[out] handle: #QfileHandle_t to write to.
+ * @param[in] walk_area: #QwalkArea_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_v2_handle_write(QfileHandle_t *handle,
+		const QwalkArea_t *walk_area) {
+	const QwalkLayer_t *layers[QWALK_AREA_TOTAL_LAYER_COUNT];
+	QwalkFileLayout_t layout;
+	unsigned char *file;
+	size_t file_size;
+	size_t offset;
+	QwalkFileBlob_t blob;
+	int returnval = Q_OK;
+
+	if ((walk_area == NULL) || (walk_area->layer_earth == NULL)
+			|| (walk_area->layer_floater == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	layers[0] = walk_area->layer_earth;
+	layers[1] = walk_area->layer_floater;
+
+	/* the header holds a single pair of dimensions */
+	if ((layers[0]->size_y != layers[1]->size_y)
+			|| (layers[0]->size_x != layers[1]->size_x)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	qwalk_file_layout_get(&layout, (size_t) QWALK_CHUNK_SIZE);
+	file_size = (size_t) QWALK_FILE_HEADER_SIZE;
+	for (int l = 0; l < QWALK_AREA_TOTAL_LAYER_COUNT; l++) {
+		file_size += qwalk_file_layer_size_get(layers[l], &layout);
+	}
+	if (file_size > (size_t) UINT32_MAX) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		return Q_ERROR;
+	}
+
+	if ((file = calloc(file_size, (size_t) 1)) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return Q_ERROR;
+	}
+	memset(&blob, 0, sizeof(blob));
+	blob.capacity = (size_t) QWALK_FILE_BLOB_CAPACITY_INIT;
+	if ((blob.data = malloc(blob.capacity)) == NULL) {
+		Q_ERROR_SYSTEM("malloc()");
+		free(file);
+		return Q_ERROR;
+	}
+
+	offset = (size_t) QWALK_FILE_HEADER_SIZE;
+	for (int l = 0; (l < QWALK_AREA_TOTAL_LAYER_COUNT) && (returnval == Q_OK);
+			l++) {
+		if (qwalk_file_layer_encode(layers[l], file + offset, &layout, &blob)
+				== Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+		offset += qwalk_file_layer_size_get(layers[l], &layout);
+	}
+	if ((returnval == Q_OK) && (blob.size > (size_t) UINT32_MAX - file_size)) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		returnval = Q_ERROR;
+	}
+
+	if (returnval == Q_OK) {
+		memcpy(file, QWALK_FILE_MAGIC, (size_t) QWALK_FILE_MAGIC_SIZE);
+		qfile_u16_put(file + QWALK_FILE_HEADER_VERSION,
+				(uint16_t) QWALK_FILE_VERSION);
+		qfile_u16_put(file + QWALK_FILE_HEADER_FLAGS, (uint16_t) 0);
+		qfile_u16_put(file + QWALK_FILE_HEADER_SIZE_Y,
+				(uint16_t) layers[0]->size_y);
+		qfile_u16_put(file + QWALK_FILE_HEADER_SIZE_X,
+				(uint16_t) layers[0]->size_x);
+		qfile_u16_put(file + QWALK_FILE_HEADER_LAYERC,
+				(uint16_t) QWALK_AREA_TOTAL_LAYER_COUNT);
+		qfile_u32_put(file + QWALK_FILE_HEADER_LAYER_SIZE,
+				(uint32_t) layout.size);
+		qfile_u32_put(file + QWALK_FILE_HEADER_BLOB, (uint32_t) file_size);
+		qfile_u32_put(file + QWALK_FILE_HEADER_BLOB_SIZE,
+				(uint32_t) blob.size);
+
+		if ((qfile_handle_bytes_write(handle, file, file_size) == Q_ERROR)
+				|| (qfile_handle_bytes_write(handle, blob.data, blob.size)
+					== Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+	}
+
+	qfile_string_index_clear(&blob.offsets);
+	free(blob.data);
+	free(file);
+	return returnval;
+}
+
+
+/**
+ * Read a columnar #QwalkArea_t from the file opened via qfile_open().
+ * @see qwalk_area_v2_handle_read().
+ * @return new #QwalkArea_t or @c NULL if the file is malformed.
+ */
+QwalkArea_t *
+qwalk_area_v2_read() {
+	return qwalk_area_v2_handle_read(qfile_handle_default_get());
+}
+
+
+/**
+ * Read a columnar #QwalkArea_t from a #QfileHandle_t.
+ * The contents of the file are detached from @p handle and kept in @ref
+ * QwalkArea_t.storage, so the file may be closed as usual afterwards.
+ * @param[in,out] handle: #QfileHandle_t to read from.
+ * @return new #QwalkArea_t or @c NULL if the file is malformed.
+ */
+QwalkArea_t *
+qwalk_area_v2_handle_read(QfileHandle_t *handle) {
+	QfileBuffer_t *buffer;
+	QwalkFileLayout_t layout;
+	QwalkLayer_t *layers[QWALK_AREA_TOTAL_LAYER_COUNT];
+	QwalkArea_t *walk_area;
+	uint16_t version;
+	int size_y;
+	int size_x;
+	size_t offset;
+	size_t blob_offset;
+	size_t blob_size;
+	const unsigned char *data;
+
+	if ((buffer = qfile_handle_buffer_detach(handle)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	data = buffer->data;
+
+	/* validate the header before trusting any offset in it */
+	if ((buffer->size < (size_t) QWALK_FILE_HEADER_SIZE)
+			|| (memcmp(data, QWALK_FILE_MAGIC, (size_t) QWALK_FILE_MAGIC_SIZE) != 0)
+			|| (((version = qfile_u16_get(data + QWALK_FILE_HEADER_VERSION))
+					!= (uint16_t) QWALK_FILE_VERSION)
+				&& (version != (uint16_t) QWALK_FILE_VERSION_UNCHUNKED))
+			|| (qfile_u16_get(data + QWALK_FILE_HEADER_LAYERC)
+				!= (uint16_t) QWALK_AREA_TOTAL_LAYER_COUNT)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		qfile_buffer_release(buffer);
+		return NULL;
+	}
+
+	size_y = (int) qfile_u16_get(data + QWALK_FILE_HEADER_SIZE_Y);
+	size_x = (int) qfile_u16_get(data + QWALK_FILE_HEADER_SIZE_X);
+	qwalk_file_layout_get(&layout, version == (uint16_t) QWALK_FILE_VERSION
+			? (size_t) QWALK_CHUNK_SIZE : (size_t) QWALK_LAYER_SIZE);
+	if (((size_t) qfile_u32_get(data + QWALK_FILE_HEADER_LAYER_SIZE)
+				!= layout.size)
+			|| ((version == (uint16_t) QWALK_FILE_VERSION_UNCHUNKED)
+				&& ((size_y != QWALK_LAYER_SIZE_Y)
+					|| (size_x != QWALK_LAYER_SIZE_X)))) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		qfile_buffer_release(buffer);
+		return NULL;
+	}
+
+	blob_offset = (size_t) qfile_u32_get(data + QWALK_FILE_HEADER_BLOB);
+	blob_size = (size_t) qfile_u32_get(data + QWALK_FILE_HEADER_BLOB_SIZE);
+	if ((blob_offset > buffer->size)
+			|| (blob_size > buffer->size - blob_offset)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		qfile_buffer_release(buffer);
+		return NULL;
+	}
+
+	/* the layers run from the header up to the blob */
+	offset = (size_t) QWALK_FILE_HEADER_SIZE;
+	for (int l = 0; l < QWALK_AREA_TOTAL_LAYER_COUNT; l++) {
+		if (version == (uint16_t) QWALK_FILE_VERSION_UNCHUNKED) {
+			layers[l] = NULL;
+			if ((offset <= blob_offset) && (layout.size <= blob_offset - offset)
+					&& ((layers[l] = qwalk_layer_create(size_y, size_x)) != NULL)
+					&& (qwalk_file_section_decode(layers[l], data + offset, -1,
+							&layout, data + blob_offset, blob_size) == Q_ERROR)) {
+				qwalk_layer_destroy(layers[l]);
+				layers[l] = NULL;
+			}
+			offset += layout.size;
+		} else {
+			layers[l] = qwalk_file_layer_decode(data, blob_offset, &offset,
+					size_y, size_x, &layout, data + blob_offset, blob_size);
+		}
+
+		if (layers[l] == NULL) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			for (int k = 0; k < l; k++) {
+				qwalk_layer_destroy(layers[k]);
+			}
+			qfile_buffer_release(buffer);
+			return NULL;
+		}
+	}
+	if (offset != blob_offset) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		for (int l = 0; l < QWALK_AREA_TOTAL_LAYER_COUNT; l++) {
+			qwalk_layer_destroy(layers[l]);
+		}
+		qfile_buffer_release(buffer);
+		return NULL;
+	}
+
+	walk_area = qwalk_area_create(layers[0], layers[1]);
+	if (walk_area == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		abort();
+	}
+	walk_area->storage = buffer;
+
+	return walk_area;
+}
+
+
+/**
+ * Tell whether the file opened via qfile_open() is a columnar #QwalkArea_t
+ * file.
+ * @see qwalk_area_file_handle_isv2().
+ * @return @c true or @c false.
+ */
+bool
+qwalk_area_file_isv2() {
+	return qwalk_area_file_handle_isv2(qfile_handle_default_get());
+}
+
+
+/**
+ * Tell whether the file open in a #QfileHandle_t is a columnar #QwalkArea_t
+ * file. The read position is left untouched.
+ * @param[in,out] handle: relevant #QfileHandle_t.
+ * @return @c true or @c false.
+ */
+bool
+qwalk_area_file_handle_isv2(QfileHandle_t *handle) {
+	char magic[QWALK_FILE_MAGIC_SIZE];
+
+	if (qfile_handle_bytes_peek(handle, magic, sizeof(magic)) != sizeof(magic)) {
+		return false;
+	}
+	return (memcmp(magic, QWALK_FILE_MAGIC, sizeof(magic)) == 0);
+}
+
+
+/**
+ * Convert a #QwalkArea_t file to the columnar format.
+ * @p src_filename may be in either format; @p dest_filename is written
+ * atomically, and may thus be the same file as @p src_filename. Either file
+ * may be a compressed block file.
+ * @param[in] src_filename: file to convert.
+ * @param[in] dest_filename: file to write the converted area to.
+ * @param[in] compress: whether to compress @p dest_filename.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_file_convert(const char *src_filename, const char *dest_filename,
+		bool compress) {
+	QfileHandle_t *handle;
+	QwalkArea_t *walk_area;
+	int returnval = Q_OK;
+
+	if ((handle = qfile_handle_open(src_filename, QFILE_MODE_READ_MAPPED))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	walk_area = qwalk_area_handle_read(handle);
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+	if (walk_area == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if ((handle = qfile_handle_open(dest_filename, QFILE_MODE_WRITE_ATOMIC))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_area_destroy(walk_area);
+		return Q_ERROR;
+	}
+	if (compress && (qfile_handle_compression_set(handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	} else if (qwalk_area_v2_handle_write(handle, walk_area) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	qwalk_area_destroy(walk_area);
+	return returnval;
+}
+
+
+/**
+ * Compute the offsets of the columns in a section.
+ * @param[out] layout: #QwalkFileLayout_t to fill out.
+ * @param[in] objc: number of objects in the section.
+ */
+void
+qwalk_file_layout_get(QwalkFileLayout_t *layout, size_t objc) {
+	size_t offset = 0;
+
+	/* round every column up to the next multiple of the alignment */
+#define QWALK_FILE_COLUMN_ALIGN(size) \
+	((((size) + QWALK_FILE_COLUMN_ALIGNMENT - 1) / QWALK_FILE_COLUMN_ALIGNMENT) \
+	 * QWALK_FILE_COLUMN_ALIGNMENT)
+
+	layout->type_column = offset;
+	offset += QWALK_FILE_COLUMN_ALIGN(objc);
+	layout->canmove_column = offset;
+	offset += QWALK_FILE_COLUMN_ALIGN((objc + 7) / 8);
+	layout->keymask_column = offset;
+	offset += QWALK_FILE_COLUMN_ALIGN(objc * sizeof(uint16_t));
+
+	for (int i = 0; i < QWALK_FILE_STRING_KEYC; i++) {
+		layout->string_offset_columns[i] = offset;
+		offset += objc * sizeof(uint32_t);
+		layout->string_length_columns[i] = offset;
+		offset += objc * sizeof(uint32_t);
+	}
+
+#undef QWALK_FILE_COLUMN_ALIGN
+
+	layout->size = offset;
+	return;
+}
+
+
+/**
+ * Find how many bytes a #QwalkLayer_t takes up in a columnar file.
+ * @param[in] layer: relevant #QwalkLayer_t.
+ * @param[in] layout: layout of a chunk section.
+ * @return size of the chunk count, chunk indices and chunk sections.
+ */
+size_t
+qwalk_file_layer_size_get(const QwalkLayer_t *layer,
+		const QwalkFileLayout_t *layout) {
+	return sizeof(uint32_t)
+		+ ((size_t) layer->chunkc * (sizeof(uint32_t) + layout->size));
+}
+
+
+/**
+ * Encode the populated chunks of a #QwalkLayer_t.
+ * @param[in] layer: #QwalkLayer_t to encode; each populated chunk must be
+ * completely filled out.
+ * @param[out] dest: zeroed memory of qwalk_file_layer_size_get() bytes.
+ * @param[in] layout: layout of a chunk section.
+ * @param[in,out] blob: blob to add string payloads to.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_file_layer_encode(const QwalkLayer_t *layer, unsigned char *dest,
+		const QwalkFileLayout_t *layout, QwalkFileBlob_t *blob) {
+	const QwalkChunk_t *chunk;
+	unsigned char *section;
+	int chunkc = 0;
+
+	/* layers should ONLY be written when they are fully filled out! */
+	if (!qwalk_layer_iscomplete(layer)) {
+		Q_ERRORFOUND(QERROR_STRUCT_INCOMPLETE);
+		return Q_ERROR;
+	}
+
+	qfile_u32_put(dest, (uint32_t) layer->chunkc);
+	section = dest + sizeof(uint32_t)
+		+ ((size_t) layer->chunkc * sizeof(uint32_t));
+
+	for (int c = 0; c < layer->chunkc_y * layer->chunkc_x; c++) {
+		if ((chunk = layer->chunks[c]) == NULL) {
+			continue;
+		}
+		qfile_u32_put(dest + sizeof(uint32_t)
+				+ ((size_t) chunkc++ * sizeof(uint32_t)), (uint32_t) c);
+
+		/* tiles past the edge stay zeroed */
+		for (int i = 0; i < QWALK_CHUNK_SIZE; i++) {
+			if ((chunk->objects[i].attr_list != NULL)
+					&& (qwalk_file_object_encode(chunk->objects[i].attr_list, i,
+							section, layout, blob) == Q_ERROR)) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				return Q_ERROR;
+			}
+		}
+		section += layout->size;
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Encode the #QattrList_t of an object into the columns of a section.
+ * @param[in] attr_list: #QattrList_t to encode.
+ * @param[in] index: index of the object in its section.
+ * @param[out] section: section to encode into.
+ * @param[in] layout: layout of @p section.
+ * @param[in,out] blob: blob to add string payloads to.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_file_object_encode(const QattrList_t *attr_list, int index,
+		unsigned char *section, const QwalkFileLayout_t *layout,
+		QwalkFileBlob_t *blob) {
+
+	QattrKey_t key;
+	Qdatameta_t *datameta;
+	Qdata_t *data;
+	QdataType_t type;
+	size_t count;
+	uint16_t keymask = 0;
+	uint16_t keybit;
+	size_t i = (size_t) index;
+	int string_index;
+	size_t offset;
+
+	for (int j = 0; j < (int) qattr_list_index_ok_get(attr_list); j++) {
+		if ((key = qattr_list_attr_key_get(attr_list, j))
+				== (QattrKey_t) Q_ERRORCODE_ENUM) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if ((datameta = qattr_list_value_get(attr_list, key)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if ((data = qdatameta_datap_get(datameta)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		type = qdatameta_type_get(datameta);
+		count = qdatameta_count_get(datameta);
+
+		keybit = (uint16_t) (1U << (unsigned) (key - QATTR_KEY_QOBJECT_TYPE));
+		if ((keymask & keybit) != 0) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			return Q_ERROR;
+		}
+		keymask = (uint16_t) (keymask | keybit);
+
+		switch (key) {
+		case QATTR_KEY_QOBJECT_TYPE:
+			if ((type != QDATA_TYPE_QOBJECT_TYPE) || (count != (size_t) 1)) {
+				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
+				return Q_ERROR;
+			}
+			if ((*(QobjType_t *) data < (QobjType_t) Q_ENUM_VALUE_START)
+					|| (*(QobjType_t *) data > QOBJ_TYPE_COUNT)) {
+				Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+				return Q_ERROR;
+			}
+			section[layout->type_column + i] = (unsigned char) *(QobjType_t *) data;
+			break;
+
+		case QATTR_KEY_CANMOVE:
+			if ((type != QDATA_TYPE_BOOL) || (count != (size_t) 1)) {
+				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
+				return Q_ERROR;
+			}
+			if (*(bool *) data) {
+				section[layout->canmove_column + (i / 8)] |=
+					(unsigned char) (1U << (i % 8));
+			}
+			break;
+
+		default:
+			if ((string_index = qwalk_file_string_key_index(key))
+					== Q_ERRORCODE_INT_NOTFOUND) {
+				Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+				return Q_ERROR;
+			}
+			if (type != QDATA_TYPE_CHAR_STRING) {
+				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
+				return Q_ERROR;
+			}
+			if ((count == 0) || (((char *) data)[count - 1] != '\0')) {
+				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
+				return Q_ERROR;
+			}
+			if (qwalk_file_blob_append(blob, (char *) data, count, &offset)
+					== Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				return Q_ERROR;
+			}
+			qfile_u32_put(section + layout->string_offset_columns[string_index]
+					+ (i * sizeof(uint32_t)), (uint32_t) offset);
+			qfile_u32_put(section + layout->string_length_columns[string_index]
+					+ (i * sizeof(uint32_t)), (uint32_t) count);
+			break;
+		}
+	}
+
+	qfile_u16_put(section + layout->keymask_column + (i * sizeof(uint16_t)),
+			keymask);
+
+	return Q_OK;
+}
+
+
+/**
+ * Add a string payload to the blob being written.
+ * A payload already in the blob isn't added again; its offset is reused.
+ * @p s is remembered as it is, so it must outlive the blob.
+ * @param[in,out] blob: blob to add to; its data may be reallocated.
+ * @param[in] s: payload to add.
+ * @param[in] size: number of bytes in @p s.
+ * @param[out] offsetp: offset of the payload in the blob.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_file_blob_append(QwalkFileBlob_t *blob, const char *s, size_t size,
+		size_t *offsetp) {
+
+	size_t capacity_new;
+	unsigned char *blob_new;
+
+	if (qfile_string_index_get(&blob->offsets, s, size, offsetp) == Q_OK) {
+		return Q_OK;
+	}
+
+	if (size > blob->capacity - blob->size) {
+		capacity_new = blob->capacity;
+		while (size > capacity_new - blob->size) {
+			capacity_new *= 2;
+		}
+		if ((blob_new = realloc(blob->data, capacity_new)) == NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return Q_ERROR;
+		}
+		blob->data = blob_new;
+		blob->capacity = capacity_new;
+	}
+
+	if (qfile_string_index_put(&blob->offsets, s, size, blob->size) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	memcpy(blob->data + blob->size, s, size);
+	*offsetp = blob->size;
+	blob->size += size;
+	return Q_OK;
+}
+
+
+/**
+ * Decode the populated chunks of a #QwalkLayer_t.
+ * The objects are decoded into a #Qarena_t owned by the layer; see @ref
+ * QwalkLayer_t.arena. Only the chunks listed are populated.
+ * @param[in] data: contents of the file.
+ * @param[in] size: number of bytes of @p data the layer may lie in.
+ * @param[in,out] offsetp: offset of the layer in @p data; moved past it.
+ * @param[in] size_y: @ref QwalkLayer_t.size_y.
+ * @param[in] size_x: @ref QwalkLayer_t.size_x.
+ * @param[in] layout: layout of a chunk section.
+ * @param[in] blob: blob of the file.
+ * @param[in] blob_size: number of bytes in @p blob.
+ * @return new #QwalkLayer_t or @c NULL if the layer is malformed.
+ */
+QwalkLayer_t *
+qwalk_file_layer_decode(const unsigned char *data, size_t size,
+		size_t *offsetp, int size_y, int size_x,
+		const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size) {
+
+	QwalkLayer_t *layer;
+	const unsigned char *numbers;
+	const unsigned char *section;
+	size_t chunkc;
+	int chunk;
+	int chunk_prev = -1;
+
+	if ((layer = qwalk_layer_create(size_y, size_x)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	if ((layer->arena = qarena_create()) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_layer_destroy(layer);
+		return NULL;
+	}
+
+	/* a layer can't list more chunks than it has */
+	if ((*offsetp > size) || (sizeof(uint32_t) > size - *offsetp)
+			|| ((chunkc = (size_t) qfile_u32_get(data + *offsetp))
+				> (size_t) layer->chunkc_y * (size_t) layer->chunkc_x)
+			|| (chunkc * (sizeof(uint32_t) + layout->size)
+				> size - *offsetp - sizeof(uint32_t))) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		qwalk_layer_destroy(layer);
+		return NULL;
+	}
+	numbers = data + *offsetp + sizeof(uint32_t);
+	section = numbers + (chunkc * sizeof(uint32_t));
+
+	for (size_t i = 0; i < chunkc; i++) {
+		chunk = (int) qfile_u32_get(numbers + (i * sizeof(uint32_t)));
+		if ((chunk <= chunk_prev)
+				|| (chunk >= layer->chunkc_y * layer->chunkc_x)
+				|| (qwalk_file_section_decode(layer, section, chunk, layout, blob,
+						blob_size) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			qwalk_layer_destroy(layer);
+			return NULL;
+		}
+		chunk_prev = chunk;
+		section += layout->size;
+	}
+
+	*offsetp = (size_t) (section - data);
+	return layer;
+}
+
+
+/**
+ * Decode the objects of a section into a #QwalkLayer_t.
+ * @param[out] layer: #QwalkLayer_t to set the objects in.
+ * @param[in] section: section to decode.
+ * @param[in] chunk: index in @ref QwalkLayer_t.chunks of the chunk the
+ * section holds, or -1 for a #QWALK_FILE_VERSION_UNCHUNKED section holding
+ * every object of @p layer.
+ * @param[in] layout: layout of @p section.
+ * @param[in] blob: blob of the file @p section belongs to.
+ * @param[in] blob_size: number of bytes in @p blob.
+ * @return #Q_OK or #Q_ERROR if @p section is malformed.
+ */
+int
+qwalk_file_section_decode(QwalkLayer_t *layer, const unsigned char *section,
+		int chunk, const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size) {
+
+	QattrList_t *attr_list;
+	int objc;
+	int index;
+
+	if ((layer->arena == NULL) && ((layer->arena = qarena_create()) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	objc = chunk < 0 ? layer->size_y * layer->size_x : QWALK_CHUNK_SIZE;
+	for (int i = 0; i < objc; i++) {
+		index = chunk < 0 ? i : qwalk_layer_chunk_index_get(layer, chunk, i);
+		if (index == Q_ERRORCODE_INT_NOTFOUND) {
+			continue;
+		}
+		if ((attr_list = qwalk_file_object_decode(section, i, layout, blob,
+						blob_size, layer->arena)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if (qwalk_layer_object_set(layer, index / layer->size_x,
+					index % layer->size_x, attr_list) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Decode the #QattrList_t of an object from the columns of a section.
+ * Attributes come out in #QattrKey_t order, and every value is a view.
+ * @param[in] section: section to decode from.
+ * @param[in] index: index of the object in its section.
+ * @param[in] layout: layout of @p section.
+ * @param[in] blob: blob of the file @p section belongs to.
+ * @param[in] blob_size: number of bytes in @p blob.
+ * @param[in,out] arena: #Qarena_t to allocate the list and its values from.
+ * @return new #QattrList_t or @c NULL if the object is malformed.
+ */
+QattrList_t *
+qwalk_file_object_decode(const unsigned char *section, int index,
+		const QwalkFileLayout_t *layout, const unsigned char *blob,
+		size_t blob_size, Qarena_t *arena) {
+
+	QattrList_t *attr_list;
+	Qdatameta_t *datameta;
+	uint16_t keymask;
+	uint16_t keymask_valid;
+	size_t count = 0;
+	size_t i = (size_t) index;
+	size_t offset;
+	size_t length;
+	unsigned obj_type;
+	int string_index;
+
+	keymask = qfile_u16_get(
+			section + layout->keymask_column + (i * sizeof(uint16_t)));
+
+	keymask_valid = (uint16_t) (1U << (QATTR_KEY_QOBJECT_TYPE - QATTR_KEY_QOBJECT_TYPE)
+		| 1U << (QATTR_KEY_CANMOVE - QATTR_KEY_QOBJECT_TYPE));
+	for (int j = 0; j < QWALK_FILE_STRING_KEYC; j++) {
+		keymask_valid = (uint16_t) (keymask_valid
+				| 1U << (unsigned) (qwalk_file_string_keys[j] - QATTR_KEY_QOBJECT_TYPE));
+	}
+	if ((keymask & ~keymask_valid) != 0) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return NULL;
+	}
+
+	for (unsigned bit = 0; bit < 16; bit++) {
+		if ((keymask & (1U << bit)) != 0) {
+			count++;
+		}
+	}
+	if (count == 0) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return NULL;
+	}
+
+	if ((attr_list = qattr_list_arena_create(arena, count)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+
+	for (QattrKey_t key = QATTR_KEY_QOBJECT_TYPE; key <= QATTR_KEY_COUNT; key++) {
+		if ((keymask & (1U << (unsigned) (key - QATTR_KEY_QOBJECT_TYPE))) == 0) {
+			continue;
+		}
+
+		switch (key) {
+		case QATTR_KEY_QOBJECT_TYPE:
+			obj_type = (unsigned) section[layout->type_column + i];
+			if ((obj_type < (unsigned) Q_ENUM_VALUE_START)
+					|| (obj_type > (unsigned) QOBJ_TYPE_COUNT)) {
+				Q_ERRORFOUND(QERROR_FILE_FORMAT);
+				qattr_list_destroy(attr_list);
+				return NULL;
+			}
+			datameta = qdatameta_arena_view_create(arena,
+					&qwalk_file_obj_types[obj_type],
+					QDATA_TYPE_QOBJECT_TYPE, (size_t) 1);
+			break;
+
+		case QATTR_KEY_CANMOVE:
+			datameta = qdatameta_arena_view_create(arena, &qwalk_file_bools[
+					(section[layout->canmove_column + (i / 8)] >> (i % 8)) & 1U],
+					QDATA_TYPE_BOOL, (size_t) 1);
+			break;
+
+		default:
+			string_index = qwalk_file_string_key_index(key);
+			offset = (size_t) qfile_u32_get(section
+					+ layout->string_offset_columns[string_index] + (i * sizeof(uint32_t)));
+			length = (size_t) qfile_u32_get(section
+					+ layout->string_length_columns[string_index] + (i * sizeof(uint32_t)));
+			if ((length == 0) || (offset > blob_size)
+					|| (length > blob_size - offset)
+					|| (blob[offset + length - 1] != '\0')) {
+				Q_ERRORFOUND(QERROR_FILE_FORMAT);
+				qattr_list_destroy(attr_list);
+				return NULL;
+			}
+			datameta = qdatameta_arena_view_create(arena, blob + offset,
+					QDATA_TYPE_CHAR_STRING, length);
+			break;
+		}
+
+		if (datameta == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qattr_list_destroy(attr_list);
+			return NULL;
+		}
+		if (qattr_list_attr_set(attr_list, key, datameta) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qdatameta_destroy(datameta);
+			qattr_list_destroy(attr_list);
+			return NULL;
+		}
+	}
+
+	return attr_list;
+}
+
+
+/**
+ * Find the index of a #QattrKey_t in #qwalk_file_string_keys.
+ * @param[in] key: #QattrKey_t to search for.
+ * @return index or #Q_ERRORCODE_INT_NOTFOUND.
+ */
+int
+qwalk_file_string_key_index(QattrKey_t key) {
+	for (int i = 0; i < QWALK_FILE_STRING_KEYC; i++) {
+		if (qwalk_file_string_keys[i] == key) {
+			return i;
+		}
+	}
+	return Q_ERRORCODE_INT_NOTFOUND;
+}
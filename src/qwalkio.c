@@ -91,9 +91,20 @@
 /** qwalk container for any `int` from an input function. */
 static int qwalk_io_buffer_int = 0;
 
+/** Lines at the bottom of #win left to qwalk_layer_object_info_display(). */
+#define QWALK_VIEW_INFO_LINES 2
+
+/** Layer y coordinate shown on the top line of #win.      */
+static int view_y = 0;
+/** Layer x coordinate shown in the leftmost column of #win. */
+static int view_x = 0;
+
 
 
 static int qwalk_layer_object_info_display(int index);
+static int qwalk_layer_view_output(const QwalkLayer_t *layer, bool isfloater,
+		int height, int width)/*@modifies win@*/;
+static int qwalk_view_origin_get(int centre, int span, int size)/*@*/;
 static QwalkCommand_t qwalk_input_to_command(int)/*@*/;
 
 
@@ -132,11 +143,14 @@ qwalk_io_end()/*@modifies win@*/{
 
 /**
  * Pass the subtick step of getting player input.
+ * @param[in] layer: #QwalkLayer_t the player is on.
  * @param[in] index: index of the player.
+ * @param[in] target_index: index of the object to interact with by default
+ * (e.g. the nearest NPC), or #Q_ERRORCODE_INT_NOTFOUND to start at the player.
  * @return #QwalkCommand_t associated with player input.
  */
 QwalkCommand_t
-qwalk_input_subtick(int index) {
+qwalk_input_subtick(const QwalkLayer_t *layer, int index, int target_index) {
 	if (win == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return (QwalkCommand_t) Q_ERRORCODE_ENUM;
@@ -154,7 +168,9 @@ qwalk_input_subtick(int index) {
 	switch (cmd) {
 	case QWALK_COMMAND_INSPECT:
 	case QWALK_COMMAND_INTERACT:
-		if ((player_index = qwalk_input_player_object_select(win, index))
+		if ((player_index = qwalk_input_player_object_select(win, layer,
+						(cmd == QWALK_COMMAND_INTERACT) && (target_index >= 0)
+						? target_index : index))
 				== Q_ERRORCODE_INT) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			break;
@@ -171,16 +187,14 @@ qwalk_input_subtick(int index) {
 
 /**
  * Pass the subtick step of outputting the game state.
+ * Only the part of the area around the active player that fits in #win is
+ * drawn, and of it only the populated chunks; the rest is left blank.
  * @return #Q_OK or #Q_ERROR.
  */
 int
 qwalk_output_subtick(const QwalkArea_t *walk_area) {
-	/*@observer@*/QattrList_t *layer_object_attr_list;
-	/*@observer@*/Qdatameta_t *datameta_value;
-	QobjType_t *obj_typep;
-	chtype outch;
-	int *coords;
-	int r;
+	int player_index;
+	int maxy, maxx;
 	if (win == NULL) {
 		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
 		return Q_ERROR;
@@ -200,59 +214,32 @@ qwalk_output_subtick(const QwalkArea_t *walk_area) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
+
+	/*@i3@*/getmaxyx(win, maxy, maxx);
+	maxy -= QWALK_VIEW_INFO_LINES;
+
+	/* keep the player centred, unless that would show past the edges */
+	if ((player_index = qwalk_area_player_index_get(walk_area)) >= 0) {
+		view_y = qwalk_view_origin_get(player_index / layer_floater->size_x,
+				maxy, layer_floater->size_y);
+		view_x = qwalk_view_origin_get(player_index % layer_floater->size_x,
+				maxx, layer_floater->size_x);
+	}
+
+	if (werase(win) == ERR) {
+		Q_ERROR_SYSTEM("werase()");
+		return Q_ERROR;
+	}
 	
 	/*
-	 * iterate through both layers and print their contents to the screen;
-	 * print everything on layer_earth and then print layer_floater non-void
-	 * objects
+	 * print both layers to the screen; print everything on layer_earth and
+	 * then print layer_floater non-void objects
 	 */
-	for (int i = 0; i < 2; i++) {
-		for (int j = 0; j < QWALK_LAYER_SIZE; j++) {
-			if (i == 0) {
-				layer_object_attr_list = qwalk_layer_object_attr_list_get(layer_earth, j);
-			} else {
-				layer_object_attr_list = qwalk_layer_object_attr_list_get(layer_floater, j);
-			}
-			if (layer_object_attr_list == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-	
-			datameta_value = qattr_list_value_get(layer_object_attr_list, QATTR_KEY_QOBJECT_TYPE);
-			if (datameta_value == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-	
-			if (qdatameta_type_get(datameta_value) != QDATA_TYPE_QOBJECT_TYPE) {
-				Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
-				abort();
-			}
-	
-			obj_typep = ((QobjType_t *) (qdatameta_datap_get(datameta_value)));
-			if (obj_typep == NULL) {
-				Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-				return Q_ERROR;
-			}
-			
-			/* if *obj_typep isn't a layer_floater void, print it to the screen */
-			if ((*obj_typep != QOBJ_TYPE_VOID) || (i != 1)) {
-				
-				outch = qwalk_obj_type_to_chtype(*obj_typep);
-				if (outch == (chtype) ERR) {
-					Q_ERRORFOUND(QERROR_ERRORVAL);
-					abort();
-				}
-	
-				coords = qwalk_index_to_coords(j);
-				r = mvwaddch(win, coords[0], coords[1], outch);
-				free(coords);
-				if (r != OK) {
-					Q_ERRORFOUND(QERROR_ERRORVAL);
-					return Q_ERROR;
-				}
-			}
-		}
+	if ((qwalk_layer_view_output(layer_earth, false, maxy, maxx) == Q_ERROR)
+			|| (qwalk_layer_view_output(layer_floater, true, maxy, maxx)
+				== Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
 	}
 	return Q_OK;
 }
@@ -260,24 +247,32 @@ qwalk_output_subtick(const QwalkArea_t *walk_area) {
 
 /**
  * Let the player select a specific object from the screen.
+ * The selection stays within the part of the layer last drawn by
+ * qwalk_output_subtick().
  * @param[out] select_win: `WINDOW` to manipulate.
- * @param[in] start_index: index on @p win to begin at.
+ * @param[in] layer: #QwalkLayer_t to select from.
+ * @param[in] start_index: index in @p layer to begin at.
  * @return index of selected object or #Q_ERRORCODE_INT.
  */
 int
-qwalk_input_player_object_select(WINDOW* select_win, int start_index) {
+qwalk_input_player_object_select(WINDOW* select_win, const QwalkLayer_t *layer,
+		int start_index) {
 
 	int *coords;
 	int ch;
 	QwalkCommand_t cmd;
 	int index;
+	int y_new, x_new;
+	int maxy, maxx;
 
 	if (win == NULL) {
 		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
 		return Q_ERROR;
 	}
 
-	coords = qwalk_index_to_coords(start_index);
+	coords = qwalk_index_to_coords(layer, start_index);
+	/*@i3@*/getmaxyx(select_win, maxy, maxx);
+	maxy -= QWALK_VIEW_INFO_LINES;
 
 	if (curs_set(1) == ERR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -286,11 +281,11 @@ qwalk_input_player_object_select(WINDOW* select_win, int start_index) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 	}
 
-	if (wmove(select_win, coords[0], coords[1]) == ERR) {
+	if (wmove(select_win, coords[0] - view_y, coords[1] - view_x) == ERR) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 	}
 
-	if ((index = qwalk_coords_to_index(coords[0], coords[1]))
+	if ((index = qwalk_coords_to_index(layer, coords[0], coords[1]))
 			== Q_ERRORCODE_INT) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 	}
@@ -310,34 +305,43 @@ qwalk_input_player_object_select(WINDOW* select_win, int start_index) {
 
 
 
+		y_new = coords[0];
+		x_new = coords[1];
 		if ((cmd = qwalk_input_to_command(ch))
 				!= (QwalkCommand_t) Q_ERRORCODE_ENUM) {
 			switch (cmd) {
 			case QWALK_COMMAND_MOVE_NORTH:
-				coords[0]--;
+				y_new--;
 				break;
 			case QWALK_COMMAND_MOVE_EAST:
-				coords[1]++;
+				x_new++;
 				break;
 			case QWALK_COMMAND_MOVE_WEST:
-				coords[1]--;
+				x_new--;
 				break;
 			case QWALK_COMMAND_MOVE_SOUTH:
-				coords[0]++;
+				y_new++;
 				break;
 			default:
 				break;
 			}
 		}
+		/* only what is on the screen may be selected */
+		if (qwalk_logic_coords_arevalid(layer, y_new, x_new)
+				&& (y_new >= view_y) && (y_new < view_y + maxy)
+				&& (x_new >= view_x) && (x_new < view_x + maxx)) {
+			coords[0] = y_new;
+			coords[1] = x_new;
+		}
 
-		if ((index = qwalk_coords_to_index(coords[0], coords[1]))
+		if ((index = qwalk_coords_to_index(layer, coords[0], coords[1]))
 				== Q_ERRORCODE_INT) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 		}
 		if (qwalk_layer_object_info_display(index) == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 		}
-		if (wmove(select_win, coords[0], coords[1]) == ERR) {
+		if (wmove(select_win, coords[0] - view_y, coords[1] - view_x) == ERR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 		}
 	}
@@ -524,3 +528,87 @@ qwalk_io_buffer_int_get()/*@globals qwalk_io_buffer_int@*/
 {
 	return qwalk_io_buffer_int;
 }
+
+
+/**
+ * Draw the part of a #QwalkLayer_t in view on #win.
+ * Chunks are drawn one at a time, and unpopulated ones skipped.
+ * @param[in] layer: #QwalkLayer_t to draw.
+ * @param[in] isfloater: whether @p layer lies over another, such that its
+ * #QOBJ_TYPE_VOID objects are left out.
+ * @param[in] height: number of lines of #win to draw on.
+ * @param[in] width: number of columns of #win to draw on.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_layer_view_output(const QwalkLayer_t *layer, bool isfloater, int height,
+		int width) {
+	const QwalkChunk_t *chunk;
+	QobjType_t obj_type;
+	chtype outch;
+	int y_end, x_end;
+	int chunk_y, chunk_x;
+
+	y_end = view_y + height < layer->size_y ? view_y + height : layer->size_y;
+	x_end = view_x + width < layer->size_x ? view_x + width : layer->size_x;
+
+	for (int cy = view_y / QWALK_CHUNK_SIZE_Y;
+			cy * QWALK_CHUNK_SIZE_Y < y_end; cy++) {
+		for (int cx = view_x / QWALK_CHUNK_SIZE_X;
+				cx * QWALK_CHUNK_SIZE_X < x_end; cx++) {
+			if ((chunk = layer->chunks[(cy * layer->chunkc_x) + cx]) == NULL) {
+				continue;
+			}
+			chunk_y = cy * QWALK_CHUNK_SIZE_Y;
+			chunk_x = cx * QWALK_CHUNK_SIZE_X;
+
+			for (int y = chunk_y > view_y ? chunk_y : view_y;
+					(y < y_end) && (y < chunk_y + QWALK_CHUNK_SIZE_Y); y++) {
+				for (int x = chunk_x > view_x ? chunk_x : view_x;
+						(x < x_end) && (x < chunk_x + QWALK_CHUNK_SIZE_X); x++) {
+					obj_type = qattr_store_type_get(chunk->store, (size_t)
+							(((y - chunk_y) * QWALK_CHUNK_SIZE_X) + (x - chunk_x)));
+					if (obj_type == (QobjType_t) Q_ERRORCODE_ENUM) {
+						Q_ERRORFOUND(QERROR_ERRORVAL);
+						abort();
+					}
+
+					/* if obj_type isn't a floater void, print it to the screen */
+					if ((obj_type == QOBJ_TYPE_VOID) && isfloater) {
+						continue;
+					}
+					outch = qwalk_obj_type_to_chtype(obj_type);
+					if (outch == (chtype) ERR) {
+						Q_ERRORFOUND(QERROR_ERRORVAL);
+						abort();
+					}
+					if (mvwaddch(win, y - view_y, x - view_x, outch) != OK) {
+						Q_ERRORFOUND(QERROR_ERRORVAL);
+						return Q_ERROR;
+					}
+				}
+			}
+		}
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Find where a view should start along one dimension of a #QwalkLayer_t.
+ * @param[in] centre: coordinate to keep in the middle of the view.
+ * @param[in] span: length of the view.
+ * @param[in] size: length of the layer.
+ * @return first coordinate in view; the view never reaches past either edge
+ * of a layer longer than it.
+ */
+int
+qwalk_view_origin_get(int centre, int span, int size) {
+	int origin = centre - (span / 2);
+
+	if (origin > size - span) {
+		origin = size - span;
+	}
+	return origin < 0 ? 0 : origin;
+}
@@ -0,0 +1,800 @@
+/**
+ * @file qwalkj.c
+ * Program file for the journal section of the qwalk module.
+ * Responsible for saving the edits made to a #QwalkArea_t without rewriting its
+ * file. Every object changed since the last save is marked in a
+ * #QwalkJournal_t; saving appends the #QattrList_t of each marked object to
+ * the journal file of the area, under #QWALK_JOURNAL_DIR, as one
+ * #QFILE_MODE_WRITE_APPEND frame laid out as follows:
+ * - #QWALK_JOURNAL_MAGIC, then the #QwalkJournalBase_t of the area file, as
+ *   three @c size_t, then the @c size_t number of records.
+ * - per record, the @c int #QwalkLayerType_t and @c int index of the object,
+ *   then its #QattrList_t as written by qattr_list_handle_write().
+ *
+ * A save thus costs in proportion to the edits rather than to the area. Upon
+ * loading, the records are replayed over the area in order, such that the last
+ * record of an object wins; qwalk_journal_compact() folds them back into the
+ * area file. Records only make sense over the very area file they were saved
+ * against, so a journal whose #QwalkJournalBase_t doesn't match the area file
+ * any more, e.g. after it was edited via devel_walk, is moved aside unread.
+ */
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ncurses.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "splint_types.h"
+#include "qattr.h"
+#include "qfile.h"
+#include "dialogue.h"
+#include "qwalk.h"
+
+
+
+/** Number of marks a #QwalkJournal_t makes room for at first. */
+#define QWALK_JOURNAL_MARK_MAX_DEFAULT 16
+
+
+
+/**
+ * An object of a #QwalkArea_t marked as edited.
+ */
+typedef struct QwalkJournalMark_t {
+	int type;  /**< #QwalkLayerType_t of the layer of the object. */
+	int index; /**< Index of the object in its layer.             */
+} QwalkJournalMark_t;
+
+
+/**
+ * Identity of the version of an area file a journal applies to.
+ * Taken upon creating the #QwalkJournal_t, i.e. as the area is loaded, and
+ * written into every save; an area file which is written anew, atomically or
+ * not, gets another one.
+ */
+typedef struct QwalkJournalBase_t {
+	size_t size;       /**< Size of the area file in bytes, or 0 if missing. */
+	size_t mtime_sec;  /**< Seconds of its modification time.               */
+	size_t mtime_nsec; /**< Nanoseconds of its modification time.           */
+} QwalkJournalBase_t;
+
+
+/**
+ * Object of a #QwalkArea_t as read from a journal file, yet to be replayed.
+ */
+typedef struct QwalkJournalRecord_t {
+	int type;  /**< #QwalkLayerType_t of the layer of the object. */
+	int index; /**< Index of the object in its layer.             */
+
+	/** #QattrList_t the object is to be given. */
+	/*@only@*/QattrList_t *attr_list;
+} QwalkJournalRecord_t;
+
+
+/**
+ * Edits made to a #QwalkArea_t since its last save.
+ * Marks are kept in the order they are made, repeats included, rather than
+ * in a table as large as the area; qwalk_journal_save() sorts them.
+ */
+typedef struct QwalkJournal_t {
+	/** Journal file of the area; see qwalk_journal_filename_get(). */
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+
+	/** Version of the area file the marks and the journal file apply to. */
+	QwalkJournalBase_t base;
+
+	/** Every object marked since the last save. */
+	/*@null@*//*@only@*/QwalkJournalMark_t *marks;
+
+	size_t markc;    /**< Number of members of @ref QwalkJournal_t.marks. */
+	size_t mark_max; /**< Room in @ref QwalkJournal_t.marks.              */
+} QwalkJournal_t;
+
+
+
+static int  qwalk_journal_filename_get(const char *area_filename,
+		/*@out@*/char *dest)/*@modifies dest@*/;
+static int  qwalk_journal_base_get(const char *area_filename,
+		/*@out@*/QwalkJournalBase_t *base)/*@modifies base@*/;
+static int  qwalk_journal_base_read(QfileHandle_t *handle,
+		/*@out@*/QwalkJournalBase_t *base)/*@modifies handle, base@*/;
+static bool qwalk_journal_base_equals(const QwalkJournalBase_t *a,
+		const QwalkJournalBase_t *b)/*@*/;
+/*@null@*//*@observer@*/
+static QwalkLayer_t *qwalk_journal_layer_get(const QwalkArea_t *walk_area,
+		QwalkLayerType_t type)/*@*/;
+static int  qwalk_journal_handle_replay(const QwalkJournal_t *journal,
+		QfileHandle_t *handle, QwalkArea_t *walk_area)
+	/*@modifies handle, walk_area@*/;
+static int  qwalk_journal_record_read(QfileHandle_t *handle,
+		const QwalkArea_t *walk_area, /*@out@*/QwalkJournalRecord_t *record)
+	/*@modifies handle, record@*/;
+static int  qwalk_journal_marks_compare(const void *a, const void *b)/*@*/;
+
+
+
+/**
+ * Create a #QwalkJournal_t for the area stored in a file.
+ * Nothing is marked, and the journal file is left alone until the first save.
+ * The journal applies to the area file as it is now; see #QwalkJournalBase_t.
+ * @param[in] area_filename: file the #QwalkArea_t is stored in.
+ * @return new #QwalkJournal_t or @c NULL.
+ */
+QwalkJournal_t *
+qwalk_journal_create(const char *area_filename) {
+	QwalkJournal_t *journal;
+
+	if ((journal = calloc((size_t) 1, sizeof(*journal))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	if ((qwalk_journal_filename_get(area_filename, journal->filename) == Q_ERROR)
+			|| (qwalk_journal_base_get(area_filename, &journal->base) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(journal);
+		return NULL;
+	}
+	return journal;
+}
+
+
+/**
+ * Destroy a #QwalkJournal_t.
+ * Unsaved marks are lost; see qwalk_journal_save().
+ * @param[in] journal: #QwalkJournal_t to destroy.
+ */
+void
+qwalk_journal_destroy(QwalkJournal_t *journal) {
+	free(journal->marks);
+	free(journal);
+	return;
+}
+
+
+/**
+ * Mark an object as edited, such that the next save records it.
+ * @param[in,out] journal: relevant #QwalkJournal_t.
+ * @param[in] type: #QwalkLayerType_t of the layer of the object.
+ * @param[in] index: index of the object in its layer.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_mark(QwalkJournal_t *journal, QwalkLayerType_t type, int index) {
+	QwalkJournalMark_t *marks;
+	size_t mark_max;
+
+	if ((type < (QwalkLayerType_t) Q_ENUM_VALUE_START)
+			|| (type > QWALK_LAYER_TYPE_COUNT)) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return Q_ERROR;
+	}
+	if (index < 0) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		return Q_ERROR;
+	}
+
+	if (journal->markc == journal->mark_max) {
+		mark_max = journal->mark_max == 0
+			? (size_t) QWALK_JOURNAL_MARK_MAX_DEFAULT : journal->mark_max * 2;
+		if ((marks = realloc(journal->marks, mark_max * sizeof(*marks)))
+				== NULL) {
+			Q_ERROR_SYSTEM("realloc()");
+			return Q_ERROR;
+		}
+		journal->marks = marks;
+		journal->mark_max = mark_max;
+	}
+
+	journal->marks[journal->markc].type = (int) type;
+	journal->marks[journal->markc].index = index;
+	journal->markc++;
+	return Q_OK;
+}
+
+
+/**
+ * Save the marked objects of a #QwalkArea_t to its journal file.
+ * The records are appended as a single frame, such that a crash midway loses
+ * the whole save and nothing else; they follow layer and index order, each
+ * object once however often it was marked. Marks of tiles holding no object
+ * are dropped. The marks are cleared upon success; if nothing is marked,
+ * nothing is written. Blocks until the frame is on the disk; see
+ * qwalk_journal_frame_get() to have that done elsewhere.
+ * @param[in,out] journal: relevant #QwalkJournal_t.
+ * @param[in] walk_area: #QwalkArea_t the marks refer to.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_save(QwalkJournal_t *journal, const QwalkArea_t *walk_area) {
+	QfileHandle_t *handle;
+
+	if (qwalk_journal_frame_get(journal, walk_area, &handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if ((handle != NULL) && (qfile_handle_close(handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Serialize the marked objects of a #QwalkArea_t into a save of its journal
+ * file, without writing it yet.
+ * The save is laid out as by qwalk_journal_save(), in memory; closing the
+ * returned #QfileHandle_t via qfile_handle_close() appends it to the journal
+ * file, and may be done on another thread, the area being free to change or
+ * go away in the meantime. The marks are cleared upon success, as the save
+ * now holds them.
+ * @param[in,out] journal: relevant #QwalkJournal_t.
+ * @param[in] walk_area: #QwalkArea_t the marks refer to.
+ * @param[out] handlep: #QFILE_MODE_WRITE_APPEND #QfileHandle_t holding the
+ * save, or @c NULL if there was nothing to save.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_frame_get(QwalkJournal_t *journal, const QwalkArea_t *walk_area,
+		QfileHandle_t **handlep) {
+	char dir_filename[QFILE_MAX_PATH_SIZE + 1];
+	QfileHandle_t *handle;
+	QwalkLayer_t *layer;
+	const QwalkChunk_t *chunk;
+	QattrList_t *attr_list;
+	size_t recordc = 0;
+	int local;
+	int returnval = Q_OK;
+
+	*handlep = NULL;
+	if (journal->markc == 0) {
+		return Q_OK;
+	}
+
+	/*
+	 * sort the marks, then fold repeats into the first of each run; marks of
+	 * void tiles of unpopulated chunks have nothing to record and are dropped
+	 */
+	qsort(journal->marks, journal->markc, sizeof(*journal->marks),
+			qwalk_journal_marks_compare);
+	for (size_t i = 0; i < journal->markc; i++) {
+		if (((layer = qwalk_journal_layer_get(walk_area,
+								(QwalkLayerType_t) journal->marks[i].type)) == NULL)
+				|| ((chunk = qwalk_layer_chunk_get(layer, journal->marks[i].index,
+							&local)) == NULL)
+				|| (chunk->objects[local].attr_list == NULL)) {
+			continue;
+		}
+		if ((recordc == 0)
+				|| (qwalk_journal_marks_compare(&journal->marks[recordc - 1],
+						&journal->marks[i]) != 0)) {
+			journal->marks[recordc++] = journal->marks[i];
+		}
+	}
+	journal->markc = recordc;
+	if (recordc == 0) {
+		return Q_OK;
+	}
+
+	/* dirname() may modify its argument, hence the copy */
+	strcpy(dir_filename, journal->filename);
+	if ((mkdir(dirname(dir_filename), 0755) == -1) && (errno != EEXIST)) {
+		Q_ERROR_SYSTEM("mkdir()");
+		return Q_ERROR;
+	}
+
+	if ((handle = qfile_handle_open(journal->filename, QFILE_MODE_WRITE_APPEND))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if ((qfile_handle_bytes_write(handle, QWALK_JOURNAL_MAGIC,
+					(size_t) QWALK_JOURNAL_MAGIC_SIZE) == Q_ERROR)
+			|| (qfile_handle_size_write(handle, journal->base.size) == Q_ERROR)
+			|| (qfile_handle_size_write(handle, journal->base.mtime_sec)
+				== Q_ERROR)
+			|| (qfile_handle_size_write(handle, journal->base.mtime_nsec)
+				== Q_ERROR)
+			|| (qfile_handle_size_write(handle, recordc) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	for (size_t i = 0; (i < recordc) && (returnval == Q_OK); i++) {
+		if (((layer = qwalk_journal_layer_get(walk_area,
+								(QwalkLayerType_t) journal->marks[i].type)) == NULL)
+				|| ((attr_list = qwalk_layer_object_attr_list_get(layer,
+							journal->marks[i].index)) == NULL)) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			returnval = Q_ERROR;
+			break;
+		}
+		if ((qfile_handle_int_write(handle, journal->marks[i].type) == Q_ERROR)
+				|| (qfile_handle_int_write(handle, journal->marks[i].index)
+					== Q_ERROR)
+				|| (qattr_list_handle_write(handle, attr_list) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+	}
+
+	/* an unfinished save must not reach the file */
+	if (returnval == Q_ERROR) {
+		(void) qfile_handle_discard(handle);
+		return Q_ERROR;
+	}
+
+	*handlep = handle;
+	journal->markc = 0;
+	return Q_OK;
+}
+
+
+/**
+ * Replay the journal file of a #QwalkArea_t over it.
+ * Every record replaces the #QattrList_t of its object. A missing journal file
+ * means there is nothing to replay. A save torn by a crash is cut off the file,
+ * such that the next one follows the last intact save. A journal file saved
+ * against another version of the area file is renamed with
+ * #QWALK_JOURNAL_STALE_SUFFIX and left unread. Either the whole journal file
+ * is replayed or, upon an error, none of it.
+ * @param[in] journal: relevant #QwalkJournal_t.
+ * @param[in,out] walk_area: #QwalkArea_t to replay the journal over.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_replay(const QwalkJournal_t *journal, QwalkArea_t *walk_area) {
+	char stale_filename[QFILE_MAX_PATH_SIZE + sizeof(QWALK_JOURNAL_STALE_SUFFIX)];
+	QfileHandle_t *handle;
+	size_t torn_offset;
+	int returnval;
+
+	if (access(journal->filename, F_OK) != 0) {
+		return Q_OK;
+	}
+
+	if ((handle = qfile_handle_open(journal->filename, QFILE_MODE_READ_MAPPED))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (!handle->isappend) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		(void) qfile_handle_close(handle);
+		return Q_ERROR;
+	}
+
+	/* strings replayed belong to the area, like those it was read with */
+	if ((walk_area->strings == NULL)
+			&& ((walk_area->strings = qfile_string_store_create()) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		(void) qfile_handle_close(handle);
+		return Q_ERROR;
+	}
+	qfile_handle_store_set(handle, walk_area->strings);
+
+	if ((returnval = qwalk_journal_handle_replay(journal, handle, walk_area))
+			== Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+	torn_offset = handle->append_torn_offset;
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	/* kept rather than removed, as it is all that is left of those saves */
+	if (returnval == Q_ERROR_NOCHANGE) {
+		strcpy(stale_filename, journal->filename);
+		strcat(stale_filename, QWALK_JOURNAL_STALE_SUFFIX);
+		if (rename(journal->filename, stale_filename) == -1) {
+			Q_ERROR_SYSTEM("rename()");
+			return Q_ERROR;
+		}
+		return Q_OK;
+	}
+
+	/* later saves would be stuck behind a torn one */
+	if ((returnval == Q_OK) && (torn_offset != 0)
+			&& (truncate(journal->filename, (off_t) torn_offset) == -1)) {
+		Q_ERROR_SYSTEM("truncate()");
+		returnval = Q_ERROR;
+	}
+	return returnval;
+}
+
+
+/**
+ * Fold the journal file of a #QwalkArea_t file back into it.
+ * The area is read, replayed over, and written back atomically in the
+ * columnar format, compressed if it was; only then is the journal file
+ * removed. Should a crash come in between, the journal is merely replayed
+ * once more over an area which already holds it.
+ * @param[in] area_filename: file the #QwalkArea_t is stored in.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_compact(const char *area_filename) {
+	QwalkJournal_t *journal;
+	QfileHandle_t *handle;
+	QwalkArea_t *walk_area;
+	bool compress;
+	int returnval = Q_OK;
+
+	if ((journal = qwalk_journal_create(area_filename)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (access(journal->filename, F_OK) != 0) {
+		qwalk_journal_destroy(journal);
+		return Q_OK;
+	}
+
+	if ((handle = qfile_handle_open(area_filename, QFILE_MODE_READ_MAPPED))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_journal_destroy(journal);
+		return Q_ERROR;
+	}
+	compress = handle->isblock;
+	walk_area = qwalk_area_handle_read(handle);
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+	if (walk_area == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_journal_destroy(journal);
+		return Q_ERROR;
+	}
+
+	if (qwalk_journal_replay(journal, walk_area) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_area_destroy(walk_area);
+		qwalk_journal_destroy(journal);
+		return Q_ERROR;
+	}
+
+	/* a stale journal file was moved aside; there is nothing to fold */
+	if (access(journal->filename, F_OK) != 0) {
+		qwalk_area_destroy(walk_area);
+		qwalk_journal_destroy(journal);
+		return Q_OK;
+	}
+
+	if ((handle = qfile_handle_open(area_filename, QFILE_MODE_WRITE_ATOMIC))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_area_destroy(walk_area);
+		qwalk_journal_destroy(journal);
+		return Q_ERROR;
+	}
+	if (compress && (qfile_handle_compression_set(handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	} else if (qwalk_area_v2_handle_write(handle, walk_area) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	if ((returnval == Q_OK) && (unlink(journal->filename) == -1)) {
+		Q_ERROR_SYSTEM("unlink()");
+		returnval = Q_ERROR;
+	}
+
+	qwalk_area_destroy(walk_area);
+	qwalk_journal_destroy(journal);
+	return returnval;
+}
+
+
+/**
+ * Tell whether a #QwalkArea_t file has a journal file.
+ * Tools which rewrite an area file should not do so while it does, lest the
+ * saves in it be lost; see qwalk_journal_compact().
+ * @param[in] area_filename: file the #QwalkArea_t is stored in.
+ * @return whether the journal file of @p area_filename exists.
+ */
+bool
+qwalk_journal_exists(const char *area_filename) {
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+
+	if (qwalk_journal_filename_get(area_filename, filename) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return false;
+	}
+	return access(filename, F_OK) == 0;
+}
+
+
+/**
+ * Get the name of the journal file of a #QwalkArea_t file.
+ * It is the basename of the area file, then the qfile_hash() of the full path
+ * of its directory in hexadecimal, then #QWALK_JOURNAL_SUFFIX, under
+ * #QWALK_JOURNAL_DIR; e.g. @c saves/area_0_0.dat.1f2e3d4c.jnl. Areas of the
+ * same name in different worlds thus keep journals of their own, and the
+ * directory may be named any way, relatively or not.
+ * @param[in] area_filename: file the #QwalkArea_t is stored in.
+ * @param[out] dest: buffer of #QFILE_MAX_PATH_SIZE + 1 bytes.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_filename_get(const char *area_filename, char *dest) {
+	char base_filename[QFILE_MAX_PATH_SIZE + 1];
+	char dir_filename[QFILE_MAX_PATH_SIZE + 1];
+	char dir_path[PATH_MAX];
+	const char *dir;
+	int len;
+
+	if (strlen(area_filename) > (size_t) QFILE_MAX_PATH_SIZE) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	/* basename() and dirname() may modify their argument, hence the copies */
+	strcpy(base_filename, area_filename);
+	strcpy(dir_filename, area_filename);
+
+	/* a directory yet to be made can't be resolved, but is named as given */
+	dir = dirname(dir_filename);
+	if (realpath(dir, dir_path) != NULL) {
+		dir = dir_path;
+	}
+
+	len = snprintf(dest, (size_t) QFILE_MAX_PATH_SIZE + 1, "%s%s.%08" PRIx32 "%s",
+			QWALK_JOURNAL_DIR, basename(base_filename),
+			qfile_hash(dir, strlen(dir), 0U), QWALK_JOURNAL_SUFFIX);
+	if ((len < 0) || (len > QFILE_MAX_PATH_SIZE)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Get the #QwalkJournalBase_t of an area file as it is now.
+ * A missing file has a zeroed one.
+ * @param[in] area_filename: file the #QwalkArea_t is stored in.
+ * @param[out] base: #QwalkJournalBase_t of @p area_filename.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_base_get(const char *area_filename, QwalkJournalBase_t *base) {
+	struct stat st;
+
+	memset(base, 0, sizeof(*base));
+	if (stat(area_filename, &st) == -1) {
+		if (errno == ENOENT) {
+			return Q_OK;
+		}
+		Q_ERROR_SYSTEM("stat()");
+		return Q_ERROR;
+	}
+	base->size = (size_t) st.st_size;
+	base->mtime_sec = (size_t) st.st_mtim.tv_sec;
+	base->mtime_nsec = (size_t) st.st_mtim.tv_nsec;
+	return Q_OK;
+}
+
+
+/**
+ * Read the #QwalkJournalBase_t of a save from a journal file.
+ * @param[in,out] handle: #QfileHandle_t of the journal file.
+ * @param[out] base: #QwalkJournalBase_t read.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_base_read(QfileHandle_t *handle, QwalkJournalBase_t *base) {
+	if (((base->size = qfile_handle_size_read(handle))
+				== (size_t) Q_ERRORCODE_SIZE)
+			|| ((base->mtime_sec = qfile_handle_size_read(handle))
+				== (size_t) Q_ERRORCODE_SIZE)
+			|| ((base->mtime_nsec = qfile_handle_size_read(handle))
+				== (size_t) Q_ERRORCODE_SIZE)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Tell whether two #QwalkJournalBase_t name the same version of an area file.
+ * @param[in] a: first #QwalkJournalBase_t.
+ * @param[in] b: second #QwalkJournalBase_t.
+ * @return whether @p a and @p b are equal.
+ */
+bool
+qwalk_journal_base_equals(const QwalkJournalBase_t *a,
+		const QwalkJournalBase_t *b) {
+	return (a->size == b->size) && (a->mtime_sec == b->mtime_sec)
+		&& (a->mtime_nsec == b->mtime_nsec);
+}
+
+
+/**
+ * Get a layer of a #QwalkArea_t by its #QwalkLayerType_t.
+ * @param[in] walk_area: relevant #QwalkArea_t.
+ * @param[in] type: #QwalkLayerType_t of the layer.
+ * @return the layer or @c NULL.
+ */
+QwalkLayer_t *
+qwalk_journal_layer_get(const QwalkArea_t *walk_area, QwalkLayerType_t type) {
+	switch (type) {
+	case QWALK_LAYER_TYPE_EARTH:
+		return qwalk_area_layer_earth_get(walk_area);
+	case QWALK_LAYER_TYPE_FLOATER:
+		return qwalk_area_layer_floater_get(walk_area);
+	default:
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return NULL;
+	}
+}
+
+
+/**
+ * Replay every record of an open journal file over a #QwalkArea_t.
+ * Every record is read and checked before any is applied, such that a bad
+ * one leaves the area as it was.
+ * @param[in] journal: relevant #QwalkJournal_t.
+ * @param[in,out] handle: #QfileHandle_t of the journal file.
+ * @param[in,out] walk_area: #QwalkArea_t to replay the journal over.
+ * @return #Q_OK, #Q_ERROR, or #Q_ERROR_NOCHANGE if the journal file was saved
+ * against another version of the area file, in which case nothing is replayed.
+ */
+int
+qwalk_journal_handle_replay(const QwalkJournal_t *journal,
+		QfileHandle_t *handle, QwalkArea_t *walk_area) {
+	unsigned char magic[QWALK_JOURNAL_MAGIC_SIZE];
+	QwalkJournalBase_t base;
+	QwalkJournalRecord_t *records = NULL;
+	QwalkJournalRecord_t *records_new;
+	size_t recordc = 0;
+	size_t record_max = 0;
+	size_t save_recordc;
+	bool isfirst = true;
+	int returnval = Q_OK;
+
+	/* one iteration per save */
+	while ((returnval == Q_OK)
+			&& (qfile_handle_bytes_peek(handle, magic, (size_t) 1) != 0)) {
+		if ((qfile_handle_bytes_read(handle, magic, sizeof(magic)) == Q_ERROR)
+				|| (memcmp(magic, QWALK_JOURNAL_MAGIC, sizeof(magic)) != 0)
+				|| (qwalk_journal_base_read(handle, &base) == Q_ERROR)
+				|| ((save_recordc = qfile_handle_size_read(handle))
+					== (size_t) Q_ERRORCODE_SIZE)) {
+			Q_ERRORFOUND(QERROR_FILE_FORMAT);
+			returnval = Q_ERROR;
+			break;
+		}
+
+		/* every save of one journal file follows the same area file */
+		if (!qwalk_journal_base_equals(&base, &journal->base)) {
+			if (!isfirst) {
+				Q_ERRORFOUND(QERROR_FILE_FORMAT);
+				returnval = Q_ERROR;
+			} else {
+				returnval = Q_ERROR_NOCHANGE;
+			}
+			break;
+		}
+		isfirst = false;
+
+		for (size_t i = 0; i < save_recordc; i++) {
+			if (recordc == record_max) {
+				record_max = (record_max == 0)
+					? (size_t) QWALK_JOURNAL_MARK_MAX_DEFAULT : record_max * 2;
+				if ((records_new = realloc(records,
+								record_max * sizeof(*records_new))) == NULL) {
+					Q_ERROR_SYSTEM("realloc()");
+					returnval = Q_ERROR;
+					break;
+				}
+				records = records_new;
+			}
+			/*@-nullderef@*/
+			if (qwalk_journal_record_read(handle, walk_area, &records[recordc])
+					== Q_ERROR) {
+				Q_ERRORFOUND(QERROR_FILE_FORMAT);
+				returnval = Q_ERROR;
+				break;
+			}
+			/*@=nullderef@*/
+			recordc++;
+		}
+	}
+
+	/*@-nullderef@*/
+	for (size_t i = 0; i < recordc; i++) {
+		if (returnval == Q_OK) {
+			qwalk_layer_object_attr_list_replace(
+					qwalk_journal_layer_get(walk_area,
+						(QwalkLayerType_t) records[i].type),
+					records[i].index, records[i].attr_list);
+		} else {
+			qattr_list_destroy(records[i].attr_list);
+		}
+	}
+	/*@=nullderef@*/
+	free(records);
+
+	return returnval;
+}
+
+
+/**
+ * Read and check a record of a journal file.
+ * The object it refers to must exist in @p walk_area, i.e. be set in a
+ * populated chunk.
+ * @param[in,out] handle: #QfileHandle_t of the journal file.
+ * @param[in] walk_area: #QwalkArea_t the journal is to be replayed over.
+ * @param[out] record: #QwalkJournalRecord_t read.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_record_read(QfileHandle_t *handle, const QwalkArea_t *walk_area,
+		QwalkJournalRecord_t *record) {
+	QwalkLayer_t *layer;
+	const QwalkChunk_t *chunk;
+	int local;
+
+	if ((qfile_handle_bytes_read(handle, &record->type, sizeof(record->type))
+				== Q_ERROR)
+			|| (qfile_handle_bytes_read(handle, &record->index,
+					sizeof(record->index)) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	if (((layer = qwalk_journal_layer_get(walk_area,
+							(QwalkLayerType_t) record->type)) == NULL)
+			|| ((chunk = qwalk_layer_chunk_get(layer, record->index, &local))
+				== NULL)
+			|| (chunk->objects[local].attr_list == NULL)) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	if ((record->attr_list = qattr_list_handle_read(handle)) == NULL) {
+		Q_ERRORFOUND(QERROR_FILE_FORMAT);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Order two #QwalkJournalMark_t by layer, then by index.
+ * @param[in] a: first #QwalkJournalMark_t.
+ * @param[in] b: second #QwalkJournalMark_t.
+ * @return negative, zero or positive, as by @c qsort().
+ */
+int
+qwalk_journal_marks_compare(const void *a, const void *b) {
+	const QwalkJournalMark_t *mark_a = a;
+	const QwalkJournalMark_t *mark_b = b;
+
+	if (mark_a->type != mark_b->type) {
+		return mark_a->type < mark_b->type ? -1 : 1;
+	}
+	if (mark_a->index != mark_b->index) {
+		return mark_a->index < mark_b->index ? -1 : 1;
+	}
+	return 0;
+}
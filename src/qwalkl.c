@@ -24,19 +24,14 @@
 
 
 static int qwalk_logic_interact(QwalkLayer_t *layer_earth,
-		QwalkLayer_t *layer_floater, int object_index);
+		QwalkLayer_t *layer_floater, int player_index, int object_index);
 static int qwalk_logic_inspect(int object_index);
-static           int          qwalk_logic_obj_move(/*@null@*/QwalkLayer_t *, int, Qdirection_t);
+static           int          qwalk_logic_obj_move(/*@null@*/QwalkLayer_t *, int *, Qdirection_t);
 static           int          qwalk_logic_objs_locs_trade(/*@null@*/QwalkLayer_t *, int, int);
-static /*@null@*/QobjType_t  *qwalk_logic_walk_layer_sanitize(QwalkLayer_t *)/*@*/;
-static           void         qwalk_logic_qobj_type_destroy(/*@only@*/QobjType_t *);
 static           bool         qwalk_logic_layer_object_canmove(const QwalkLayer_t *, int);
-/*@observer@*/
-static /*@null@*/Qdatameta_t *qwalk_logic_layer_object_attr_value_get(const QwalkLayer_t *, int, QattrKey_t);
-/*@observer@*/
-static /*@null@*/QattrList_t *qwalk_logic_layer_object_attr_list_get(const QwalkLayer_t *, int); 
-static           int          qwalk_logic_find_qobj_index(/*@null@*/QobjType_t *, QobjType_t)/*@*/;
 static           Qdirection_t qwalk_logic_command_move_to_direction(QwalkCommand_t)/*@*/;
+static /*@null@*//*@only@*/QattrList_t *qwalk_logic_attr_list_detach(
+		const QattrList_t *attr_list);
 
 
 
@@ -50,20 +45,12 @@ static           Qdirection_t qwalk_logic_command_move_to_direction(QwalkCommand
 int
 qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
 
-	/* Index of the player in walk_layer and obj_types */
-	int player_index;
+	/* Index of the active player in layer_floater */
+	int *player_indexp;
 
 	/* Player's direction, if applicable */
 	Qdirection_t player_direction;
 
-	/*
-	 * Dynamic arrays of every #QwalkObj_t #QobjType_t #Qattr_t for each
-	 * #QwalkLayer_t.
-	 * Indexes are assumed to be in lockstep with each #QwalkLayer_t.
-	 */
-	QobjType_t *obj_types_layer_earth;
-	QobjType_t *obj_types_layer_floater;
-
 	QwalkLayer_t *layer_earth;
 	QwalkLayer_t *layer_floater;
 
@@ -84,46 +71,24 @@ qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
 		return Q_OK;
 	}
 	
+	/*
+	 * the area was checked by qwalk_area_validate() upon loading, and the
+	 * stores of its layers have been kept up to date since.
+	 */
 	layer_earth   = qwalk_area_layer_earth_get(walk_area);
 	layer_floater = qwalk_area_layer_floater_get(walk_area);
 
-	obj_types_layer_earth = qwalk_logic_walk_layer_sanitize(layer_earth);
-	if (obj_types_layer_earth == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-	
-	obj_types_layer_floater = qwalk_logic_walk_layer_sanitize(layer_floater);
-	if (obj_types_layer_floater == NULL) {
-		qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
-
 
-	/* find the player's index */
 	/*
-	 * Very possible bug could arise here if there are multiple players! This code
-	 * assumes there's either 1 or 0 players on the map!
+	 * commands apply to the active player only; any other player stays put
+	 * until made the active one.
 	 */
-	player_index = qwalk_logic_find_qobj_index(obj_types_layer_floater, QOBJ_TYPE_PLAYER);
-	if (player_index == Q_ERRORCODE_INT) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-		qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
-		return Q_ERROR;
-	}
-	if (player_index == Q_ERRORCODE_INT_NOTFOUND) {
-		/* 
-		 * This because Q_ERRORCODE_INT_NOTFOUND is returned by
-		 * qwalk_logic_find_obj_index() when it finds zero instances of the search
-		 * query. This is impossible; we must have a player.
-		 */
+	if (walk_area->playerc == 0) {
+		/* This is impossible; we must have a player. */
 		Q_ERRORFOUND(QERROR_ZERO_VALUE_UNEXPECTED);
-		qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-		qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
 		return Q_ERROR;
 	}
+	player_indexp = &walk_area->player_indices[walk_area->player_active];
 
 
 	/* check for & handle movement commands */
@@ -132,17 +97,12 @@ qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
 		player_direction = qwalk_logic_command_move_to_direction(walk_command);
 		if ((int) player_direction == Q_ERRORCODE_ENUM) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
 			return Q_ERROR;
 		}
 
-		if (qwalk_logic_obj_move(qwalk_area_layer_floater_get(walk_area),
-				player_index, player_direction)
+		if (qwalk_logic_obj_move(layer_floater, player_indexp, player_direction)
 				==  Q_ERROR ) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
 			return Q_ERROR;
 		}
 	}
@@ -150,11 +110,10 @@ qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
 	/* interact command */
 	if (walk_command == QWALK_COMMAND_INTERACT) {
 		int object_index = qwalk_io_buffer_int_get();
-		if (qwalk_logic_interact(layer_earth, layer_floater, object_index)
+		if (qwalk_logic_interact(layer_earth, layer_floater, *player_indexp,
+					object_index)
 				== Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
 			return Q_ERROR;
 		}
 	}
@@ -163,17 +122,120 @@ qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
 		if (qwalk_logic_inspect(object_index)
 				== Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-			qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
 			return Q_ERROR;
 		}
 	}
 
-	qwalk_logic_qobj_type_destroy(obj_types_layer_earth);
-	obj_types_layer_earth = NULL;
-	
-	qwalk_logic_qobj_type_destroy(obj_types_layer_floater);
-	obj_types_layer_floater = NULL;
+	return Q_OK;
+}
+
+
+/**
+ * Move the active player of a #QwalkArea_t across one of its edges into the
+ * area beyond it.
+ * The player enters @p walk_area_next on the tile facing the one it left, and
+ * trades places with the object there, as a move within an area would. It
+ * becomes the active player of @p walk_area_next. Both lists are cloned over,
+ * such that neither area keeps memory of the other (e.g. views into its file)
+ * once that is destroyed.
+ * @param[out] walk_area: #QwalkArea_t the player is in.
+ * @param[out] walk_area_next: #QwalkArea_t across the edge.
+ * @param[in] walk_command: movement #QwalkCommand_t leading off the edge.
+ * @return #Q_OK, #Q_ERROR_NOCHANGE if the move doesn't lead off the edge or
+ * the tile facing it can't be moved into, or #Q_ERROR.
+ */
+int
+qwalk_logic_area_cross(QwalkArea_t *walk_area, QwalkArea_t *walk_area_next,
+		QwalkCommand_t walk_command) {
+	QwalkLayer_t *layer_floater;
+	QwalkLayer_t *layer_floater_next;
+	QattrList_t *attr_list;
+	QattrList_t *attr_list_next;
+	int index;
+	int index_next;
+	int y;
+	int x;
+
+	if ((walk_area == NULL) || (walk_area_next == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (walk_area->playerc == 0) {
+		Q_ERRORFOUND(QERROR_ZERO_VALUE_UNEXPECTED);
+		return Q_ERROR;
+	}
+	if (walk_area_next->playerc == QWALK_AREA_PLAYERC_MAX) {
+		return Q_ERROR_NOCHANGE;
+	}
+
+	layer_floater = walk_area->layer_floater;
+	layer_floater_next = walk_area_next->layer_floater;
+	index = walk_area->player_indices[walk_area->player_active];
+	y = index / layer_floater->size_x;
+	x = index % layer_floater->size_x;
+
+	/* find the tile facing the one to leave, along the opposite edge */
+	switch (qwalk_logic_command_move_to_direction(walk_command)) {
+	case QDIRECTION_NORTH:
+		if (y != QWALK_LAYER_COORD_MINIMUM) {
+			return Q_ERROR_NOCHANGE;
+		}
+		y = layer_floater_next->size_y - 1;
+		break;
+	case QDIRECTION_EAST:
+		if (x != layer_floater->size_x - 1) {
+			return Q_ERROR_NOCHANGE;
+		}
+		x = QWALK_LAYER_COORD_MINIMUM;
+		break;
+	case QDIRECTION_SOUTH:
+		if (y != layer_floater->size_y - 1) {
+			return Q_ERROR_NOCHANGE;
+		}
+		y = QWALK_LAYER_COORD_MINIMUM;
+		break;
+	case QDIRECTION_WEST:
+		if (x != QWALK_LAYER_COORD_MINIMUM) {
+			return Q_ERROR_NOCHANGE;
+		}
+		x = layer_floater_next->size_x - 1;
+		break;
+	default:
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return Q_ERROR;
+	}
+
+	/* the next area may be narrower along the edge */
+	if (!qwalk_logic_coords_arevalid(layer_floater_next, y, x)) {
+		return Q_ERROR_NOCHANGE;
+	}
+	index_next = qwalk_coords_to_index(layer_floater_next, y, x);
+	if (!qwalk_logic_layer_object_canmove(layer_floater_next, index_next)) {
+		return Q_ERROR_NOCHANGE;
+	}
+
+	if ((attr_list = qwalk_logic_attr_list_detach(
+					qwalk_layer_object_attr_list_get(layer_floater, index))) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if ((attr_list_next = qwalk_logic_attr_list_detach(
+					qwalk_layer_object_attr_list_get(layer_floater_next, index_next)))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qattr_list_destroy(attr_list);
+		return Q_ERROR;
+	}
+	qwalk_layer_object_attr_list_replace(layer_floater_next, index_next, attr_list);
+	qwalk_layer_object_attr_list_replace(layer_floater, index, attr_list_next);
+
+	/* the player is tracked by the area it entered instead */
+	walk_area->playerc--;
+	walk_area->player_indices[walk_area->player_active] =
+		walk_area->player_indices[walk_area->playerc];
+	walk_area->player_active = 0;
+	walk_area_next->player_active = walk_area_next->playerc;
+	walk_area_next->player_indices[walk_area_next->playerc++] = index_next;
 
 	return Q_OK;
 }
@@ -183,28 +245,18 @@ qwalk_logic_subtick(QwalkArea_t *walk_area, QwalkCommand_t walk_command) {
  * Have the player interact with a given layer object.
  * @param[out] layer_earth: earth #QwalkLayer_t of the #QwalkArea_t.
  * @param[out] layer_floater: floater #QwalkLayer_t of the #QwalkArea_t.
+ * @param[in] player_index: index in @p layer_floater of the player.
  * @param[in] object_index: index of the object to interact with.
  * @return #Q_ERROR or #Q_OK.
  */
 int
 qwalk_logic_interact(QwalkLayer_t *layer_earth, QwalkLayer_t *layer_floater,
-		int object_index) {
+		int player_index, int object_index) {
 
 	QobjType_t earth_object_type, floater_object_type, active_object_type;
 
 	QwalkLayer_t *active_layer;
 
-	/* find the player's index */
-	int player_index;
-	if ((player_index = qwalk_layer_obj_index_get(
-					layer_floater, QOBJ_TYPE_PLAYER)) == Q_ERROR) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return Q_ERROR;
-	} else if (player_index == Q_ERRORCODE_INT) {
-		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
-		return Q_ERROR;
-	}
-
 	if ((earth_object_type = qwalk_layer_object_type_get(
 					layer_earth, object_index)) == (QobjType_t) Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -291,13 +343,14 @@ qwalk_logic_inspect(int object_index) {
  * If the location to attempt to move to is valid, the move occurs. Otherwise,
  * the old coordinates remain and nothing is changed.
  * @param[out] walk_layer: walk_layer to operate on
- * @param[in]  index:      index in walk_layer of the object to attempt to move
+ * @param[in,out] indexp:  index in walk_layer of the object to attempt to
+ * move; follows the object should it move.
  * @param[in] direction:   #Qdirection_t to attempt to move in
  * @return #Q_OK, #Q_ERROR_NOCHANGE if the attempt to move resulted in illegal
  * behaviour (e.g. passing through walls), or #Q_ERROR.
  */
 int
-qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction) {
+qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int *indexp, Qdirection_t direction) {
 	int returnval = Q_OK;
 
 	int y_old;
@@ -312,8 +365,8 @@ qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction
 	/* The object trying to move, i.e. walk_layer[index] */
 	int coord_occupant_mover_index;
 
-	y_old = qwalk_layer_object_coord_y_get(walk_layer, index);
-	x_old = qwalk_layer_object_coord_x_get(walk_layer, index);
+	y_old = qwalk_layer_object_coord_y_get(walk_layer, *indexp);
+	x_old = qwalk_layer_object_coord_x_get(walk_layer, *indexp);
  	
 	y_new = y_old;
 	x_new = x_old;
@@ -341,12 +394,12 @@ qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction
 		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 		return Q_ERROR;
 	}
-	if (!qwalk_logic_coords_arevalid(y_new, x_new)) {
+	if (!qwalk_logic_coords_arevalid(walk_layer, y_new, x_new)) {
 		return Q_ERROR_NOCHANGE; 
 	}
 
-	coord_occupant_mover_index = qwalk_coords_to_index(y_old, x_old);
-	coord_occupant_old_index = qwalk_coords_to_index(y_new, x_new);
+	coord_occupant_mover_index = qwalk_coords_to_index(walk_layer, y_old, x_old);
+	coord_occupant_old_index = qwalk_coords_to_index(walk_layer, y_new, x_new);
 
 	/* only trade spots if the previous occupant is allowed to move */
 	if (qwalk_logic_layer_object_canmove(walk_layer, coord_occupant_old_index)) {	
@@ -354,6 +407,8 @@ qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction
 					coord_occupant_mover_index, coord_occupant_old_index) == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			returnval = Q_ERROR;
+		} else {
+			*indexp = coord_occupant_old_index;
 		}
 	}
 
@@ -364,10 +419,11 @@ qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction
 /**
  * Make two #QwalkObj_t on the same #QwalkLayer_t exchange places.
  * This is implemented in this fashion in order to adhere to the rule: every
- * #QwalkLayer_t must have <i>exactly</i> #QWALK_LAYER_SIZE many #QwalkObj_t on
- * it at any given time; therefore, if a #QwalkObj_t moves, it must exchange
- * places with a different #QwalkObj_t, even if one of the aforementioned is
- * merely a #QOBJ_TYPE_VOID.
+ * tile of a populated chunk of a #QwalkLayer_t must hold <i>exactly</i> one
+ * #QwalkObj_t at any given time; therefore, if a #QwalkObj_t moves, it must
+ * exchange places with a different #QwalkObj_t, even if one of the
+ * aforementioned is merely a #QOBJ_TYPE_VOID. Both may lie in different
+ * chunks.
  * @param[out] walk_layer:  #QwalkLayer_t to operate on
  * @param[in] mover_index:  index of that #QwalkObj_t which dislocates another.
  * @param[in] movend_index: index of that #QwalkObj_t which is dislocated by another.
@@ -375,12 +431,19 @@ qwalk_logic_obj_move(QwalkLayer_t *walk_layer, int index, Qdirection_t direction
  */
 int
 qwalk_logic_objs_locs_trade(QwalkLayer_t *walk_layer, int mover_index, int movend_index) {
+	QwalkChunk_t *mover_chunk;
+	QwalkChunk_t *movend_chunk;
+	int mover_local;
+	int movend_local;
+
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
-	if ((mover_index < 0) || (mover_index >= QWALK_LAYER_SIZE)
-			|| (movend_index < 0) || (movend_index >= QWALK_LAYER_SIZE)) {
+	if (((mover_chunk = qwalk_layer_chunk_get(walk_layer, mover_index,
+						&mover_local)) == NULL)
+			|| ((movend_chunk = qwalk_layer_chunk_get(walk_layer, movend_index,
+						&movend_local)) == NULL)) {
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return Q_ERROR;
 	}
@@ -390,199 +453,41 @@ qwalk_logic_objs_locs_trade(QwalkLayer_t *walk_layer, int mover_index, int moven
 	 * places).
 	 */
 	/*@only@*/QattrList_t *attr_list_buffer;
-	attr_list_buffer = walk_layer->objects[mover_index].attr_list;
-	walk_layer->objects[mover_index].attr_list = walk_layer->objects[movend_index].attr_list;
-	walk_layer->objects[movend_index].attr_list = attr_list_buffer;
+	attr_list_buffer = mover_chunk->objects[mover_local].attr_list;
+	mover_chunk->objects[mover_local].attr_list =
+		movend_chunk->objects[movend_local].attr_list;
+	movend_chunk->objects[movend_local].attr_list = attr_list_buffer;
 	attr_list_buffer = NULL;
-	return Q_OK;
-}
-
-
-/**
- * Error-check a #QwalkLayer_t and create an array of every #QobjType_t therein.
- * This is for ease of future indexing and to sanitize inputs to dispose of the
- * need for excessive error-checking code; i.e., this function's params and
- * return value are assumed to be error-free if a non-`NULL` value is returned.
- * The exception is everything under walk_layer->objects[].attr_list, barring
- * the #QATTR_KEY_QOBJECT_TYPE value. The verb sanitize is certainly a
- * misnomer, but this function's identifier really should only be so long!
- * @param[in] walk_layer: #QwalkLayer_t to parse and proof-read 
- * @return Dynamic #QobjType_t array or @c NULL if an error was encountered
- */
-QobjType_t *
-qwalk_logic_walk_layer_sanitize(QwalkLayer_t *walk_layer) {
-	QattrList_t           *attr_list;
-	Qdatameta_t           *datameta_object_type;
-	QobjType_t            *object_type;
-
-	/*@only@*/QobjType_t  *obj_types;
-	obj_types = calloc((size_t) QWALK_LAYER_SIZE, sizeof(*obj_types));
-
-	if (obj_types == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return NULL;
-	}
-	/* parse starting from the outside and travelling to the inside */
-	if (walk_layer == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		free(obj_types);
-		return NULL;
-	}
 
-	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
-		
-		if (walk_layer->objects[i].coord_x < QWALK_LAYER_COORD_MINIMUM) {
-			Q_ERRORFOUND(QERROR_NEGATIVE_VALUE_UNEXPECTED);
-			free(obj_types);
-			return NULL;
-		}
-		if (walk_layer->objects[i].coord_y < QWALK_LAYER_COORD_MINIMUM) {
-			Q_ERRORFOUND(QERROR_NEGATIVE_VALUE_UNEXPECTED);
-			free(obj_types);
-			return NULL;
-		}
-    
-		/*
-		 * TODO: in future, implement an interface function to nab the attr_list
-		 * that we can mark with the splint observer annotation!
-		 */
-		attr_list            = walk_layer->objects[i].attr_list;
-		if (attr_list == NULL) {
-			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-			free(obj_types);
-			return NULL;
-		}
-		
-		datameta_object_type = qattr_list_value_get(attr_list, QATTR_KEY_QOBJECT_TYPE);
-		if (datameta_object_type == NULL) {
-			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-			free(obj_types);
-			return NULL;
-		}
-		if (qdatameta_type_get(datameta_object_type) != QDATA_TYPE_QOBJECT_TYPE) {
-			Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_INCOMPATIBLE);
-			free(obj_types);
-			return NULL;
-		}
-		
-		/* ensure QATTR_KEY_OBJECT_TYPE has size of exactly 1 */
-		if (qdatameta_count_get(datameta_object_type) != (size_t) 1) {
-			Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
-			free(obj_types);
-			return NULL;
-		}
-
-		object_type = (QobjType_t *) qdatameta_datap_get(datameta_object_type);
-		if (object_type == NULL) {
-			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-			free(obj_types);
-			return NULL;
-		}
-		
-		obj_types[i] = *object_type;
+	/* the entries of the stores follow their lists */
+	if ((qattr_store_bind(mover_chunk->store, (size_t) mover_local,
+					mover_chunk->objects[mover_local].attr_list) == Q_ERROR)
+			|| (qattr_store_bind(movend_chunk->store, (size_t) movend_local,
+					movend_chunk->objects[movend_local].attr_list) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
 	}
-	/*@i1@*/return obj_types;
-}
-
-
-/**
- * Safely destroy a dynamic #QobjType_t array.
- * @param[out] obj_types: array to destroy
- */
-void
-qwalk_logic_qobj_type_destroy(QobjType_t *obj_types) {
-	free(obj_types);
-	return;
+	return Q_OK;
 }
 
 
 /**
  * Check the value of a given object's #QATTR_KEY_CANMOVE attribute.
+ * Tiles of unpopulated chunks can't be moved into.
  * @param[in] layer: Pointer to the #QwalkLayer_t in question.
  * @param[in] index: Index in @p layer.
  * @return #QATTR_KEY_CANMOVE value or `false` on an error.
  */
 bool
 qwalk_logic_layer_object_canmove(const QwalkLayer_t *layer, int index) {
-	/* check if old occupant can move. only move if it can. */
-	Qdatameta_t *datameta;
-	Qdata_t     *data;
+	const QwalkChunk_t *chunk;
+	int local;
 
-	if ((datameta = qwalk_logic_layer_object_attr_value_get(layer, index, QATTR_KEY_CANMOVE)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return false;
-	}
-	if ((data = qdatameta_datap_get(datameta)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
+	/* check if old occupant can move. only move if it can. */
+	if ((chunk = qwalk_layer_chunk_get(layer, index, &local)) == NULL) {
 		return false;
 	}
-	return *((bool *) data);
-}
-
-
-/**
- * Get a specific #QattrKey_t value from a #QwalkLayer_t and an index.
- * @param[in] layer: Pointer to the #QwalkLayer_t in question.
- * @param[in] index: Index in @p layer.
- * @param[in] key:  #QattrKey_t of the value to return.
- * @return desired value or NULL on error.
- */
-Qdatameta_t *
-qwalk_logic_layer_object_attr_value_get(const QwalkLayer_t *layer,
-		int index, QattrKey_t key) {
-	
-	QattrList_t *attr_list;
-	if ((attr_list = qwalk_logic_layer_object_attr_list_get(layer, index)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return NULL;
-	}
-	return qattr_list_value_get(attr_list, key);
-}
-
-
-/**
- * Get the #QattrList_t of a given occupant of a #QwalkLayer_t.
- * @param[in] layer: Pointer to the #QwalkLayer_t in question.
- * @param[in] index: Index in @p layer.
- * @return desired #QattrList_t or @c NULL.
- */
-QattrList_t *
-qwalk_logic_layer_object_attr_list_get(const QwalkLayer_t *layer, int index) {
-	return layer->objects[index].attr_list;
-}
-
-
-/**
- * Find the index of a #QwalkObj_t according to a #QobjType_t search query.
- * The #QobjType_t is assumed to be occur either once or zero times; if an
- * object occurs more than once, this function will fail.
- * @param[in] obj_types_parse: QobjType_t array to parse
- * @param[in] obj_type_search: search query; #QobjType_t to check against
- * @return index of desired #QwalkObj_t, <i>OR</i> #Q_ERRORCODE_INT in the
- * event of a fatal error, <i>OR</i> #Q_ERRORCODE_INT_NOTFOUND if the match for
- * obj_type_search cannot be found.
- */
-int
-qwalk_logic_find_qobj_index(QobjType_t *obj_types_parse, QobjType_t obj_type_search) {
-	
-	if (obj_types_parse == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERRORCODE_INT;
-	}
-	if (obj_type_search < (QobjType_t) Q_ENUM_VALUE_START) {
-		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID_ZERO);
-		return Q_ERRORCODE_INT;
-	} else if (obj_type_search > QOBJ_TYPE_COUNT) {
-		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
-		return Q_ERRORCODE_INT;
-	}
-
-	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
-		if (obj_types_parse[i] == obj_type_search) {
-			return i;
-		}	
-	}
-	return Q_ERRORCODE_INT_NOTFOUND;
+	return qattr_store_canmove_get(chunk->store, (size_t) local);
 }
 
 
@@ -612,19 +517,47 @@ qwalk_logic_command_move_to_direction(QwalkCommand_t cmd) {
  * Tell caller if coordinates are valid for qwalk.
  * Specifically whether they index within the playable space. This function's
  * output is usually expected to be handled gracefully.
+ * @param[in] layer: #QwalkLayer_t whose dimensions bound the coords.
  * @param[in] y: y coord to check
  * @param[in] x: x coord to check
  */
 bool
-qwalk_logic_coords_arevalid(int y, int x) {
+qwalk_logic_coords_arevalid(const QwalkLayer_t *layer, int y, int x) {
 	if (y < QWALK_LAYER_COORD_MINIMUM) {
 		return false;
-	} else if (y >= QWALK_LAYER_SIZE_Y) {
+	} else if (y >= layer->size_y) {
 		return false;
 	} else if (x < QWALK_LAYER_COORD_MINIMUM) {
 		return false;
-	} else if (x >= QWALK_LAYER_SIZE_X) {
+	} else if (x >= layer->size_x) {
 		return false;
 	}
 	return true;
 }
+
+
+/**
+ * Clone a #QattrList_t such that the clone owns every value it holds.
+ * Deferred values are read first; views and values in a #Qarena_t are then
+ * copied rather than shared by qattr_list_clone(), such that the clone
+ * outlives the file, arena and string store of the area @p attr_list lies in.
+ * @param[in] attr_list: #QattrList_t to clone, or @c NULL.
+ * @return the clone or @c NULL.
+ */
+QattrList_t *
+qwalk_logic_attr_list_detach(const QattrList_t *attr_list) {
+	if (attr_list == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return NULL;
+	}
+
+	for (int i = 0; i < (int) qattr_list_index_ok_get(attr_list); i++) {
+		if (qattr_list_value_get(attr_list, qattr_list_attr_key_get(attr_list, i))
+				== NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return NULL;
+		}
+	}
+
+	return qattr_list_clone(attr_list);
+}
@@ -0,0 +1,949 @@
+/**
+ * @file qwalkm.c
+ * Program file for the world map section of the qwalk module.
+ * A world is a grid of areas addressed by meta-coordinates, each stored in a
+ * file named after #QWALK_WORLD_AREA_FILENAME_FORMAT within one directory;
+ * walking off an edge of an area leads into the area across it, if any.
+ * At most #QWALK_WORLD_CACHE_SIZE areas are held at once: those the player
+ * nears are read on threads of their own ahead of time, and the least
+ * recently visited ones are dropped to make room, their edits saved to their
+ * journals first. Saves are committed, fsync() and all, on a thread of their
+ * own (see #QwalkWorldSaver_t), such that neither dropping an area nor the
+ * autosave stalls a tick. As every area interns its strings into a store of its own
+ * (see @ref QwalkArea_t.strings), dropping it frees them too; memory is thus
+ * bounded however large the world.
+ */
+
+
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libgen.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <ncurses.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "splint_types.h"
+#include "qattr.h"
+#include "qfile.h"
+#include "dialogue.h"
+#include "qwalk.h"
+
+
+
+/**
+ * States of a #QwalkWorldSlot_t.
+ */
+typedef enum QwalkWorldSlotState_t {
+	/** Holds nothing. */
+	QWALK_WORLD_SLOT_STATE_EMPTY = Q_ENUM_VALUE_START,
+	/** Its area is being read by @ref QwalkWorldSlot_t.loader. */
+	QWALK_WORLD_SLOT_STATE_LOADING,
+	/** Holds its area. */
+	QWALK_WORLD_SLOT_STATE_READY,
+	/** Its area doesn't exist, or couldn't be read. */
+	QWALK_WORLD_SLOT_STATE_MISSING,
+} QwalkWorldSlotState_t;
+
+
+/**
+ * Save of a #QwalkWorld_t waiting to be committed.
+ */
+typedef struct QwalkWorldSave_t {
+	/** Save queued after this one. */
+	/*@null@*//*@only@*/struct QwalkWorldSave_t *next;
+
+	/** Save itself, from qwalk_journal_frame_get(); closing it commits it. */
+	/*@only@*/QfileHandle_t *handle;
+} QwalkWorldSave_t;
+
+
+/**
+ * Committer of the saves of a #QwalkWorld_t.
+ * Saves are serialized on the main thread, in proportion to the edits, and
+ * queued; @ref QwalkWorldSaver_t.thread appends them to their journal files in
+ * order. Should it not start, saves are committed right away instead.
+ */
+typedef struct QwalkWorldSaver_t {
+	/** Guards every member but @ref QwalkWorldSaver_t.thread. */
+	pthread_mutex_t mutex;
+
+	/** Signalled once a save is queued, or the thread is to stop. */
+	pthread_cond_t queued;
+
+	/** Signalled once a save is committed. */
+	pthread_cond_t committed;
+
+	/** Oldest save queued. */
+	/*@null@*//*@only@*/QwalkWorldSave_t *head;
+
+	/** Newest save queued. */
+	/*@null@*//*@dependent@*/QwalkWorldSave_t *tail;
+
+	size_t pending; /**< Number of saves queued or being committed. */
+	size_t failc;   /**< Number of saves which failed to commit.    */
+
+	bool isrunning;  /**< Whether @ref QwalkWorldSaver_t.thread started. */
+	bool isstopping; /**< Whether the thread is to stop once idle.       */
+
+	/** Thread committing the saves. */
+	pthread_t thread;
+} QwalkWorldSaver_t;
+
+
+/**
+ * An area of a #QwalkWorld_t, along with its journal.
+ */
+typedef struct QwalkWorldSlot_t {
+	QwalkWorldSlotState_t state; /**< What the slot holds. */
+
+	int meta_coord_y; /**< Meta-coordinates of the area in its world.   */
+	int meta_coord_x; /**< X counterpart of @ref QwalkWorldSlot_t.meta_coord_y. */
+
+	/** File the area is stored in. */
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+
+	/** The area, once read; see #QWALK_WORLD_SLOT_STATE_READY. */
+	/*@null@*//*@only@*/QwalkArea_t *area;
+
+	/**
+	 * Edits made to the area since it was last saved. Only touched by
+	 * @ref QwalkWorldSlot_t.loader until it is joined.
+	 */
+	/*@null@*//*@only@*/struct QwalkJournal_t *journal;
+
+	/** Thread reading the area; see #QWALK_WORLD_SLOT_STATE_LOADING. */
+	pthread_t loader;
+
+	/** Committer of the saves of the world, which the loader waits for. */
+	/*@dependent@*/QwalkWorldSaver_t *saver;
+
+	/** Value of @ref QwalkWorld_t.clock when the area was last visited. */
+	unsigned long used;
+
+	struct timespec load_start; /**< When the area started being read. */
+	/** When the area was read; written by @ref QwalkWorldSlot_t.loader. */
+	struct timespec load_end;
+} QwalkWorldSlot_t;
+
+
+/**
+ * The areas of a world held in memory.
+ */
+typedef struct QwalkWorld_t {
+	/** Directory the files of the areas are in. */
+	char dirname[QFILE_MAX_PATH_SIZE + 1];
+
+	/**
+	 * Whether the first area was named after
+	 * #QWALK_WORLD_AREA_FILENAME_FORMAT; a lone area has no others around it.
+	 */
+	bool ismapped;
+
+	/** Every area held, or being read. */
+	QwalkWorldSlot_t slots[QWALK_WORLD_CACHE_SIZE];
+
+	/** Member of @ref QwalkWorld_t.slots holding the area of the player. */
+	int slot_curr;
+
+	/** Ticks of the world, for @ref QwalkWorldSlot_t.used. */
+	unsigned long clock;
+
+	/** Committer of the saves of every area. */
+	QwalkWorldSaver_t saver;
+} QwalkWorld_t;
+
+
+
+static int   qwalk_world_area_load(QwalkWorld_t *world, int meta_coord_y,
+		int meta_coord_x)/*@modifies world@*/;
+static void *qwalk_world_area_read(void *arg)
+	/*@modifies fileSystem@*/;
+static int   qwalk_world_slot_join(QwalkWorldSlot_t *slot)
+	/*@modifies slot@*/;
+static int   qwalk_world_slot_evict(QwalkWorldSlot_t *slot)
+	/*@modifies slot, fileSystem@*/;
+static int   qwalk_world_slot_save(QwalkWorldSlot_t *slot)
+	/*@modifies slot, fileSystem@*/;
+static void  qwalk_world_saver_start(QwalkWorldSaver_t *saver)
+	/*@modifies saver@*/;
+static void  qwalk_world_saver_stop(QwalkWorldSaver_t *saver)
+	/*@modifies saver, fileSystem@*/;
+static int   qwalk_world_saver_push(QwalkWorldSaver_t *saver,
+		/*@only@*/QfileHandle_t *handle)
+	/*@modifies saver, handle, fileSystem@*/;
+static void  qwalk_world_saver_wait(QwalkWorldSaver_t *saver)
+	/*@modifies saver@*/;
+static void *qwalk_world_saver_run(void *arg)
+	/*@modifies fileSystem@*/;
+static int   qwalk_world_slot_find(const QwalkWorld_t *world,
+		int meta_coord_y, int meta_coord_x)/*@*/;
+static int   qwalk_world_slot_victim_get(const QwalkWorld_t *world)/*@*/;
+
+
+
+/**
+ * Create a #QwalkWorld_t around the area stored in a file.
+ * Should the basename of @p area_filename follow
+ * #QWALK_WORLD_AREA_FILENAME_FORMAT, the area lies at the meta-coordinates it
+ * names, and the others of the world are looked for next to it; otherwise it
+ * is a world of its own. The area is read in the background; see
+ * qwalk_world_area_curr_get().
+ * @param[in] area_filename: file of the area the player starts in.
+ * @return new #QwalkWorld_t or @c NULL.
+ * @allocs{1} for returned pointer.
+ */
+QwalkWorld_t *
+qwalk_world_create(const char *area_filename) {
+	QwalkWorld_t *world;
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+	int meta_coord_y = 0;
+	int meta_coord_x = 0;
+	int consumed = -1;
+
+	if (strlen(area_filename) > (size_t) QFILE_MAX_PATH_SIZE) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+
+	if ((world = calloc((size_t) 1, sizeof(*world))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	qwalk_world_saver_start(&world->saver);
+	for (int i = 0; i < QWALK_WORLD_CACHE_SIZE; i++) {
+		world->slots[i].state = QWALK_WORLD_SLOT_STATE_EMPTY;
+		world->slots[i].area = NULL;
+		world->slots[i].journal = NULL;
+		world->slots[i].saver = &world->saver;
+	}
+	world->clock = 0;
+
+	/* basename() and dirname() may modify their argument, hence the copies */
+	strcpy(filename, area_filename);
+	(void) sscanf(basename(filename), QWALK_WORLD_AREA_FILENAME_FORMAT "%n",
+			&meta_coord_y, &meta_coord_x, &consumed);
+	strcpy(filename, area_filename);
+	world->ismapped = (consumed >= 0)
+		&& (basename(filename)[consumed] == '\0');
+	strcpy(filename, area_filename);
+	strcpy(world->dirname, dirname(filename));
+	if (!world->ismapped) {
+		meta_coord_y = 0;
+		meta_coord_x = 0;
+	}
+
+	/* the first area is read from the filename given, whatever its form */
+	world->slot_curr = 0;
+	strcpy(world->slots[0].filename, area_filename);
+	if (qwalk_world_area_load(world, meta_coord_y, meta_coord_x) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_world_destroy(world);
+		return NULL;
+	}
+
+	return world;
+}
+
+
+/**
+ * Destroy a #QwalkWorld_t along with every area it holds.
+ * Unsaved edits are lost; see qwalk_world_save(). Saves already queued are
+ * committed first.
+ * @param[out] world: #QwalkWorld_t to destroy.
+ */
+void
+qwalk_world_destroy(QwalkWorld_t *world) {
+	QwalkWorldSlot_t *slot;
+
+	for (int i = 0; i < QWALK_WORLD_CACHE_SIZE; i++) {
+		slot = &world->slots[i];
+		if (qwalk_world_slot_join(slot) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+		if (slot->area != NULL) {
+			qwalk_area_destroy(slot->area);
+			slot->area = NULL;
+		}
+		if (slot->journal != NULL) {
+			qwalk_journal_destroy(slot->journal);
+			slot->journal = NULL;
+		}
+	}
+	qwalk_world_saver_stop(&world->saver);
+	free(world);
+	return;
+}
+
+
+/**
+ * Get the #QwalkArea_t of a #QwalkWorld_t the player is in.
+ * Waits for the area to be read, should it still be.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @return the area, or @c NULL if it couldn't be read.
+ */
+QwalkArea_t *
+qwalk_world_area_curr_get(QwalkWorld_t *world) {
+	QwalkWorldSlot_t *slot = &world->slots[world->slot_curr];
+
+	if (qwalk_world_slot_join(slot) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	return slot->area;
+}
+
+
+/**
+ * Get the #QwalkJournal_t of the area of a #QwalkWorld_t the player is in.
+ * @param[in] world: relevant #QwalkWorld_t.
+ * @return the journal, or @c NULL if the area couldn't be read.
+ */
+struct QwalkJournal_t *
+qwalk_world_journal_curr_get(const QwalkWorld_t *world) {
+	return world->slots[world->slot_curr].journal;
+}
+
+
+/**
+ * Get how long the area of a #QwalkWorld_t the player is in took to read.
+ * @param[in] world: relevant #QwalkWorld_t, whose current area was read.
+ * @return elapsed time in milliseconds.
+ */
+double
+qwalk_world_load_ms_get(const QwalkWorld_t *world) {
+	const QwalkWorldSlot_t *slot = &world->slots[world->slot_curr];
+
+	return ((double) (slot->load_end.tv_sec - slot->load_start.tv_sec) * 1000.0)
+		+ ((double) (slot->load_end.tv_nsec - slot->load_start.tv_nsec)
+				/ 1000000.0);
+}
+
+
+/**
+ * Start reading the areas across the edges the player is near.
+ * Those within #QWALK_WORLD_PREFETCH_DISTANCE of the player are read in the
+ * background, as is the one across a corner near both its edges, such that
+ * walking into them needn't wait. The current area counts as visited.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_world_prefetch(QwalkWorld_t *world) {
+	const QwalkArea_t *walk_area;
+	const QwalkLayer_t *layer;
+	int player_index;
+	int y;
+	int x;
+	int returnval = Q_OK;
+
+	if ((walk_area = qwalk_world_area_curr_get(world)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	world->slots[world->slot_curr].used = ++world->clock;
+
+	if (!world->ismapped) {
+		return Q_OK;
+	}
+	if ((player_index = qwalk_area_player_index_get(walk_area))
+			== Q_ERRORCODE_INT_NOTFOUND) {
+		return Q_OK;
+	}
+	layer = walk_area->layer_floater;
+	y = player_index / layer->size_x;
+	x = player_index % layer->size_x;
+
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			if (((dy == 0) && (dx == 0))
+					|| ((dy < 0) && (y >= QWALK_WORLD_PREFETCH_DISTANCE))
+					|| ((dy > 0) && (y < layer->size_y - QWALK_WORLD_PREFETCH_DISTANCE))
+					|| ((dx < 0) && (x >= QWALK_WORLD_PREFETCH_DISTANCE))
+					|| ((dx > 0) && (x < layer->size_x - QWALK_WORLD_PREFETCH_DISTANCE))) {
+				continue;
+			}
+			if (qwalk_world_slot_find(world, walk_area->meta_coord_y + dy,
+						walk_area->meta_coord_x + dx) != Q_ERRORCODE_INT_NOTFOUND) {
+				continue;
+			}
+			if (qwalk_world_area_load(world, walk_area->meta_coord_y + dy,
+						walk_area->meta_coord_x + dx) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				returnval = Q_ERROR;
+			}
+		}
+	}
+
+	return returnval;
+}
+
+
+/**
+ * Have a movement command take the player across an edge of its area.
+ * The area across is read right away, unless it already was in the
+ * background; see qwalk_world_prefetch(). The tiles the player left and
+ * entered are marked in the journals of their areas.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @param[in] walk_command: #QwalkCommand_t of the player.
+ * @return #Q_OK if the player entered another area, #Q_ERROR_NOCHANGE if
+ * @p walk_command doesn't lead off an edge, or there is no way across it, or
+ * #Q_ERROR.
+ */
+int
+qwalk_world_cross(QwalkWorld_t *world, QwalkCommand_t walk_command) {
+	QwalkWorldSlot_t *slot;
+	QwalkWorldSlot_t *slot_next;
+	QwalkArea_t *walk_area;
+	int player_index;
+	int y;
+	int x;
+	int dy = 0;
+	int dx = 0;
+	int s;
+	int r;
+
+	if ((walk_command < QWALK_COMMAND_MOVE_MIN)
+			|| (walk_command > QWALK_COMMAND_MOVE_MAX) || !world->ismapped) {
+		return Q_ERROR_NOCHANGE;
+	}
+	if ((walk_area = qwalk_world_area_curr_get(world)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if ((player_index = qwalk_area_player_index_get(walk_area))
+			== Q_ERRORCODE_INT_NOTFOUND) {
+		Q_ERRORFOUND(QERROR_ZERO_VALUE_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	switch (walk_command) {
+	case QWALK_COMMAND_MOVE_NORTH:
+		dy = QDIRECTION_MULTIPLIER_DEFAULT * QDIRECTION_NORTH_Y_MULTIPLICAND;
+		break;
+	case QWALK_COMMAND_MOVE_EAST:
+		dx = QDIRECTION_MULTIPLIER_DEFAULT * QDIRECTION_EAST_X_MULTIPLICAND;
+		break;
+	case QWALK_COMMAND_MOVE_SOUTH:
+		dy = QDIRECTION_MULTIPLIER_DEFAULT * QDIRECTION_SOUTH_Y_MULTIPLICAND;
+		break;
+	case QWALK_COMMAND_MOVE_WEST:
+		dx = QDIRECTION_MULTIPLIER_DEFAULT * QDIRECTION_WEST_X_MULTIPLICAND;
+		break;
+	default:
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return Q_ERROR;
+	}
+
+	/* moves staying within the area are left to the logic */
+	y = player_index / walk_area->layer_floater->size_x;
+	x = player_index % walk_area->layer_floater->size_x;
+	if (qwalk_logic_coords_arevalid(walk_area->layer_floater, y + dy, x + dx)) {
+		return Q_ERROR_NOCHANGE;
+	}
+
+	if ((s = qwalk_world_slot_find(world, walk_area->meta_coord_y + dy,
+					walk_area->meta_coord_x + dx)) == Q_ERRORCODE_INT_NOTFOUND) {
+		if (qwalk_world_area_load(world, walk_area->meta_coord_y + dy,
+					walk_area->meta_coord_x + dx) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		if ((s = qwalk_world_slot_find(world, walk_area->meta_coord_y + dy,
+						walk_area->meta_coord_x + dx)) == Q_ERRORCODE_INT_NOTFOUND) {
+			/* no room could be made for it */
+			return Q_ERROR_NOCHANGE;
+		}
+	}
+	slot = &world->slots[world->slot_curr];
+	slot_next = &world->slots[s];
+	if (qwalk_world_slot_join(slot_next) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (slot_next->state != QWALK_WORLD_SLOT_STATE_READY) {
+		return Q_ERROR_NOCHANGE;
+	}
+
+	if ((r = qwalk_logic_area_cross(walk_area, slot_next->area, walk_command))
+			!= Q_OK) {
+		if (r == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+		return r;
+	}
+
+	world->slot_curr = s;
+	slot_next->used = ++world->clock;
+	if ((qwalk_journal_mark(slot->journal, QWALK_LAYER_TYPE_FLOATER, player_index)
+				== Q_ERROR)
+			|| (qwalk_journal_mark(slot_next->journal, QWALK_LAYER_TYPE_FLOATER,
+					qwalk_area_player_index_get(slot_next->area)) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Save the journal of every area a #QwalkWorld_t holds.
+ * Unlike the saves made while playing, waits for every save to be committed,
+ * those queued earlier included.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @return #Q_OK, or #Q_ERROR if any save failed since the last call.
+ */
+int
+qwalk_world_save(QwalkWorld_t *world) {
+	int returnval = Q_OK;
+
+	for (int i = 0; i < QWALK_WORLD_CACHE_SIZE; i++) {
+		if (qwalk_world_slot_save(&world->slots[i]) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+	}
+
+	qwalk_world_saver_wait(&world->saver);
+	(void) pthread_mutex_lock(&world->saver.mutex);
+	if (world->saver.failc != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+		world->saver.failc = 0;
+	}
+	(void) pthread_mutex_unlock(&world->saver.mutex);
+
+	return returnval;
+}
+
+
+/**
+ * Save the journal of the area of a #QwalkWorld_t the player is in.
+ * The save is committed in the background; see #QwalkWorldSaver_t.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_world_curr_save(QwalkWorld_t *world) {
+	return qwalk_world_slot_save(&world->slots[world->slot_curr]);
+}
+
+
+/**
+ * Start reading the area at a pair of meta-coordinates into a free slot of a
+ * #QwalkWorld_t.
+ * The least recently visited area is dropped should no slot be free; if none
+ * can be, nothing is read. An area without a file is noted as missing.
+ * Should no thread start, the area is read right away instead.
+ * @param[in,out] world: relevant #QwalkWorld_t.
+ * @param[in] meta_coord_y: meta y coord of the area.
+ * @param[in] meta_coord_x: meta x coord of the area.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_world_area_load(QwalkWorld_t *world, int meta_coord_y, int meta_coord_x) {
+	QwalkWorldSlot_t *slot;
+	char filename[QFILE_MAX_PATH_SIZE + 1];
+	int s;
+
+	/* the first area is named by whoever created the world */
+	if (world->slots[world->slot_curr].state == QWALK_WORLD_SLOT_STATE_EMPTY) {
+		s = world->slot_curr;
+		strcpy(filename, world->slots[s].filename);
+	} else {
+		if (snprintf(filename, sizeof(filename), "%s/"
+					QWALK_WORLD_AREA_FILENAME_FORMAT, world->dirname, meta_coord_y,
+					meta_coord_x) >= (int) sizeof(filename)) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			return Q_ERROR;
+		}
+		if ((s = qwalk_world_slot_victim_get(world)) == Q_ERRORCODE_INT_NOTFOUND) {
+			return Q_OK;
+		}
+		if (qwalk_world_slot_evict(&world->slots[s]) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+	}
+	slot = &world->slots[s];
+
+	strcpy(slot->filename, filename);
+	slot->meta_coord_y = meta_coord_y;
+	slot->meta_coord_x = meta_coord_x;
+	slot->used = world->clock;
+
+	if (access(slot->filename, F_OK) != 0) {
+		slot->state = QWALK_WORLD_SLOT_STATE_MISSING;
+		return Q_OK;
+	}
+	if ((slot->journal = qwalk_journal_create(slot->filename)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		slot->state = QWALK_WORLD_SLOT_STATE_MISSING;
+		return Q_ERROR;
+	}
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &slot->load_start);
+	if (pthread_create(&slot->loader, NULL, qwalk_world_area_read, slot) == 0) {
+		slot->state = QWALK_WORLD_SLOT_STATE_LOADING;
+	} else {
+		slot->area = (QwalkArea_t *) qwalk_world_area_read(slot);
+		slot->state = (slot->area != NULL)
+			? QWALK_WORLD_SLOT_STATE_READY : QWALK_WORLD_SLOT_STATE_MISSING;
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Read the area of a #QwalkWorldSlot_t and replay its journal over it.
+ * Runs on @ref QwalkWorldSlot_t.loader, and thus only touches its own
+ * #QfileHandle_t and the members of @p arg the main thread leaves alone until
+ * the thread is joined.
+ * @param[in,out] arg: relevant #QwalkWorldSlot_t.
+ * @return new #QwalkArea_t, or @c NULL if it couldn't be read or its journal
+ * couldn't be replayed.
+ */
+void *
+qwalk_world_area_read(void *arg) {
+	QwalkWorldSlot_t *slot = (QwalkWorldSlot_t *) arg;
+	QfileHandle_t *handle;
+	QwalkArea_t *walk_area = NULL;
+
+	if ((handle = qfile_handle_open(slot->filename, QFILE_MODE_READ_MAPPED))
+			== NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	} else {
+		if ((walk_area = qwalk_area_handle_read(handle)) == NULL) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+		if (qfile_handle_close(handle) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+	}
+
+	/* saves of the area made before it was last dropped must be replayed too */
+	qwalk_world_saver_wait(slot->saver);
+
+	/* without its saves the area would silently go back in time; keep it out */
+	if ((walk_area != NULL)
+			&& (qwalk_journal_replay(slot->journal, walk_area) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_area_destroy(walk_area);
+		walk_area = NULL;
+	}
+
+	/*
+	 * the journal may have moved the players; checked once here, such that
+	 * ticks needn't check again
+	 */
+	if ((walk_area != NULL)
+			&& ((qwalk_area_players_track(walk_area) == Q_ERROR)
+				|| (qwalk_area_validate(walk_area) == Q_ERROR))) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_area_destroy(walk_area);
+		walk_area = NULL;
+	}
+	if (walk_area != NULL) {
+		walk_area->meta_coord_y = slot->meta_coord_y;
+		walk_area->meta_coord_x = slot->meta_coord_x;
+	}
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &slot->load_end);
+	return walk_area;
+}
+
+
+/**
+ * Wait for the area of a #QwalkWorldSlot_t to be read and take it.
+ * Does nothing unless the slot is #QWALK_WORLD_SLOT_STATE_LOADING.
+ * @param[in,out] slot: relevant #QwalkWorldSlot_t.
+ * @return #Q_OK, or #Q_ERROR if the area couldn't be read.
+ */
+int
+qwalk_world_slot_join(QwalkWorldSlot_t *slot) {
+	void *walk_area;
+
+	if (slot->state != QWALK_WORLD_SLOT_STATE_LOADING) {
+		return Q_OK;
+	}
+
+	if (pthread_join(slot->loader, &walk_area) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	if ((slot->area = (QwalkArea_t *) walk_area) == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		slot->state = QWALK_WORLD_SLOT_STATE_MISSING;
+		return Q_ERROR;
+	}
+	slot->state = QWALK_WORLD_SLOT_STATE_READY;
+	return Q_OK;
+}
+
+
+/**
+ * Empty a #QwalkWorldSlot_t, saving the journal of its area first.
+ * @param[in,out] slot: relevant #QwalkWorldSlot_t, which mustn't be
+ * #QWALK_WORLD_SLOT_STATE_LOADING.
+ * @return #Q_OK, or #Q_ERROR if the journal couldn't be saved, in which case
+ * the slot is left alone.
+ */
+int
+qwalk_world_slot_evict(QwalkWorldSlot_t *slot) {
+	if (qwalk_world_slot_save(slot) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if (slot->area != NULL) {
+		qwalk_area_destroy(slot->area);
+		slot->area = NULL;
+	}
+	if (slot->journal != NULL) {
+		qwalk_journal_destroy(slot->journal);
+		slot->journal = NULL;
+	}
+	slot->state = QWALK_WORLD_SLOT_STATE_EMPTY;
+	return Q_OK;
+}
+
+
+/**
+ * Save the journal of the area of a #QwalkWorldSlot_t in the background.
+ * The save is serialized right away and queued on @ref
+ * QwalkWorldSlot_t.saver, such that the area may go away at once. Does
+ * nothing unless the slot is #QWALK_WORLD_SLOT_STATE_READY.
+ * @param[in,out] slot: relevant #QwalkWorldSlot_t.
+ * @return #Q_OK, or #Q_ERROR if the save couldn't be serialized, in which case
+ * its marks are kept.
+ */
+int
+qwalk_world_slot_save(QwalkWorldSlot_t *slot) {
+	QfileHandle_t *handle;
+
+	if (slot->state != QWALK_WORLD_SLOT_STATE_READY) {
+		return Q_OK;
+	}
+	/*@-nullpass@*/
+	if (qwalk_journal_frame_get(slot->journal, slot->area, &handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	/*@=nullpass@*/
+	if ((handle != NULL)
+			&& (qwalk_world_saver_push(slot->saver, handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	return Q_OK;
+}
+
+
+/**
+ * Start the thread of a #QwalkWorldSaver_t.
+ * Should it not start, or its members not be set up, saves are committed
+ * right away instead.
+ * @param[out] saver: #QwalkWorldSaver_t to start.
+ */
+void
+qwalk_world_saver_start(QwalkWorldSaver_t *saver) {
+	saver->head = NULL;
+	saver->tail = NULL;
+	saver->pending = 0;
+	saver->failc = 0;
+	saver->isstopping = false;
+	saver->isrunning = false;
+
+	if (pthread_mutex_init(&saver->mutex, NULL) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	if ((pthread_cond_init(&saver->queued, NULL) != 0)
+			|| (pthread_cond_init(&saver->committed, NULL) != 0)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	saver->isrunning = (pthread_create(&saver->thread, NULL,
+				qwalk_world_saver_run, saver) == 0);
+	return;
+}
+
+
+/**
+ * Stop the thread of a #QwalkWorldSaver_t, once it committed every save.
+ * @param[in,out] saver: #QwalkWorldSaver_t to stop.
+ */
+void
+qwalk_world_saver_stop(QwalkWorldSaver_t *saver) {
+	if (saver->isrunning) {
+		(void) pthread_mutex_lock(&saver->mutex);
+		saver->isstopping = true;
+		(void) pthread_cond_signal(&saver->queued);
+		(void) pthread_mutex_unlock(&saver->mutex);
+		if (pthread_join(saver->thread, NULL) != 0) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			abort();
+		}
+		saver->isrunning = false;
+	}
+	(void) pthread_cond_destroy(&saver->committed);
+	(void) pthread_cond_destroy(&saver->queued);
+	(void) pthread_mutex_destroy(&saver->mutex);
+	return;
+}
+
+
+/**
+ * Queue a save on a #QwalkWorldSaver_t.
+ * @param[in,out] saver: relevant #QwalkWorldSaver_t.
+ * @param[in] handle: save from qwalk_journal_frame_get().
+ * @return #Q_OK, or #Q_ERROR if the save was committed right away and failed.
+ */
+int
+qwalk_world_saver_push(QwalkWorldSaver_t *saver, QfileHandle_t *handle) {
+	QwalkWorldSave_t *save;
+
+	if (!saver->isrunning
+			|| ((save = malloc(sizeof(*save))) == NULL)) {
+		return qfile_handle_close(handle);
+	}
+	save->next = NULL;
+	save->handle = handle;
+
+	(void) pthread_mutex_lock(&saver->mutex);
+	if (saver->tail == NULL) {
+		saver->head = save;
+	} else {
+		saver->tail->next = save;
+	}
+	saver->tail = save;
+	saver->pending++;
+	(void) pthread_cond_signal(&saver->queued);
+	(void) pthread_mutex_unlock(&saver->mutex);
+	return Q_OK;
+}
+
+
+/**
+ * Wait for a #QwalkWorldSaver_t to commit every save queued so far.
+ * @param[in,out] saver: relevant #QwalkWorldSaver_t.
+ */
+void
+qwalk_world_saver_wait(QwalkWorldSaver_t *saver) {
+	(void) pthread_mutex_lock(&saver->mutex);
+	while (saver->pending != 0) {
+		(void) pthread_cond_wait(&saver->committed, &saver->mutex);
+	}
+	(void) pthread_mutex_unlock(&saver->mutex);
+	return;
+}
+
+
+/**
+ * Commit the saves queued on a #QwalkWorldSaver_t, in order.
+ * Runs on @ref QwalkWorldSaver_t.thread until told to stop and no save is
+ * left. A save which fails to commit is counted in @ref
+ * QwalkWorldSaver_t.failc, and lost.
+ * @param[in,out] arg: relevant #QwalkWorldSaver_t.
+ * @return @c NULL.
+ */
+void *
+qwalk_world_saver_run(void *arg) {
+	QwalkWorldSaver_t *saver = (QwalkWorldSaver_t *) arg;
+	QwalkWorldSave_t *save;
+	int r;
+
+	(void) pthread_mutex_lock(&saver->mutex);
+	for (;;) {
+		while ((saver->head == NULL) && !saver->isstopping) {
+			(void) pthread_cond_wait(&saver->queued, &saver->mutex);
+		}
+		if ((save = saver->head) == NULL) {
+			break;
+		}
+		if ((saver->head = save->next) == NULL) {
+			saver->tail = NULL;
+		}
+
+		/* saves are only ever appended, so others may be queued meanwhile */
+		(void) pthread_mutex_unlock(&saver->mutex);
+		if ((r = qfile_handle_close(save->handle)) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+		}
+		free(save);
+		(void) pthread_mutex_lock(&saver->mutex);
+
+		if (r == Q_ERROR) {
+			saver->failc++;
+		}
+		saver->pending--;
+		(void) pthread_cond_broadcast(&saver->committed);
+	}
+	(void) pthread_mutex_unlock(&saver->mutex);
+	return NULL;
+}
+
+
+/**
+ * Find the #QwalkWorldSlot_t of the area at a pair of meta-coordinates.
+ * @param[in] world: relevant #QwalkWorld_t.
+ * @param[in] meta_coord_y: meta y coord of the area.
+ * @param[in] meta_coord_x: meta x coord of the area.
+ * @return index in @ref QwalkWorld_t.slots or #Q_ERRORCODE_INT_NOTFOUND.
+ */
+int
+qwalk_world_slot_find(const QwalkWorld_t *world, int meta_coord_y,
+		int meta_coord_x) {
+	for (int i = 0; i < QWALK_WORLD_CACHE_SIZE; i++) {
+		if ((world->slots[i].state != QWALK_WORLD_SLOT_STATE_EMPTY)
+				&& (world->slots[i].meta_coord_y == meta_coord_y)
+				&& (world->slots[i].meta_coord_x == meta_coord_x)) {
+			return i;
+		}
+	}
+	return Q_ERRORCODE_INT_NOTFOUND;
+}
+
+
+/**
+ * Pick the #QwalkWorldSlot_t of a #QwalkWorld_t to empty for another area.
+ * Empty slots come first, then missing areas, then the least recently
+ * visited one; the current area and those still being read are kept.
+ * @param[in] world: relevant #QwalkWorld_t.
+ * @return index in @ref QwalkWorld_t.slots or #Q_ERRORCODE_INT_NOTFOUND.
+ */
+int
+qwalk_world_slot_victim_get(const QwalkWorld_t *world) {
+	const QwalkWorldSlot_t *slot;
+	int victim = Q_ERRORCODE_INT_NOTFOUND;
+	int rank;
+	int rank_victim = 0;
+
+	for (int i = 0; i < QWALK_WORLD_CACHE_SIZE; i++) {
+		slot = &world->slots[i];
+		if ((i == world->slot_curr)
+				|| (slot->state == QWALK_WORLD_SLOT_STATE_LOADING)) {
+			continue;
+		}
+		if (slot->state == QWALK_WORLD_SLOT_STATE_EMPTY) {
+			return i;
+		}
+		rank = (slot->state == QWALK_WORLD_SLOT_STATE_MISSING) ? 2 : 1;
+		if ((rank > rank_victim) || ((rank == rank_victim)
+					&& (slot->used < world->slots[victim].used))) {
+			victim = i;
+			rank_victim = rank;
+		}
+	}
+
+	return victim;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file qwalks.c
+ * Program file for the spatial section of the qwalk module.
+ * Responsible for finding objects of a #QwalkLayer_t by where they are: within
+ * a rectangle, within a radius, or nearest to a point. The per-type bitsets of
+ * each @ref QwalkChunk_t.store already hold the position of every object of
+ * each type, and are kept current by every move or change of type; as objects
+ * of a chunk are numbered row by row, each row of a region is a contiguous
+ * span of those bitsets in every chunk it crosses. A query thus reads a word
+ * or two per row and chunk covered, rather than every object of the layer,
+ * and skips unpopulated chunks outright.
+ */
+
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <ncurses.h>
+
+#include "qdefs.h"
+#include "qerror.h"
+
+#include "splint_types.h"
+#include "qutils.h"
+#include "qattr.h"
+#include "dialogue.h"
+#include "qwalk.h"
+
+
+
+static int  qwalk_layer_span_query(const QwalkLayer_t *layer,
+		unsigned long keymask, /*@null@*/const QobjType_t *types, size_t typec,
+		int y, int x0, int x1, /*@out@*/int *indices)/*@modifies indices@*/;
+static void qwalk_layer_nearest_span_search(const QwalkLayer_t *layer,
+		QobjType_t type, int y, int x, int y_span, int x0, int x1,
+		int *index_bestp, int *distance_bestp)
+	/*@modifies index_bestp, distance_bestp@*/;
+static bool qwalk_layer_query_isvalid(const QwalkLayer_t *layer,
+		/*@null@*/const QobjType_t *types, size_t typec)/*@*/;
+static int  qwalk_radius_halfwidth_get(int radius, int dy)/*@*/;
+
+
+
+/**
+ * Find every object of a #QwalkLayer_t within a rectangle having some keys
+ * and being of some types.
+ * The rectangle is clipped to the layer, such that it may lie partly outside.
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the objects must have;
+ * 0 for any.
+ * @param[in] types: #QobjType_t the objects may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] y0: y coordinate of the top left corner.
+ * @param[in] x0: x coordinate of the top left corner.
+ * @param[in] y1: y coordinate of the bottom right corner, included.
+ * @param[in] x1: x coordinate of the bottom right corner, included.
+ * @param[out] indices: ascending index of each matching object; room for
+ * one per coordinate of the rectangle within the layer is needed.
+ * @return number of matching objects or #Q_ERRORCODE_INT.
+ */
+int
+qwalk_layer_rect_query(const QwalkLayer_t *layer, unsigned long keymask,
+		const QobjType_t *types, size_t typec, int y0, int x0, int y1, int x1,
+		int *indices) {
+	int indexc = 0;
+
+	if (!qwalk_layer_query_isvalid(layer, types, typec)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+
+	y0 = y0 < QWALK_LAYER_COORD_MINIMUM ? QWALK_LAYER_COORD_MINIMUM : y0;
+	x0 = x0 < QWALK_LAYER_COORD_MINIMUM ? QWALK_LAYER_COORD_MINIMUM : x0;
+	y1 = y1 >= layer->size_y ? layer->size_y - 1 : y1;
+	x1 = x1 >= layer->size_x ? layer->size_x - 1 : x1;
+
+	for (int y = y0; y <= y1; y++) {
+		indexc += qwalk_layer_span_query(layer, keymask, types, typec, y, x0,
+				x1, &indices[indexc]);
+	}
+
+	return indexc;
+}
+
+
+/**
+ * Find every object of a #QwalkLayer_t within a distance of a point having
+ * some keys and being of some types.
+ * Distances are those of qwalk_index_distance_get(), such that an object
+ * found here is one qwalk_dialogue() deems close enough when @p radius is
+ * #QWALK_DIALOGUE_DISTANCE_MAX.
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the objects must have;
+ * 0 for any.
+ * @param[in] types: #QobjType_t the objects may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] y: y coordinate of the point, which must be in the layer.
+ * @param[in] x: x coordinate of the point, which must be in the layer.
+ * @param[in] radius: greatest distance of an object from the point.
+ * @param[out] indices: ascending index of each matching object; room for
+ * one per coordinate within @p radius is needed.
+ * @return number of matching objects or #Q_ERRORCODE_INT.
+ */
+int
+qwalk_layer_radius_query(const QwalkLayer_t *layer, unsigned long keymask,
+		const QobjType_t *types, size_t typec, int y, int x, int radius,
+		int *indices) {
+	int indexc = 0;
+	int halfwidth;
+
+	if (!qwalk_layer_query_isvalid(layer, types, typec)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+	if ((!qwalk_logic_coords_arevalid(layer, y, x)) || (radius < 0)
+			|| (radius > layer->size_y + layer->size_x)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+
+	for (int dy = -radius; dy <= radius; dy++) {
+		if ((y + dy < QWALK_LAYER_COORD_MINIMUM) || (y + dy >= layer->size_y)) {
+			continue;
+		}
+		halfwidth = qwalk_radius_halfwidth_get(radius, dy);
+		indexc += qwalk_layer_span_query(layer, keymask, types, typec, y + dy,
+				x - halfwidth < QWALK_LAYER_COORD_MINIMUM
+					? QWALK_LAYER_COORD_MINIMUM : x - halfwidth,
+				x + halfwidth >= layer->size_x ? layer->size_x - 1 : x + halfwidth,
+				&indices[indexc]);
+	}
+
+	return indexc;
+}
+
+
+/**
+ * Find the object of a #QwalkLayer_t of a #QobjType_t nearest to a point,
+ * e.g. the NPC the player is most likely to want to speak to.
+ * Square rings around the point are searched outwards, and the search stops
+ * as soon as no ring left may hold anything nearer than what was found.
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] type: #QobjType_t of the object.
+ * @param[in] y: y coordinate of the point, which must be in the layer.
+ * @param[in] x: x coordinate of the point, which must be in the layer.
+ * @param[in] radius_max: greatest distance of the object from the point.
+ * @return index of the object, lowest among equally near ones;
+ * #Q_ERRORCODE_INT_NOTFOUND if there is none within @p radius_max; or
+ * #Q_ERRORCODE_INT.
+ */
+int
+qwalk_layer_nearest_get(const QwalkLayer_t *layer, QobjType_t type, int y,
+		int x, int radius_max) {
+	int index_best = Q_ERRORCODE_INT_NOTFOUND;
+	int distance_best = radius_max;
+
+	if (!qwalk_layer_query_isvalid(layer, &type, (size_t) 1)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+	if ((!qwalk_logic_coords_arevalid(layer, y, x)) || (radius_max < 0)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+
+	/* nothing in ring r is nearer than r */
+	for (int r = 0; (r <= distance_best)
+			&& (r < layer->size_y + layer->size_x); r++) {
+		for (int dy = -r; dy <= r; dy++) {
+			if ((dy == -r) || (dy == r)) {
+				qwalk_layer_nearest_span_search(layer, type, y, x, y + dy,
+						x - r, x + r, &index_best, &distance_best);
+			} else {
+				qwalk_layer_nearest_span_search(layer, type, y, x, y + dy,
+						x - r, x - r, &index_best, &distance_best);
+				qwalk_layer_nearest_span_search(layer, type, y, x, y + dy,
+						x + r, x + r, &index_best, &distance_best);
+			}
+		}
+	}
+
+	return index_best;
+}
+
+
+/**
+ * Find the distance between two indices of a #QwalkLayer_t.
+ * @param[in] layer: #QwalkLayer_t of the indices.
+ * @param[in] index_a: first index.
+ * @param[in] index_b: second index.
+ * @return distance, as by qutils_distance_calculate(), or #Q_ERRORCODE_INT.
+ */
+int
+qwalk_index_distance_get(const QwalkLayer_t *layer, int index_a,
+		int index_b) {
+	if ((index_a < QWALK_LAYER_COORD_MINIMUM)
+			|| (index_a >= layer->size_y * layer->size_x)
+			|| (index_b < QWALK_LAYER_COORD_MINIMUM)
+			|| (index_b >= layer->size_y * layer->size_x)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+
+	return qutils_distance_calculate(
+			index_a / layer->size_x, index_a % layer->size_x,
+			index_b / layer->size_x, index_b % layer->size_x);
+}
+
+
+/**
+ * Find every object of a #QwalkLayer_t within a span of a row having some
+ * keys and being of some types.
+ * The span is searched chunk by chunk; unpopulated chunks hold nothing.
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the objects must have.
+ * @param[in] types: #QobjType_t the objects may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] y: y coordinate of the row; nothing is found outside the layer.
+ * @param[in] x0: x coordinate of the start of the span.
+ * @param[in] x1: x coordinate of the end of the span, included.
+ * @param[out] indices: ascending index of each matching object.
+ * @return number of matching objects.
+ */
+int
+qwalk_layer_span_query(const QwalkLayer_t *layer, unsigned long keymask,
+		const QobjType_t *types, size_t typec, int y, int x0, int x1,
+		int *indices) {
+	const QwalkChunk_t *chunk;
+	int indexc = 0;
+	int row;
+	int chunk_x0;
+	size_t local, end;
+
+	if ((y < QWALK_LAYER_COORD_MINIMUM) || (y >= layer->size_y)
+			|| (x0 < QWALK_LAYER_COORD_MINIMUM) || (x1 >= layer->size_x)
+			|| (x0 > x1)) {
+		return 0;
+	}
+
+	row = (y % QWALK_CHUNK_SIZE_Y) * QWALK_CHUNK_SIZE_X;
+	for (int cx = x0 / QWALK_CHUNK_SIZE_X; cx <= x1 / QWALK_CHUNK_SIZE_X; cx++) {
+		chunk = layer->chunks[((y / QWALK_CHUNK_SIZE_Y) * layer->chunkc_x) + cx];
+		if (chunk == NULL) {
+			continue;
+		}
+		chunk_x0 = cx * QWALK_CHUNK_SIZE_X;
+		local = (size_t) (row + (x0 > chunk_x0 ? x0 - chunk_x0 : 0));
+		end = (size_t) (row + (x1 < chunk_x0 + QWALK_CHUNK_SIZE_X - 1
+					? x1 - chunk_x0 : QWALK_CHUNK_SIZE_X - 1) + 1);
+		while ((local = qattr_store_query_next(chunk->store, keymask, types,
+							typec, local, end)) < end) {
+			indices[indexc++] = (y * layer->size_x) + chunk_x0
+				+ ((int) local++ % QWALK_CHUNK_SIZE_X);
+		}
+	}
+
+	return indexc;
+}
+
+
+/**
+ * Look for an object nearer to a point than the best one found so far within
+ * a span of a row, for qwalk_layer_nearest_get().
+ * The span is clipped to the layer and searched a chunk at a time.
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] type: #QobjType_t of the object.
+ * @param[in] y: y coordinate of the point.
+ * @param[in] x: x coordinate of the point.
+ * @param[in] y_span: y coordinate of the row.
+ * @param[in] x0: x coordinate of the start of the span.
+ * @param[in] x1: x coordinate of the end of the span, included.
+ * @param[in,out] index_bestp: index of the best object so far, or
+ * #Q_ERRORCODE_INT_NOTFOUND.
+ * @param[in,out] distance_bestp: its distance, or the greatest one allowed.
+ */
+void
+qwalk_layer_nearest_span_search(const QwalkLayer_t *layer, QobjType_t type,
+		int y, int x, int y_span, int x0, int x1, int *index_bestp,
+		int *distance_bestp) {
+	int found[QWALK_CHUNK_SIZE_X];
+	int foundc;
+	int distance;
+	int x_end;
+
+	x0 = x0 < QWALK_LAYER_COORD_MINIMUM ? QWALK_LAYER_COORD_MINIMUM : x0;
+	x1 = x1 >= layer->size_x ? layer->size_x - 1 : x1;
+
+	for (; x0 <= x1; x0 = x_end + 1) {
+		x_end = ((x0 / QWALK_CHUNK_SIZE_X) * QWALK_CHUNK_SIZE_X)
+			+ QWALK_CHUNK_SIZE_X - 1;
+		x_end = x_end > x1 ? x1 : x_end;
+		foundc = qwalk_layer_span_query(layer, 0, &type, (size_t) 1, y_span,
+				x0, x_end, found);
+
+		for (int i = 0; i < foundc; i++) {
+			distance = qutils_distance_calculate(y, x,
+					found[i] / layer->size_x, found[i] % layer->size_x);
+			if ((distance < *distance_bestp) || ((distance == *distance_bestp)
+						&& ((*index_bestp == Q_ERRORCODE_INT_NOTFOUND)
+							|| (found[i] < *index_bestp)))) {
+				*distance_bestp = distance;
+				*index_bestp = found[i];
+			}
+		}
+	}
+
+	return;
+}
+
+
+/**
+ * Tell whether a spatial query may be run on a #QwalkLayer_t.
+ * @param[in] layer: #QwalkLayer_t to search, which must be complete.
+ * @param[in] types: #QobjType_t to search for, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @return whether @p layer is complete and each of @p types is valid.
+ */
+bool
+qwalk_layer_query_isvalid(const QwalkLayer_t *layer, const QobjType_t *types,
+		size_t typec) {
+	if (!qwalk_layer_iscomplete(layer)) {
+		return false;
+	}
+	for (size_t i = 0; (types != NULL) && (i < typec); i++) {
+		if ((types[i] < (QobjType_t) Q_ENUM_VALUE_START)
+				|| (types[i] > QOBJ_TYPE_COUNT)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Find how far a row of a circle reaches to each side of its centre.
+ * @param[in] radius: radius of the circle.
+ * @param[in] dy: offset of the row from the centre, within @p radius.
+ * @return greatest x offset within @p radius on the row, as by
+ * qutils_distance_calculate(), which truncates.
+ */
+int
+qwalk_radius_halfwidth_get(int radius, int dy) {
+	int halfwidth = radius;
+
+	while ((halfwidth > 0) && ((dy * dy) + (halfwidth * halfwidth)
+				>= (radius + 1) * (radius + 1))) {
+		halfwidth--;
+	}
+
+	return halfwidth;
+}
@@ -3,11 +3,14 @@
  * Program file for the wrapper section of the qwalk module.
  */
 
+#include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
 #include <ncurses.h>
 
 #include "qdefs.h"
@@ -17,6 +20,7 @@
 #include "qutils.h"
 #include "mode.h"
 #include "qattr.h"
+#include "qarena.h"
 #include "qfile.h"
 #include "qwins.h"
 #include "dialogue.h"
@@ -25,8 +29,8 @@
 
 
 
-/** Pointer to current #QwalkLayer_t */
-/*@only@*//*@null@*/static QwalkArea_t *walk_area_curr = NULL;
+/** Pointer to current #QwalkLayer_t, held by #walk_world. */
+/*@dependent@*//*@null@*/static QwalkArea_t *walk_area_curr = NULL;
 
 /** Whether the qwalk module is currently initialized  */
 static bool          isinit = false; 
@@ -38,12 +42,47 @@ static bool          isinit = false;
 /** #Qwindow_t for the environment log. */
 /*@only@*//*@null@*/static Qwindow_t *walk_environment_log_win = NULL;
 
+/** World #walk_area_curr is part of, holding its neighbours and journals. */
+/*@only@*//*@null@*/static struct QwalkWorld_t *walk_world = NULL;
+/** Whether the first area of #walk_world has yet to be waited for. */
+static bool          isloading = false;
+
+/** Ticks passed since the journal of #walk_area_curr was last saved. */
+static int           walk_journal_ticks = 0;
+
+/**
+ * @defgroup WalkLoaderTiming Area loading timestamps
+ * Timestamps of the startup phases, for the report of qwalk_area_load_join().
+ * @{
+ */
+
+/** When qwalk_init() started reading the first area.          */
+static struct timespec walk_loader_start;
+/** When qwalk_init() finished setting up the windows.          */
+static struct timespec walk_setup_end;
+
+/** @} */
+
+
+
+static int     qwalk_area_load_join(void)
+	/*@modifies walk_area_curr, walk_world, isloading@*/;
+static double  qwalk_timespec_ms(const struct timespec *start,
+		const struct timespec *end)/*@*/;
+static int     qwalk_journal_curr_mark(const QwalkLayer_t *layer, int index)
+	/*@modifies walk_world@*/;
+static /*@null@*//*@dependent@*/QwalkChunk_t *qwalk_layer_chunk_populate(
+		QwalkLayer_t *layer, int y, int x)/*@modifies layer@*/;
+
 
 
 /**
  * Initialize the qwalk module.
  * Upon a successful inititialization, set #isinit to @c true. #walk_area_curr
- * is updated.
+ * is read in the background by #walk_world, such that the windows are set up
+ * while the area is being decoded; it is only waited for by the first
+ * qwalk_tick(). The edits saved to the journal of the area in earlier
+ * sessions are replayed over it.
  * @param[in] area_filename: filename of the file where the #QwalkArea_t is
  * saved.
  * @return #Q_OK or #Q_ERROR
@@ -60,27 +99,20 @@ qwalk_init(const char *area_filename)/*@modifies walk_area_curr, isinit@*/{
 
 	isinit = true;
 
-	if (walk_area_curr != NULL) {
+	if ((walk_area_curr != NULL) || (walk_world != NULL)) {
 		Q_ERRORFOUND(QERROR_NONNULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
 
 
 	/* deal with logic initializations */
-	if (qfile_open(area_filename, QFILE_MODE_READ) == Q_ERROR) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return Q_ERROR;
-	}
-
-	if ((walk_area_curr = qwalk_area_read()) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return Q_ERROR;
-	}
-
-	if (qfile_close() == Q_ERROR) {
+	(void) clock_gettime(CLOCK_MONOTONIC, &walk_loader_start);
+	if ((walk_world = qwalk_world_create(area_filename)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
 	}
+	isloading = true;
+	walk_journal_ticks = 0;
 
 
 	/* deal with I/O initializations */
@@ -101,12 +133,15 @@ qwalk_init(const char *area_filename)/*@modifies walk_area_curr, isinit@*/{
 		}
 	}
 
+	(void) clock_gettime(CLOCK_MONOTONIC, &walk_setup_end);
 	return returnval;
 }
 
 
 /**
  * Safely exit the qwalk module.
+ * The edits made to every area #walk_world holds are saved to their journals
+ * beforehand.
  * @return #Q_OK or #Q_ERROR
  */ 
 int
@@ -122,7 +157,11 @@ qwalk_end() {
 		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
 	}
 
-	if (walk_area_curr == NULL) {
+	if (qwalk_area_load_join() == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+
+	if ((walk_area_curr == NULL) || (walk_world == NULL)) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
@@ -135,23 +174,12 @@ qwalk_end() {
 
 
 	/* logic cleanup */
-	if (walk_area_curr->layer_earth == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		returncode = Q_ERROR;
-	} else {
-		qwalk_layer_destroy(walk_area_curr->layer_earth);
-		walk_area_curr->layer_earth = NULL;
-	}
-
-	if (walk_area_curr->layer_floater == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+	if (qwalk_world_save(walk_world) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returncode = Q_ERROR;
-	} else {
-		qwalk_layer_destroy(walk_area_curr->layer_floater);
-		walk_area_curr->layer_floater = NULL;
 	}
-
-	free(walk_area_curr);
+	qwalk_world_destroy(walk_world);
+	walk_world = NULL;
 
 
 	/* I/O cleanup */
@@ -172,7 +200,10 @@ qwalk_end() {
 /**
  * Pass a tick in qwalk.
  * Works in the order: output -> input -> logic
- * executing the mode for the next tick.
+ * executing the mode for the next tick. A move off an edge of #walk_area_curr
+ * leads into the area across it in #walk_world, and the areas the player
+ * nears are then read ahead of time. Every #QWALK_JOURNAL_AUTOSAVE_TICKS
+ * ticks, the edits made to #walk_area_curr are saved to its journal.
  * @return #Q_OK or #Q_ERROR
  */
 int
@@ -183,8 +214,15 @@ qwalk_tick() {
 	int returnval = Q_OK;
 
 	int player_index;
+	int player_index_new;
+	int target_index;
 
-	if (walk_area_curr == NULL) {
+	if (qwalk_area_load_join() == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+
+	if ((walk_area_curr == NULL) || (walk_world == NULL)) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
@@ -225,16 +263,22 @@ qwalk_tick() {
 		return Q_ERROR;
 	}
 
-	if ((player_index = qwalk_layer_obj_index_get(
-					layer_floater, QOBJ_TYPE_PLAYER)) == Q_ERRORCODE_INT) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return Q_ERROR;
-	} else if (player_index == Q_ERRORCODE_INT_NOTFOUND) {
+	if ((player_index = qwalk_area_player_index_get(walk_area_curr))
+			== Q_ERRORCODE_INT_NOTFOUND) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		return Q_ERROR;
 	}
 
-	cmd = qwalk_input_subtick(player_index);
+	/* have the selection for interacting start on the nearest friendly NPC */
+	if ((target_index = qwalk_layer_nearest_get(layer_floater,
+					QOBJ_TYPE_NPC_FRIENDLY, player_index / layer_floater->size_x,
+					player_index % layer_floater->size_x,
+					QWALK_DIALOGUE_DISTANCE_MAX)) == Q_ERRORCODE_INT) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		target_index = Q_ERRORCODE_INT_NOTFOUND;
+	}
+
+	cmd = qwalk_input_subtick(layer_floater, player_index, target_index);
 	if (cmd == (QwalkCommand_t) Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return Q_ERROR;
@@ -244,17 +288,137 @@ qwalk_tick() {
 		return Q_ERROR;
 	}
 
-	r = qwalk_logic_subtick(walk_area_curr, cmd);
-	if (r == Q_ERROR) {
+	/* the world marks the tiles of a move into another area by itself */
+	if ((r = qwalk_world_cross(walk_world, cmd)) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return Q_ERROR;
+	}
+	if (r == Q_OK) {
+		if ((walk_area_curr = qwalk_world_area_curr_get(walk_world)) == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			return Q_ERROR;
+		}
+	} else if ((r = qwalk_logic_subtick(walk_area_curr, cmd)) == Q_ERROR) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
 
+	/* a move trades the places of the player and whatever was there */
+	if ((layer_floater == walk_area_curr->layer_floater)
+			&& ((player_index_new = qwalk_area_player_index_get(walk_area_curr)) >= 0)
+			&& (player_index_new != player_index)) {
+		if ((qwalk_journal_curr_mark(layer_floater, player_index) == Q_ERROR)
+				|| (qwalk_journal_curr_mark(layer_floater, player_index_new)
+					== Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+	}
+
+	if (qwalk_world_prefetch(walk_world) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		returnval = Q_ERROR;
+	}
+
+	if (++walk_journal_ticks >= QWALK_JOURNAL_AUTOSAVE_TICKS) {
+		if (qwalk_world_curr_save(walk_world) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			returnval = Q_ERROR;
+		}
+		walk_journal_ticks = 0;
+	}
+
 
 	return returnval;
 }
 
 
+/**
+ * Wait for the first area of #walk_world to be read and take it.
+ * Does nothing if it already was. If the #QWALK_TIMING_ENV environment
+ * variable is set, a report of how long the area took to load, how long the
+ * windows took to set up meanwhile, and how long was spent waiting here is
+ * printed to @c stderr.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_load_join() {
+	struct timespec join_start;
+	struct timespec join_end;
+
+	if (!isloading) {
+		return Q_OK;
+	}
+	if (walk_world == NULL) {
+		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
+		return Q_ERROR;
+	}
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &join_start);
+	walk_area_curr = qwalk_world_area_curr_get(walk_world);
+	(void) clock_gettime(CLOCK_MONOTONIC, &join_end);
+	isloading = false;
+
+	if (walk_area_curr == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		return Q_ERROR;
+	}
+
+	if (getenv(QWALK_TIMING_ENV) != NULL) {
+		(void) fprintf(stderr,
+				"qwalk: area loaded in %.3f ms, windows set up in %.3f ms, "
+				"waited %.3f ms\n",
+				qwalk_world_load_ms_get(walk_world),
+				qwalk_timespec_ms(&walk_loader_start, &walk_setup_end),
+				qwalk_timespec_ms(&join_start, &join_end));
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Get the time elapsed between two timestamps.
+ * @param[in] start: earlier timestamp.
+ * @param[in] end: later timestamp.
+ * @return elapsed time in milliseconds.
+ */
+double
+qwalk_timespec_ms(const struct timespec *start, const struct timespec *end) {
+	return ((double) (end->tv_sec - start->tv_sec) * 1000.0)
+		+ ((double) (end->tv_nsec - start->tv_nsec) / 1000000.0);
+}
+
+
+/**
+ * Mark an object of #walk_area_curr as edited in its journal.
+ * @param[in] layer: layer of #walk_area_curr the object is on.
+ * @param[in] index: index of the object in @p layer.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_journal_curr_mark(const QwalkLayer_t *layer, int index) {
+	QwalkLayerType_t type;
+
+	if ((walk_area_curr == NULL) || (walk_world == NULL)) {
+		Q_ERRORFOUND(QERROR_MODULE_UNINITIALIZED);
+		return Q_ERROR;
+	}
+
+	if (layer == walk_area_curr->layer_earth) {
+		type = QWALK_LAYER_TYPE_EARTH;
+	} else if (layer == walk_area_curr->layer_floater) {
+		type = QWALK_LAYER_TYPE_FLOATER;
+	} else {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return Q_ERROR;
+	}
+
+	return qwalk_journal_mark(qwalk_world_journal_curr_get(walk_world), type,
+			index);
+}
+
+
 /**
  * Wrapper function for qwalk to interface with dialogue.
  * @param[out] layer: #QwalkLayer_t with an NPC to speak to.
@@ -271,26 +435,12 @@ qwalk_dialogue(QwalkLayer_t *layer, int player_index, int npc_index) {
 	char *dialogue_filename;
 
 	/* find distance between player and NPC */
-	int *player_coords, *npc_coords;
 	int distance;
-	if ((player_coords = qwalk_index_to_coords(player_index)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return Q_ERROR;
-	}
-	if ((npc_coords = qwalk_index_to_coords(npc_index)) == NULL) {
+	if ((distance = qwalk_index_distance_get(layer, player_index, npc_index))
+			== Q_ERRORCODE_INT) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
-		free(player_coords);
 		return Q_ERROR;
 	}
-	if ((distance = qutils_distance_calculate(player_coords[0], player_coords[1],
-					npc_coords[0], npc_coords[1])) == Q_ERRORCODE_INT) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
-		free(player_coords);
-		free(npc_coords);
-		return Q_ERROR;
-	}
-	free(player_coords);
-	free(npc_coords);
 	if (distance > QWALK_DIALOGUE_DISTANCE_MAX) {
 		if (qwalk_log_print(QWALK_EXCESSIVE_DISTANCE_LOG_MESSAGE) == Q_ERROR) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -400,6 +550,16 @@ qwalk_dialogue_command_handler(QwalkLayer_t *layer, int index,
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			return Q_ERROR;
 		}
+		if (qwalk_journal_curr_mark(layer, index) == Q_ERROR) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
+		/* a player may have come or gone */
+		if ((walk_area_curr != NULL) && (layer == walk_area_curr->layer_floater)
+				&& (qwalk_area_players_track(walk_area_curr) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			return Q_ERROR;
+		}
 		break;
 
 	default:
@@ -491,10 +651,148 @@ qwalk_area_create(QwalkLayer_t *layer_earth, QwalkLayer_t *layer_floater) {
 	walk_area->layer_earth   = layer_earth;
 	walk_area->layer_floater = layer_floater;
 
+	/* too many players is only fatal upon loading; see qwalk_area_validate() */
+	if (qwalk_area_players_track(walk_area) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+	}
+
 	return walk_area;
 }
 
 
+/**
+ * Check the invariants the logic of a #QwalkArea_t relies on.
+ * Both layers must have the same dimensions; every object of their populated
+ * chunks must be set, lie at the coordinates of its index, and have a valid
+ * #QATTR_KEY_QOBJECT_TYPE; every object tracked in @ref
+ * QwalkArea_t.player_indices must be a player. An area may hold no player at
+ * all, as one of a world the player has yet to walk into does; see
+ * #QwalkWorld_t. These are upheld by every setter afterwards,
+ * such that an area need only be checked upon loading, rather than on each
+ * tick.
+ * @param[in] walk_area: #QwalkArea_t to check.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_validate(const QwalkArea_t *walk_area) {
+	const QwalkLayer_t *layers[2];
+	const QwalkLayer_t *layer;
+	const QwalkChunk_t *chunk;
+	int index;
+
+	layers[0] = walk_area->layer_earth;
+	layers[1] = walk_area->layer_floater;
+
+	for (int l = 0; l < 2; l++) {
+		if ((layer = layers[l]) == NULL) {
+			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+			return Q_ERROR;
+		}
+		if ((layer->size_y != layers[0]->size_y)
+				|| (layer->size_x != layers[0]->size_x)) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			return Q_ERROR;
+		}
+		if (!qwalk_layer_iscomplete(layer)) {
+			Q_ERRORFOUND(QERROR_STRUCT_INCOMPLETE);
+			return Q_ERROR;
+		}
+
+		for (int c = 0; c < layer->chunkc_y * layer->chunkc_x; c++) {
+			if ((chunk = layer->chunks[c]) == NULL) {
+				continue;
+			}
+			for (int i = 0; i < QWALK_CHUNK_SIZE; i++) {
+				/* tiles past the edge are never set */
+				if ((index = qwalk_layer_chunk_index_get(layer, c, i))
+						== Q_ERRORCODE_INT_NOTFOUND) {
+					continue;
+				}
+				if (chunk->objects[i].attr_list == NULL) {
+					Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+					return Q_ERROR;
+				}
+				if ((chunk->objects[i].coord_y != index / layer->size_x)
+						|| (chunk->objects[i].coord_x != index % layer->size_x)) {
+					Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+					return Q_ERROR;
+				}
+				/* the store only takes in valid types */
+				if (qattr_store_type_get(chunk->store, (size_t) i)
+						== (QobjType_t) Q_ERRORCODE_ENUM) {
+					Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+					return Q_ERROR;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < walk_area->playerc; i++) {
+		if (qwalk_layer_object_type_get(walk_area->layer_floater,
+					walk_area->player_indices[i]) != QOBJ_TYPE_PLAYER) {
+			Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+			return Q_ERROR;
+		}
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Find every #QOBJ_TYPE_PLAYER object of a #QwalkArea_t anew.
+ * Needed only after the floater layer was altered other than by moving a
+ * player, e.g. by replaying a journal; the first player, chunk by chunk,
+ * becomes the active one.
+ * @param[out] walk_area: relevant #QwalkArea_t.
+ * @return #Q_OK, or #Q_ERROR if there are more than #QWALK_AREA_PLAYERC_MAX
+ * players, in which case only the first ones are tracked.
+ */
+int
+qwalk_area_players_track(QwalkArea_t *walk_area) {
+	const QwalkLayer_t *layer = walk_area->layer_floater;
+	const QwalkChunk_t *chunk;
+	const QobjType_t type = QOBJ_TYPE_PLAYER;
+	size_t local;
+
+	walk_area->playerc = 0;
+	walk_area->player_active = 0;
+	for (int c = 0; c < layer->chunkc_y * layer->chunkc_x; c++) {
+		if ((chunk = layer->chunks[c]) == NULL) {
+			continue;
+		}
+		local = 0;
+		while ((local = qattr_store_query_next(chunk->store, 0, &type,
+							(size_t) 1, local, (size_t) QWALK_CHUNK_SIZE))
+				< (size_t) QWALK_CHUNK_SIZE) {
+			if (walk_area->playerc == QWALK_AREA_PLAYERC_MAX) {
+				Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+				return Q_ERROR;
+			}
+			walk_area->player_indices[walk_area->playerc++] =
+				qwalk_layer_chunk_index_get(layer, c, (int) local++);
+		}
+	}
+
+	return Q_OK;
+}
+
+
+/**
+ * Get the index of the active player of a #QwalkArea_t.
+ * @param[in] walk_area: relevant #QwalkArea_t.
+ * @return index in @ref QwalkArea_t.layer_floater, or
+ * #Q_ERRORCODE_INT_NOTFOUND if the area has no player.
+ */
+int
+qwalk_area_player_index_get(const QwalkArea_t *walk_area) {
+	if (walk_area->playerc == 0) {
+		return Q_ERRORCODE_INT_NOTFOUND;
+	}
+	return walk_area->player_indices[walk_area->player_active];
+}
+
+
 /**
  * Recursively destroy a #QwalkArea_t.
  * @param[out] walk_area: #QwalkArea_t to destroy.
@@ -503,19 +801,39 @@ void
 qwalk_area_destroy(QwalkArea_t *walk_area) {
 	qwalk_layer_destroy(walk_area->layer_floater);
 	qwalk_layer_destroy(walk_area->layer_earth);
+	/* the layers may have held views into the storage; release it last */
+	if (walk_area->storage != NULL) {
+		qfile_buffer_release(walk_area->storage);
+	}
+	if (walk_area->strings != NULL) {
+		qfile_string_store_destroy(walk_area->strings);
+	}
 	free(walk_area);
 	return;
 }
 
 
 /**
- * Write a #QwalkArea_t to storage.
- * Follows the order #QwalkArea_t.layer_earth, #QwalkArea_t.layer_floater.
+ * Write a #QwalkArea_t to the file opened via qfile_open().
+ * @see qwalk_area_handle_write().
  * @param[in] walk_area: #QwalkArea_t to write
  * @return #Q_OK or #Q_ERROR.
  */
 int
 qwalk_area_write(const QwalkArea_t *walk_area) {
+	return qwalk_area_handle_write(qfile_handle_default_get(), walk_area);
+}
+
+
+/**
+ * Write a #QwalkArea_t to a #QfileHandle_t.
+ * Follows the order #QwalkArea_t.layer_earth, #QwalkArea_t.layer_floater.
+ * @param[out] handle: #QfileHandle_t to write to.
+ * @param[in] walk_area: #QwalkArea_t to write
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_area_handle_write(QfileHandle_t *handle, const QwalkArea_t *walk_area) {
 	int r;
 	int returnval = Q_OK;
 	
@@ -524,13 +842,13 @@ qwalk_area_write(const QwalkArea_t *walk_area) {
 		return Q_ERROR;
 	}
 	
-	r = qwalk_layer_write(walk_area->layer_earth);
+	r = qwalk_layer_handle_write(handle, walk_area->layer_earth);
 	if (r != Q_OK) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returnval = Q_ERROR;
 	}
 	
-	r = qwalk_layer_write(walk_area->layer_floater);
+	r = qwalk_layer_handle_write(handle, walk_area->layer_floater);
 	if (r != Q_OK) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		returnval = Q_ERROR;
@@ -541,23 +859,56 @@ qwalk_area_write(const QwalkArea_t *walk_area) {
 
 
 /**
- * Read a #QwalkArea_t from storage.
- * Follows the order #QwalkArea_t.layer_earth, #QwalkArea_t.layer_floater.
+ * Read a #QwalkArea_t from the file opened via qfile_open().
+ * @see qwalk_area_handle_read().
  * @return new #QwalkArea_t
  */
 QwalkArea_t *
 qwalk_area_read() {
+	return qwalk_area_handle_read(qfile_handle_default_get());
+}
+
+
+/**
+ * Read a #QwalkArea_t from a #QfileHandle_t.
+ * Follows the order #QwalkArea_t.layer_earth, #QwalkArea_t.layer_floater.
+ * Columnar files are recognized by their magic number and handed to
+ * qwalk_area_v2_handle_read(). Otherwise, if @p handle is mapped, cold values
+ * are left in the map until first accessed, and the map is then handed over to
+ * @ref QwalkArea_t.storage; nothing more may thus be read from @p handle.
+ * @param[in,out] handle: #QfileHandle_t to read from.
+ * @return new #QwalkArea_t
+ */
+QwalkArea_t *
+qwalk_area_handle_read(QfileHandle_t *handle) {
 	QwalkArea_t *walk_area;
 	QwalkLayer_t *layer_earth;
 	QwalkLayer_t *layer_floater;
+	struct QfileStringStore_t *store_prev;
+	struct QfileStringStore_t *strings;
+	bool isdeferring;
+
+	if (qwalk_area_file_handle_isv2(handle)) {
+		return qwalk_area_v2_handle_read(handle);
+	}
 
-	layer_earth = qwalk_layer_read();
+	/* strings of the area, deferred ones included, go away along with it */
+	if ((strings = qfile_string_store_create()) == NULL) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		abort();
+	}
+	store_prev = handle->store;
+	qfile_handle_store_set(handle, strings);
+
+	isdeferring = qfile_handle_defer_begin(handle);
+
+	layer_earth = qwalk_layer_handle_read(handle);
 	if (layer_earth == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		abort();
 	}
 	
-	layer_floater = qwalk_layer_read();
+	layer_floater = qwalk_layer_handle_read(handle);
 	if (layer_floater == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		abort();
@@ -569,6 +920,15 @@ qwalk_area_read() {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		abort();
 	}
+	walk_area->strings = strings;
+	qfile_handle_store_set(handle, store_prev);
+
+	/* deferred values point into the map, so it must live as long as they do */
+	if (isdeferring
+			&& ((walk_area->storage = qfile_handle_buffer_detach(handle)) == NULL)) {
+		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
+		abort();
+	}
 
 	return walk_area;
 }
@@ -613,59 +973,111 @@ QwalkLayer_t
 
 
 /**
- * Create an empty #QwalkLayer_t and set its contents to @c NULL.
+ * Create an empty #QwalkLayer_t of given dimensions.
+ * None of its chunks are populated yet; see qwalk_layer_object_set().
+ * @param[in] size_y: @ref QwalkLayer_t.size_y.
+ * @param[in] size_x: @ref QwalkLayer_t.size_x.
  * @return new #QwalkLayer_t or @c NULL upon failure.
- * @allocs{2} for the new walk_layer and its objects member
+ * @allocs{2} for the new walk_layer and its chunk table.
  */
 QwalkLayer_t *
-qwalk_layer_create() {
+qwalk_layer_create(int size_y, int size_x) {
 	QwalkLayer_t *walk_layer;
+
+	if ((size_y <= 0) || (size_y > QWALK_LAYER_DIMENSION_MAX)
+			|| (size_x <= 0) || (size_x > QWALK_LAYER_DIMENSION_MAX)
+			|| (size_y > INT_MAX / size_x)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
+
 	walk_layer = calloc((size_t) 1, sizeof(*walk_layer));
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
-	walk_layer->objects = calloc((size_t) QWALK_LAYER_SIZE, sizeof(*(walk_layer->objects)));
-	if (walk_layer->objects == NULL) {
+	walk_layer->size_y = size_y;
+	walk_layer->size_x = size_x;
+	walk_layer->chunkc_y = (size_y + QWALK_CHUNK_SIZE_Y - 1) / QWALK_CHUNK_SIZE_Y;
+	walk_layer->chunkc_x = (size_x + QWALK_CHUNK_SIZE_X - 1) / QWALK_CHUNK_SIZE_X;
+	walk_layer->chunks = calloc(
+			(size_t) walk_layer->chunkc_y * (size_t) walk_layer->chunkc_x,
+			sizeof(*(walk_layer->chunks)));
+	if (walk_layer->chunks == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		free(walk_layer);
 		return NULL;
 	}
 
-	walk_layer->index_ok = 0;
+	walk_layer->chunkc = 0;
+	walk_layer->objc = 0;
+	walk_layer->tilec = 0;
+	walk_layer->arena = NULL;
 	return walk_layer;
 }
 
 
 /**
  * Destroy a #QwalkLayer_t and its contents.
+ * Objects are only visited if some of them hold heap memory; those of a layer
+ * read into a #Qarena_t, and untouched since, are freed along with it.
  * @note
  * Relies on the fact that @c calloc() automatically initializes memory to 0,
  * which compares equal to @c NULL.
  */
 void
 qwalk_layer_destroy(QwalkLayer_t *walk_layer) {
+	QwalkChunk_t *chunk;
+	bool isvisiting;
 
-	for (int i = 0; i < walk_layer->index_ok; i++) {
-		/* destroy each QwalkObj_t and its contents */
-		qattr_list_destroy(walk_layer->objects[i].attr_list);
+	isvisiting = (walk_layer->arena == NULL) || !qarena_isclean(walk_layer->arena);
+	for (int c = 0; c < walk_layer->chunkc_y * walk_layer->chunkc_x; c++) {
+		if ((chunk = walk_layer->chunks[c]) == NULL) {
+			continue;
+		}
+		for (int i = 0; isvisiting && (i < QWALK_CHUNK_SIZE); i++) {
+			/* destroy each QwalkObj_t and its contents */
+			if (chunk->objects[i].attr_list != NULL) {
+				qattr_list_destroy(chunk->objects[i].attr_list);
+			}
+		}
+		qattr_store_destroy(chunk->store);
+		free(chunk);
+	}
+	if (walk_layer->arena != NULL) {
+		qarena_destroy(walk_layer->arena);
 	}
-	/*@i1@*/free(walk_layer->objects);
+	/*@i1@*/free(walk_layer->chunks);
 	free(walk_layer);
 	return;
 }
 
 
 /**
- * Write a #QwalkLayer_t to storage.
+ * Write a #QwalkLayer_t to the file opened via qfile_open().
+ * @see qwalk_layer_handle_write().
+ * @param[in] walk_layer: #QwalkLayer_t to write.
+ * @return #Q_OK or #Q_ERROR.
+ */
+int
+qwalk_layer_write(const QwalkLayer_t *walk_layer) {
+	return qwalk_layer_handle_write(qfile_handle_default_get(), walk_layer);
+}
+
+
+/**
+ * Write a #QwalkLayer_t to a #QfileHandle_t.
  * Only @ref QwalkObj_t.attr_list is written; this is because @ref
  * QwalkObj_t.coord_y and @ref QwalkObj_t.coord_x can be confidently converted to
- * and from their index.
+ * and from their index. This raw format records no dimensions, so only a
+ * #QWALK_LAYER_SIZE_Y by #QWALK_LAYER_SIZE_X layer with every object set may
+ * be written; others need qwalk_area_v2_handle_write().
+ * @param[out] handle: #QfileHandle_t to write to.
  * @param[in] walk_layer: #QwalkLayer_t to write.
  * @return #Q_OK or #Q_ERROR.
  */
 int
-qwalk_layer_write(const QwalkLayer_t *walk_layer) {
+qwalk_layer_handle_write(QfileHandle_t *handle, const QwalkLayer_t *walk_layer) {
 	int r;
 	int returnval = Q_OK;
 	
@@ -673,20 +1085,19 @@ qwalk_layer_write(const QwalkLayer_t *walk_layer) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERROR;
 	}
-	if (walk_layer->objects == NULL) {
-		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-		return Q_ERROR;
-	}
 
 	/* layers should ONLY be written when they are fully filled out! */
-	if (walk_layer->index_ok != QWALK_LAYER_SIZE) {
+	if ((walk_layer->size_y != QWALK_LAYER_SIZE_Y)
+			|| (walk_layer->size_x != QWALK_LAYER_SIZE_X)
+			|| (walk_layer->objc != QWALK_LAYER_SIZE)) {
 		Q_ERRORFOUND(QERROR_STRUCT_INCOMPLETE);
 		return Q_ERROR;
 	}
 
 	/* iterate through every layer object */
 	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
-		r = qattr_list_write(walk_layer->objects[i].attr_list);
+		r = qattr_list_handle_write(handle,
+				qwalk_layer_object_attr_list_get(walk_layer, i));
 		if (r != Q_OK) {
 			Q_ERRORFOUND(QERROR_ERRORVAL);
 			returnval = Q_ERROR;
@@ -698,32 +1109,53 @@ qwalk_layer_write(const QwalkLayer_t *walk_layer) {
 
 
 /**
- * Read a #QwalkLayer_t from storage.
+ * Read a #QwalkLayer_t from the file opened via qfile_open().
+ * @see qwalk_layer_handle_read().
  * @return new #QwalkLayer_t.
  */
 QwalkLayer_t *
 qwalk_layer_read() {
+	return qwalk_layer_handle_read(qfile_handle_default_get());
+}
+
+
+/**
+ * Read a #QwalkLayer_t from a #QfileHandle_t.
+ * The layer is #QWALK_LAYER_SIZE_Y by #QWALK_LAYER_SIZE_X; see
+ * qwalk_layer_handle_write(). The objects are read into a #Qarena_t owned by
+ * the layer; see @ref QwalkLayer_t.arena.
+ * @param[in,out] handle: #QfileHandle_t to read from.
+ * @return new #QwalkLayer_t.
+ */
+QwalkLayer_t *
+qwalk_layer_handle_read(QfileHandle_t *handle) {
 	QwalkLayer_t *walk_layer;
 	QattrList_t  *attr_list;
 	int *coords;
 	int r;
 
-	walk_layer = qwalk_layer_create();
+	walk_layer = qwalk_layer_create(QWALK_LAYER_SIZE_Y, QWALK_LAYER_SIZE_X);
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return NULL;
 	}
+	if ((walk_layer->arena = qarena_create()) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_layer_destroy(walk_layer);
+		return NULL;
+	}
+	qfile_handle_arena_set(handle, walk_layer->arena);
 
 	/* iterate through every layer object */
 	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
 		
-		attr_list = qattr_list_read();
+		attr_list = qattr_list_handle_read(handle);
 		if (attr_list == NULL) {
 			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 			abort();
 		}
 		
-		coords = qwalk_index_to_coords(i);
+		coords = qwalk_index_to_coords(walk_layer, i);
 		if (coords == NULL) {
 			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 			abort();
@@ -737,12 +1169,15 @@ qwalk_layer_read() {
 		free(coords);
 	}
 
+	qfile_handle_arena_set(handle, NULL);
 	return walk_layer;
 }
 
 
 /**
  * Set a #QwalkObj_t in a #QwalkLayer_t.
+ * The chunk holding the coordinates is populated first if need be; a tile
+ * already set is left alone, see qwalk_layer_object_attr_list_replace().
  * @param[out] walk_layer: relevant #QwalkLayer_t.
  * @param[in] y: @ref QwalkObj_t.coord_y.
  * @param[in] x: @ref QwalkObj_t.coord_x.
@@ -751,6 +1186,9 @@ qwalk_layer_read() {
  */
 int
 qwalk_layer_object_set(QwalkLayer_t *walk_layer, int y, int x, QattrList_t *attr_list) {
+	QwalkChunk_t *chunk;
+	int local;
+
 	if ((walk_layer == NULL) || (attr_list == NULL)) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		if (attr_list != NULL) {
@@ -758,22 +1196,125 @@ qwalk_layer_object_set(QwalkLayer_t *walk_layer, int y, int x, QattrList_t *attr
 		}
 		return Q_ERROR;
 	}
-	if (walk_layer->objects == NULL) {
+	if (!qwalk_logic_coords_arevalid(walk_layer, y, x)) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		qattr_list_destroy(attr_list);
+		return Q_ERROR;
+	}
+	if (((chunk = qwalk_layer_chunk_get(walk_layer, (y * walk_layer->size_x) + x,
+						&local)) == NULL)
+			&& ((chunk = qwalk_layer_chunk_populate(walk_layer, y, x)) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
 	}
-	if (walk_layer->index_ok >= QWALK_LAYER_SIZE) {
+	if (chunk->objects[local].attr_list != NULL) {
 		qattr_list_destroy(attr_list);
 		return Q_ERROR;
 	}
-	walk_layer->objects[walk_layer->index_ok].coord_y = y;
-	walk_layer->objects[walk_layer->index_ok].coord_x = x;
-	walk_layer->objects[walk_layer->index_ok].attr_list = attr_list;
-	walk_layer->index_ok++;
+	if ((walk_layer->arena != NULL) && (attr_list->arena != walk_layer->arena)) {
+		qarena_heap_note(walk_layer->arena);
+	}
+	chunk->objects[local].coord_y = y;
+	chunk->objects[local].coord_x = x;
+	chunk->objects[local].attr_list = attr_list;
+	(void) qattr_store_bind(chunk->store, (size_t) local, attr_list);
+	chunk->objc++;
+	walk_layer->objc++;
 	return Q_OK;
 }
 
 
+/**
+ * Replace the #QattrList_t of a #QwalkObj_t in a #QwalkLayer_t.
+ * The former list is destroyed. Should the new one not lie in @ref
+ * QwalkLayer_t.arena, the arena is told so, such that qwalk_layer_destroy()
+ * still frees it.
+ * @param[out] walk_layer: relevant #QwalkLayer_t.
+ * @param[in] index: index of the #QwalkObj_t in @p walk_layer, which must be
+ * set.
+ * @param[in] attr_list: new @ref QwalkObj_t.attr_list.
+ */
+void
+qwalk_layer_object_attr_list_replace(QwalkLayer_t *walk_layer, int index,
+		QattrList_t *attr_list) {
+	QwalkChunk_t *chunk;
+	int local;
+
+	if ((chunk = qwalk_layer_chunk_get(walk_layer, index, &local)) == NULL) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
+		abort();
+	}
+	qattr_list_destroy(chunk->objects[local].attr_list);
+	if ((walk_layer->arena != NULL) && (attr_list->arena != walk_layer->arena)) {
+		qarena_heap_note(walk_layer->arena);
+	}
+	chunk->objects[local].attr_list = attr_list;
+	(void) qattr_store_bind(chunk->store, (size_t) local, attr_list);
+	return;
+}
+
+
+/**
+ * Tell whether every tile of the populated chunks of a #QwalkLayer_t is set.
+ * Tiles of unpopulated chunks don't count; they are void.
+ * @param[in] layer: relevant #QwalkLayer_t.
+ * @return whether @p layer is complete.
+ */
+bool
+qwalk_layer_iscomplete(const QwalkLayer_t *layer) {
+	return layer->objc == layer->tilec;
+}
+
+
+/**
+ * Get the #QwalkChunk_t holding an index of a #QwalkLayer_t.
+ * @param[in] layer: relevant #QwalkLayer_t.
+ * @param[in] index: index in @p layer.
+ * @param[out] localp: index of the tile within the chunk; only set if @p
+ * index lies in @p layer.
+ * @return the #QwalkChunk_t, or @c NULL if @p index is out of range or its
+ * chunk is unpopulated.
+ */
+QwalkChunk_t *
+qwalk_layer_chunk_get(const QwalkLayer_t *layer, int index, int *localp) {
+	int y;
+	int x;
+
+	if ((index < 0) || (index >= layer->size_y * layer->size_x)) {
+		return NULL;
+	}
+	y = index / layer->size_x;
+	x = index % layer->size_x;
+	*localp = ((y % QWALK_CHUNK_SIZE_Y) * QWALK_CHUNK_SIZE_X)
+		+ (x % QWALK_CHUNK_SIZE_X);
+	return layer->chunks[((y / QWALK_CHUNK_SIZE_Y) * layer->chunkc_x)
+		+ (x / QWALK_CHUNK_SIZE_X)];
+}
+
+
+/**
+ * Get the index in a #QwalkLayer_t of a tile of one of its chunks.
+ * @param[in] layer: relevant #QwalkLayer_t.
+ * @param[in] chunk: index of the chunk in @ref QwalkLayer_t.chunks.
+ * @param[in] local: index of the tile within the chunk.
+ * @return index in @p layer, or #Q_ERRORCODE_INT_NOTFOUND if the tile lies
+ * past the edge of @p layer.
+ */
+int
+qwalk_layer_chunk_index_get(const QwalkLayer_t *layer, int chunk, int local) {
+	int y = ((chunk / layer->chunkc_x) * QWALK_CHUNK_SIZE_Y)
+		+ (local / QWALK_CHUNK_SIZE_X);
+	int x = ((chunk % layer->chunkc_x) * QWALK_CHUNK_SIZE_X)
+		+ (local % QWALK_CHUNK_SIZE_X);
+
+	if ((y >= layer->size_y) || (x >= layer->size_x)) {
+		return Q_ERRORCODE_INT_NOTFOUND;
+	}
+	return (y * layer->size_x) + x;
+}
+
+
 /**
  * Get the y coordinate of a #QwalkObj_t in a #QwalkLayer_t.
  * @param[in] walk_layer: pointer to #QwalkLayer_t in question.
@@ -782,15 +1323,19 @@ qwalk_layer_object_set(QwalkLayer_t *walk_layer, int y, int x, QattrList_t *attr
  */
 int
 qwalk_layer_object_coord_y_get(const QwalkLayer_t *walk_layer, int index) {
+	const QwalkChunk_t *chunk;
+	int local;
+
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERRORCODE_INT;
 	}
-	if ((index >= walk_layer->index_ok) || (index < 0)) {
+	if (((chunk = qwalk_layer_chunk_get(walk_layer, index, &local)) == NULL)
+			|| (chunk->objects[local].attr_list == NULL)) {
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return Q_ERRORCODE_INT;
 	}
-	return walk_layer->objects[index].coord_y;
+	return chunk->objects[local].coord_y;
 }
 
 
@@ -802,71 +1347,76 @@ qwalk_layer_object_coord_y_get(const QwalkLayer_t *walk_layer, int index) {
  */
 int
 qwalk_layer_object_coord_x_get(const QwalkLayer_t *walk_layer, int index) {
+	const QwalkChunk_t *chunk;
+	int local;
+
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return Q_ERRORCODE_INT;
 	}
-	if ((index >= walk_layer->index_ok) || (index < 0)) {
+	if (((chunk = qwalk_layer_chunk_get(walk_layer, index, &local)) == NULL)
+			|| (chunk->objects[local].attr_list == NULL)) {
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return Q_ERRORCODE_INT;
 	}
-	return walk_layer->objects[index].coord_x;
+	return chunk->objects[local].coord_x;
 }
 
 
 /**
  * Get the #QattrList_t of a #QwalkObj_t in a #QwalkLayer_t.
+ * Void tiles of unpopulated chunks have none.
  * @param[in] walk_layer: pointer to #QwalkLayer_t in question.
  * @param[in] index: index of #QwalkObj_t in question.
  * @return #QattrList_t or @c NULL if an error occurs
  */
 QattrList_t *
 qwalk_layer_object_attr_list_get(const QwalkLayer_t *walk_layer, int index) {
+	const QwalkChunk_t *chunk;
+	int local;
+
 	if (walk_layer == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return NULL;
 	}
-	if ((index >= walk_layer->index_ok) || (index < 0)) {
+	if ((chunk = qwalk_layer_chunk_get(walk_layer, index, &local)) == NULL) {
 		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return NULL;
 	}
-	if (walk_layer->objects[index].attr_list == NULL) {
+	if (chunk->objects[local].attr_list == NULL) {
 		Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
 		return NULL;
 	}
-	return walk_layer->objects[index].attr_list;
+	return chunk->objects[local].attr_list;
 }
 
 
 /**
  * Get the #QobjType_t of an object in a #QwalkLayer_t.
+ * Tiles of unpopulated chunks are #QOBJ_TYPE_VOID.
  * @param[in] layer: #QwalkLayer_t to search.
  * @param[in] index: index of object in @p layer.
  * @return requested #QobjType_t or #Q_ERRORCODE_ENUM.
  */
 QobjType_t
 qwalk_layer_object_type_get(const QwalkLayer_t *layer, int index) {
+	const QwalkChunk_t *chunk;
+	QobjType_t obj_type;
+	int local;
 
-	Qdatameta_t *datameta;
-	QobjType_t  *obj_type;
-
-	if ((datameta = qwalk_layer_obj_attr_value_get(
-					layer, index, QATTR_KEY_QOBJECT_TYPE)) == NULL) {
-		Q_ERRORFOUND(QERROR_ERRORVAL);
+	if ((index >= layer->size_y * layer->size_x) || (index < 0)) {
+		Q_ERRORFOUND(QERROR_INDEX_OUTOFRANGE);
 		return (QobjType_t) Q_ERRORCODE_ENUM;
 	}
-
-	if (qdatameta_type_get(datameta) != QDATA_TYPE_QOBJECT_TYPE) {
-		Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
-		return (QobjType_t) Q_ERRORCODE_ENUM;
+	if ((chunk = qwalk_layer_chunk_get(layer, index, &local)) == NULL) {
+		return QOBJ_TYPE_VOID;
 	}
-
-	if ((obj_type = (QobjType_t *) qdatameta_datap_get(datameta)) == NULL) {
+	if ((obj_type = qattr_store_type_get(chunk->store, (size_t) local))
+			== (QobjType_t) Q_ERRORCODE_ENUM) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
-		return (QobjType_t) Q_ERRORCODE_ENUM;
 	}
 
-	return *obj_type;
+	return obj_type;
 }
 
 
@@ -888,6 +1438,14 @@ qwalk_layer_obj_attr_value_get(const QwalkLayer_t *layer, int index,
 		Q_ERRORFOUND(QERROR_ERRORVAL);
 		return NULL;
 	}
+	if ((key < (QattrKey_t) Q_ENUM_VALUE_START) || (key > QATTR_KEY_COUNT)) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return NULL;
+	}
+	if (!qattr_list_key_has(attr_list, key)) {
+		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
+		return NULL;
+	}
 
 	if ((datameta = qattr_list_value_get(attr_list, key)) == NULL) {
 		Q_ERRORFOUND(QERROR_ERRORVAL);
@@ -911,70 +1469,151 @@ int
 qwalk_layer_obj_index_get(
 		const QwalkLayer_t *parse_layer, const QobjType_t type_search) {
 
-	QattrList_t *attr_list;
-	Qdatameta_t *datameta;
-	QobjType_t  *obj_type;
+	const QwalkChunk_t *chunk;
+	size_t local;
 
-	for (int i = 0; i < QWALK_LAYER_SIZE; i++) {
-		if ((attr_list = parse_layer->objects[i].attr_list) == NULL) {
-			Q_ERRORFOUND(QERROR_NULL_POINTER_UNEXPECTED);
-			return Q_ERRORCODE_INT;
-		}
-		if ((datameta = qattr_list_value_get(attr_list, QATTR_KEY_QOBJECT_TYPE))
-				== NULL) {
-			Q_ERRORFOUND(QERROR_ERRORVAL);
-			return Q_ERRORCODE_INT;
-		}
-		if (qdatameta_type_get(datameta) != QDATA_TYPE_QOBJECT_TYPE) {
-			Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
-			return Q_ERRORCODE_INT;
+	if ((type_search < (QobjType_t) Q_ENUM_VALUE_START)
+			|| (type_search > QOBJ_TYPE_COUNT)) {
+		Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
+		return Q_ERRORCODE_INT;
+	}
+	if (!qwalk_layer_iscomplete(parse_layer)) {
+		Q_ERRORFOUND(QERROR_STRUCT_INCOMPLETE);
+		return Q_ERRORCODE_INT;
+	}
+
+	for (int c = 0; c < parse_layer->chunkc_y * parse_layer->chunkc_x; c++) {
+		if (((chunk = parse_layer->chunks[c]) != NULL)
+				&& ((local = qattr_store_query_next(chunk->store, 0, &type_search,
+							(size_t) 1, (size_t) 0, (size_t) QWALK_CHUNK_SIZE))
+					< (size_t) QWALK_CHUNK_SIZE)) {
+			return qwalk_layer_chunk_index_get(parse_layer, c, (int) local);
 		}
+	}
+
+	return Q_ERRORCODE_INT_NOTFOUND;
+}
 
-		if ((obj_type = (QobjType_t *) qdatameta_datap_get(datameta)) == NULL) {
-			Q_ERRORFOUND(QERROR_QDATAMETA_TYPE_COUNT_INCOMPATIBLE);
+
+/**
+ * Find every object of a #QwalkLayer_t having some keys and being of some
+ * types, e.g. each NPC one may talk to.
+ * Only the bitsets of the @ref QwalkChunk_t.store of each populated chunk are
+ * read; see qattr_store_query().
+ * @param[in] layer: #QwalkLayer_t to search.
+ * @param[in] keymask: #QATTR_KEY_BIT() of every key the objects must have;
+ * 0 for any.
+ * @param[in] types: #QobjType_t the objects may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[out] indices: index of each matching object, chunk by chunk; room
+ * for @ref QwalkLayer_t.objc of them is needed.
+ * @return number of matching objects or #Q_ERRORCODE_INT.
+ */
+int
+qwalk_layer_objects_query(const QwalkLayer_t *layer, unsigned long keymask,
+		const QobjType_t *types, size_t typec, int *indices) {
+	const QwalkChunk_t *chunk;
+	int indexc = 0;
+	size_t local;
+
+	for (size_t i = 0; i < typec; i++) {
+		if ((types[i] < (QobjType_t) Q_ENUM_VALUE_START)
+				|| (types[i] > QOBJ_TYPE_COUNT)) {
+			Q_ERRORFOUND(QERROR_ENUM_CONSTANT_INVALID);
 			return Q_ERRORCODE_INT;
 		}
+	}
 
-		if (*obj_type == type_search) {
-			return i;
+	for (int c = 0; c < layer->chunkc_y * layer->chunkc_x; c++) {
+		if ((chunk = layer->chunks[c]) == NULL) {
+			continue;
+		}
+		local = 0;
+		while ((local = qattr_store_query_next(chunk->store, keymask, types,
+							typec, local, (size_t) QWALK_CHUNK_SIZE))
+				< (size_t) QWALK_CHUNK_SIZE) {
+			/* unset entries only match a query for anything */
+			if (chunk->objects[local].attr_list != NULL) {
+				indices[indexc++] = qwalk_layer_chunk_index_get(layer, c, (int) local);
+			}
+			local++;
 		}
 	}
 
-	return Q_ERRORCODE_INT_NOTFOUND;
+	return indexc;
 }
 
 
 /**
  * Convert coordinates in qwalk to an index.
+ * @param[in] layer: #QwalkLayer_t of the coordinates.
  * @param[in] y: y coordinate.
  * @param[in] x: x coordinate.
  * @return index or #Q_ERRORCODE_INT.
  */
 int
-qwalk_coords_to_index(int y, int x) {
-	if ((y < QWALK_LAYER_COORD_MINIMUM) || (y >= QWALK_LAYER_SIZE_Y) ||
-			(x < QWALK_LAYER_COORD_MINIMUM) || (x >= QWALK_LAYER_SIZE_X)) {
+qwalk_coords_to_index(const QwalkLayer_t *layer, int y, int x) {
+	if (!qwalk_logic_coords_arevalid(layer, y, x)) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		return Q_ERRORCODE_INT;
 	}
-	return ((y * QWALK_LAYER_SIZE_X) + x);
+	return ((y * layer->size_x) + x);
 }
 
 /**
  * Convert index in qwalk to coordinates.
+ * @param[in] layer: #QwalkLayer_t of the index.
  * @param[in] index: index to convert.
  * @return @c int array in the order: y, x.
  */
 int *
-qwalk_index_to_coords(int index) {
+qwalk_index_to_coords(const QwalkLayer_t *layer, int index) {
 	int *vals;
 	vals = calloc((size_t) 2, sizeof(*vals));
 	assert(vals != NULL);
-	if ((index >= QWALK_LAYER_SIZE) || (index < QWALK_LAYER_COORD_MINIMUM)) {
+	if ((index >= layer->size_y * layer->size_x)
+			|| (index < QWALK_LAYER_COORD_MINIMUM)) {
 		Q_ERRORFOUND(QERROR_PARAMETER_INVALID);
 		abort();
 	}
-	vals[0] = index / QWALK_LAYER_SIZE_X;
-	vals[1] = index % QWALK_LAYER_SIZE_X;
+	vals[0] = index / layer->size_x;
+	vals[1] = index % layer->size_x;
 	return vals;
 }
+
+
+/**
+ * Populate the chunk of a #QwalkLayer_t holding some coordinates.
+ * @param[out] layer: relevant #QwalkLayer_t.
+ * @param[in] y: y coordinate within the chunk.
+ * @param[in] x: x coordinate within the chunk.
+ * @return the new, empty #QwalkChunk_t or @c NULL upon failure.
+ */
+QwalkChunk_t *
+qwalk_layer_chunk_populate(QwalkLayer_t *layer, int y, int x) {
+	QwalkChunk_t *chunk;
+	int chunk_y = y / QWALK_CHUNK_SIZE_Y;
+	int chunk_x = x / QWALK_CHUNK_SIZE_X;
+	int rowc;
+	int colc;
+
+	if ((chunk = calloc((size_t) 1, sizeof(*chunk))) == NULL) {
+		Q_ERROR_SYSTEM("calloc()");
+		return NULL;
+	}
+	if ((chunk->store = qattr_store_create((size_t) QWALK_CHUNK_SIZE)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		free(chunk);
+		return NULL;
+	}
+	chunk->objc = 0;
+
+	/* chunks along the far edges overhang the layer */
+	rowc = layer->size_y - (chunk_y * QWALK_CHUNK_SIZE_Y);
+	colc = layer->size_x - (chunk_x * QWALK_CHUNK_SIZE_X);
+	layer->tilec += (rowc < QWALK_CHUNK_SIZE_Y ? rowc : QWALK_CHUNK_SIZE_Y)
+		* (colc < QWALK_CHUNK_SIZE_X ? colc : QWALK_CHUNK_SIZE_X);
+	layer->chunkc++;
+	layer->chunks[(chunk_y * layer->chunkc_x) + chunk_x] = chunk;
+	return chunk;
+}
@@ -5,6 +5,8 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <ncurses.h>
 
@@ -21,6 +23,7 @@
 #include "dialogue.h"
 #include "qwalk.h"
 #include "qwins.h"
+#include "qdefault.h"
 
 
 /*
@@ -31,11 +34,25 @@
 #define FILENAME "saves/test.sav"
 #define FILENAME2 "data/walk-world/test2.dat"
 #define DIALOGUE_FILENAME "dialogue_test.qdl"
+#define JOURNAL_FILENAME "saves/test_journal.dat"
 
 
 
 static void test_qwins(void);
 static void test_qutils(void);
+static void test_qattr_duplicate(void);
+static void test_qfile_block(void);
+static void test_qfile_block_round_trip(const unsigned char *src, size_t size);
+static void test_qfile_block_cut_check(const unsigned char *zblock,
+		size_t zsize, size_t cut, unsigned char *block, size_t size);
+static void test_qwalk_journal(void);
+static QwalkArea_t *test_qwalk_area_create(int size_y, int size_x);
+static QwalkArea_t *test_qwalk_area_load(const char *filename);
+static off_t test_file_size_get(const char *filename);
+static void test_qwalk_query(void);
+static void test_qwalk_query_check(const QwalkLayer_t *walk_layer,
+		const QobjType_t *types, size_t typec, int y, int x, int radius,
+		int *indices, int *expected);
 
 
 
@@ -51,6 +68,10 @@ int main(/*@unused@*/int argc, /*@unused@*/char** argv) {
 	fprintf(stderr, "------END PHONY ERRORS------\n\n\n");
 
 	test_qutils();
+	test_qattr_duplicate();
+	test_qfile_block();
+	test_qwalk_journal();
+	test_qwalk_query();
 
 	int r;
 
@@ -304,9 +325,9 @@ int main(/*@unused@*/int argc, /*@unused@*/char** argv) {
 	s = qdatameta_count_get(datameta);
 	printf("%i, %i\n", (int) s, (int) data_type);
 
-	walk_layer_earth = qwalk_layer_create();
+	walk_layer_earth = qwalk_layer_create(QWALK_LAYER_SIZE_Y, QWALK_LAYER_SIZE_X);
 	assert(walk_layer_earth != NULL);
-	walk_layer_floater = qwalk_layer_create();
+	walk_layer_floater = qwalk_layer_create(QWALK_LAYER_SIZE_Y, QWALK_LAYER_SIZE_X);
 	assert(walk_layer_floater != NULL);
 
 	qattr_list_destroy(attr_list);
@@ -329,7 +350,7 @@ int main(/*@unused@*/int argc, /*@unused@*/char** argv) {
 		assert(attr_list != NULL);
 		
 		int *coords;
-		coords = qwalk_index_to_coords(i);
+		coords = qwalk_index_to_coords(walk_layer_earth, i);
 		r = qwalk_layer_object_set(walk_layer_earth, coords[0], coords[1], attr_list);
 		free(coords);
 		attr_list = NULL;
@@ -358,7 +379,7 @@ int main(/*@unused@*/int argc, /*@unused@*/char** argv) {
 		assert(attr_list != NULL);
 		
 		int *coords;
-		coords = qwalk_index_to_coords(i);
+		coords = qwalk_index_to_coords(walk_layer_floater, i);
 		r = qwalk_layer_object_set(walk_layer_floater, coords[0], coords[1], attr_list);
 		free(coords);
 		attr_list = NULL;
@@ -553,3 +574,587 @@ test_qutils() {
 
 	return;
 }
+
+
+/**
+ * Test deleting a key a #QattrList_t holds twice.
+ * qattr_list_attr_set() appends a key it already has, as inserting an
+ * attribute in devel_walk does; once one copy is deleted, the other must
+ * still be found.
+ */
+void
+test_qattr_duplicate() {
+	QattrList_t *attr_list;
+	Qdatameta_t *datameta;
+	/*@observer@*/
+	const char *values[] = {"foo", "baz", "bar"};
+	const QattrKey_t keys[] = {QATTR_KEY_NAME, QATTR_KEY_DESCRIPTION_BRIEF,
+		QATTR_KEY_NAME};
+	char *value;
+
+	if ((attr_list = qattr_list_create((size_t) 3)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); i++) {
+		if (((value = calloc(strlen(values[i]) + (size_t) 1, sizeof(*value)))
+					== NULL)) {
+			Q_ERROR_SYSTEM("calloc()");
+			abort();
+		}
+		strcpy(value, values[i]);
+		if (((datameta = qdatameta_create((Qdata_t *) value,
+							QDATA_TYPE_CHAR_STRING, strlen(values[i]) + (size_t) 1))
+					== NULL)
+				|| (qattr_list_attr_set(attr_list, keys[i], datameta) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			abort();
+		}
+	}
+
+	/* the first "foo" goes, and "bar" takes its place */
+	if ((qattr_list_attr_delete(&attr_list, QATTR_KEY_NAME) == Q_ERROR)
+			|| (qattr_list_count_get(attr_list) != (size_t) 2)
+			|| !qattr_list_key_has(attr_list, QATTR_KEY_NAME)
+			|| ((datameta = qattr_list_value_get(attr_list, QATTR_KEY_NAME))
+				== NULL)
+			|| (strcmp((char *) qdatameta_datap_get(datameta), "bar") != 0)
+			|| (qattr_list_value_get(attr_list, QATTR_KEY_DESCRIPTION_BRIEF)
+				== NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	if ((qattr_list_attr_delete(&attr_list, QATTR_KEY_NAME) == Q_ERROR)
+			|| (qattr_list_count_get(attr_list) != (size_t) 1)
+			|| qattr_list_key_has(attr_list, QATTR_KEY_NAME)
+			|| (qattr_list_value_get(attr_list, QATTR_KEY_NAME) != NULL)
+			|| (qattr_list_value_get(attr_list, QATTR_KEY_DESCRIPTION_BRIEF)
+				== NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	qattr_list_destroy(attr_list);
+	printf("qattr_duplicate: OK\n");
+
+	return;
+}
+
+
+/**
+ * Test the block codec of @ref qfilez.c.
+ * Runs, text, incompressible bytes and sizes around #QFILE_BLOCK_SIZE must
+ * survive a round trip, and a truncated block must be an error.
+ */
+void
+test_qfile_block() {
+	unsigned char *src;
+	unsigned char *dest;
+	uint32_t state = 2463534242u;
+	size_t size;
+
+	if (((src = malloc((size_t) QFILE_BLOCK_SIZE)) == NULL)
+			|| ((dest = malloc(qfile_block_bound((size_t) QFILE_BLOCK_SIZE)))
+				== NULL)) {
+		Q_ERROR_SYSTEM("malloc()");
+		abort();
+	}
+
+	fprintf(stderr, "\n-----BEGIN EXPECTED ERRORS-----\n");
+
+	/* a run, such as a layer of identical tiles */
+	memset(src, 'q', (size_t) QFILE_BLOCK_SIZE);
+	for (size = 0; size <= (size_t) 9; size++) {
+		test_qfile_block_round_trip(src, size);
+	}
+	test_qfile_block_round_trip(src, (size_t) QFILE_BLOCK_SIZE);
+	if (qfile_block_compress(src, (size_t) QFILE_BLOCK_SIZE, dest,
+				qfile_block_bound((size_t) QFILE_BLOCK_SIZE))
+			> (size_t) QFILE_BLOCK_SIZE / 100) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	/* text, whose matches are short and near */
+	for (size = 0; size < (size_t) QFILE_BLOCK_SIZE; size++) {
+		src[size] = (unsigned char) "the grass by tree number "[size % 25];
+		if (size % 25 == 24) {
+			src[size] = (unsigned char) ('0' + (size / 25) % 10);
+		}
+	}
+	test_qfile_block_round_trip(src, (size_t) 1000);
+	test_qfile_block_round_trip(src, (size_t) QFILE_BLOCK_SIZE - 1);
+
+	/* incompressible bytes, which grow by no more than qfile_block_bound() */
+	for (size = 0; size < (size_t) QFILE_BLOCK_SIZE; size++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		src[size] = (unsigned char) state;
+	}
+	test_qfile_block_round_trip(src, (size_t) 300);
+	test_qfile_block_round_trip(src, (size_t) QFILE_BLOCK_SIZE);
+	if (qfile_block_compress(src, (size_t) QFILE_BLOCK_SIZE, dest,
+				(size_t) QFILE_BLOCK_SIZE / 2) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	/* too large for the offsets of a block */
+	if (qfile_block_compress(src, (size_t) QFILE_BLOCK_SIZE + 1, dest,
+				qfile_block_bound((size_t) QFILE_BLOCK_SIZE + 1)) != 0) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	fprintf(stderr, "------END EXPECTED ERRORS------\n\n\n");
+
+	free(dest);
+	free(src);
+	printf("qfile_block: OK\n");
+
+	return;
+}
+
+
+/**
+ * Compress and decompress @p size bytes, aborting if they don't come back the
+ * same, or if a truncated or overlong copy of the block is accepted.
+ * @param[in] src: bytes to round trip.
+ * @param[in] size: number of bytes in @p src.
+ */
+void
+test_qfile_block_round_trip(const unsigned char *src, size_t size) {
+	unsigned char *zblock;
+	unsigned char *block;
+	size_t zsize;
+	/* every cut of a small block, and a few of a large one */
+	size_t cuts[] = {0, 1, 2, 3, 0, 0, 0};
+
+	if (((zblock = malloc(qfile_block_bound(size) + 1)) == NULL)
+			|| ((block = malloc(size + 1)) == NULL)) {
+		Q_ERROR_SYSTEM("malloc()");
+		abort();
+	}
+
+	if (((zsize = qfile_block_compress(src, size, zblock,
+						qfile_block_bound(size))) == 0)
+			|| (zsize > qfile_block_bound(size))
+			|| (qfile_block_decompress(zblock, zsize, block, size) == Q_ERROR)
+			|| (memcmp(src, block, size) != 0)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	/* nothing at all also decodes to an empty block */
+	if (size == 0) {
+		free(block);
+		free(zblock);
+		return;
+	}
+
+	if (zsize <= (size_t) 64) {
+		for (size_t cut = 0; cut < zsize; cut++) {
+			test_qfile_block_cut_check(zblock, zsize, cut, block, size);
+		}
+	} else {
+		cuts[4] = zsize / 2;
+		cuts[5] = zsize - 2;
+		cuts[6] = zsize - 1;
+		for (size_t i = 0; i < sizeof(cuts) / sizeof(*cuts); i++) {
+			test_qfile_block_cut_check(zblock, zsize, cuts[i], block, size);
+		}
+	}
+
+	/* trailing bytes, or a destination of the wrong size, are as bad */
+	zblock[zsize] = 0;
+	if ((qfile_block_decompress(zblock, zsize + 1, block, size) != Q_ERROR)
+			|| (qfile_block_decompress(zblock, zsize, block, size + 1)
+				!= Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	free(block);
+	free(zblock);
+
+	return;
+}
+
+
+/**
+ * Abort if a block cut short at @p cut bytes is accepted.
+ * The one cut allowed is that of the empty sequence a block may end on, once
+ * a match has filled it up; it decodes to the same bytes either way.
+ * @param[in] zblock: compressed block.
+ * @param[in] zsize: number of bytes in @p zblock.
+ * @param[in] cut: number of bytes of @p zblock to decompress.
+ * @param[out] block: buffer for the decompressed bytes.
+ * @param[in] size: number of bytes the whole block decompresses to.
+ */
+void
+test_qfile_block_cut_check(const unsigned char *zblock, size_t zsize,
+		size_t cut, unsigned char *block, size_t size) {
+	if ((cut + 1 == zsize) && (zblock[cut] == 0)) {
+		return;
+	}
+	if (qfile_block_decompress(zblock, cut, block, size) != Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	return;
+}
+
+
+/**
+ * Test the recovery of a journal whose last save was torn by a crash.
+ * The torn save must be dropped and cut off the file, leaving the saves
+ * before it replayed and those after it following on from them.
+ */
+void
+test_qwalk_journal() {
+	QwalkArea_t *walk_area;
+	QwalkArea_t *walk_area_read;
+	struct QwalkJournal_t *journal;
+	QfileHandle_t *handle;
+	char journal_filename[QFILE_MAX_PATH_SIZE + 1];
+	off_t intact_size;
+
+	/* not of the default size, so it is written as a v2 file */
+	if ((walk_area = test_qwalk_area_create(40, 40)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	if (((handle = qfile_handle_open(JOURNAL_FILENAME, QFILE_MODE_WRITE_ATOMIC))
+				== NULL)
+			|| (qwalk_area_v2_handle_write(handle, walk_area) == Q_ERROR)
+			|| (qfile_handle_close(handle) == Q_ERROR)
+			|| ((journal = qwalk_journal_create(JOURNAL_FILENAME)) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	/* the first save goes through qwalk_journal_frame_get() for its filename */
+	if ((qdefault_qwalk_layer_object_replace(walk_area->layer_earth, 5,
+					QOBJ_TYPE_TREE) == Q_ERROR)
+			|| (qwalk_journal_mark(journal, QWALK_LAYER_TYPE_EARTH, 5) == Q_ERROR)
+			|| (qwalk_journal_frame_get(journal, walk_area, &handle) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	strcpy(journal_filename, handle->atomic_filename);
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	intact_size = test_file_size_get(journal_filename);
+
+	/* tear the second save within its records */
+	if ((qdefault_qwalk_layer_object_replace(walk_area->layer_earth, 6,
+					QOBJ_TYPE_TREE) == Q_ERROR)
+			|| (qwalk_journal_mark(journal, QWALK_LAYER_TYPE_EARTH, 6) == Q_ERROR)
+			|| (qwalk_journal_save(journal, walk_area) == Q_ERROR)
+			|| (truncate(journal_filename,
+					test_file_size_get(journal_filename) - 3) == -1)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	if (((walk_area_read = test_qwalk_area_load(JOURNAL_FILENAME)) == NULL)
+			|| (qwalk_journal_replay(journal, walk_area_read) == Q_ERROR)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 5)
+				!= QOBJ_TYPE_TREE)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 6)
+				!= QOBJ_TYPE_GRASS)
+			|| (test_file_size_get(journal_filename) != intact_size)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	qwalk_area_destroy(walk_area_read);
+
+	/* tear the fourth save within its frame header */
+	if ((qdefault_qwalk_layer_object_replace(walk_area->layer_earth, 7,
+					QOBJ_TYPE_TREE) == Q_ERROR)
+			|| (qwalk_journal_mark(journal, QWALK_LAYER_TYPE_EARTH, 7) == Q_ERROR)
+			|| (qwalk_journal_save(journal, walk_area) == Q_ERROR)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	intact_size = test_file_size_get(journal_filename);
+	if ((qdefault_qwalk_layer_object_replace(walk_area->layer_earth, 8,
+					QOBJ_TYPE_TREE) == Q_ERROR)
+			|| (qwalk_journal_mark(journal, QWALK_LAYER_TYPE_EARTH, 8) == Q_ERROR)
+			|| (qwalk_journal_save(journal, walk_area) == Q_ERROR)
+			|| (truncate(journal_filename, intact_size + 2) == -1)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	if (((walk_area_read = test_qwalk_area_load(JOURNAL_FILENAME)) == NULL)
+			|| (qwalk_journal_replay(journal, walk_area_read) == Q_ERROR)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 5)
+				!= QOBJ_TYPE_TREE)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 6)
+				!= QOBJ_TYPE_GRASS)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 7)
+				!= QOBJ_TYPE_TREE)
+			|| (qwalk_layer_object_type_get(walk_area_read->layer_earth, 8)
+				!= QOBJ_TYPE_GRASS)
+			|| (test_file_size_get(journal_filename) != intact_size)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	qwalk_area_destroy(walk_area_read);
+
+	qwalk_journal_destroy(journal);
+	qwalk_area_destroy(walk_area);
+	if ((unlink(journal_filename) == -1) || (unlink(JOURNAL_FILENAME) == -1)) {
+		Q_ERROR_SYSTEM("unlink()");
+		abort();
+	}
+	printf("qwalk_journal: OK\n");
+
+	return;
+}
+
+
+/**
+ * Create a #QwalkArea_t of grass under void, in the manner of devel_walk.
+ * @param[in] size_y: rows of both layers.
+ * @param[in] size_x: columns of both layers.
+ * @return new #QwalkArea_t or @c NULL.
+ */
+QwalkArea_t *
+test_qwalk_area_create(int size_y, int size_x) {
+	QwalkLayer_t *walk_layer_earth;
+	QwalkLayer_t *walk_layer_floater;
+
+	if ((walk_layer_earth = qwalk_layer_create(size_y, size_x)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	if ((walk_layer_floater = qwalk_layer_create(size_y, size_x)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		qwalk_layer_destroy(walk_layer_earth);
+		return NULL;
+	}
+
+	for (int i = 0; i < size_y * size_x; i++) {
+		if ((qdefault_qwalk_layer_object_incomplete(walk_layer_earth, i,
+						QOBJ_TYPE_GRASS) == Q_ERROR)
+				|| (qdefault_qwalk_layer_object_incomplete(walk_layer_floater, i,
+						QOBJ_TYPE_VOID) == Q_ERROR)) {
+			Q_ERRORFOUND(QERROR_ERRORVAL);
+			qwalk_layer_destroy(walk_layer_earth);
+			qwalk_layer_destroy(walk_layer_floater);
+			return NULL;
+		}
+	}
+
+	return qwalk_area_create(walk_layer_earth, walk_layer_floater);
+}
+
+
+/**
+ * Read a #QwalkArea_t from a file, as qwalk_world_area_load() would.
+ * @param[in] filename: area file.
+ * @return new #QwalkArea_t or @c NULL.
+ */
+QwalkArea_t *
+test_qwalk_area_load(const char *filename) {
+	QfileHandle_t *handle;
+	QwalkArea_t *walk_area;
+
+	if ((handle = qfile_handle_open(filename, QFILE_MODE_READ_MAPPED)) == NULL) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		return NULL;
+	}
+	walk_area = qwalk_area_handle_read(handle);
+	if (qfile_handle_close(handle) == Q_ERROR) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		if (walk_area != NULL) {
+			qwalk_area_destroy(walk_area);
+		}
+		return NULL;
+	}
+
+	return walk_area;
+}
+
+
+/**
+ * Get the size of a file.
+ * @param[in] filename: relevant file.
+ * @return size of @p filename in bytes; aborts if it can't be found.
+ */
+off_t
+test_file_size_get(const char *filename) {
+	struct stat st;
+
+	if (stat(filename, &st) == -1) {
+		Q_ERROR_SYSTEM("stat()");
+		abort();
+	}
+
+	return st.st_size;
+}
+
+
+/**
+ * Test the spatial queries of @ref qwalks.c against a scan of every object.
+ * The layer is a few chunks across, with a partial chunk along two of its
+ * sides; points sit on both sides of chunk edges and in the corners, and
+ * their rectangles and radii overhang the layer.
+ */
+void
+test_qwalk_query() {
+	QwalkArea_t *walk_area;
+	QwalkLayer_t *walk_layer;
+	int *indices;
+	int *expected;
+	uint32_t state = 88172645u;
+	int size_y = QWALK_CHUNK_SIZE_Y * 2 + 6;
+	int size_x = QWALK_CHUNK_SIZE_X + 13;
+	const QobjType_t types[] = {QOBJ_TYPE_TREE, QOBJ_TYPE_GRASS};
+	const int ys[] = {0, QWALK_CHUNK_SIZE_Y - 1, QWALK_CHUNK_SIZE_Y, 50,
+		size_y - 1};
+	const int xs[] = {0, QWALK_CHUNK_SIZE_X - 1, QWALK_CHUNK_SIZE_X, size_x - 1};
+	const int radii[] = {0, 1, 4, QWALK_CHUNK_SIZE_X - 1, 100};
+
+	if (((walk_area = test_qwalk_area_create(size_y, size_x)) == NULL)
+			|| ((indices = calloc((size_t) (size_y * size_x), sizeof(*indices)))
+				== NULL)
+			|| ((expected = calloc((size_t) (size_y * size_x),
+						sizeof(*expected))) == NULL)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+	walk_layer = walk_area->layer_floater;
+
+	/* scatter trees and grass, and line both sides of the chunk edges */
+	for (int i = 0; i < size_y * size_x; i++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		if ((state % 16 == 0) || ((i % size_x) == QWALK_CHUNK_SIZE_X - 1)
+				|| ((i / size_x) == QWALK_CHUNK_SIZE_Y)) {
+			if (qdefault_qwalk_layer_object_replace(walk_layer, i,
+						types[state % 2]) == Q_ERROR) {
+				Q_ERRORFOUND(QERROR_ERRORVAL);
+				abort();
+			}
+		}
+	}
+
+	for (size_t iy = 0; iy < sizeof(ys) / sizeof(*ys); iy++) {
+		for (size_t ix = 0; ix < sizeof(xs) / sizeof(*xs); ix++) {
+			for (size_t ir = 0; ir < sizeof(radii) / sizeof(*radii); ir++) {
+				test_qwalk_query_check(walk_layer, types, (size_t) 1, ys[iy],
+						xs[ix], radii[ir], indices, expected);
+				test_qwalk_query_check(walk_layer, types, (size_t) 2, ys[iy],
+						xs[ix], radii[ir], indices, expected);
+				test_qwalk_query_check(walk_layer, NULL, (size_t) 0, ys[iy],
+						xs[ix], radii[ir], indices, expected);
+			}
+		}
+	}
+
+	free(expected);
+	free(indices);
+	qwalk_area_destroy(walk_area);
+	printf("qwalk_query: OK\n");
+
+	return;
+}
+
+
+/**
+ * Abort unless qwalk_layer_rect_query(), qwalk_layer_radius_query() and
+ * qwalk_layer_nearest_get() agree with a scan of every object of a layer.
+ * The rectangle reaches @p radius above and to the left of the point, and
+ * twice that below and to the right.
+ * @param[in] walk_layer: #QwalkLayer_t to search.
+ * @param[in] types: #QobjType_t the objects may be of, or @c NULL for any.
+ * @param[in] typec: number of members of @p types.
+ * @param[in] y: y coordinate of the point.
+ * @param[in] x: x coordinate of the point.
+ * @param[in] radius: size of the rectangle and radius of the circle.
+ * @param[out] indices: room for an index per object of @p walk_layer.
+ * @param[out] expected: room for an index per object of @p walk_layer.
+ */
+void
+test_qwalk_query_check(const QwalkLayer_t *walk_layer, const QobjType_t *types,
+		size_t typec, int y, int x, int radius, int *indices, int *expected) {
+	int y0 = y - radius;
+	int x0 = x - radius;
+	int y1 = y + radius * 2;
+	int x1 = x + radius * 2;
+	int expectedc_rect = 0;
+	int expectedc_radius = 0;
+	int nearest = Q_ERRORCODE_INT_NOTFOUND;
+	int nearest_distance = 0;
+	int indexc;
+	int obj_y;
+	int obj_x;
+	int distance;
+	bool istype;
+
+	/* rectangle first, in ascending order like the query */
+	for (int i = 0; i < walk_layer->size_y * walk_layer->size_x; i++) {
+		obj_y = i / walk_layer->size_x;
+		obj_x = i % walk_layer->size_x;
+		istype = (types == NULL);
+		for (size_t j = 0; j < typec; j++) {
+			istype = istype
+				|| (qwalk_layer_object_type_get(walk_layer, i) == types[j]);
+		}
+		if (istype && (obj_y >= y0) && (obj_y <= y1) && (obj_x >= x0)
+				&& (obj_x <= x1)) {
+			expected[expectedc_rect++] = i;
+		}
+	}
+	if (((indexc = qwalk_layer_rect_query(walk_layer, 0, types, typec, y0, x0,
+						y1, x1, indices)) != expectedc_rect)
+			|| (memcmp(indices, expected,
+					(size_t) indexc * sizeof(*indices)) != 0)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	for (int i = 0; i < walk_layer->size_y * walk_layer->size_x; i++) {
+		obj_y = i / walk_layer->size_x;
+		obj_x = i % walk_layer->size_x;
+		distance = qutils_distance_calculate(y, x, obj_y, obj_x);
+		istype = (types == NULL);
+		for (size_t j = 0; j < typec; j++) {
+			istype = istype
+				|| (qwalk_layer_object_type_get(walk_layer, i) == types[j]);
+		}
+		if (istype && (distance <= radius)) {
+			expected[expectedc_radius++] = i;
+			if ((nearest == Q_ERRORCODE_INT_NOTFOUND)
+					|| (distance < nearest_distance)) {
+				nearest = i;
+				nearest_distance = distance;
+			}
+		}
+	}
+	if (((indexc = qwalk_layer_radius_query(walk_layer, 0, types, typec, y, x,
+						radius, indices)) != expectedc_radius)
+			|| (memcmp(indices, expected,
+					(size_t) indexc * sizeof(*indices)) != 0)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	/* a single type, the lowest index winning ties */
+	if ((typec == (size_t) 1) && (qwalk_layer_nearest_get(walk_layer, types[0],
+					y, x, radius) != nearest)) {
+		Q_ERRORFOUND(QERROR_ERRORVAL);
+		abort();
+	}
+
+	return;
+}